@@ -0,0 +1,424 @@
+/**
+ * @file bench.cpp
+ * @brief Benchmark de la biblioteca contra el emulador del SIM7080G
+ *
+ * @details Cada escenario corre en un proceso propio (la biblioteca guarda
+ * su estado en variables globales) con el reloj virtual desde cero. El
+ * bucle principal hace lo mismo que el sketch: modemPoll() y espera hasta
+ * modemPollTimeout() o hasta el próximo byte del módem, pero la espera solo
+ * avanza el reloj virtual, así una hora simulada corre en milisegundos.
+ *
+ * Escenarios:
+ * - boot: arranque completo hasta MODEM_STATE_READY y hasta que el
+ *   servidor recibe el primer byte.
+ * - latency: mensajes de a uno; del encolado al callback.
+ * - backlog: la cola siempre llena, sin ventana y con ventana de 4096
+ *   bytes; throughput y CPU del host por byte.
+ * - reconnect: cortes del socket 0; del corte al callback siguiente.
+ * - pdpdown: el contexto PDP cae durante toda la escalada; la prueba
+ *   semiabierta tras el enfriamiento debe reactivarlo.
+ */
+
+#include "Arduino.h"
+#include "emulator.h"
+#include "gsmlte.h"
+#include "gsmlte_stats.h"
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BENCH_TIMEOUT_US (600ULL * 1000000)   ///< Tope de tiempo virtual por fase
+#define BENCH_BUSY_STEP_US 50                 ///< Avance cuando modemPollTimeout() es 0
+#define BENCH_SEND_TIMEOUT 10000
+
+/** CA de prueba para --tls: el emulador solo cuenta los bytes subidos */
+static const char benchCaPem[] =
+    "-----BEGIN CERTIFICATE-----\n"
+    "MIIBszCCAVmgAwIBAgIUbenchbenchbenchbenchbenchbenchwCgYIKoZIzj0EAwIw\n"
+    "-----END CERTIFICATE-----\n";
+
+struct BenchOptions {
+  EmulatorConfig emulator;
+  unsigned long baud = 0;             ///< 0 = la velocidad por defecto de la biblioteca
+  const char* transcript = NULL;
+  unsigned messages = 50;
+  size_t size = 128;
+  size_t window = 4096;
+  bool tls = false;
+  bool dns = false;
+  bool csv = false;
+  bool verbose = false;
+  std::string only;
+};
+
+static BenchOptions benchOptions;
+static uint64_t benchFirstPayloadUs = 0;
+static uint32_t benchDone = 0;
+static uint32_t benchFailed = 0;
+static uint64_t benchLastDoneUs = 0;
+
+static void benchReport(const char* scenario, const char* metric, double value, const char* unit) {
+  if (benchOptions.csv) {
+    printf("%s,%s,%.3f,%s\n", scenario, metric, value, unit);
+  } else {
+    printf("  %-10s %-22s %12.3f %s\n", scenario, metric, value, unit);
+  }
+}
+
+static void benchOnPayload(int id, const uint8_t* data, size_t len, uint64_t atUs) {
+  (void)id;
+  (void)data;
+  (void)len;
+  if (benchFirstPayloadUs == 0) benchFirstPayloadUs = atUs;
+}
+
+static void benchOnSent(bool success, void* ctx) {
+  (void)ctx;
+  benchDone++;
+  if (!success) benchFailed++;
+  benchLastDoneUs = hostMicros();
+}
+
+static void benchLogSink(const uint8_t* data, size_t len, void* ctx) {
+  (void)ctx;
+  fwrite(data, 1, len, stderr);
+}
+
+/**
+ * Corre el bucle principal hasta que done() sea cierto
+ * @details done() se evalúa tras cada modemPoll(), antes de calcular la
+ * espera, así puede encolar trabajo nuevo como lo haría un callback
+ * @return false si se agotó BENCH_TIMEOUT_US
+ */
+static bool benchRun(const std::function<bool()>& done) {
+  uint64_t limit = hostMicros() + BENCH_TIMEOUT_US;
+  for (;;) {
+    modemPoll();
+    if (done()) return true;
+    if (hostMicros() >= limit) return false;
+
+    uint64_t now = hostMicros();
+    unsigned long wait = modemPollTimeout();
+    uint64_t until = wait == 0 ? now + BENCH_BUSY_STEP_US : now + (uint64_t)wait * 1000;
+    hostAdvanceTo(std::min(until, hostNextEvent()));
+  }
+}
+
+static double benchCpuSeconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string benchMessage(unsigned n) {
+  char prefix[24];
+  snprintf(prefix, sizeof(prefix), "BENCH_%06u_", n);
+  std::string m(prefix);
+  m.resize(std::max(benchOptions.size, m.size()), 'x');
+  return m;
+}
+
+static bool benchSubmit(unsigned n) {
+  std::string m = benchMessage(n);
+  return tcpSendPersistentAsync(m.c_str(), m.size(), BENCH_SEND_TIMEOUT, benchOnSent, NULL);
+}
+
+/**
+ * Prepara el emulador y la biblioteca y arranca el módem
+ * @return false si el arranque no llegó a MODEM_STATE_READY
+ */
+static bool benchBoot(const char* scenario, size_t window) {
+  emulatorBegin(benchOptions.emulator);
+  emulatorSetPayloadHandler(benchOnPayload);
+  if (benchOptions.transcript != NULL && !emulatorLoadTranscript(benchOptions.transcript)) {
+    fprintf(stderr, "No se pudo cargar %s\n", benchOptions.transcript);
+    return false;
+  }
+  if (benchOptions.verbose) Serial.hostConnect(benchLogSink, NULL);
+
+  if (benchOptions.baud != 0) modemUartConfigure(benchOptions.baud, false);
+  tcpConfigurePersistent(30000);
+  tcpSendWindowConfigure(window);
+  if (benchOptions.tls) tcpTlsConfigure(true, benchCaPem, NULL, NULL);
+  if (benchOptions.dns) tcpResolverConfigure(true, 0);
+  setupModemAsync();
+
+  if (!benchRun([] { return !modemIsStarting(); }) || modemGetState() != MODEM_STATE_READY) {
+    benchReport(scenario, "boot_failed_state", modemGetState(), "");
+    return false;
+  }
+  return true;
+}
+
+static int benchScenarioBoot() {
+  if (!benchBoot("boot", 0)) return 1;
+  uint64_t readyUs = hostMicros();
+
+  benchSubmit(0);
+  if (!benchRun([] { return benchFirstPayloadUs != 0; })) return 1;
+
+  benchReport("boot", "ready", readyUs / 1000.0, "ms");
+  benchReport("boot", "first_byte", benchFirstPayloadUs / 1000.0, "ms");
+  benchReport("boot", "at_commands", emulatorStats().commands, "");
+  if (benchOptions.tls) benchReport("boot", "tls_files", emulatorStats().filesWritten, "");
+  return 0;
+}
+
+static int benchScenarioLatency() {
+  if (!benchBoot("latency", 0)) return 1;
+
+  std::vector<double> samples;
+  for (unsigned i = 0; i < benchOptions.messages; ++i) {
+    uint64_t start = hostMicros();
+    uint32_t target = benchDone + 1;
+    if (!benchSubmit(i) || !benchRun([target] { return benchDone >= target; })) return 1;
+    samples.push_back((benchLastDoneUs - start) / 1000.0);
+  }
+
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (size_t i = 0; i < samples.size(); ++i) sum += samples[i];
+  size_t p95 = (samples.size() * 95 + 99) / 100;
+
+  benchReport("latency", "min", samples.front(), "ms");
+  benchReport("latency", "avg", sum / samples.size(), "ms");
+  benchReport("latency", "p95", samples[p95 > 0 ? p95 - 1 : 0], "ms");
+  benchReport("latency", "max", samples.back(), "ms");
+  benchReport("latency", "failed", benchFailed, "");
+  return 0;
+}
+
+static int benchScenarioBacklog(const char* scenario, size_t window) {
+  if (!benchBoot(scenario, window)) return 1;
+
+  EmulatorStats before = emulatorStats();
+  unsigned submitted = 0;
+  uint64_t start = hostMicros();
+  double cpuStart = benchCpuSeconds();
+
+  bool ok = benchRun([&submitted] {
+    while (submitted < benchOptions.messages && benchSubmit(submitted)) submitted++;
+    return benchDone >= benchOptions.messages;
+  });
+  if (!ok) return 1;
+
+  double cpu = benchCpuSeconds() - cpuStart;
+  double seconds = (benchLastDoneUs - start) / 1e6;
+  double bytes = (double)benchOptions.messages * benchOptions.size;
+  EmulatorStats after = emulatorStats();
+
+  benchReport(scenario, "throughput", bytes / seconds, "B/s");
+  benchReport(scenario, "messages", benchOptions.messages / seconds, "msg/s");
+  benchReport(scenario, "at_per_message",
+              (double)(after.commands - before.commands) / benchOptions.messages, "");
+  benchReport(scenario, "host_cpu_per_byte", cpu * 1e9 / bytes, "ns");
+  MemPoolStats atQueue;
+  MemPoolStats tcpTx;
+  memPoolGet(MEM_POOL_AT_QUEUE, atQueue);
+  memPoolGet(MEM_POOL_TCP_TX, tcpTx);
+  benchReport(scenario, "at_queue_peak", atQueue.peak, "B");
+  benchReport(scenario, "tcp_tx_peak", tcpTx.peak, "B");
+  benchReport(scenario, "failed", benchFailed, "");
+  return 0;
+}
+
+/**
+ * Cortes del socket 0 desde la red: mide del corte hasta que el mensaje
+ * enviado justo después recibe su callback (incluye la espera de reconexión)
+ */
+static int benchScenarioReconnect() {
+  if (!benchBoot("reconnect", 0)) return 1;
+  if (benchOptions.dns && !benchRun([] { return tcpResolverAddress() != NULL; })) return 1;
+
+  unsigned drops = benchOptions.messages < 10 ? benchOptions.messages : 10;
+  uint32_t lookups = emulatorStats().dnsLookups;
+  double sum = 0;
+  double worst = 0;
+  for (unsigned i = 0; i < drops; ++i) {
+    emulatorDropSocket(0);
+    uint64_t start = hostMicros();
+    uint32_t target = benchDone + 1;
+    if (!benchSubmit(i) || !benchRun([target] { return benchDone >= target; })) return 1;
+    double ms = (benchLastDoneUs - start) / 1000.0;
+    sum += ms;
+    worst = std::max(worst, ms);
+  }
+
+  benchReport("reconnect", "avg", sum / drops, "ms");
+  benchReport("reconnect", "max", worst, "ms");
+  benchReport("reconnect", "dns_lookups", emulatorStats().dnsLookups - lookups, "");
+  benchReport("reconnect", "failed", benchFailed, "");
+  return 0;
+}
+
+/**
+ * Corte del contexto PDP que dura toda la escalada: el circuito se abre y,
+ * ya restablecida la red, la prueba semiabierta debe reactivar el PDP.
+ * Mide del fin del corte a la reconexión y el nivel al que llegó la prueba.
+ */
+static int benchScenarioPdpDown() {
+  if (!benchBoot("pdpdown", 0)) return 1;
+  // Puerto cambiado en tiempo de ejecución: debe sobrevivir a la escalada PWRKEY
+  snprintf(modemConfig.serverPort, sizeof(modemConfig.serverPort), "12608");
+
+  uint64_t start = hostMicros();
+  emulatorPdpOutage(true);
+  if (!benchRun([] { return tcpBreakerState() == TCP_BREAKER_OPEN; })) return 1;
+  double tripMs = (hostMicros() - start) / 1000.0;
+
+  emulatorPdpOutage(false);
+  uint64_t restored = hostMicros();
+  TcpRecoverStage probe = TCP_RECOVER_SOCKET;
+  if (!benchRun([&probe] {
+        if (tcpBreakerState() == TCP_BREAKER_HALF_OPEN && tcpRecoverStage() > probe) {
+          probe = tcpRecoverStage();
+        }
+        return tcpConnected && tcpBreakerState() == TCP_BREAKER_CLOSED;
+      })) {
+    return 1;
+  }
+  double recoverMs = (hostMicros() - restored) / 1000.0;
+  if (strcmp(modemConfig.serverPort, "12608") != 0) {
+    benchReport("pdpdown", "config_kept", 0, "");
+    return 1;
+  }
+
+  uint32_t target = benchDone + 1;
+  if (!benchSubmit(0) || !benchRun([target] { return benchDone >= target; })) return 1;
+
+  benchReport("pdpdown", "until_trip", tripMs, "ms");
+  benchReport("pdpdown", "recover", recoverMs, "ms");
+  benchReport("pdpdown", "probe_stage", probe, "");
+  benchReport("pdpdown", "trips", modemStatsLink().breakerTrips, "");
+  benchReport("pdpdown", "failed", benchFailed, "");
+  return 0;
+}
+
+static int benchScenario(const std::string& name) {
+  if (name == "boot") return benchScenarioBoot();
+  if (name == "latency") return benchScenarioLatency();
+  if (name == "backlog") return benchScenarioBacklog("backlog", 0);
+  if (name == "window") return benchScenarioBacklog("window", benchOptions.window);
+  if (name == "reconnect") return benchScenarioReconnect();
+  if (name == "pdpdown") return benchScenarioPdpDown();
+  return 1;
+}
+
+static void benchUsage(const char* program) {
+  fprintf(stderr,
+          "Uso: %s [opciones] [escenario]\n"
+          "  escenarios: boot latency backlog window reconnect pdpdown (todos si no se indica)\n"
+          "  --baud N        velocidad a negociar con +IPR\n"
+          "  --latency MS    latencia del módem (20)\n"
+          "  --jitter MS     variación ± de la latencia (0)\n"
+          "  --errors P      fracción de comandos con ERROR (0)\n"
+          "  --ack MS        demora de confirmación del servidor (300)\n"
+          "  --attach MS     de +CNACT=0,1 al contexto PDP activo (1500)\n"
+          "  --seed N        semilla (1)\n"
+          "  --transcript F  respuestas grabadas\n"
+          "  --messages N    mensajes por escenario (50)\n"
+          "  --size N        bytes por mensaje (128)\n"
+          "  --window N      ventana del escenario window (4096)\n"
+          "  --tls           conexión persistente con TLS del módem\n"
+          "  --handshake MS  duración del handshake TLS en +CAOPEN (1500)\n"
+          "  --dns           resolver el servidor con +CDNSGIP y conectar por IP\n"
+          "  --dns-latency MS  consulta DNS por aire (800)\n"
+          "  --csv           salida escenario,métrica,valor,unidad\n"
+          "  -v              registro de la biblioteca y comandos en stderr\n",
+          program);
+}
+
+static bool benchParse(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--csv") {
+      benchOptions.csv = true;
+    } else if (arg == "--tls") {
+      benchOptions.tls = true;
+    } else if (arg == "--dns") {
+      benchOptions.dns = true;
+    } else if (arg == "-v") {
+      benchOptions.verbose = true;
+      benchOptions.emulator.trace = true;
+    } else if (arg[0] != '-') {
+      benchOptions.only = arg;
+    } else if (!hasValue) {
+      return false;
+    } else if (arg == "--baud") {
+      benchOptions.baud = strtoul(argv[++i], NULL, 10);
+    } else if (arg == "--latency") {
+      benchOptions.emulator.latencyUs = (uint32_t)(atof(argv[++i]) * 1000);
+    } else if (arg == "--jitter") {
+      benchOptions.emulator.jitterUs = (uint32_t)(atof(argv[++i]) * 1000);
+    } else if (arg == "--errors") {
+      benchOptions.emulator.errorRate = atof(argv[++i]);
+    } else if (arg == "--attach") {
+      benchOptions.emulator.attachMs = (uint32_t)atol(argv[++i]);
+    } else if (arg == "--ack") {
+      benchOptions.emulator.ackDelayMs = (uint32_t)atol(argv[++i]);
+    } else if (arg == "--seed") {
+      benchOptions.emulator.seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (arg == "--transcript") {
+      benchOptions.transcript = argv[++i];
+    } else if (arg == "--messages") {
+      benchOptions.messages = (unsigned)atol(argv[++i]);
+    } else if (arg == "--size") {
+      benchOptions.size = (size_t)atol(argv[++i]);
+    } else if (arg == "--window") {
+      benchOptions.window = (size_t)atol(argv[++i]);
+    } else if (arg == "--dns-latency") {
+      benchOptions.emulator.dnsLatencyMs = (uint32_t)atol(argv[++i]);
+    } else if (arg == "--handshake") {
+      benchOptions.emulator.tlsHandshakeMs = (uint32_t)atol(argv[++i]);
+    } else {
+      return false;
+    }
+  }
+  return benchOptions.messages > 0 && benchOptions.size > 0 && benchOptions.size <= TCP_CASEND_MAX - 2;
+}
+
+static const char* const benchScenarios[] = {"boot", "latency", "backlog", "window", "reconnect",
+                                            "pdpdown"};
+#define BENCH_SCENARIOS (sizeof(benchScenarios) / sizeof(benchScenarios[0]))
+
+static bool benchKnown(const std::string& name) {
+  for (size_t i = 0; i < BENCH_SCENARIOS; ++i) {
+    if (name == benchScenarios[i]) return true;
+  }
+  return false;
+}
+
+int main(int argc, char** argv) {
+  if (!benchParse(argc, argv) || (!benchOptions.only.empty() && !benchKnown(benchOptions.only))) {
+    benchUsage(argv[0]);
+    return 2;
+  }
+
+  if (benchOptions.csv) printf("scenario,metric,value,unit\n");
+
+  int failures = 0;
+  for (size_t i = 0; i < BENCH_SCENARIOS; ++i) {
+    if (!benchOptions.only.empty() && benchOptions.only != benchScenarios[i]) continue;
+
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+      srand(benchOptions.emulator.seed);
+      int status = benchScenario(benchScenarios[i]);
+      fflush(stdout);
+      _exit(status);
+    }
+
+    int status = 1;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "Escenario %s falló\n", benchScenarios[i]);
+      failures++;
+    }
+  }
+  return failures > 0 ? 1 : 0;
+}
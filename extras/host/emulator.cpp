@@ -0,0 +1,558 @@
+/**
+ * @file emulator.cpp
+ * @brief Implementación del emulador del SIM7080G
+ *
+ * @details Lo que escribe la biblioteca llega a emulatorOnTx() byte a byte;
+ * al completarse una línea se elige la respuesta (transcript, error
+ * inyectado o comportamiento integrado) y se encola con su instante de
+ * salida. La cola se entrega con el temporizador del host, de modo que cada
+ * respuesta empieza a llegar exactamente a su hora y después de la
+ * anterior, como en un UART real.
+ */
+
+#include "emulator.h"
+#include "Arduino.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#define EMU_SOCKETS 4
+#define EMU_RAW_FILE -2
+#define EMU_SERVER_ADDRESS "203.0.113.10"   ///< Respuesta de +CDNSGIP
+#define EMU_PWRKEY_PIN 9
+#define EMU_TX_TOTAL_BASE 5000    ///< Bytes enviados por la red antes del arranque
+
+struct EmuRule {
+  std::string command;
+  std::vector<std::string> lines;
+  long latencyMs = -1;
+};
+
+struct EmuPending {
+  uint64_t at;
+  uint64_t seq;
+  unsigned long baud;       ///< Velocidad del módem al generar la respuesta
+  std::string data;
+};
+
+struct EmuUnacked {
+  uint64_t at;
+  size_t len;
+};
+
+static EmulatorConfig emuConfig;
+static EmulatorStats emuCounters;
+static std::mt19937 emuRandom;
+static EmulatorPayloadHandler emuPayloadHandler = NULL;
+
+static std::vector<EmuPending> emuQueue;   ///< Montículo por instante de salida
+static uint64_t emuSeq = 0;
+static uint64_t emuLastOut = 0;
+
+static std::map<std::string, std::deque<EmuRule>> emuRules;
+static std::string emuLine;
+static unsigned long emuBaud = 115200;
+static unsigned long emuSavedBaud = 115200;
+
+static int emuRawSocket = -1;            ///< Destino de los bytes crudos (EMU_RAW_FILE = +CFSWFILE)
+static size_t emuRawLeft = 0;
+static std::string emuRaw;
+
+static bool emuOpen[EMU_SOCKETS];
+static bool emuSsl[EMU_SOCKETS];          ///< +CASSLCFG=<id>,"SSL",1 desde el último reinicio
+static size_t emuTxTotal[EMU_SOCKETS];
+static std::deque<EmuUnacked> emuUnacked[EMU_SOCKETS];
+static uint64_t emuPdpAt = 0;              ///< Instante en que el contexto queda activo (0 = sin pedir)
+static bool emuCeregUrc = false;           ///< +CEREG=2: el registro se informa como URC
+static bool emuPdpOutage = false;          ///< La red rechaza +CNACT=0,1 (emulatorPdpOutage())
+
+static uint8_t emuPwrKeyLevel = LOW;
+static long emuRuleLatencyMs = -1;        ///< Latencia de la regla sin respuesta en curso
+
+static bool emuLater(const EmuPending& a, const EmuPending& b) {
+  return a.at != b.at ? a.at > b.at : a.seq > b.seq;
+}
+
+static void emuDeliver();
+
+static void emuArm() {
+  hostSetTimer(emuQueue.empty() ? UINT64_MAX : emuQueue.front().at,
+               emuQueue.empty() ? NULL : emuDeliver);
+}
+
+static void emuEnqueue(uint64_t at, const std::string& data) {
+  emuQueue.push_back(EmuPending{at, emuSeq++, emuBaud, data});
+  std::push_heap(emuQueue.begin(), emuQueue.end(), emuLater);
+  emuArm();
+}
+
+/**
+ * Entrega lo que ya venció; si las velocidades no coinciden la biblioteca
+ * solo vería basura, así que no recibe nada
+ */
+static void emuDeliver() {
+  uint64_t now = hostMicros();
+  while (!emuQueue.empty() && emuQueue.front().at <= now) {
+    std::pop_heap(emuQueue.begin(), emuQueue.end(), emuLater);
+    EmuPending p = emuQueue.back();
+    emuQueue.pop_back();
+    if (Serial1.baudRate() == p.baud) Serial1.hostInject(p.data, now);
+  }
+  emuArm();
+}
+
+static uint64_t emuLatencyUs(long ruleLatencyMs) {
+  int64_t latency = ruleLatencyMs >= 0 ? (int64_t)ruleLatencyMs * 1000 : emuConfig.latencyUs;
+  if (emuConfig.jitterUs > 0) {
+    std::uniform_int_distribution<int64_t> jitter(-(int64_t)emuConfig.jitterUs, emuConfig.jitterUs);
+    latency += jitter(emuRandom);
+  }
+  return latency > 0 ? (uint64_t)latency : 0;
+}
+
+/**
+ * Encola una respuesta tras la latencia, sin adelantar a la anterior
+ */
+static void emuReply(const std::string& data, long ruleLatencyMs = -1) {
+  if (ruleLatencyMs < 0) ruleLatencyMs = emuRuleLatencyMs;
+  uint64_t at = std::max(Serial1.hostTxDoneAt(), hostMicros()) + emuLatencyUs(ruleLatencyMs);
+  at = std::max(at, emuLastOut);
+  emuLastOut = at;
+  emuEnqueue(at, data);
+}
+
+static bool emuStartsWith(const std::string& s, const char* prefix) {
+  return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+/**
+ * Indica si el campo entre comillas que empieza en s es una dirección IP
+ */
+static bool emuIsAddress(const char* s) {
+  for (; *s != '"' && *s != '\0'; ++s) {
+    if ((*s < '0' || *s > '9') && *s != '.' && *s != ':') return false;
+  }
+  return true;
+}
+
+static int emuSocketArg(const std::string& cmd, size_t pos) {
+  int id = atoi(cmd.c_str() + pos);
+  return id >= 0 && id < EMU_SOCKETS ? id : -1;
+}
+
+/**
+ * Bytes sin confirmar de un socket; los que cumplieron ackDelayMs se confirman
+ */
+static size_t emuUnackedBytes(int id) {
+  uint64_t now = hostMicros();
+  std::deque<EmuUnacked>& q = emuUnacked[id];
+  while (!q.empty() && now - q.front().at >= (uint64_t)emuConfig.ackDelayMs * 1000) q.pop_front();
+
+  size_t n = 0;
+  for (size_t i = 0; i < q.size(); ++i) n += q[i].len;
+  return n;
+}
+
+/**
+ * Busca la regla del transcript con el prefijo más largo que coincide
+ */
+static EmuRule* emuMatchRule(const std::string& cmd) {
+  std::map<std::string, std::deque<EmuRule>>::iterator best = emuRules.end();
+  for (std::map<std::string, std::deque<EmuRule>>::iterator it = emuRules.begin();
+       it != emuRules.end(); ++it) {
+    if (!emuStartsWith(cmd, it->first.c_str())) continue;
+    if (best == emuRules.end() || it->first.size() > best->first.size()) best = it;
+  }
+  if (best == emuRules.end()) return NULL;
+  return &best->second.front();
+}
+
+static void emuConsumeRule(const std::string& prefix) {
+  std::deque<EmuRule>& rules = emuRules[prefix];
+  if (rules.size() > 1) rules.pop_front();
+}
+
+/**
+ * Indica si el contexto PDP 0 ya está activo
+ */
+static bool emuPdpActive() {
+  return emuPdpAt != 0 && hostMicros() >= emuPdpAt;
+}
+
+/**
+ * Desactiva el contexto PDP 0: la red cierra los sockets abiertos
+ */
+static void emuPdpDeactivate() {
+  if (emuPdpAt == 0) return;
+  emuPdpAt = 0;
+  for (int i = 0; i < EMU_SOCKETS; ++i) {
+    if (!emuOpen[i]) continue;
+    emuOpen[i] = false;
+    emuEnqueue(hostMicros(), "\r\n+CASTATE: " + std::to_string(i) + ",0\r\n");
+  }
+  emuEnqueue(hostMicros(), "\r\n+APP PDP: 0,DEACTIVE\r\n");
+}
+
+/**
+ * Comportamiento integrado del módem
+ */
+static void emuBuiltin(const std::string& cmd) {
+  if (emuStartsWith(cmd, "AT+CASEND=")) {
+    int id = emuSocketArg(cmd, 10);
+    size_t comma = cmd.find(',');
+    if (id < 0 || !emuOpen[id] || comma == std::string::npos) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    emuRawSocket = id;
+    emuRawLeft = (size_t)atoi(cmd.c_str() + comma + 1);
+    emuRaw.clear();
+    emuReply("\r\n>");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CFSWFILE=")) {
+    // AT+CFSWFILE=<dir>,"<nombre>",<modo>,<tamaño>,<tiempo>
+    size_t comma = cmd.find(',', cmd.find(',', cmd.find(',') + 1) + 1);
+    size_t len = comma != std::string::npos ? (size_t)atoi(cmd.c_str() + comma + 1) : 0;
+    if (len == 0) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    emuRawSocket = EMU_RAW_FILE;
+    emuRawLeft = len;
+    emuRaw.clear();
+    emuReply("\r\nDOWNLOAD\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CASSLCFG=")) {
+    int id = emuSocketArg(cmd, 12);
+    if (id < 0) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    if (cmd.find(",\"SSL\",") != std::string::npos) emuSsl[id] = cmd[cmd.size() - 1] == '1';
+    emuReply("\r\nOK\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CDNSGIP=")) {
+    // OK inmediato y el resultado como URC cuando termina la consulta
+    size_t open = cmd.find('"');
+    size_t close = open != std::string::npos ? cmd.find('"', open + 1) : std::string::npos;
+    if (close == std::string::npos) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    emuCounters.dnsLookups++;
+    emuReply("\r\nOK\r\n");
+    emuEnqueue(Serial1.hostTxDoneAt() + (uint64_t)emuConfig.dnsLatencyMs * 1000,
+               "\r\n+CDNSGIP: 1," + cmd.substr(open, close - open + 1) +
+               ",\"" EMU_SERVER_ADDRESS "\"\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CARECV=")) {
+    emuReply("\r\n+CARECV: 0\r\n\r\nOK\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CAACK=")) {
+    int id = emuSocketArg(cmd, 9);
+    if (id < 0) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    emuReply("\r\n+CAACK: " + std::to_string(emuTxTotal[id]) + "," +
+             std::to_string(emuUnackedBytes(id)) + "\r\n\r\nOK\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CAOPEN=")) {
+    int id = emuSocketArg(cmd, 10);
+    if (id < 0) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    if (!emuPdpActive()) {
+      emuReply("\r\n+CAOPEN: " + std::to_string(id) + ",1\r\n\r\nOK\r\n");
+      return;
+    }
+    emuOpen[id] = true;
+    emuTxTotal[id] = EMU_TX_TOTAL_BASE;
+    emuUnacked[id].clear();
+    long latencyMs = emuRuleLatencyMs;
+    if (latencyMs < 0) latencyMs = emuConfig.latencyUs / 1000;
+    size_t host = cmd.find(",\"", cmd.find("\"TCP\"") + 5);
+    if (host != std::string::npos && !emuIsAddress(cmd.c_str() + host + 2)) {
+      latencyMs += emuConfig.dnsLatencyMs;
+      emuCounters.dnsLookups++;
+    }
+    if (emuSsl[id]) {
+      // El handshake TLS se suma a la latencia del comando
+      latencyMs += emuConfig.tlsHandshakeMs;
+      emuCounters.handshakes++;
+    }
+    emuReply("\r\n+CAOPEN: " + std::to_string(id) + ",0\r\n\r\nOK\r\n", latencyMs);
+    return;
+  }
+  if (cmd == "AT+CASTATE?") {
+    std::string r = "\r\n";
+    for (int i = 0; i < EMU_SOCKETS; ++i) {
+      if (emuOpen[i]) r += "+CASTATE: " + std::to_string(i) + ",1\r\n";
+    }
+    emuReply(r + "\r\nOK\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+CACLOSE=")) {
+    int id = emuSocketArg(cmd, 11);
+    bool wasOpen = id >= 0 && emuOpen[id];
+    if (id >= 0) emuOpen[id] = false;
+    emuReply(wasOpen ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+    return;
+  }
+  if (emuStartsWith(cmd, "AT+IPR=")) {
+    emuReply("\r\nOK\r\n");
+    emuBaud = strtoul(cmd.c_str() + 7, NULL, 10);
+    return;
+  }
+  if (cmd == "AT&W") emuSavedBaud = emuBaud;
+  if (emuStartsWith(cmd, "AT+CPOWD=")) {
+    for (int i = 0; i < EMU_SOCKETS; ++i) emuOpen[i] = emuSsl[i] = false;
+    emuPdpAt = 0;
+    emuCeregUrc = false;
+    emuReply("\r\nNORMAL POWER DOWN\r\n");
+    return;
+  }
+
+  if (cmd == "AT+CCID") {
+    emuReply("\r\n89521020123456789012\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CGSN") {
+    emuReply("\r\n861234567890123\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+COPS?") {
+    emuReply("\r\n+COPS: 0,0,\"TELCEL\",9\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CPSI?") {
+    emuReply("\r\n+CPSI: LTE CAT-M1,Online,334-020,0x1A2B,27551836,301,EUTRAN-BAND4,2175,"
+             "5,5,-11,-95,-65,14\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CSQ") {
+    emuReply("\r\n+CSQ: 18,99\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CPIN?") {
+    emuReply("\r\n+CPIN: READY\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CFUN?") {
+    emuReply("\r\n+CFUN: 1\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CEREG?") {
+    emuReply("\r\n+CEREG: 0,1\r\n\r\nOK\r\n");
+  } else if (cmd == "AT+CNACT=0,1") {
+    if (emuPdpOutage) {
+      emuReply("\r\nERROR\r\n");
+      return;
+    }
+    emuReply("\r\nOK\r\n");
+    if (emuPdpAt == 0) {
+      emuPdpAt = Serial1.hostTxDoneAt() + (uint64_t)emuConfig.attachMs * 1000;
+      if (emuCeregUrc) {
+        emuEnqueue(emuPdpAt - (uint64_t)emuConfig.attachMs * 500, "\r\n+CEREG: 1,\"1A2B\",\"01A46B1C\",9\r\n");
+      }
+      emuEnqueue(emuPdpAt, "\r\n+APP PDP: 0,ACTIVE\r\n");
+    }
+  } else if (emuStartsWith(cmd, "AT+CEREG=")) {
+    emuCeregUrc = atoi(cmd.c_str() + 9) > 0;
+    emuReply("\r\nOK\r\n");
+  } else if (cmd == "AT+CNACT=0,0" || cmd == "AT+CFUN=0") {
+    emuPdpDeactivate();
+    emuReply("\r\nOK\r\n");
+  } else if (cmd == "AT+CNACT?") {
+    emuReply(emuPdpActive() ? "\r\n+CNACT: 0,1,\"10.0.0.2\"\r\n+CNACT: 1,0,\"0.0.0.0\"\r\n\r\nOK\r\n"
+                    : "\r\n+CNACT: 0,0,\"0.0.0.0\"\r\n\r\nOK\r\n");
+  } else {
+    emuReply("\r\nOK\r\n");
+  }
+}
+
+static void emuHandle(const std::string& cmd) {
+  if (emuConfig.trace) {
+    fprintf(stderr, "[emu %8.3f] %s\n", hostMicros() / 1e6, cmd.c_str());
+  }
+  emuCounters.commands++;
+
+  EmuRule* rule = emuMatchRule(cmd);
+  if (rule != NULL && rule->lines.empty()) {
+    // Solo cambia la latencia: responde el comportamiento integrado
+    emuRuleLatencyMs = rule->latencyMs;
+    emuConsumeRule(rule->command);
+    emuBuiltin(cmd);
+    emuRuleLatencyMs = -1;
+    return;
+  }
+  if (rule != NULL) {
+    std::string r;
+    for (size_t i = 0; i < rule->lines.size(); ++i) r += "\r\n" + rule->lines[i] + "\r\n";
+    emuReply(r, rule->latencyMs);
+    emuConsumeRule(rule->command);
+    return;
+  }
+
+  std::bernoulli_distribution fail(emuConfig.errorRate);
+  if (cmd != "AT" && emuConfig.errorRate > 0 && fail(emuRandom)) {
+    emuCounters.errorsInjected++;
+    emuReply("\r\nERROR\r\n");
+    return;
+  }
+
+  emuBuiltin(cmd);
+}
+
+static void emuOnPayload() {
+  int id = emuRawSocket;
+  emuRawSocket = -1;
+  if (id == EMU_RAW_FILE) {
+    emuCounters.filesWritten++;
+    emuReply("\r\nOK\r\n");
+    return;
+  }
+  emuCounters.casends++;
+  emuCounters.payloadBytes += emuRaw.size();
+
+  emuTxTotal[id] += emuRaw.size();
+  emuUnacked[id].push_back(EmuUnacked{Serial1.hostTxDoneAt(), emuRaw.size()});
+  if (emuPayloadHandler != NULL) {
+    emuPayloadHandler(id, (const uint8_t*)emuRaw.data(), emuRaw.size(), Serial1.hostTxDoneAt());
+  }
+  emuReply("\r\nOK\r\n");
+}
+
+static void emuOnTx(const uint8_t* data, size_t len, void* ctx) {
+  (void)ctx;
+  if (Serial1.baudRate() != emuBaud) {
+    emuCounters.garbled += len;
+    emuLine.clear();
+    return;
+  }
+
+  for (size_t i = 0; i < len; ++i) {
+    char c = (char)data[i];
+    if (emuRawLeft > 0) {
+      emuRaw += c;
+      if (--emuRawLeft == 0) emuOnPayload();
+      continue;
+    }
+    if (c == '\r') continue;
+    if (c == '\n') {
+      if (!emuLine.empty()) emuHandle(emuLine);
+      emuLine.clear();
+      continue;
+    }
+    emuLine += c;
+  }
+}
+
+/**
+ * Pulso de PWRKEY (alto y luego bajo): el módem reinicia a la velocidad
+ * guardada con &W y vuelve a registrarse
+ */
+static void emuOnPin(uint8_t pin, uint8_t value) {
+  if (pin != EMU_PWRKEY_PIN) return;
+
+  if (emuPwrKeyLevel == HIGH && value == LOW) {
+    emuBaud = emuSavedBaud;
+    emuPdpAt = 0;
+    emuCeregUrc = false;
+    for (int i = 0; i < EMU_SOCKETS; ++i) emuOpen[i] = emuSsl[i] = false;
+  }
+  emuPwrKeyLevel = value;
+}
+
+void emulatorBegin(const EmulatorConfig& config) {
+  emuConfig = config;
+  emuCounters = EmulatorStats();
+  emuRandom.seed(config.seed);
+  emuBaud = emuSavedBaud = config.baud;
+  Serial1.hostConnect(emuOnTx, NULL);
+  hostOnPinWrite(emuOnPin);
+}
+
+/**
+ * Quita espacios al inicio y al final
+ */
+static std::string emuTrim(const std::string& s) {
+  size_t a = s.find_first_not_of(" \t\r\n");
+  if (a == std::string::npos) return std::string();
+  return s.substr(a, s.find_last_not_of(" \t\r\n") - a + 1);
+}
+
+bool emulatorLoadTranscript(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL) return false;
+
+  char buffer[512];
+  EmuRule* current = NULL;
+  bool ok = true;
+  unsigned lineNumber = 0;
+
+  while (fgets(buffer, sizeof(buffer), f) != NULL) {
+    lineNumber++;
+    std::string line = emuTrim(buffer);
+    if (line.empty() || line[0] == '#') continue;
+
+    std::string arg = emuTrim(line.substr(1));
+    switch (line[0]) {
+      case '>': {
+        std::deque<EmuRule>& rules = emuRules[arg];
+        rules.push_back(EmuRule());
+        current = &rules.back();
+        current->command = arg;
+        break;
+      }
+      case '<':
+        if (current == NULL) ok = false;
+        else current->lines.push_back(arg);
+        break;
+      case '@':
+        if (current == NULL) ok = false;
+        else current->latencyMs = atol(arg.c_str());
+        break;
+      case '~': {
+        size_t space = arg.find(' ');
+        if (space == std::string::npos) {
+          ok = false;
+          break;
+        }
+        emuEnqueue((uint64_t)atol(arg.c_str()) * 1000, "\r\n" + emuTrim(arg.substr(space)) + "\r\n");
+        emuCounters.urcs++;
+        break;
+      }
+      default:
+        ok = false;
+        break;
+    }
+    if (!ok) {
+      fprintf(stderr, "%s:%u: línea inválida\n", path, lineNumber);
+      break;
+    }
+  }
+
+  fclose(f);
+  return ok;
+}
+
+void emulatorSetPayloadHandler(EmulatorPayloadHandler handler) {
+  emuPayloadHandler = handler;
+}
+
+void emulatorUrc(const char* line, uint32_t delayMs) {
+  emuEnqueue(hostMicros() + (uint64_t)delayMs * 1000, std::string("\r\n") + line + "\r\n");
+  emuCounters.urcs++;
+}
+
+void emulatorDropSocket(int id) {
+  if (id < 0 || id >= EMU_SOCKETS || !emuOpen[id]) return;
+  emuOpen[id] = false;
+  emuEnqueue(hostMicros(), "\r\n+CASTATE: " + std::to_string(id) + ",0\r\n");
+}
+
+void emulatorPdpOutage(bool active) {
+  emuPdpOutage = active;
+  if (active) emuPdpDeactivate();
+}
+
+EmulatorStats emulatorStats() {
+  return emuCounters;
+}
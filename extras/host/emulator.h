@@ -0,0 +1,126 @@
+/**
+ * @file emulator.h
+ * @brief Emulador del SIM7080G conectado a Serial1 del host
+ * @version 3.0
+ *
+ * @details Responde a los comandos AT que usa la biblioteca con el
+ * comportamiento del módem real: prompt '>' y bytes crudos de +CASEND,
+ * +CAOPEN/+CASTATE/+CACLOSE, +CAACK con confirmación diferida, +IPR/&W,
+ * +CFSWFILE con su prompt DOWNLOAD, el handshake de los sockets con
+ * +CASSLCFG "SSL", +CDNSGIP (y la consulta DNS de un +CAOPEN por nombre), el
+ * registro tras +CNACT=0,1 (URC +CEREG si se activó con +CEREG=2 y
+ * "+APP PDP: 0,ACTIVE"; +CNACT=0,0 y +CFUN=0 lo desactivan y sin contexto
+ * +CAOPEN falla) y el reinicio por PWRKEY. Cada respuesta sale cuando termina de transmitirse el
+ * comando más la latencia configurada (± jitter), a la velocidad del UART;
+ * con errorRate una fracción de los comandos responde ERROR.
+ *
+ * Un transcript reemplaza o completa el comportamiento integrado. Formato
+ * (una directiva por línea, '#' comenta):
+ *
+ *   > AT+CSQ            comando (coincide por prefijo)
+ *   < +CSQ: 9,99        líneas de respuesta, en orden
+ *   < OK
+ *   @ 800               latencia de esta regla en ms (opcional)
+ *   ~ 45000 +CASTATE: 0,0   URC a los 45000 ms del inicio
+ *
+ * Las reglas de un mismo comando se consumen en orden y la última se
+ * repite. Una regla sin líneas '<' solo cambia la latencia y deja responder
+ * al comportamiento integrado (así se demora el prompt de +CASEND); con
+ * líneas, responde en su lugar.
+ *
+ * @example
+ * @code
+ * EmulatorConfig config;
+ * config.latencyUs = 60000;
+ * emulatorBegin(config);
+ * emulatorLoadTranscript("transcripts/weak_signal.txt");
+ * setupModemAsync();
+ * @endcode
+ */
+
+#ifndef HOST_EMULATOR_H
+#define HOST_EMULATOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @struct EmulatorConfig
+ * @brief Parámetros del emulador
+ */
+struct EmulatorConfig {
+  uint32_t latencyUs = 20000;       ///< Del fin del comando al inicio de la respuesta
+  uint32_t jitterUs = 0;            ///< Variación uniforme ± de la latencia
+  double errorRate = 0.0;           ///< Fracción de comandos que responden ERROR
+  uint32_t seed = 1;                ///< Semilla de jitter y errores
+  unsigned long baud = 115200;      ///< Velocidad guardada del módem (&W)
+  uint32_t ackDelayMs = 300;        ///< Tiempo hasta que el servidor confirma los bytes
+  uint32_t attachMs = 1500;         ///< De +CNACT=0,1 a "+APP PDP: 0,ACTIVE" (registro a la mitad)
+  uint32_t tlsHandshakeMs = 1500;   ///< Demora extra de +CAOPEN en un socket con SSL
+  uint32_t dnsLatencyMs = 800;      ///< Consulta DNS por aire (+CDNSGIP o +CAOPEN por nombre)
+  bool trace = false;               ///< Imprime cada comando en stderr
+};
+
+/**
+ * @struct EmulatorStats
+ * @brief Contadores del emulador
+ */
+struct EmulatorStats {
+  uint32_t commands;        ///< Comandos AT recibidos
+  uint32_t casends;         ///< +CASEND completados
+  uint32_t payloadBytes;    ///< Bytes de datos aceptados
+  uint32_t errorsInjected;  ///< Respuestas ERROR por errorRate
+  uint32_t urcs;            ///< URC programadas
+  uint32_t garbled;         ///< Bytes descartados por velocidad distinta
+  uint32_t filesWritten;    ///< Archivos recibidos con +CFSWFILE
+  uint32_t handshakes;      ///< +CAOPEN con handshake TLS
+  uint32_t dnsLookups;      ///< Consultas DNS (+CDNSGIP o +CAOPEN por nombre)
+};
+
+/**
+ * @brief Función llamada al aceptar los datos de un +CASEND
+ * @param atUs Instante en que llegó el último byte de los datos
+ */
+typedef void (*EmulatorPayloadHandler)(int id, const uint8_t* data, size_t len, uint64_t atUs);
+
+/**
+ * @brief Conecta el emulador a Serial1 y al pin PWRKEY
+ */
+void emulatorBegin(const EmulatorConfig& config);
+
+/**
+ * @brief Carga un transcript
+ * @return false si no se pudo leer o tiene una línea inválida
+ */
+bool emulatorLoadTranscript(const char* path);
+
+/**
+ * @brief Registra la función que recibe los datos enviados al servidor
+ */
+void emulatorSetPayloadHandler(EmulatorPayloadHandler handler);
+
+/**
+ * @brief Programa una URC para dentro de delayMs
+ */
+void emulatorUrc(const char* line, uint32_t delayMs);
+
+/**
+ * @brief Cierra un socket desde el lado de la red (+CASTATE: id,0)
+ */
+void emulatorDropSocket(int id);
+
+/**
+ * @brief Corte del contexto PDP desde la red
+ * @details Con active en true desactiva el contexto (+APP PDP: 0,DEACTIVE y
+ * +CASTATE: id,0 de cada socket) y +CNACT=0,1 responde ERROR. Al terminar el
+ * corte el contexto sigue inactivo hasta el próximo +CNACT=0,1; mientras
+ * tanto +CAOPEN falla.
+ */
+void emulatorPdpOutage(bool active);
+
+/**
+ * @brief Obtiene los contadores
+ */
+EmulatorStats emulatorStats();
+
+#endif
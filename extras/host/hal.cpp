@@ -0,0 +1,621 @@
+/**
+ * @file hal.cpp
+ * @brief Reloj virtual, UART, NVS, LittleFS, heap y FreeRTOS del host
+ *
+ * @details Todo corre en un solo hilo. El reloj solo avanza cuando la
+ * biblioteca espera (delay(), vTaskDelay(), ulTaskNotifyTake()) o cuando el
+ * benchmark llama a hostAdvanceTo(); cada lectura de millis()/micros() suma
+ * HAL_CLOCK_READ_US para que los bucles de espera activa terminen. Al
+ * cruzar el temporizador del emulador se lo atiende con el reloj en su
+ * instante exacto, así las respuestas salen con la latencia programada.
+ */
+
+#include "Arduino.h"
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "TinyGsmClient.h"
+#include "WiFi.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <algorithm>
+#include <map>
+#include <new>
+#include <vector>
+
+#define HAL_CLOCK_READ_US 1
+#define HAL_UART_FIFO_THRESHOLD 120       ///< Bytes de FIFO que disparan la entrega al driver
+#define HAL_UART_RX_TIMEOUT_SYMBOLS 2     ///< Silencio que cierra una ráfaga (setRxTimeout)
+
+static uint64_t halNow = 0;
+static uint64_t halTimerAt = UINT64_MAX;
+static void (*halTimer)() = NULL;
+static void (*halPinHandler)(uint8_t, uint8_t) = NULL;
+static uint32_t halNotifications = 0;
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+LittleFSFS LittleFS;
+WiFiClass WiFi;
+
+// ---------------------------------------------------------------------------
+// Reloj
+// ---------------------------------------------------------------------------
+
+void hostSetTimer(uint64_t atUs, void (*handler)()) {
+  halTimerAt = handler != NULL ? atUs : UINT64_MAX;
+  halTimer = handler;
+}
+
+void hostAdvanceTo(uint64_t us) {
+  while (halTimer != NULL && halTimerAt <= us) {
+    if (halTimerAt > halNow) halNow = halTimerAt;
+    void (*handler)() = halTimer;
+    halTimer = NULL;
+    halTimerAt = UINT64_MAX;
+    handler();
+  }
+  if (us > halNow) halNow = us;
+}
+
+void hostAdvance(uint64_t us) {
+  hostAdvanceTo(halNow + us);
+}
+
+uint64_t hostMicros() {
+  return halNow;
+}
+
+uint64_t hostNextEvent() {
+  uint64_t next = halTimerAt;
+  next = std::min(next, Serial1.hostNextArrival());
+  next = std::min(next, Serial.hostNextArrival());
+  return next;
+}
+
+unsigned long millis() {
+  hostAdvance(HAL_CLOCK_READ_US);
+  return (unsigned long)(halNow / 1000);
+}
+
+unsigned long micros() {
+  hostAdvance(HAL_CLOCK_READ_US);
+  return (unsigned long)halNow;
+}
+
+void delay(unsigned long ms) {
+  hostAdvance((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvance(us);
+}
+
+void yield() {
+  hostAdvance(10);
+}
+
+// ---------------------------------------------------------------------------
+// Pines y números aleatorios
+// ---------------------------------------------------------------------------
+
+void hostOnPinWrite(void (*handler)(uint8_t pin, uint8_t value)) {
+  halPinHandler = handler;
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (halPinHandler != NULL) halPinHandler(pin, value);
+}
+
+int digitalRead(uint8_t pin) {
+  (void)pin;
+  return LOW;
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+  srand((unsigned)seed);
+}
+
+// ---------------------------------------------------------------------------
+// Stream y HardwareSerial
+// ---------------------------------------------------------------------------
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t n = 0;
+  unsigned long start = millis();
+  while (n < length && millis() - start < timeout) {
+    if (available() > 0) {
+      buffer[n++] = (char)read();
+    } else {
+      delay(1);
+    }
+  }
+  return n;
+}
+
+String Stream::readString() {
+  String result;
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    if (available() > 0) {
+      result += (char)read();
+      start = millis();
+    } else {
+      delay(1);
+    }
+  }
+  return result;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String result;
+  unsigned long start = millis();
+  while (millis() - start < timeout) {
+    if (available() > 0) {
+      char c = (char)read();
+      if (c == terminator) break;
+      result += c;
+    } else {
+      delay(1);
+    }
+  }
+  return result;
+}
+
+/**
+ * Microsegundos que tarda un byte (inicio, 8 datos, parada)
+ */
+static uint64_t halByteUs(unsigned long baud) {
+  return baud > 0 ? 10000000ULL / baud : 0;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+  (void)config;
+  (void)rxPin;
+  (void)txPin;
+  this->baud = baud;
+}
+
+size_t HardwareSerial::arrived() const {
+  size_t n = 0;
+  while (n < rx.size() && rx[n].at <= halNow) n++;
+  return n;
+}
+
+int HardwareSerial::available() {
+  hostAdvance(HAL_CLOCK_READ_US);
+  return (int)arrived();
+}
+
+int HardwareSerial::read() {
+  if (available() == 0) return -1;
+  uint8_t value = rx.front().value;
+  rx.pop_front();
+  return value;
+}
+
+int HardwareSerial::peek() {
+  return available() > 0 ? rx.front().value : -1;
+}
+
+size_t HardwareSerial::read(uint8_t* buffer, size_t size) {
+  size_t n = std::min(size, (size_t)available());
+  for (size_t i = 0; i < n; ++i) {
+    buffer[i] = rx.front().value;
+    rx.pop_front();
+  }
+  return n;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  txFreeAt = std::max(txFreeAt, halNow) + halByteUs(baud) * size;
+  if (sink != NULL) sink(buffer, size, sinkCtx);
+  return size;
+}
+
+void HardwareSerial::flush() {
+  hostAdvanceTo(txFreeAt);
+}
+
+uint64_t HardwareSerial::hostInject(const uint8_t* data, size_t len, uint64_t startUs) {
+  uint64_t t = std::max(startUs, lineFreeAt);
+  uint64_t step = halByteUs(baud);
+  uint64_t last = t + step * len;
+
+  // El driver entrega la FIFO al llenarse o tras el silencio de fin de ráfaga
+  for (size_t i = 0; i < len; ++i) {
+    size_t chunkEnd = (i / HAL_UART_FIFO_THRESHOLD + 1) * HAL_UART_FIFO_THRESHOLD;
+    uint64_t visible = chunkEnd < len ? t + step * chunkEnd
+                                      : last + step * HAL_UART_RX_TIMEOUT_SYMBOLS;
+    if (rx.size() >= rxCapacity) {
+      overruns++;
+      continue;
+    }
+    rx.push_back(RxByte{visible, data[i]});
+  }
+  lineFreeAt = last;
+  if (len > 0 && receiveCallback) receiveCallback();
+  return last;
+}
+
+uint64_t HardwareSerial::hostNextArrival() const {
+  size_t n = arrived();
+  return n < rx.size() ? rx[n].at : UINT64_MAX;
+}
+
+bool TinyGsm::testAT(uint32_t timeoutMs) {
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    sendAT();
+    std::string response;
+    unsigned long sent = millis();
+    while (millis() - sent < 200) {
+      int c = stream.read();
+      if (c < 0) {
+        delay(1);
+        continue;
+      }
+      response += (char)c;
+      if (response.find("OK\r\n") != std::string::npos) return true;
+    }
+  }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+// Preferences (NVS)
+// ---------------------------------------------------------------------------
+
+static std::map<std::string, uint32_t> halNvs;
+static std::map<std::string, std::string> halNvsText;
+
+void hostPreferencesClear() {
+  halNvs.clear();
+  halNvsText.clear();
+}
+
+bool Preferences::begin(const char* name, bool readOnly) {
+  ns = name;
+  this->readOnly = readOnly;
+  return true;
+}
+
+bool Preferences::clear() {
+  if (readOnly) return false;
+  std::string prefix = ns + "/";
+  for (std::map<std::string, uint32_t>::iterator it = halNvs.begin(); it != halNvs.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      halNvs.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  for (std::map<std::string, std::string>::iterator it = halNvsText.begin(); it != halNvsText.end();) {
+    if (it->first.compare(0, prefix.size(), prefix) == 0) {
+      halNvsText.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return true;
+}
+
+bool Preferences::remove(const char* key) {
+  if (readOnly) return false;
+  return halNvs.erase(fullKey(key)) + halNvsText.erase(fullKey(key)) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+  return halNvs.count(fullKey(key)) > 0 || halNvsText.count(fullKey(key)) > 0;
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue) {
+  std::map<std::string, uint32_t>::const_iterator it = halNvs.find(fullKey(key));
+  return it != halNvs.end() ? it->second : defaultValue;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value) {
+  if (readOnly) return 0;
+  halNvs[fullKey(key)] = value;
+  return 4;
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+  std::map<std::string, std::string>::const_iterator it = halNvsText.find(fullKey(key));
+  if (it == halNvsText.end() || it->second.size() + 1 > maxLen) return 0;
+  memcpy(value, it->second.c_str(), it->second.size() + 1);
+  return it->second.size() + 1;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+  if (readOnly) return 0;
+  halNvsText[fullKey(key)] = value;
+  return strlen(value);
+}
+
+// ---------------------------------------------------------------------------
+// LittleFS
+// ---------------------------------------------------------------------------
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+  if (data == nullptr) return 0;
+  if (position > data->size()) position = data->size();
+  size_t overlap = std::min(size, data->size() - position);
+  std::copy(buffer, buffer + overlap, data->begin() + position);
+  data->insert(data->end(), buffer + overlap, buffer + size);
+  position += size;
+  return size;
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+  if (data == nullptr || position >= data->size()) return 0;
+  size_t n = std::min(size, data->size() - position);
+  std::copy(data->begin() + position, data->begin() + position + n, buffer);
+  position += n;
+  return n;
+}
+
+bool File::seek(uint32_t position) {
+  if (data == nullptr || position > data->size()) return false;
+  this->position = position;
+  return true;
+}
+
+File File::openNextFile() {
+  while (!entries.empty()) {
+    std::string next = entries.front();
+    entries.erase(entries.begin());
+    File f = LittleFS.open(next.c_str(), "r");
+    if (f) return f;
+  }
+  return File();
+}
+
+File LittleFSFS::open(const char* path, const char* mode) {
+  File f;
+  f.path = path;
+
+  if (dirs.count(path) > 0) {
+    std::string prefix = std::string(path) + "/";
+    for (std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>::const_iterator it =
+             files.begin(); it != files.end(); ++it) {
+      if (it->first.compare(0, prefix.size(), prefix) == 0) f.entries.push_back(it->first);
+    }
+    f.isDir = true;
+    return f;
+  }
+
+  std::string m = mode;
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>::iterator it = files.find(path);
+  if (m == "r") {
+    if (it == files.end()) return File();
+    f.data = it->second;
+    return f;
+  }
+
+  if (it == files.end() || m == "w") {
+    files[path] = std::make_shared<std::vector<uint8_t>>();
+  }
+  f.data = files[path];
+  f.position = m == "a" ? f.data->size() : 0;
+  return f;
+}
+
+size_t LittleFSFS::usedBytes() const {
+  size_t used = 0;
+  for (std::map<std::string, std::shared_ptr<std::vector<uint8_t>>>::const_iterator it =
+           files.begin(); it != files.end(); ++it) {
+    used += it->second->size();
+  }
+  return used;
+}
+
+// ---------------------------------------------------------------------------
+// Heap: new y delete llevan la cuenta para heap_caps_get_info()
+// ---------------------------------------------------------------------------
+
+struct HalHeapHeader {
+  size_t size;
+  size_t pad;                             ///< Mantiene la alineación de 16 bytes
+};
+
+static size_t halHeapUsed = 0;
+static size_t halHeapBlocks = 0;
+static size_t halHeapMinFree = HOST_HEAP_SIZE;
+
+static size_t halHeapFree() {
+  return halHeapUsed < HOST_HEAP_SIZE ? HOST_HEAP_SIZE - halHeapUsed : 0;
+}
+
+// Fuera de línea: expandidos dentro de hal.cpp, GCC ve free() sobre un puntero de new
+__attribute__((noinline)) void* operator new(size_t size) {
+  HalHeapHeader* h = static_cast<HalHeapHeader*>(malloc(sizeof(HalHeapHeader) + size));
+  if (h == NULL) throw std::bad_alloc();
+  h->size = size;
+  halHeapUsed += size;
+  halHeapBlocks++;
+  halHeapMinFree = std::min(halHeapMinFree, halHeapFree());
+  return h + 1;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+__attribute__((noinline)) void operator delete(void* ptr) noexcept {
+  if (ptr == NULL) return;
+  HalHeapHeader* h = static_cast<HalHeapHeader*>(ptr) - 1;
+  halHeapUsed -= h->size;
+  halHeapBlocks--;
+  free(h);
+}
+
+void operator delete[](void* ptr) noexcept {
+  operator delete(ptr);
+}
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps) {
+  (void)caps;
+  info->total_free_bytes = halHeapFree();
+  info->total_allocated_bytes = halHeapUsed;
+  info->largest_free_block = halHeapFree();
+  info->minimum_free_bytes = halHeapMinFree;
+  info->allocated_blocks = halHeapBlocks;
+  info->free_blocks = 1;
+  info->total_blocks = halHeapBlocks + 1;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+  (void)caps;
+  return HOST_HEAP_SIZE;
+}
+
+// ---------------------------------------------------------------------------
+// FreeRTOS
+// ---------------------------------------------------------------------------
+
+struct HostQueue {
+  size_t itemSize;
+  size_t capacity;
+  std::deque<std::vector<uint8_t>> items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue* q = new HostQueue();
+  q->itemSize = itemSize;
+  q->capacity = length;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+  (void)ticks;
+  if (queue->items.size() >= queue->capacity) return pdFALSE;
+  const uint8_t* bytes = static_cast<const uint8_t*>(item);
+  queue->items.push_back(std::vector<uint8_t>(bytes, bytes + queue->itemSize));
+  return pdTRUE;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticks) {
+  (void)ticks;
+  if (queue->items.empty()) return pdFALSE;
+  if (queue->itemSize > 0) memcpy(item, queue->items.front().data(), queue->itemSize);
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+  if (xQueuePeek(queue, item, ticks) != pdTRUE) return pdFALSE;
+  queue->items.pop_front();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  return (UBaseType_t)queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  return (UBaseType_t)(queue->capacity - queue->items.size());
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage,
+                                 StaticQueue_t* state) {
+  (void)storage;
+  (void)state;
+  return xQueueCreate(length, itemSize);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return xQueueCreate(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t ticks) {
+  (void)mutex;
+  (void)ticks;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+  (void)mutex;
+  return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+  (void)task;
+  (void)name;
+  (void)stack;
+  (void)arg;
+  (void)priority;
+  (void)core;
+  if (handle != NULL) *handle = NULL;
+  return pdFALSE;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task, const char* name, uint32_t stack,
+                                           void* arg, UBaseType_t priority, StackType_t* stackBuffer,
+                                           StaticTask_t* state, BaseType_t core) {
+  (void)task;
+  (void)name;
+  (void)stack;
+  (void)arg;
+  (void)priority;
+  (void)stackBuffer;
+  (void)state;
+  (void)core;
+  return NULL;
+}
+
+void vTaskDelay(TickType_t ticks) {
+  delay(ticks);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  (void)task;
+}
+
+TickType_t xTaskGetTickCount() {
+  return (TickType_t)millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+  return &halNotifications;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  (void)task;
+  return 0;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) {
+  uint64_t until = ticks == portMAX_DELAY ? UINT64_MAX : halNow + (uint64_t)ticks * 1000;
+  while (halNotifications == 0) {
+    uint64_t next = std::min(until, hostNextEvent());
+    if (next == UINT64_MAX || next <= halNow) break;
+    hostAdvanceTo(next);
+    if (next == until || Serial1.available() > 0 || Serial.available() > 0) break;
+  }
+
+  uint32_t count = halNotifications;
+  halNotifications = clear ? 0 : (count > 0 ? count - 1 : 0);
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  (void)task;
+  halNotifications++;
+  return pdTRUE;
+}
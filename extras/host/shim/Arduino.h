@@ -0,0 +1,294 @@
+/**
+ * @file Arduino.h
+ * @brief Núcleo Arduino mínimo para compilar la biblioteca en el host
+ * @version 3.0
+ *
+ * @details Solo lo que usan gsmlte*.cpp: tiempo virtual (millis(), micros(),
+ * delay()), pines, String, Print/Stream y HardwareSerial. El reloj es
+ * virtual y lo avanzan delay(), hostAdvance() y, muy poco, cada lectura del
+ * reloj (así las esperas activas de la biblioteca siempre terminan).
+ *
+ * HardwareSerial modela el UART: los bytes recibidos llevan la marca de
+ * tiempo en que terminan de llegar según la velocidad configurada y, como
+ * el driver del ESP32, se vuelven visibles de a 120 (umbral de la FIFO) o
+ * al cerrarse la ráfaga; available() solo cuenta los visibles. Lo escrito se entrega al
+ * receptor conectado con hostConnect() (el emulador del módem).
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define SERIAL_8N1 0x800001c
+#define UART_HW_FLOWCTRL_CTS_RTS 3
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+/**
+ * @brief Tiempo virtual en microsegundos desde el inicio
+ */
+uint64_t hostMicros();
+
+/**
+ * @brief Avanza el reloj virtual
+ */
+void hostAdvance(uint64_t us);
+
+/**
+ * @brief Función llamada al cambiar un pin (PWRKEY del emulador)
+ */
+void hostOnPinWrite(void (*handler)(uint8_t pin, uint8_t value));
+
+/**
+ * @brief Programa la función que se llama cuando el reloj alcanza atUs
+ * @details Un solo temporizador (lo usa el emulador para sus respuestas y
+ * URC); se llama con el reloj ya en atUs y puede volver a programarse
+ */
+void hostSetTimer(uint64_t atUs, void (*handler)());
+
+/**
+ * @brief Instante del próximo evento: temporizador o byte por llegar
+ * @return UINT64_MAX si no hay ninguno
+ */
+uint64_t hostNextEvent();
+
+/**
+ * @brief Avanza el reloj hasta un instante, atendiendo los eventos intermedios
+ */
+void hostAdvanceTo(uint64_t us);
+
+class String {
+ public:
+  String() {}
+  String(const char* c) : s(c != NULL ? c : "") {}
+  String(const std::string& x) : s(x) {}
+  String(char c) : s(1, c) {}
+  String(int v) : s(std::to_string(v)) {}
+  String(unsigned int v) : s(std::to_string(v)) {}
+  String(long v) : s(std::to_string(v)) {}
+  String(unsigned long v) : s(std::to_string(v)) {}
+  String(double v, int decimals = 2) {
+    char b[32];
+    snprintf(b, sizeof(b), "%.*f", decimals, v);
+    s = b;
+  }
+
+  unsigned int length() const { return (unsigned int)s.size(); }
+  const char* c_str() const { return s.c_str(); }
+  bool reserve(unsigned int n) { s.reserve(n); return true; }
+  char operator[](unsigned int i) const { return i < s.size() ? s[i] : 0; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+
+  String& operator+=(const String& o) { s += o.s; return *this; }
+  String& operator+=(const char* o) { s += o; return *this; }
+  String& operator+=(char c) { s += c; return *this; }
+  String& operator+=(int v) { s += std::to_string(v); return *this; }
+  String& operator+=(unsigned long v) { s += std::to_string(v); return *this; }
+  bool concat(const char* o, unsigned int n) { s.append(o, n); return true; }
+  bool concat(char c) { s += c; return true; }
+
+  bool operator==(const String& o) const { return s == o.s; }
+  bool operator==(const char* o) const { return s == o; }
+  bool operator!=(const String& o) const { return s != o.s; }
+  bool operator!=(const char* o) const { return s != o; }
+
+  int indexOf(const String& t, unsigned int from = 0) const { return pos(s.find(t.s, from)); }
+  int indexOf(const char* t, unsigned int from = 0) const { return pos(s.find(t, from)); }
+  int indexOf(char c, unsigned int from = 0) const { return pos(s.find(c, from)); }
+  String substring(unsigned int from) const { return from >= s.size() ? String() : String(s.substr(from)); }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    return from >= s.size() ? String() : String(s.substr(from, to - from));
+  }
+  void remove(unsigned int i) { if (i < s.size()) s.erase(i); }
+  void remove(unsigned int i, unsigned int n) { if (i < s.size()) s.erase(i, n); }
+  bool startsWith(const String& p) const { return s.compare(0, p.s.size(), p.s) == 0; }
+  bool endsWith(const String& p) const {
+    return s.size() >= p.s.size() && s.compare(s.size() - p.s.size(), p.s.size(), p.s) == 0;
+  }
+  void trim() {
+    size_t a = s.find_first_not_of(" \t\r\n");
+    if (a == std::string::npos) { s.clear(); return; }
+    s = s.substr(a, s.find_last_not_of(" \t\r\n") - a + 1);
+  }
+  long toInt() const { return atol(s.c_str()); }
+  void toUpperCase() { for (size_t i = 0; i < s.size(); ++i) s[i] = (char)toupper(s[i]); }
+  void replace(const String& from, const String& to) {
+    if (from.s.empty()) return;
+    for (size_t p = 0; (p = s.find(from.s, p)) != std::string::npos; p += to.s.size()) {
+      s.replace(p, from.s.size(), to.s);
+    }
+  }
+
+ private:
+  static int pos(size_t p) { return p == std::string::npos ? -1 : (int)p; }
+  std::string s;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size-- > 0) n += write(*buffer++);
+    return n;
+  }
+  size_t write(const char* str) { return write((const uint8_t*)str, strlen(str)); }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char* x) { return write(x); }
+  size_t print(const String& x) { return write(x.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print(String(v)); }
+  size_t print(unsigned int v) { return print(String(v)); }
+  size_t print(long v) { return print(String(v)); }
+  size_t print(unsigned long v) { return print(String(v)); }
+  size_t print(double v, int decimals = 2) { return print(String(v, decimals)); }
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& x) { size_t n = print(x); return n + println(); }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+    char b[512];
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(b, sizeof(b), format, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)b, (size_t)n < sizeof(b) ? (size_t)n : sizeof(b) - 1);
+  }
+};
+
+class Stream : public Print {
+ public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long timeoutMs) { timeout = timeoutMs; }
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readString();
+  String readStringUntil(char terminator);
+
+ protected:
+  unsigned long timeout = 1000;
+};
+
+/**
+ * @brief Receptor de los bytes escritos en un HardwareSerial
+ */
+typedef void (*HostSerialSink)(const uint8_t* data, size_t len, void* ctx);
+
+class HardwareSerial : public Stream {
+ public:
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void end() {}
+  void updateBaudRate(unsigned long baud) { this->baud = baud; }
+  unsigned long baudRate() const { return baud; }
+  size_t setRxBufferSize(size_t size) { rxCapacity = size; return size; }
+  bool setPins(int8_t, int8_t, int8_t = -1, int8_t = -1) { return true; }
+  bool setHwFlowCtrlMode(uint8_t = 0, uint8_t = 64) { return true; }
+  void onReceive(std::function<void()> callback, bool onlyOnTimeout = false) {
+    (void)onlyOnTimeout;
+    receiveCallback = callback;
+  }
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* buffer, size_t size);
+  size_t read(char* buffer, size_t size) { return read((uint8_t*)buffer, size); }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int availableForWrite() override { return 256; }
+  void flush() override;
+  operator bool() const { return true; }
+
+  /**
+   * @brief Conecta el lado de transmisión a un receptor
+   */
+  void hostConnect(HostSerialSink sink, void* ctx) { this->sink = sink; sinkCtx = ctx; }
+
+  /**
+   * @brief Pone bytes en la línea de recepción a partir de un instante
+   * @details Cada byte llega 10 bits después del anterior a la velocidad
+   * actual y se entrega con su bloque de FIFO; los que no caben en el
+   * buffer del driver se pierden
+   * @param startUs Instante en que empieza a llegar el primer byte
+   * @return Instante en que llega el último
+   */
+  uint64_t hostInject(const uint8_t* data, size_t len, uint64_t startUs);
+  uint64_t hostInject(const std::string& data, uint64_t startUs) {
+    return hostInject((const uint8_t*)data.data(), data.size(), startUs);
+  }
+
+  /**
+   * @brief Instante en que termina de salir lo escrito (10 bits por byte)
+   */
+  uint64_t hostTxDoneAt() const { return txFreeAt; }
+
+  /**
+   * @brief Instante del próximo byte aún no llegado (UINT64_MAX si no hay)
+   */
+  uint64_t hostNextArrival() const;
+
+  /**
+   * @brief Bytes perdidos por buffer de recepción lleno
+   */
+  uint32_t hostOverruns() const { return overruns; }
+
+ private:
+  struct RxByte {
+    uint64_t at;
+    uint8_t value;
+  };
+
+  size_t arrived() const;
+
+  unsigned long baud = 115200;
+  size_t rxCapacity = 256;
+  std::deque<RxByte> rx;
+  uint64_t lineFreeAt = 0;
+  uint64_t txFreeAt = 0;
+  uint32_t overruns = 0;
+  HostSerialSink sink = NULL;
+  void* sinkCtx = NULL;
+  std::function<void()> receiveCallback;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
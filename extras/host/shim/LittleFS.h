@@ -0,0 +1,67 @@
+/**
+ * @file LittleFS.h
+ * @brief Sistema de archivos en memoria para el host
+ * @version 3.0
+ *
+ * @details Los archivos son vectores de bytes indexados por ruta completa; un
+ * directorio existe si se creó con mkdir(). Alcanza para gsmlte_store.cpp:
+ * abrir en "r", "w" o "a", leer, escribir, posicionar, listar y borrar.
+ */
+
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+class File {
+ public:
+  File() {}
+
+  explicit operator bool() const { return data != nullptr || isDir; }
+  size_t write(const uint8_t* buffer, size_t size);
+  size_t read(uint8_t* buffer, size_t size);
+  bool seek(uint32_t position);
+  size_t size() const { return data != nullptr ? data->size() : 0; }
+  const char* name() const { return path.c_str(); }
+  void close() { data.reset(); isDir = false; }
+  File openNextFile();
+
+ private:
+  friend class LittleFSFS;
+  std::shared_ptr<std::vector<uint8_t>> data;
+  std::string path;
+  size_t position = 0;
+  bool isDir = false;
+  std::vector<std::string> entries;   ///< Archivos del directorio por listar
+};
+
+class LittleFSFS {
+ public:
+  bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+  File open(const char* path, const char* mode = "r");
+  bool exists(const char* path) const { return files.count(path) > 0 || dirs.count(path) > 0; }
+  bool remove(const char* path) { return files.erase(path) > 0; }
+  bool mkdir(const char* path) { return dirs.insert(path).second; }
+  size_t totalBytes() const { return 1536 * 1024; }
+  size_t usedBytes() const;
+
+  /**
+   * @brief Borra todos los archivos y directorios
+   */
+  void hostFormat() { files.clear(); dirs.clear(); }
+
+ private:
+  friend class File;
+  std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> files;
+  std::set<std::string> dirs;
+};
+
+extern LittleFSFS LittleFS;
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * @file Preferences.h
+ * @brief NVS en memoria para el host
+ * @version 3.0
+ *
+ * @details Los valores duran lo que dura el proceso; hostPreferencesClear()
+ * simula un equipo recién grabado entre escenarios del benchmark.
+ */
+
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <map>
+#include <string>
+
+/**
+ * @brief Borra todos los espacios de nombres
+ */
+void hostPreferencesClear();
+
+class Preferences {
+ public:
+  bool begin(const char* name, bool readOnly = false);
+  void end() {}
+  bool clear();
+  bool remove(const char* key);
+  bool isKey(const char* key);
+  uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+  size_t putUInt(const char* key, uint32_t value);
+  uint8_t getUChar(const char* key, uint8_t defaultValue = 0) { return (uint8_t)getUInt(key, defaultValue); }
+  size_t putUChar(const char* key, uint8_t value) { return putUInt(key, value) ? 1 : 0; }
+  uint16_t getUShort(const char* key, uint16_t defaultValue = 0) { return (uint16_t)getUInt(key, defaultValue); }
+  size_t putUShort(const char* key, uint16_t value) { return putUInt(key, value) ? 2 : 0; }
+  size_t getString(const char* key, char* value, size_t maxLen);
+  size_t putString(const char* key, const char* value);
+
+ private:
+  std::string fullKey(const char* key) const { return ns + "/" + key; }
+  std::string ns;
+  bool readOnly = false;
+};
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * @file TinyGsmClient.h
+ * @brief Lo que la biblioteca usa de TinyGSM: sendAT() y testAT()
+ * @version 3.0
+ */
+
+#ifndef HOST_TINYGSM_CLIENT_H
+#define HOST_TINYGSM_CLIENT_H
+
+#include "Arduino.h"
+
+class TinyGsm {
+ public:
+  explicit TinyGsm(Stream& stream) : stream(stream) {}
+
+  template <typename... Args> void sendAT(Args... args) {
+    stream.print("AT");
+    streamWrite(args...);
+    stream.print("\r\n");
+  }
+
+  /**
+   * @brief Envía "AT" hasta recibir OK o agotar el tiempo
+   */
+  bool testAT(uint32_t timeoutMs = 10000);
+
+ private:
+  void streamWrite() {}
+  template <typename Head, typename... Tail> void streamWrite(Head head, Tail... tail) {
+    stream.print(head);
+    streamWrite(tail...);
+  }
+
+  Stream& stream;
+};
+
+#endif
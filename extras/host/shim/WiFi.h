@@ -0,0 +1,39 @@
+/**
+ * @file WiFi.h
+ * @brief WiFi del host: nunca conecta, así el transporte usa la vía celular
+ * @version 3.0
+ */
+
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+#include <arpa/inet.h>
+
+#define WL_CONNECTED 3
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
+
+class IPAddress {
+ public:
+  operator uint32_t() const { return addr; }
+  uint32_t addr = 0;
+};
+
+class WiFiClass {
+ public:
+  int status() { return WL_DISCONNECTED; }
+  void mode(int) {}
+  void setAutoReconnect(bool) {}
+  void begin(const char*, const char*) {}
+  int hostByName(const char* host, IPAddress& ip) {
+    struct in_addr a;
+    if (inet_aton(host, &a) == 0) return 0;
+    ip.addr = a.s_addr;
+    return 1;
+  }
+};
+
+extern WiFiClass WiFi;
+
+#endif
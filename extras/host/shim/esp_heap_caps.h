@@ -0,0 +1,33 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Información del heap de ESP-IDF en el host
+ * @version 3.0
+ *
+ * @details El heap virtual mide HOST_HEAP_SIZE y solo cuenta las reservas
+ * con new de C++ (incluye las de String): no hay fragmentación, así que el
+ * bloque libre más grande es todo lo libre.
+ */
+
+#ifndef HOST_ESP_HEAP_CAPS_H
+#define HOST_ESP_HEAP_CAPS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define HOST_HEAP_SIZE 327680
+
+typedef struct {
+  size_t total_free_bytes;
+  size_t total_allocated_bytes;
+  size_t largest_free_block;
+  size_t minimum_free_bytes;
+  size_t allocated_blocks;
+  size_t free_blocks;
+  size_t total_blocks;
+} multi_heap_info_t;
+
+void heap_caps_get_info(multi_heap_info_t* info, uint32_t caps);
+size_t heap_caps_get_total_size(uint32_t caps);
+
+#endif
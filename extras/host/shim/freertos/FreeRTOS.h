@@ -0,0 +1,29 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Tipos de FreeRTOS para compilar la biblioteca en el host
+ * @version 3.0
+ *
+ * @details El host corre en una sola tarea: las colas funcionan sin
+ * bloquear, los mutex siempre se obtienen y las tareas nuevas no corren.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define tskNO_AFFINITY 0x7fffffff
+
+#endif
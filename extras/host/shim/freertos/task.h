@@ -0,0 +1,32 @@
+/**
+ * @file task.h
+ * @brief Tareas de FreeRTOS en el host (una sola tarea, la del benchmark)
+ * @version 3.0
+ */
+
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+typedef uint8_t StackType_t;
+typedef struct { void* reserved; } StaticTask_t;
+
+/** No crea la tarea: devuelve pdFALSE y la biblioteca sigue sin ella */
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+/** Tampoco crea la tarea: devuelve NULL */
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task, const char* name, uint32_t stack,
+                                           void* arg, UBaseType_t priority, StackType_t* stackBuffer,
+                                           StaticTask_t* state, BaseType_t core);
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t task);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+#endif
@@ -0,0 +1,17 @@
+/**
+ * @file sockets.h
+ * @brief Sockets BSD del host en lugar de lwIP
+ * @version 3.0
+ */
+
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#endif
@@ -18,29 +18,62 @@
  */
 
 #include "gsmlte.h"
+#include "gsmlte_urc.h"
+#include "gsmlte_match.h"
+#include "gsmlte_stats.h"
+#include "gsmlte_store.h"
+#include "gsmlte_transport.h"
+#include "gsmlte_lz.h"
+#include "gsmlte_power.h"
+#include "gsmlte_info.h"
 #include <TinyGsmClient.h>
+#include <Preferences.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <string.h>
 
 TinyGsm modem(SerialAT);
 ModemConfig modemConfig;
 
 bool modemInitialized = false;
 int consecutiveFailures = 0;
+static int networkRegStatus = -1;
+
+static void atEnginePoll();
+static void modemLifecyclePoll();
+static void tcpPersistentPoll();
+static bool tcpFormatOpenCommand(char* buffer, size_t size);
+static bool copyBounded(char* dst, size_t size, const char* src);
+static void modemEnsureUrcHandlers();
+static void urcFeedIdle(char c);
+struct TcpSocket;
+static size_t tcpRxWriteSpan(TcpSocket* s, uint8_t** span);
+static void tcpRxCommit(TcpSocket* s, size_t len);
+static void tcpMemNote();
+static void tcpBeginReconnect(TcpSocket& s);
+static void tcpAckFail(TcpSocket& s);
+static void tcpTlsInvalidate();
+static int8_t tcpTlsPoll();
+static unsigned long tcpPersistentOpenTimeout();
 
-bool tcpConnected = false;
-unsigned long lastTcpActivity = 0;
 unsigned long tcpKeepAliveInterval = 30000;
-int tcpReconnectAttempts = 0;
 const int MAX_RECONNECT_ATTEMPTS = 3;
 
+#if GSMLTE_STATIC_ALLOC
+char iccidsim0[MODEM_ICCID_MAX] = "";
+#else
 String iccidsim0 = "";
+#endif
 int signalsim0 = 0;
+static bool modemConfigLoaded = false;   ///< initModemConfig() ya llenó modemConfig
 
 void initModemConfig() {
-  modemConfig.serverIP = DB_SERVER_IP;
-  modemConfig.serverPort = TCP_PORT;
-  modemConfig.apn = APN;
-  modemConfig.networkMode = MODEM_NETWORK_MODE;
-  modemConfig.bandMode = CAT_M;
+  modemConfigLoaded = true;
+  copyBounded(modemConfig.serverIP, sizeof(modemConfig.serverIP), DB_SERVER_IP);
+  copyBounded(modemConfig.serverPort, sizeof(modemConfig.serverPort), TCP_PORT);
+  copyBounded(modemConfig.apn, sizeof(modemConfig.apn), APN);
+  modemConfig.networkMode = MODEM_PROFILE_NETWORK_MODE;
+  modemConfig.bandMode = MODEM_PROFILE_BAND_MODE;
   modemConfig.maxRetries = SEND_RETRIES;
   modemConfig.baseTimeout = 5000;  
   modemConfig.enableDebug = true;
@@ -48,7 +81,85 @@ void initModemConfig() {
   logMessage(2, "🔧 Configuración del módem inicializada");
 }
 
-unsigned long getAdaptiveTimeout() {
+/**
+ * Estimador de RTT de una clase de comandos (Jacobson/Karels, RFC 6298)
+ * @details srtt y rttvar se guardan escalados (x8 y x4) para operar con
+ * enteros, como en la pila TCP de BSD
+ */
+struct ModemRttState {
+  uint32_t srtt8;
+  uint32_t rttvar4;
+  uint32_t samples;
+  uint32_t timeouts;
+  uint8_t backoff;
+};
+
+static ModemRttState modemRtt[MODEM_RTT_CLASSES];
+static const uint16_t modemRttFloor[MODEM_RTT_CLASSES] = {
+  RTT_LOCAL_FLOOR, RTT_SOCKET_FLOOR, RTT_NETWORK_FLOOR
+};
+static const uint16_t modemRttCeiling[MODEM_RTT_CLASSES] = {
+  RTT_LOCAL_CEILING, RTT_SOCKET_CEILING, RTT_NETWORK_CEILING
+};
+
+ModemRttClass modemRttClassOf(const char* command) {
+  static const char* const networkPrefixes[] = {
+    "+CNACT", "+CFUN", "+CGATT", "+COPS", "+CDNSGIP"
+  };
+
+  if (strncmp(command, "+CA", 3) == 0) return MODEM_RTT_SOCKET;
+  for (size_t i = 0; i < sizeof(networkPrefixes) / sizeof(networkPrefixes[0]); ++i) {
+    if (strncmp(command, networkPrefixes[i], strlen(networkPrefixes[i])) == 0) {
+      return MODEM_RTT_NETWORK;
+    }
+  }
+  return MODEM_RTT_LOCAL;
+}
+
+/**
+ * Alimenta el estimador con el resultado de un comando
+ * @details Solo las respuestas esperadas son muestras; un timeout duplica
+ * el RTO (hasta RTT_MAX_BACKOFF veces) hasta la siguiente muestra válida
+ */
+static void modemRttSample(ModemRttClass cls, int8_t result, uint32_t latencyUs) {
+  ModemRttState& st = modemRtt[cls];
+
+  if (result == 0) {
+    st.timeouts++;
+    if (st.backoff < RTT_MAX_BACKOFF) st.backoff++;
+    return;
+  }
+  if (result != 1) return;
+
+  uint32_t r = (latencyUs + 999) / 1000;
+  if (st.samples == 0) {
+    st.srtt8 = r << 3;
+    st.rttvar4 = r << 1;
+  } else {
+    int32_t delta = (int32_t)r - (int32_t)(st.srtt8 >> 3);
+    st.srtt8 += delta;
+    if (delta < 0) delta = -delta;
+    st.rttvar4 += delta - (int32_t)(st.rttvar4 >> 2);
+  }
+  st.samples++;
+  st.backoff = 0;
+}
+
+bool modemRttGet(ModemRttClass cls, ModemRttInfo& info) {
+  if (cls >= MODEM_RTT_CLASSES) return false;
+  const ModemRttState& st = modemRtt[cls];
+  info.srtt = st.srtt8 >> 3;
+  info.rttvar = st.rttvar4 >> 2;
+  info.rto = getAdaptiveTimeout(cls);
+  info.samples = st.samples;
+  info.timeouts = st.timeouts;
+  return true;
+}
+
+/**
+ * Timeout antes de tener muestras: según calidad de señal y fallas
+ */
+static unsigned long modemRttInitial() {
   unsigned long baseTimeout = modemConfig.baseTimeout;
   
   if (signalsim0 > 15) {
@@ -69,26 +180,22 @@ unsigned long getAdaptiveTimeout() {
   return baseTimeout;
 }
 
-void logMessage(int level, const String& message) {
-  if (!modemConfig.enableDebug && level > 2) return;
-  if (level > 1 && millis() < 30000) return;
-  
-  String timestamp = String(millis()) + "ms";
-  String levelStr;
+unsigned long getAdaptiveTimeout(ModemRttClass cls) {
+  const ModemRttState& st = modemRtt[cls];
+  unsigned long rto;
 
-  switch (level) {
-    case 0: levelStr = "ERROR"; break;
-    case 1: levelStr = "WARN"; break;
-    case 2: levelStr = "INFO"; break;
-    case 3: levelStr = "DEBUG"; break;
-    default: levelStr = "UNKN"; break;
+  if (st.samples == 0) {
+    rto = modemRttInitial();
+  } else {
+    rto = (st.srtt8 >> 3) + (st.rttvar4 > RTT_GRANULARITY ? st.rttvar4 : RTT_GRANULARITY);
   }
 
-  Serial.println("[" + timestamp + "] " + levelStr + ": " + message);
+  if (rto < modemRttFloor[cls]) rto = modemRttFloor[cls];
+  rto <<= st.backoff;
+  if (rto > modemRttCeiling[cls]) rto = modemRttCeiling[cls];
+  return rto;
 }
 
-
-
 /**
  * @brief Configura e inicializa el módem LTE/GSM completo
  * @details Ejecuta la secuencia completa de inicialización del módem:
@@ -99,40 +206,19 @@ void logMessage(int level, const String& message) {
  * 5. Establece conexión LTE/CAT-M
  * 6. Inicializa conexión TCP persistente
  * 
+ * Versión bloqueante: ejecuta la máquina de estados de setupModemAsync()
+ * hasta que el arranque finaliza.
+ * 
  * @note Esta función debe llamarse una vez durante setup()
  * @warning Asegurar que el hardware esté correctamente conectado
  */
 void setupModem() {
-  logMessage(2, "🚀 Iniciando configuración del módem LTE/GSM");
-
-  initModemConfig();
-
-  SerialMon.begin(115200);
-  SerialAT.begin(UART_BAUD, SERIAL_8N1, PIN_RX, PIN_TX);
-
-  startGsm();
-  getIccid();
+  setupModemAsync();
 
-  if (startLTE() == true) {
-    logMessage(2, "✅ Conexión LTE establecida, iniciando TCP persistente");
-    
-    if (tcpInitPersistent()) {
-      logMessage(2, "✅ Conexión TCP persistente establecida");
-      consecutiveFailures = 0;
-      
-      logMessage(2, "🔗 Conexión TCP persistente mantenida para futuras operaciones");
-    } else {
-      logMessage(1, "⚠️  Fallo estableciendo TCP persistente");
-      consecutiveFailures++;
-    }
-  } else {
-    consecutiveFailures++;
-    logMessage(1, "⚠️  Fallo en conexión LTE (intento " + String(consecutiveFailures) + ")");
+  while (modemIsStarting()) {
+    modemPoll();
+    delay(1);
   }
-
-  modemInitialized = true;
-
-  logMessage(2, "🏁 Configuración del módem completada");
 }
 
 /**
@@ -162,8 +248,14 @@ void modemPwrKeyPulse() {
   SerialAT.println("AT");
   delay(500);
   if (SerialAT.available()) {
-    String response = SerialAT.readString();
-    logMessage(3, "📡 Respuesta inicial: " + response);
+    char response[64];
+    size_t len = 0;
+    while (SerialAT.available()) {
+      char ch = SerialAT.read();
+      if (len < sizeof(response) - 1 && ch != '\r' && ch != '\n') response[len++] = ch;
+    }
+    response[len] = '\0';
+    logMessagef(3, "📡 Respuesta inicial: %s", response);
   }
   
   logMessage(2, "✅ Secuencia PWRKEY completada");
@@ -171,554 +263,3983 @@ void modemPwrKeyPulse() {
 
 /**
  * Diagnóstico completo del estado del módem SIM7080G
+ * @details Solo la prueba AT va al módem; el resto sale del caché
  */
 void diagnosticoModem() {
   logMessage(2, "🔍 === DIAGNÓSTICO DEL MÓDEM SIM7080G ===");
   
   logMessage(2, "📡 Verificando comunicación AT...");
-  if (modem.testAT(3000)) {
+  if (sendATCommand("", "", 3000)) {
     logMessage(2, "✅ Comunicación AT: OK");
   } else {
     logMessage(0, "❌ Comunicación AT: FALLO");
     return;
   }
   
-  String response = "";
-  SerialAT.println("ATI");
-  delay(300);
-  if (SerialAT.available()) {
-    response = SerialAT.readString();
-    logMessage(2, "📋 Info módem: " + response.substring(0, 50));
-  }
-  
-  if (sendATCommand("+CPIN?", "READY", 3000)) {
-    logMessage(2, "✅ SIM Card: READY");
-  } else {
-    logMessage(0, "❌ SIM Card: NO READY");
-  }
-  
-  SerialAT.println("AT+CFUN?");
-  delay(300);
-  if (SerialAT.available()) {
-    response = SerialAT.readString();
-    logMessage(2, "📡 Estado RF: " + response);
-  }
-  
-  SerialAT.println("AT+CREG?");
-  delay(300);
-  if (SerialAT.available()) {
-    response = SerialAT.readString();
-    logMessage(2, "🌐 Registro red: " + response);
-  }
-  
-  SerialAT.println("AT+CSQ");
-  delay(300);
-  if (SerialAT.available()) {
-    response = SerialAT.readString();
-    logMessage(2, "📶 Calidad señal: " + response);
-  }
+  logMessagef(2, "⚙️  Estado del módem: %d, registro de red: %d",
+              (int)modemGetState(), modemRegistrationStatus());
+  logMessagef(2, "🔧 UART del módem: %lu baud", (unsigned long)modemUartBaud());
+
+  // Los campos vencidos quedan pedidos y se actualizan en modemPoll()
+  modemInfo();
+  logMessage(2, "📋 Información en caché:");
+  modemInfoPrint(SerialMon);
   
   logMessage(2, "🔍 === FIN DIAGNÓSTICO ===");
 }
 
+/**
+ * Establece conexión LTE (versión bloqueante sobre startLTEAsync())
+ * @return true si el módem quedó registrado con contexto PDP activo
+ */
 bool startLTE() {
-  logMessage(2, "🌐 Iniciando conexión LTE");
-
-  if (!sendATCommand("+CNMP=" + String(modemConfig.networkMode), "OK", getAdaptiveTimeout())) {
-    logMessage(0, "❌ Fallo configurando modo de red");
-    return false;
-  }
+  startLTEAsync();
 
-  if (!sendATCommand("+CMNB=" + String(modemConfig.bandMode), "OK", getAdaptiveTimeout())) {
-    logMessage(0, "❌ Fallo configurando modo de banda");
-    return false;
+  while (modemIsStarting()) {
+    atEnginePoll();
+    modemLifecyclePoll();
+    logPoll();
+    delay(1);
   }
 
-  if (!sendATCommand("+CBANDCFG=\"CAT-M\",2,4,5", "OK", getAdaptiveTimeout())) {
-    logMessage(1, "⚠️  Fallo configurando bandas CAT-M");
-  }
+  return modemGetState() == MODEM_STATE_READY;
+}
 
-  if (!sendATCommand("+CBANDCFG=\"NB-IOT\"", "OK", getAdaptiveTimeout())) {
-    logMessage(1, "⚠️  Fallo configurando bandas NB-IoT");
-  }
+/**
+ * Abre conexión TCP con reintentos adaptativos
+ * @return true si la conexión se abre exitosamente
+ */
 
-  sendATCommand("+CBANDCFG?", "OK", 2000);
-  delay(SHORT_DELAY);
 
-  String pdpCommand = "+CGDCONT=1,\"IP\",\"" + modemConfig.apn + "\"";
-  if (!sendATCommand(pdpCommand, "OK", 3000)) {
-    logMessage(0, "❌ Fallo configurando contexto PDP");
-    return false;
+/**
+ * Limpia todos los buffers de comunicación serial
+ * @note Las líneas pendientes pasan por el despachador URC antes de descartarse
+ */
+void flushPortSerial() {
+  int bytesCleared = 0;
+  while (SerialAT.available()) {
+    urcFeedIdle(SerialAT.read());
+    bytesCleared++;
   }
 
-  if (!sendATCommand("+CNACT=0,1", "OK", 3000)) {
-    logMessage(0, "❌ Fallo activando contexto PDP");
-    return false;
+  if (bytesCleared > 0 && modemConfig.enableDebug) {
+    logMessagef(3, "🧹 Limpiados %d bytes del buffer serial", bytesCleared);
   }
+}
 
-  unsigned long t0 = millis();
-  unsigned long maxWaitTime = 45000;  // Reducido de 60s a 45s
-
-  while (millis() - t0 < maxWaitTime) {
-    int signalQuality = modem.getSignalQuality();
-    logMessage(3, "📶 Calidad de señal: " + String(signalQuality));
-
-    sendATCommand("+CNACT?", "OK", 2000);
+/**
+ * Analizador incremental de respuestas AT
+ * @details Procesa la respuesta byte a byte sobre un buffer de capacidad fija.
+ * La respuesta esperada (búsqueda KMP) solo se marca: el comando termina con
+ * su código de resultado final (OK/ERROR/+CME ERROR/NORMAL POWER DOWN), así
+ * ningún resto de la respuesta queda en el UART para el comando siguiente.
+ * Los prompts ('>' y DOWNLOAD) no tienen resultado final y deciden al llegar.
+ */
+struct AtResponseScanner {
+  TokenKmp expected;
+  bool matched;                 ///< Ya apareció la respuesta esperada
+  bool prompt;                  ///< Se espera un prompt: decide al coincidir
+  char* body;
+  size_t capacity;
+  size_t length;
+  size_t lineStart;
+  const char* command;
+  bool dataHeader;
+  size_t dataLen;
+};
 
-    if (modem.isNetworkConnected()) {
-      logMessage(2, "✅ Conectado a la red LTE");
-      sendATCommand("+CPSI?", "OK", 2000);
-      flushPortSerial();
-      return true;
-    }
+#define AT_SCAN_DATA 2
 
-    delay(500);  // Reducido de 1000ms a 500ms
-  }
+static const char TCP_RECV_HEADER[] = "+CARECV: ";
 
-  logMessage(0, "❌ Timeout: No se pudo conectar a la red LTE");
-  return false;
+/**
+ * Inicia el análisis de una respuesta
+ * @param sc - Estado del analizador
+ * @param expected - Respuesta esperada (vacía = solo resultado final OK)
+ * @param body - Buffer donde se acumula la respuesta
+ * @param capacity - Capacidad del buffer (incluye terminador NUL)
+ * @param command - Comando en curso (para distinguir respuestas solicitadas de URC)
+ */
+static void atScanBegin(AtResponseScanner& sc, const char* expected, char* body, size_t capacity,
+                        const char* command) {
+  tokenKmpBegin(sc.expected, expected);
+  sc.matched = false;
+  sc.prompt = false;
+  sc.body = body;
+  sc.capacity = capacity;
+  sc.length = 0;
+  sc.lineStart = 0;
+  sc.command = command;
+  sc.dataHeader = false;
+  sc.dataLen = 0;
+  body[0] = '\0';
 }
 
 /**
- * Abre conexión TCP con reintentos adaptativos
- * @return true si la conexión se abre exitosamente
+ * Cambia la respuesta esperada conservando el contenido acumulado
  */
+static void atScanExpect(AtResponseScanner& sc, const char* expected) {
+  tokenKmpBegin(sc.expected, expected);
+  sc.matched = false;
+  sc.prompt = false;
+}
 
+/**
+ * Espera un prompt ('>' o DOWNLOAD) en lugar de una respuesta
+ */
+static void atScanPrompt(AtResponseScanner& sc, const char* prompt) {
+  atScanExpect(sc, prompt);
+  sc.prompt = true;
+}
 
 /**
- * Limpia todos los buffers de comunicación serial
+ * Agrega un byte al buffer; si está lleno descarta las líneas más antiguas
  */
-void flushPortSerial() {
-  int bytesCleared = 0;
-  while (SerialAT.available()) {
-    char c = SerialAT.read();
-    bytesCleared++;
+static void atScanAppend(AtResponseScanner& sc, char c) {
+  if (sc.length + 1 >= sc.capacity) {
+    size_t discard = (sc.lineStart > 0) ? sc.lineStart : sc.length / 2;
+    memmove(sc.body, sc.body + discard, sc.length - discard);
+    sc.length -= discard;
+    sc.lineStart = (sc.lineStart > discard) ? sc.lineStart - discard : 0;
   }
 
-  if (bytesCleared > 0 && modemConfig.enableDebug) {
-    logMessage(3, "🧹 Limpiados " + String(bytesCleared) + " bytes del buffer serial");
-  }
+  sc.body[sc.length++] = c;
+  sc.body[sc.length] = '\0';
 }
 
 /**
- * Lee respuesta del módem con timeout adaptativo
- * @param timeout - Timeout base en milisegundos
- * @return Respuesta del módem como String
+ * Procesa un byte de la respuesta del módem
+ * @param sc - Estado del analizador
+ * @param c - Byte recibido
+ * @return 1=Resultado final tras la respuesta esperada (o prompt recibido),
+ *         -1=Error o resultado final sin coincidencia, 0=Pendiente,
+ *         AT_SCAN_DATA=Siguen dataLen bytes de datos (encabezado "+CARECV: <len>,")
+ * @note Una respuesta esperada que llega después del OK no se ve: el comando
+ * ya terminó con -1. Las que el módem envía después (+APP PDP tras +CNACT,
+ * +CDNSGIP) se esperan como URC, y el comando espera solo "OK".
  */
-String readResponse(unsigned long timeout) {
-  unsigned long start = millis();
-  String response = "";
-  unsigned long adaptiveTimeout = getAdaptiveTimeout();
+static int8_t atScanFeed(AtResponseScanner& sc, char c) {
+  atScanAppend(sc, c);
 
-  unsigned long finalTimeout = (timeout > adaptiveTimeout) ? timeout : adaptiveTimeout;
+  if (tokenKmpFeed(sc.expected, c)) {
+    if (sc.prompt) return 1;
+    sc.matched = true;
+  }
 
-  flushPortSerial();
+  if (sc.dataHeader && c == ',' &&
+      sc.length - sc.lineStart > sizeof(TCP_RECV_HEADER) - 1 &&
+      memcmp(sc.body + sc.lineStart, TCP_RECV_HEADER, sizeof(TCP_RECV_HEADER) - 1) == 0) {
+    sc.dataHeader = false;
+    sc.dataLen = strtoul(sc.body + sc.lineStart + sizeof(TCP_RECV_HEADER) - 1, NULL, 10);
+    return AT_SCAN_DATA;
+  }
 
-  while (millis() - start < finalTimeout) {
-    while (SerialAT.available()) {
-      char c = SerialAT.read();
-      response += c;
-    }
+  if (c != '\n') return 0;
+
+  size_t start = sc.lineStart;
+  size_t end = sc.length - 1;
+  if (end > start && sc.body[end - 1] == '\r') end--;
+  sc.lineStart = sc.length;
+
+  const char* line = sc.body + start;
+  size_t len = end - start;
+
+  if (urcDispatchLine(line, len, sc.command)) {
+    sc.length = start;
+    sc.lineStart = start;
+    sc.body[start] = '\0';
+    return 0;
+  }
+
+  if (urcLineMatches(line, len, "OK", false) ||
+      urcLineMatches(line, len, "NORMAL POWER DOWN", false)) {
+    return (sc.matched || sc.expected.len == 0) ? 1 : -1;
   }
 
-  if (modemConfig.enableDebug) {
-    logMessage(3, "📥 Respuesta recibida (" + String(response.length()) + " bytes): " + response);
+  if (urcLineMatches(line, len, "ERROR", false) ||
+      urcLineMatches(line, len, "SEND FAIL", false) ||
+      urcLineMatches(line, len, "+CME ERROR", true) ||
+      urcLineMatches(line, len, "+CMS ERROR", true)) {
+    return -1;
   }
 
-  return response;
+  return 0;
 }
 
+#if !GSMLTE_STATIC_ALLOC
 /**
- * Envía comando AT y espera respuesta específica
- * @param command - Comando AT a enviar
- * @param expectedResponse - Respuesta esperada
- * @param timeout - Timeout en milisegundos
- * @return true si se recibe la respuesta esperada
+ * Lee respuesta del módem hasta el código de resultado final o timeout
+ * @param timeout - Timeout base en milisegundos
+ * @return Respuesta del módem como String
  */
-bool sendATCommand(const String& command, const String& expectedResponse, unsigned long timeout) {
-  logMessage(3, "📤 Enviando comando AT: " + command);
-
-  String response = "";
+String readResponse(unsigned long timeout) {
   unsigned long start = millis();
-  unsigned long adaptiveTimeout = getAdaptiveTimeout();
+  char response[AT_RESPONSE_MAX];
+  unsigned long adaptiveTimeout = getAdaptiveTimeout(MODEM_RTT_LOCAL);
+
   unsigned long finalTimeout = (timeout > adaptiveTimeout) ? timeout : adaptiveTimeout;
 
   flushPortSerial();
 
-  modem.sendAT(command);
+  AtResponseScanner sc;
+  atScanBegin(sc, "", response, sizeof(response), NULL);
 
-  while (millis() - start < finalTimeout) {
+  bool done = false;
+  while (!done && millis() - start < finalTimeout) {
     while (SerialAT.available()) {
-      char c = SerialAT.read();
-      response += c;
-      if (modemConfig.enableDebug) {
-        Serial.print(c);
+      if (atScanFeed(sc, SerialAT.read()) != 0) {
+        done = true;
+        break;
       }
     }
   }
 
-  if (response.indexOf(expectedResponse) != -1) {
-    logMessage(3, "✅ Comando AT exitoso: " + command);
-    return true;
-  }
+  logMessagef(3, "📥 Respuesta recibida (%u bytes): %s", (unsigned)sc.length, response);
 
-  logMessage(1, "⚠️  Comando AT falló: " + command + " (esperaba: " + expectedResponse + ")");
-  return false;
+  return String(response);
 }
+#endif
 
 /**
- * Busca texto específico en una cadena principal
- * @param textoPrincipal - Texto donde buscar
- * @param textoBuscado - Texto a buscar
- * @return true si se encuentra el texto
+ * Solicitud AT pendiente en la cola asíncrona
  */
-
-
-
+struct AtRequest {
+  char command[AT_COMMAND_MAX];
+  char expected[AT_EXPECTED_MAX];
+  const uint8_t* payload;
+  size_t payloadLen;
+  const char* prompt;           ///< Prompt que precede a payload (NULL = '>')
+  TcpSocket* recvSocket;
+  unsigned long timeout;
+  ATCallback callback;
+  void* ctx;
+};
 
 /**
- * Obtiene información de la tarjeta SIM y calidad de señal
+ * Resultado de una operación AT consultado por las máquinas de estado
  */
-void getIccid() {
-  logMessage(2, "📱 Obteniendo información de la tarjeta SIM");
+struct AtOp {
+  bool pending;
+  int8_t result;
+  char response[AT_RESPONSE_MAX];
 
-  flushPortSerial();
+  AtOp() : pending(false), result(0) { response[0] = '\0'; }
+};
 
-  for (int i = 0; i < 3; i++) {
-    iccidsim0 = modem.getSimCCID();
-    signalsim0 = modem.getSignalQuality();
-    delay(300);  
-  }
+#define AT_QUEUE_SIZE 8
+#define URC_LINE_MAX 128
 
-  logMessage(2, "📱 ICCID: " + iccidsim0);
-  logMessage(2, "📶 Calidad de señal: " + String(signalsim0));
+static AtRequest atQueue[AT_QUEUE_SIZE];
+static uint8_t atQueueHead = 0;
+static uint8_t atQueueCount = 0;
 
-  if (signalsim0 >= 20) {
-    logMessage(2, "✅ Señal excelente");
-  } else if (signalsim0 >= 15) {
-    logMessage(2, "✅ Señal buena");
-  } else if (signalsim0 >= 10) {
-    logMessage(1, "⚠️  Señal regular");
-  } else {
-    logMessage(0, "❌ Señal débil - problemas de conectividad esperados");
+static AtRequest atActive;
+static bool atBusy = false;
+static bool atAwaitingPrompt = false;
+static unsigned long atStart = 0;
+static unsigned long atActiveTimeout = 0;
+static unsigned long atStartMicros = 0;
+static uint32_t atTxBytes = 0;
+static uint32_t atRxBytes = 0;
+static size_t atDataRemaining = 0;
+static char atResponse[AT_RESPONSE_MAX];
+static AtResponseScanner atScanner;
+
+/**
+ * Copia una cadena truncando al tamaño del destino
+ * @return true si la cadena cupo completa
+ */
+static bool copyBounded(char* dst, size_t size, const char* src) {
+  size_t len = strlen(src);
+  if (len >= size) {
+    memcpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+    return false;
   }
+  memcpy(dst, src, len + 1);
+  return true;
 }
 
-
-
 /**
- * Inicia la comunicación GSM con secuencia robusta para SIM7080G
+ * Procesa un byte recibido sin comando en curso: arma líneas y las entrega
+ * al despachador URC; el resto se descarta
  */
-void startGsm() {
-  logMessage(2, "📱 Iniciando comunicación GSM con SIM7080G");
-  
-  pinMode(PWRKEY_PIN, OUTPUT);
-  digitalWrite(PWRKEY_PIN, LOW);
-  
-  logMessage(2, "🔌 Ejecutando secuencia de encendido inicial");
-  modemPwrKeyPulse();
-  
-  int retry = 0;
-  const int maxRetries = 5;
-  
-  while (!modem.testAT(2000)) {
-    flushPortSerial();
-    logMessage(3, "🔄 Esperando respuesta AT del SIM7080G... (intento " + String(retry + 1) + ")");
-    
-    if (retry++ >= maxRetries) {
-      logMessage(1, "⚠️  Sin respuesta AT, ejecutando nuevo ciclo de encendido");
-      
-      digitalWrite(PWRKEY_PIN, HIGH);
-      delay(1500);
-      digitalWrite(PWRKEY_PIN, LOW);
-      delay(1000);
-      
-      modemPwrKeyPulse();
-      retry = 0;
-    } else {
-      delay(500);
-    }
-  }
-  
-  logMessage(2, "✅ Comunicación AT establecida con SIM7080G");
-  
-  logMessage(2, "🔍 Verificando estado del módem");
-  sendATCommand("", "OK", 500);
-  
-  if (sendATCommand("+CPIN?", "READY", 5000)) {
-    logMessage(2, "✅ SIM card lista y desbloqueada");
-  } else {
-    logMessage(1, "⚠️  Problema con SIM card, continuando...");
-  }
-  
-  logMessage(2, "📡 Activando RF del SIM7080G");
-  
-  if (sendATCommand("+CFUN=1", "OK", 8000)) {
-    logMessage(2, "✅ RF del módem activada correctamente");
-  } else {
-    logMessage(1, "⚠️  Error al activar RF, forzando reinicio...");
-    
-    if (sendATCommand("+CFUN=1,1", "OK", 12000)) {
-      logMessage(2, "✅ RF activada con reinicio del módem");
-      delay(2000);
-    } else {
-      logMessage(0, "❌ Fallo crítico al activar RF del módem");
-    }
-  }
-  
-  delay(1000);
-  
-  if (sendATCommand("+CFUN?", "+CFUN: 1", 3000)) {
-    logMessage(2, "✅ SIM7080G completamente funcional y listo");
-  } else {
-    logMessage(1, "⚠️  Advertencia: No se pudo verificar estado final de RF");
+static void urcFeedIdle(char c) {
+  static char idleLine[URC_LINE_MAX];
+  static size_t idleLen = 0;
+
+  modemEnsureUrcHandlers();
+
+  if (c == '\n') {
+    size_t end = idleLen;
+    if (end > 0 && idleLine[end - 1] == '\r') end--;
+    urcDispatchLine(idleLine, end, NULL);
+    idleLen = 0;
+  } else if (idleLen < URC_LINE_MAX) {
+    idleLine[idleLen++] = c;
   }
 }
 
 /**
- * Espera un token específico en el stream con timeout
- * @param s - Stream a monitorear
- * @param token - Token a buscar
- * @param timeout_ms - Timeout en milisegundos
- * @return true si se encuentra el token
+ * Encola un comando AT para ejecución asíncrona
+ * @param command - Comando AT a enviar (sin prefijo "AT")
+ * @param expectedResponse - Respuesta esperada (vacía = solo resultado final OK)
+ * @param timeout - Timeout máximo en milisegundos
+ * @param callback - Función a invocar al completar (puede ser NULL)
+ * @param ctx - Contexto de usuario para el callback
+ * @param payload - Datos a escribir tras el prompt '>' (NULL = comando normal);
+ *                  deben permanecer válidos hasta que el comando finalice
+ * @param payloadLen - Longitud de los datos
+ * @return true si el comando fue encolado
  */
-static bool waitForToken(Stream& s, const String& token, uint32_t timeout_ms) {
-  uint32_t start = millis();
-  String buf;
-  buf.reserve(256);
+static bool atEnqueue(const char* command, const char* expectedResponse, unsigned long timeout,
+                      ATCallback callback, void* ctx, const uint8_t* payload, size_t payloadLen) {
+  if (atQueueCount >= AT_QUEUE_SIZE) {
+    logMessagef(1, "⚠️  Cola AT llena, descartando comando: %s", command);
+    return false;
+  }
 
-  while (millis() - start < timeout_ms) {
-    while (s.available()) {
-      char c = s.read();
-      buf += c;
+  AtRequest& req = atQueue[(atQueueHead + atQueueCount) % AT_QUEUE_SIZE];
+  if (!copyBounded(req.command, sizeof(req.command), command) ||
+      !copyBounded(req.expected, sizeof(req.expected), expectedResponse)) {
+    logMessagef(0, "❌ Comando AT demasiado largo: %s", command);
+    return false;
+  }
+  req.payload = payload;
+  req.payloadLen = payloadLen;
+  req.prompt = NULL;
+  req.recvSocket = NULL;
+  req.timeout = timeout;
+  req.callback = callback;
+  req.ctx = ctx;
+  atQueueCount++;
+  memNote(MEM_POOL_AT_QUEUE, atQueueCount * sizeof(AtRequest), sizeof(atQueue));
+  return true;
+}
 
-      if (buf.length() > 512) buf.remove(0, buf.length() - 256);
+bool modemSubmitAT(const char* command, const char* expectedResponse, unsigned long timeout,
+                   ATCallback callback, void* ctx) {
+  return atEnqueue(command, expectedResponse, timeout, callback, ctx, NULL, 0);
+}
 
-      if (buf.indexOf(token) >= 0) return true;
-    }
-    delay(1);
-  }
+#if !GSMLTE_STATIC_ALLOC
+bool modemSubmitAT(const String& command, const String& expectedResponse, unsigned long timeout,
+                   ATCallback callback, void* ctx) {
+  return modemSubmitAT(command.c_str(), expectedResponse.c_str(), timeout, callback, ctx);
+}
+#endif
 
-  return false;
+bool modemIsIdle() {
+  return !atBusy && atQueueCount == 0;
 }
 
 /**
- * Espera cualquiera de varios tokens con timeout
- * @param s - Stream a monitorear
- * @param okTokens - Array de tokens de éxito
- * @param okCount - Cantidad de tokens de éxito
- * @param errTokens - Array de tokens de error
- * @param errCount - Cantidad de tokens de error
- * @param timeout_ms - Timeout en milisegundos
- * @return 1=OK, -1=Error, 0=Timeout
+ * Inicia el siguiente comando de la cola
  */
-static int8_t waitForAnyToken(Stream& s,
-                              const char* okTokens[], size_t okCount,
-                              const char* errTokens[], size_t errCount,
-                              uint32_t timeout_ms) {
-  uint32_t start = millis();
-  String buf;
-  buf.reserve(512);
+static void atStartNext() {
+  atActive = atQueue[atQueueHead];
+  atQueueHead = (atQueueHead + 1) % AT_QUEUE_SIZE;
+  atQueueCount--;
+  memNote(MEM_POOL_AT_QUEUE, atQueueCount * sizeof(AtRequest), sizeof(atQueue));
 
-  while (millis() - start < timeout_ms) {
-    while (s.available()) {
-      char c = s.read();
-      buf += c;
+  logMessagef(3, "📤 Enviando comando AT: %s", atActive.command);
 
-      if (buf.length() > 1024) buf.remove(0, buf.length() - 512);
+  unsigned long adaptiveTimeout = getAdaptiveTimeout(modemRttClassOf(atActive.command));
+  atActiveTimeout = (atActive.timeout > adaptiveTimeout) ? atActive.timeout : adaptiveTimeout;
 
-      for (size_t i = 0; i < errCount; ++i) {
-        if (buf.indexOf(errTokens[i]) >= 0) return -1;
-      }
+  flushPortSerial();
 
-      for (size_t i = 0; i < okCount; ++i) {
-        if (buf.indexOf(okTokens[i]) >= 0) return 1;
-      }
-    }
-    delay(1);
-  }
+  modem.sendAT(atActive.command);
+  atStartMicros = micros();
+  atTxBytes = strlen(atActive.command) + 4;
+  atRxBytes = 0;
 
-  return 0;
+  atAwaitingPrompt = atActive.payload != NULL;
+  atScanBegin(atScanner, atActive.expected, atResponse, sizeof(atResponse), atActive.command);
+  if (atAwaitingPrompt) atScanPrompt(atScanner, atActive.prompt != NULL ? atActive.prompt : ">");
+  atScanner.dataHeader = atActive.recvSocket != NULL;
+  atDataRemaining = 0;
+  atStart = millis();
+  atBusy = true;
 }
 
 /**
- * Envía datos TCP con gestión robusta de errores
- * @param datos - Datos a enviar
+ * Finaliza el comando activo e invoca su callback
+ * @param result - 1=Respuesta esperada, -1=Error, 0=Timeout
+ */
+static void atComplete(int8_t result) {
+  atBusy = false;
+  uint32_t latencyUs = micros() - atStartMicros;
+  modemStatsRecord(atActive.command, result, latencyUs, atTxBytes, atRxBytes);
+  modemRttSample(modemRttClassOf(atActive.command), result, latencyUs);
+  memNote(MEM_POOL_AT_RESPONSE, atScanner.length, sizeof(atResponse));
+  logMessagef(3, "📥 AT%s -> %d (%luus): %s", atActive.command, result,
+              (unsigned long)latencyUs, atResponse);
+
+  if (atActive.callback != NULL) {
+    atActive.callback(result, atResponse, atActive.ctx);
+  }
+}
+
+/**
+ * Copia datos de +CARECV del UART directamente al buffer circular de recepción
+ * @details Los bytes que no caben (no debería ocurrir: cada +CARECV pide a lo
+ * sumo el espacio libre) se descartan
+ */
+static void atReadData() {
+  uint8_t* span;
+  size_t room = tcpRxWriteSpan(atActive.recvSocket, &span);
+  size_t available = SerialAT.available();
+
+  if (room == 0) {
+    SerialAT.read();
+    atDataRemaining--;
+    atRxBytes++;
+    return;
+  }
+
+  size_t n = atDataRemaining;
+  if (n > room) n = room;
+  if (n > available) n = available;
+
+  n = SerialAT.read(span, n);
+  tcpRxCommit(atActive.recvSocket, n);
+  atDataRemaining -= n;
+  atRxBytes += n;
+}
+
+/**
+ * Avanza el motor AT sin bloquear: procesa bytes disponibles,
+ * detecta fin/timeout del comando activo e inicia el siguiente
+ */
+static void atEnginePoll() {
+  if (!atBusy) {
+    if (atQueueCount == 0) {
+      while (SerialAT.available()) {
+        urcFeedIdle(SerialAT.read());
+      }
+      return;
+    }
+    atStartNext();
+  }
+
+  while (SerialAT.available()) {
+    if (atDataRemaining > 0) {
+      atReadData();
+      continue;
+    }
+
+    char c = SerialAT.read();
+    atRxBytes++;
+
+    int8_t result = atScanFeed(atScanner, c);
+    if (result == 0) continue;
+
+    if (result == AT_SCAN_DATA) {
+      atDataRemaining = atScanner.dataLen;
+      continue;
+    }
+
+    if (atAwaitingPrompt && result == 1) {
+      atAwaitingPrompt = false;
+      SerialAT.write(atActive.payload, atActive.payloadLen);
+      atTxBytes += atActive.payloadLen;
+      atScanExpect(atScanner, atActive.expected);
+      atStart = millis();
+      continue;
+    }
+
+    atComplete(result);
+    return;
+  }
+
+  if (millis() - atStart >= atActiveTimeout) {
+    // La respuesta esperada llegó pero el resultado final no
+    atComplete(atScanner.matched ? 1 : 0);
+  }
+}
+
+/**
+ * Callback que guarda el resultado de una operación AT
+ */
+static void atOpCallback(int8_t result, const char* response, void* ctx) {
+  AtOp* op = static_cast<AtOp*>(ctx);
+  op->result = result;
+  copyBounded(op->response, sizeof(op->response), response);
+  op->pending = false;
+}
+
+/**
+ * Encola un comando AT cuyo resultado se guarda en una operación
+ * @return true si el comando fue encolado
+ */
+static bool atOpSubmit(AtOp& op, const char* command, const char* expectedResponse,
+                       unsigned long timeout, const uint8_t* payload = NULL, size_t payloadLen = 0) {
+  op.pending = true;
+  op.result = 0;
+  op.response[0] = '\0';
+  if (!atEnqueue(command, expectedResponse, timeout, atOpCallback, &op, payload, payloadLen)) {
+    op.pending = false;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Encola un +CARECV cuyos datos se copian al buffer circular de recepción
+ * @param socket - Socket cuyo buffer recibe los datos
+ * @return true si el comando fue encolado
+ */
+static bool atOpSubmitRecv(AtOp& op, const char* command, unsigned long timeout,
+                           TcpSocket* socket) {
+  if (!atOpSubmit(op, command, "", timeout)) return false;
+
+  atQueue[(atQueueHead + atQueueCount - 1) % AT_QUEUE_SIZE].recvSocket = socket;
+  return true;
+}
+
+/**
+ * Encola una escritura de archivo (+CFSWFILE): los datos siguen al prompt
+ * "DOWNLOAD" en lugar de '>'
+ * @param data - Contenido; debe permanecer válido hasta que el comando finalice
+ */
+static bool atOpSubmitUpload(AtOp& op, const char* command, unsigned long timeout,
+                             const uint8_t* data, size_t len) {
+  if (!atOpSubmit(op, command, "", timeout, data, len)) return false;
+
+  atQueue[(atQueueHead + atQueueCount - 1) % AT_QUEUE_SIZE].prompt = "DOWNLOAD";
+  return true;
+}
+
+/**
+ * Bombea el motor AT hasta que la operación finaliza
+ */
+static int8_t atOpWait(AtOp& op) {
+  while (op.pending) {
+    atEnginePoll();
+    logPoll();
+    delay(1);
+  }
+  return op.result;
+}
+
+/**
+ * Bombea el motor AT hasta vaciar la cola, antes de acceder al UART directamente
+ */
+static void atEngineDrain() {
+  while (!modemIsIdle()) {
+    atEnginePoll();
+    delay(1);
+  }
+}
+
+/**
+ * Espera el resultado de un comando y registra el desenlace
+ */
+static int8_t atOpWaitLogged(AtOp& op, const char* command, const char* expectedResponse) {
+  int8_t result = atOpWait(op);
+
+  if (result == 1) {
+    logMessagef(3, "✅ Comando AT exitoso: %s", command);
+  } else if (result == -1) {
+    logMessagef(1, "⚠️  Comando AT falló: %s (esperaba: %s)", command, expectedResponse);
+  } else {
+    logMessagef(1, "⚠️  Timeout en comando AT: %s (esperaba: %s)", command, expectedResponse);
+  }
+  return result;
+}
+
+int8_t sendATCommandBuf(const char* command, const char* expectedResponse,
+                        char* response, size_t responseSize, unsigned long timeout) {
+  AtOp op;
+  if (!atOpSubmit(op, command, expectedResponse, timeout)) {
+    if (response != NULL && responseSize > 0) response[0] = '\0';
+    return -1;
+  }
+
+  int8_t result = atOpWaitLogged(op, command, expectedResponse);
+  if (response != NULL && responseSize > 0) {
+    copyBounded(response, responseSize, op.response);
+  }
+  return result;
+}
+
+int8_t sendATCommandf(const char* expectedResponse, unsigned long timeout, const char* format, ...) {
+  char command[AT_COMMAND_MAX];
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(command, sizeof(command), format, args);
+  va_end(args);
+
+  if (len < 0 || (size_t)len >= sizeof(command)) {
+    logMessagef(0, "❌ Comando AT demasiado largo: %s", format);
+    return -1;
+  }
+
+  return sendATCommandBuf(command, expectedResponse, NULL, 0, timeout);
+}
+
+#if !GSMLTE_STATIC_ALLOC
+/**
+ * Envía comando AT y captura la respuesta hasta el resultado final
+ * @param command - Comando AT a enviar
+ * @param expectedResponse - Respuesta esperada (vacía = solo resultado final OK)
+ * @param response - Cuerpo de la respuesta recibida
+ * @param timeout - Timeout máximo en milisegundos
+ * @return 1=Respuesta esperada, -1=Error, 0=Timeout
+ */
+int8_t sendATCommandResponse(const String& command, const String& expectedResponse,
+                             String& response, unsigned long timeout) {
+  char buffer[AT_RESPONSE_MAX];
+  int8_t result = sendATCommandBuf(command.c_str(), expectedResponse.c_str(),
+                                   buffer, sizeof(buffer), timeout);
+  response = buffer;
+  return result;
+}
+#endif
+
+/**
+ * Envía comando AT y espera respuesta específica
+ * @param command - Comando AT a enviar
+ * @param expectedResponse - Respuesta esperada
+ * @param timeout - Timeout máximo en milisegundos (retorna antes si llega el resultado final)
+ * @return true si se recibe la respuesta esperada
+ */
+bool sendATCommand(const char* command, const char* expectedResponse, unsigned long timeout) {
+  return sendATCommandBuf(command, expectedResponse, NULL, 0, timeout) == 1;
+}
+
+#if !GSMLTE_STATIC_ALLOC
+bool sendATCommand(const String& command, const String& expectedResponse, unsigned long timeout) {
+  return sendATCommand(command.c_str(), expectedResponse.c_str(), timeout);
+}
+#endif
+
+/**
+ * Busca texto específico en una cadena principal
+ * @param textoPrincipal - Texto donde buscar
+ * @param textoBuscado - Texto a buscar
+ * @return true si se encuentra el texto
+ */
+
+
+
+
+/**
+ * Registra ICCID y clasificación de la calidad de señal
+ */
+static void logSimInfo() {
+#if GSMLTE_STATIC_ALLOC
+  logMessagef(2, "📱 ICCID: %s", iccidsim0);
+#else
+  logMessagef(2, "📱 ICCID: %s", iccidsim0.c_str());
+#endif
+  logMessagef(2, "📶 Calidad de señal: %d", signalsim0);
+
+  if (signalsim0 >= 20) {
+    logMessage(2, "✅ Señal excelente");
+  } else if (signalsim0 >= 15) {
+    logMessage(2, "✅ Señal buena");
+  } else if (signalsim0 >= 10) {
+    logMessage(1, "⚠️  Señal regular");
+  } else {
+    logMessage(0, "❌ Señal débil - problemas de conectividad esperados");
+  }
+}
+
+/**
+ * Obtiene información de la tarjeta SIM y calidad de señal
+ * @details Solo consulta al módem los valores que no estén vigentes en el caché
+ */
+void getIccid() {
+  logMessage(2, "📱 Obteniendo información de la tarjeta SIM");
+
+  if (!modemInfoValid(MODEM_INFO_ICCID)) modemInfoRefresh(MODEM_INFO_ICCID);
+  if (!modemInfoValid(MODEM_INFO_SIGNAL)) modemInfoRefresh(MODEM_INFO_SIGNAL);
+
+  logSimInfo();
+}
+
+/**
+ * Inicia la comunicación GSM con secuencia robusta para SIM7080G
+ */
+void startGsm() {
+  logMessage(2, "📱 Iniciando comunicación GSM con SIM7080G");
+  
+  pinMode(PWRKEY_PIN, OUTPUT);
+  digitalWrite(PWRKEY_PIN, LOW);
+  
+  logMessage(2, "🔌 Ejecutando secuencia de encendido inicial");
+  modemPwrKeyPulse();
+  
+  int retry = 0;
+  const int maxRetries = 5;
+  
+  while (!modem.testAT(2000)) {
+    flushPortSerial();
+    logMessagef(3, "🔄 Esperando respuesta AT del SIM7080G... (intento %d)", retry + 1);
+    
+    if (retry++ >= maxRetries) {
+      logMessage(1, "⚠️  Sin respuesta AT, ejecutando nuevo ciclo de encendido");
+      
+      digitalWrite(PWRKEY_PIN, HIGH);
+      delay(1500);
+      digitalWrite(PWRKEY_PIN, LOW);
+      delay(1000);
+      
+      modemPwrKeyPulse();
+      retry = 0;
+    } else {
+      delay(500);
+    }
+  }
+  
+  logMessage(2, "✅ Comunicación AT establecida con SIM7080G");
+  
+  logMessage(2, "🔍 Verificando estado del módem");
+  sendATCommand("", "OK", 500);
+  
+  if (sendATCommand("+CPIN?", "READY", 5000)) {
+    logMessage(2, "✅ SIM card lista y desbloqueada");
+  } else {
+    logMessage(1, "⚠️  Problema con SIM card, continuando...");
+  }
+  
+  logMessage(2, "📡 Activando RF del SIM7080G");
+  
+  if (sendATCommand("+CFUN=1", "OK", 8000)) {
+    logMessage(2, "✅ RF del módem activada correctamente");
+  } else {
+    logMessage(1, "⚠️  Error al activar RF, forzando reinicio...");
+    
+    if (sendATCommand("+CFUN=1,1", "OK", 12000)) {
+      logMessage(2, "✅ RF activada con reinicio del módem");
+      delay(2000);
+    } else {
+      logMessage(0, "❌ Fallo crítico al activar RF del módem");
+    }
+  }
+  
+  delay(1000);
+  
+  if (sendATCommand("+CFUN?", "+CFUN: 1", 3000)) {
+    logMessage(2, "✅ SIM7080G completamente funcional y listo");
+  } else {
+    logMessage(1, "⚠️  Advertencia: No se pudo verificar estado final de RF");
+  }
+}
+
+/**
+ * Paso de configuración ejecutado por la máquina de estados de arranque
+ */
+struct ModemStep {
+  const char* command;          ///< NULL = el perfil no usa este paso
+  const char* expected;
+  unsigned long timeout;        ///< 0 = timeout adaptativo de comandos locales
+  unsigned long postDelay;
+  bool critical;
+  int8_t failLevel;
+  const char* okMessage;
+  const char* failMessage;
+};
+
+#define SETUP_STEP_CFUN_RESET 3
+#define SETUP_STEP_CCID 5
+#define SETUP_STEP_CSQ 6
+#define SETUP_STEP_CEREG 7
+#define SETUP_STEP_LTE_FIRST 8
+#define SETUP_STEP_NET_LAST 12
+#define SETUP_STEP_PDP 13
+#define SETUP_STEP_CNACT_QUERY 14
+#define SETUP_STEP_CNACT 15
+
+#define FAST_PROBE_RETRIES 2
+#define MODEM_NVS_NAMESPACE "gsmlte"
+
+#define PROBE_AT_MAX_RETRIES 5
+#define LTE_REGISTER_TIMEOUT 45000
+#define LTE_REGISTER_RECHECK 5000       ///< +CNACT? de respaldo si no llega ninguna URC
+#define MODEM_POWER_OFF_DELAY 3000       ///< Espera tras +CPOWD antes del pulso PWRKEY
+
+static ModemState modemState = MODEM_STATE_OFF;
+static AtOp smOp;
+static bool smAwaiting = false;
+static uint8_t smStep = 0;
+static uint8_t smRetry = 0;
+static bool smPrevOk = true;
+static bool smOpenTcp = true;
+static bool smFast = false;
+static bool smProbeOnly = false;
+static bool smLteOk = true;
+static uint16_t smSkip = 0;
+static unsigned long smTimer = 0;
+static unsigned long smRegisterStart = 0;
+static bool smPdpActive = false;         ///< Recibido "+APP PDP: 0,ACTIVE"
+
+static bool tcpFinishOpen(int8_t result);
+/**
+ * Verifica si un temporizador de la máquina de estados expiró
+ */
+static bool modemTimerExpired(unsigned long deadline) {
+  return (long)(millis() - deadline) >= 0;
+}
+
+/**
+ * Pasos del arranque, armados al compilar desde el perfil (gsmlte_profile.h)
+ * @details El índice de cada entrada es el número de paso que usan smSkip y
+ * los SETUP_STEP_*; los pasos que el perfil no usa tienen comando NULL.
+ * +CEREG=2 va antes de la radio para que el registro llegue como URC.
+ */
+static const ModemStep modemSteps[] = {
+  { "", "OK", 500, 0, false, 1, NULL, NULL },
+  { "+CPIN?", "READY", 5000, 0, false, 1,
+    "✅ SIM card lista y desbloqueada", "⚠️  Problema con SIM card, continuando..." },
+  { "+CFUN=1", "OK", 8000, LONG_DELAY, false, 1,
+    "✅ RF del módem activada correctamente", "⚠️  Error al activar RF, forzando reinicio..." },
+  { "+CFUN=1,1", "OK", 12000, MODEM_STABILIZE_DELAY + LONG_DELAY, false, 0,
+    "✅ RF activada con reinicio del módem", "❌ Fallo crítico al activar RF del módem" },
+  { "+CFUN?", "+CFUN: 1", 3000, 0, false, 1,
+    "✅ SIM7080G completamente funcional y listo",
+    "⚠️  Advertencia: No se pudo verificar estado final de RF" },
+  { "+CCID", "", 1000, 0, false, 1, NULL, NULL },
+  { "+CSQ", "", 1000, 0, false, 1, NULL, NULL },
+  { "+CEREG=2", "OK", 0, 0, false, 1, NULL, "⚠️  URC de registro no disponibles, se consultará" },
+  { MODEM_PROFILE_CMD_NETWORK_MODE, "OK", 0, 0, true, 0,
+    NULL, "❌ Fallo configurando modo de red" },
+  { MODEM_PROFILE_CMD_BAND_MODE, "OK", 0, 0, true, 0,
+    NULL, "❌ Fallo configurando modo de banda" },
+  { MODEM_PROFILE_CMD_BANDS_CATM, "OK", 0, 0, false, 1,
+    NULL, "⚠️  Fallo configurando bandas CAT-M" },
+  { MODEM_PROFILE_CMD_BANDS_NBIOT, "OK", 0, 0, false, 1,
+    NULL, "⚠️  Fallo configurando bandas NB-IoT" },
+  { "+CBANDCFG?", "OK", 2000, SHORT_DELAY, false, 1, NULL, NULL },
+  { MODEM_PROFILE_CMD_PDP, "OK", 3000, 0, true, 0,
+    NULL, "❌ Fallo configurando contexto PDP" },
+  { "+CNACT?", "+CNACT: 0,1", 2000, 0, false, 1, NULL, NULL },
+  { "+CNACT=0,1", "OK", 3000, 0, true, 0, NULL, "❌ Fallo activando contexto PDP" }
+};
+
+#define SETUP_STEP_COUNT (sizeof(modemSteps) / sizeof(modemSteps[0]))
+
+/**
+ * Timeout de un paso de configuración
+ */
+static unsigned long modemStepTimeout(const ModemStep& def) {
+  return def.timeout != 0 ? def.timeout : getAdaptiveTimeout(MODEM_RTT_LOCAL);
+}
+
+/**
+ * Calcula el hash FNV-1a de un bloque de datos
+ */
+static uint32_t modemHash(uint32_t hash, const void* data, size_t len) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * Hash de la configuración de radio (pasos +CNMP, +CMNB y +CBANDCFG)
+ */
+static uint32_t modemNetConfigHash() {
+  uint32_t hash = 2166136261UL;
+
+  for (uint8_t step = SETUP_STEP_LTE_FIRST; step <= SETUP_STEP_NET_LAST; ++step) {
+    const char* command = modemSteps[step].command != NULL ? modemSteps[step].command : "";
+    hash = modemHash(hash, command, strlen(command) + 1);
+  }
+  return hash;
+}
+
+/**
+ * Hash de la configuración del contexto PDP (paso +CGDCONT)
+ */
+static uint32_t modemPdpConfigHash() {
+  const char* command = modemSteps[SETUP_STEP_PDP].command;
+  return modemHash(2166136261UL, command, strlen(command) + 1);
+}
+
+/**
+ * Guarda en NVS los hashes de la configuración aplicada (solo si cambiaron)
+ */
+static void modemStoreConfigHash() {
+  Preferences prefs;
+  if (!prefs.begin(MODEM_NVS_NAMESPACE, false)) return;
+
+  uint32_t net = modemNetConfigHash();
+  uint32_t pdp = modemPdpConfigHash();
+  bool changed = false;
+
+  if (prefs.getUInt("net", 0) != net) {
+    prefs.putUInt("net", net);
+    changed = true;
+  }
+  if (prefs.getUInt("pdp", 0) != pdp) {
+    prefs.putUInt("pdp", pdp);
+    changed = true;
+  }
+  prefs.end();
+
+  if (changed) logMessage(3, "💾 Configuración del módem guardada en NVS");
+}
+
+/**
+ * Calcula los pasos de configuración que pueden omitirse en arranque rápido
+ * @return Máscara de pasos cuya configuración ya está aplicada en el módem
+ */
+static uint16_t modemFastSkipMask() {
+  Preferences prefs;
+  uint32_t net = 0;
+  uint32_t pdp = 0;
+
+  if (prefs.begin(MODEM_NVS_NAMESPACE, true)) {
+    net = prefs.getUInt("net", 0);
+    pdp = prefs.getUInt("pdp", 0);
+    prefs.end();
+  }
+
+  uint16_t mask = 0;
+  if (net != 0 && net == modemNetConfigHash()) {
+    for (uint8_t step = SETUP_STEP_LTE_FIRST; step <= SETUP_STEP_NET_LAST; ++step) {
+      mask |= (1u << step);
+    }
+    logMessage(2, "⚡ Configuración de radio sin cambios, se omite");
+  }
+  if (pdp != 0 && pdp == modemPdpConfigHash()) {
+    mask |= (1u << SETUP_STEP_PDP);
+    logMessage(2, "⚡ Contexto PDP sin cambios, se omite");
+  }
+  return mask;
+}
+
+void modemForgetConfig() {
+  Preferences prefs;
+  if (prefs.begin(MODEM_NVS_NAMESPACE, false)) {
+    prefs.clear();
+    prefs.end();
+  }
+}
+
+static uint32_t uartTargetBaud = UART_BAUD_FAST;
+static bool uartFlowControl = UART_FLOW_CONTROL;
+static uint32_t uartBaud = UART_BAUD;
+static uint32_t uartSavedBaud = 0;       ///< Velocidad guardada en NVS (0 = ninguna)
+static uint32_t uartFailedBaud = 0;      ///< Velocidad que no se pudo confirmar
+static uint32_t uartFailedBoots = 0;     ///< Arranques desde esa falla
+static uint32_t uartPreviousBaud = UART_BAUD;
+static uint8_t uartProbeIndex = 0;
+static bool uartStarted = false;
+
+void modemUartConfigure(uint32_t baud, bool flowControl) {
+  uartTargetBaud = baud;
+  uartFlowControl = flowControl;
+}
+
+uint32_t modemUartBaud() {
+  return uartBaud;
+}
+
+/**
+ * Guarda en NVS una velocidad (solo si cambió)
+ */
+static void modemUartStore(const char* key, uint32_t baud) {
+  Preferences prefs;
+  if (!prefs.begin(MODEM_NVS_NAMESPACE, false)) return;
+  if (prefs.getUInt(key, 0) != baud) prefs.putUInt(key, baud);
+  prefs.end();
+}
+
+/**
+ * Registra la velocidad que no se pudo confirmar
+ */
+static void modemUartNoteFailed(uint32_t baud) {
+  uartFailedBaud = baud;
+  uartFailedBoots = 0;
+  modemUartStore("baudbad", baud);
+  modemUartStore("baudboots", 0);
+}
+
+/**
+ * Olvida la velocidad que falló (ya confirmada o se vuelve a probar)
+ */
+static void modemUartClearFailed() {
+  uartFailedBaud = 0;
+  uartFailedBoots = 0;
+  modemUartStore("baudbad", 0);
+  modemUartStore("baudboots", 0);
+}
+
+/**
+ * Lee de NVS la velocidad guardada y la que falló
+ * @details La que falló se evita durante UART_BAUD_RETRY_BOOTS arranques (una
+ * falla puede ser ruido durante el cambio) y se olvida si la velocidad pedida
+ * cambió
+ */
+static void modemUartLoad() {
+  Preferences prefs;
+  uartSavedBaud = 0;
+  uartFailedBaud = 0;
+  uartFailedBoots = 0;
+
+  if (prefs.begin(MODEM_NVS_NAMESPACE, true)) {
+    uartSavedBaud = prefs.getUInt("baud", 0);
+    uartFailedBaud = prefs.getUInt("baudbad", 0);
+    uartFailedBoots = prefs.getUInt("baudboots", 0);
+    prefs.end();
+  }
+  if (uartFailedBaud == 0) return;
+
+  uint32_t target = uartTargetBaud != 0 ? uartTargetBaud : UART_BAUD;
+  if (uartFailedBaud != target || uartFailedBoots + 1 >= UART_BAUD_RETRY_BOOTS) {
+    if (uartFailedBaud == target) {
+      logMessagef(2, "🔁 Se vuelve a probar %lu baud", (unsigned long)target);
+    }
+    modemUartClearFailed();
+    return;
+  }
+  uartFailedBoots++;
+  modemUartStore("baudboots", uartFailedBoots);
+}
+
+/**
+ * Cambia la velocidad del UART del lado del ESP32
+ */
+static void modemUartSetBaud(uint32_t baud) {
+  if (baud == uartBaud) return;
+  SerialAT.flush();
+  SerialAT.updateBaudRate(baud);
+  uartBaud = baud;
+  logMessagef(3, "🔧 UART del módem a %lu baud", (unsigned long)baud);
+}
+
+/**
+ * Abre el UART a la velocidad guardada; en los arranques siguientes solo la ajusta
+ */
+static void modemUartBegin() {
+  modemUartLoad();
+  uint32_t baud = uartSavedBaud != 0 ? uartSavedBaud : UART_BAUD;
+  uartProbeIndex = 0;
+
+  if (uartStarted) {
+    modemUartSetBaud(baud);
+    return;
+  }
+
+  SerialAT.setRxBufferSize(SERIAL_AT_RX_BUFFER);
+  SerialAT.begin(baud, SERIAL_8N1, PIN_RX, PIN_TX);
+  uartBaud = baud;
+  uartStarted = true;
+
+  if (uartFlowControl && PIN_RTS >= 0 && PIN_CTS >= 0) {
+    SerialAT.setPins(PIN_RX, PIN_TX, PIN_CTS, PIN_RTS);
+    SerialAT.setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, UART_RTS_THRESHOLD);
+  }
+}
+
+/**
+ * Pasa a la siguiente velocidad candidata tras una sonda AT sin respuesta
+ * @details Alterna entre la guardada, la de fábrica y la pedida, por si el
+ * módem conservó una velocidad distinta a la de NVS (NVS borrada, AT&W previo)
+ */
+static void modemUartNextProbe() {
+  uint32_t candidates[3] = {
+    uartSavedBaud != 0 ? uartSavedBaud : UART_BAUD,
+    UART_BAUD,
+    uartTargetBaud != 0 ? uartTargetBaud : UART_BAUD
+  };
+
+  for (uint8_t n = 0; n < 3; ++n) {
+    uartProbeIndex = (uint8_t)((uartProbeIndex + 1) % 3);
+    if (candidates[uartProbeIndex] != uartBaud) {
+      modemUartSetBaud(candidates[uartProbeIndex]);
+      return;
+    }
+  }
+}
+
+/**
+ * Indica si el arranque debe pasar por la negociación del UART
+ */
+static bool modemUartNeedsSetup() {
+  uint32_t target = uartTargetBaud != 0 ? uartTargetBaud : UART_BAUD;
+  if (uartFlowControl) return true;
+  return target != uartBaud && target != uartFailedBaud;
+}
+
+/**
+ * Indica si un paso de configuración debe omitirse
+ */
+static bool modemStepSkipped(uint8_t step) {
+  if (step >= SETUP_STEP_COUNT) return false;
+  if (modemSteps[step].command == NULL) return true;
+  if (step == SETUP_STEP_CFUN_RESET && smPrevOk) return true;
+  return (smSkip & (1u << step)) != 0;
+}
+
+/**
+ * Procesa la respuesta de los pasos que extraen información
+ */
+static void modemStepFinished(uint8_t step, bool ok, const char* response) {
+  if (step >= SETUP_STEP_LTE_FIRST && step <= SETUP_STEP_PDP && !ok) smLteOk = false;
+  if (!ok) return;
+
+  if (step == SETUP_STEP_CNACT_QUERY) {
+    logMessage(2, "⚡ Contexto PDP ya activo");
+    smSkip |= (1u << SETUP_STEP_CNACT);
+    return;
+  }
+
+  if (step == SETUP_STEP_CCID) {
+    modemInfoUpdate(MODEM_INFO_ICCID, response);
+  } else if (step == SETUP_STEP_CSQ) {
+    modemInfoUpdate(MODEM_INFO_SIGNAL, response);
+    logSimInfo();
+  }
+}
+
+/**
+ * Finaliza el arranque con el estado indicado
+ */
+static void modemFinishStartup(ModemState finalState) {
+  modemState = finalState;
+  modemInitialized = true;
+  logMessage(2, "🏁 Configuración del módem completada");
+  if (finalState == MODEM_STATE_READY) memMarkBaseline(false);
+}
+
+/**
+ * Marca la conexión LTE como fallida
+ */
+static void modemLteFailed() {
+  consecutiveFailures++;
+  logMessagef(1, "⚠️  Fallo en conexión LTE (intento %d)", consecutiveFailures);
+  modemFinishStartup(MODEM_STATE_FAILED);
+}
+
+/**
+ * Termina la negociación del UART y sigue con la configuración
+ */
+static void modemUartDone() {
+  smStep = 0;
+  smRetry = 0;
+  smPrevOk = true;
+  smTimer = millis();
+  modemState = MODEM_STATE_CONFIGURE;
+}
+
+/**
+ * Inicia la etapa LTE de la máquina de estados
+ * @param openTcp - true para abrir TCP persistente al registrarse
+ */
+static void modemBeginLte(bool openTcp) {
+  smOpenTcp = openTcp;
+  smFast = false;
+  smSkip = (1u << SETUP_STEP_CNACT_QUERY);
+  smLteOk = true;
+  smPdpActive = false;
+  smAwaiting = false;
+  smStep = SETUP_STEP_LTE_FIRST;
+  smPrevOk = true;
+  smTimer = millis();
+  modemState = MODEM_STATE_CONFIGURE;
+}
+
+bool modemIsStarting() {
+  return modemState != MODEM_STATE_OFF &&
+         modemState != MODEM_STATE_READY &&
+         modemState != MODEM_STATE_FAILED;
+}
+
+ModemState modemGetState() {
+  return modemState;
+}
+
+/**
+ * Carga la configuración del perfil y abre el monitor serie, solo la primera vez
+ * @details Así los reinicios posteriores (setupModem*() de nuevo o la escalada
+ * PWRKEY) conservan el servidor y el puerto cambiados en tiempo de ejecución
+ */
+static void modemFirstStartup() {
+  static bool started = false;
+  if (started) return;
+  started = true;
+
+  if (!modemConfigLoaded) initModemConfig();
+  SerialMon.begin(115200);
+}
+
+/**
+ * Prepara el hardware y reinicia la máquina de estados de ambos arranques
+ */
+static void modemBeginStartup(bool fast) {
+  modemUartBegin();
+
+  logMessage(2, "📱 Iniciando comunicación GSM con SIM7080G");
+  pinMode(PWRKEY_PIN, OUTPUT);
+  digitalWrite(PWRKEY_PIN, LOW);
+
+  smOpenTcp = true;
+  smFast = fast;
+  smProbeOnly = fast;
+  tcpTlsInvalidate();
+  smSkip = fast ? modemFastSkipMask() : (1u << SETUP_STEP_CNACT_QUERY);
+  if (modemInfoValid(MODEM_INFO_ICCID)) smSkip |= (1u << SETUP_STEP_CCID);
+  smLteOk = true;
+  smPdpActive = false;
+  smAwaiting = false;
+  smRetry = 0;
+
+  modemInfoInvalidate(MODEM_INFO_OPERATOR);
+  modemInfoInvalidate(MODEM_INFO_CELL);
+  modemInfoInvalidate(MODEM_INFO_IP);
+  smStep = 0;
+}
+
+void setupModemAsync() {
+  modemFirstStartup();
+  logMessage(2, "🚀 Iniciando configuración del módem LTE/GSM");
+
+  modemBeginStartup(false);
+
+  logMessage(2, "🔌 Ejecutando secuencia de encendido inicial");
+  smTimer = millis() + 100;
+  modemState = MODEM_STATE_POWER_PULSE;
+}
+
+void setupModemFastAsync() {
+  modemFirstStartup();
+  logMessage(2, "⚡ Iniciando arranque rápido del módem LTE/GSM");
+
+  modemBeginStartup(true);
+
+  smTimer = millis();
+  modemState = MODEM_STATE_PROBE_AT;
+}
+
+void startLTEAsync() {
+  modemBeginLte(false);
+}
+
+/**
+ * Apaga el módem con +CPOWD y repite el arranque completo con PWRKEY
+ * @details Si el módem no responde al +CPOWD, el pulso puede apagarlo en
+ * lugar de encenderlo; la sonda AT lo detecta y repite el pulso
+ */
+static void modemPowerCycleAsync() {
+  modemBeginStartup(false);
+
+  atOpSubmit(smOp, "+CPOWD=1", "NORMAL POWER DOWN", 5000);
+  smTimer = millis() + MODEM_POWER_OFF_DELAY;
+  modemState = MODEM_STATE_POWER_PULSE;
+}
+
+/**
+ * Avanza la máquina de estados de arranque del módem sin bloquear
+ */
+static void modemLifecyclePoll() {
+  if (!modemIsStarting()) return;
+  if (smOp.pending || !modemTimerExpired(smTimer)) return;
+
+  switch (modemState) {
+    case MODEM_STATE_POWER_PULSE:
+      if (smStep == 0) {
+        digitalWrite(PWRKEY_PIN, HIGH);
+        smTimer = millis() + MODEM_PWRKEY_DELAY;
+        smStep = 1;
+      } else if (smStep == 1) {
+        digitalWrite(PWRKEY_PIN, LOW);
+        logMessage(3, "⏳ Esperando estabilización del módem (3s)...");
+        smTimer = millis() + 3000;
+        smStep = 2;
+      } else if (smStep == 2) {
+        logMessage(2, "✅ Secuencia PWRKEY completada");
+        smAwaiting = false;
+        modemState = MODEM_STATE_PROBE_AT;
+      } else if (smStep == 10) {
+        digitalWrite(PWRKEY_PIN, LOW);
+        smTimer = millis() + LONG_DELAY;
+        smStep = 11;
+      } else {
+        digitalWrite(PWRKEY_PIN, LOW);
+        smTimer = millis() + 100;
+        smStep = 0;
+      }
+      break;
+
+    case MODEM_STATE_PROBE_AT:
+      if (!smAwaiting) {
+        atOpSubmit(smOp, "", "OK", 2000);
+        smAwaiting = true;
+        break;
+      }
+
+      smAwaiting = false;
+      if (smOp.result == 1) {
+        logMessagef(2, "✅ Comunicación AT establecida con SIM7080G (%lu baud)", (unsigned long)uartBaud);
+        logMessage(2, "🔍 Verificando estado del módem");
+        if (uartBaud != uartSavedBaud) {
+          modemUartStore("baud", uartBaud);
+          uartSavedBaud = uartBaud;
+        }
+        smStep = 0;
+        smRetry = 0;
+        smPrevOk = true;
+        modemState = modemUartNeedsSetup() ? MODEM_STATE_UART : MODEM_STATE_CONFIGURE;
+        break;
+      }
+
+      logMessagef(3, "🔄 Esperando respuesta AT del SIM7080G... (intento %d)", smRetry + 1);
+      modemUartNextProbe();
+      if (smProbeOnly && ++smRetry >= FAST_PROBE_RETRIES) {
+        logMessage(2, "🔌 Módem sin respuesta, ejecutando secuencia de encendido");
+        smProbeOnly = false;
+        smRetry = 0;
+        smStep = 0;
+        smTimer = millis() + 100;
+        modemState = MODEM_STATE_POWER_PULSE;
+      } else if (smProbeOnly) {
+        smTimer = millis() + 500;
+      } else if (smRetry++ >= PROBE_AT_MAX_RETRIES) {
+        logMessage(1, "⚠️  Sin respuesta AT, ejecutando nuevo ciclo de encendido");
+        digitalWrite(PWRKEY_PIN, HIGH);
+        smTimer = millis() + 1500;
+        smStep = 10;
+        smRetry = 0;
+        modemState = MODEM_STATE_POWER_PULSE;
+      } else {
+        smTimer = millis() + 500;
+      }
+      break;
+
+    case MODEM_STATE_UART: {
+      uint32_t target = uartTargetBaud != 0 ? uartTargetBaud : UART_BAUD;
+      char command[AT_COMMAND_MAX];
+
+      switch (smStep) {
+        case 0:
+          if (!uartFlowControl) {
+            smStep = 2;
+            break;
+          }
+          atOpSubmit(smOp, "+IFC=2,2", "OK", getAdaptiveTimeout(MODEM_RTT_LOCAL));
+          smStep = 1;
+          break;
+
+        case 1:
+          if (smOp.result == 1) {
+            logMessage(2, "✅ Control de flujo RTS/CTS activado");
+          } else {
+            logMessage(1, "⚠️  El módem no aceptó +IFC, se sigue sin control de flujo");
+          }
+          smStep = 2;
+          break;
+
+        case 2:
+          if (target == uartBaud || target == uartFailedBaud) {
+            modemUartDone();
+            break;
+          }
+          snprintf(command, sizeof(command), "+IPR=%lu", (unsigned long)target);
+          atOpSubmit(smOp, command, "OK", getAdaptiveTimeout(MODEM_RTT_LOCAL));
+          smStep = 3;
+          break;
+
+        case 3:
+          if (smOp.result != 1) {
+            logMessagef(1, "⚠️  El módem no acepta %lu baud, se mantiene %lu",
+                        (unsigned long)target, (unsigned long)uartBaud);
+            modemUartNoteFailed(target);
+            modemUartDone();
+            break;
+          }
+          // El OK llega a la velocidad anterior; el módem cambia después
+          uartPreviousBaud = uartBaud;
+          modemUartSetBaud(target);
+          smRetry = 0;
+          smTimer = millis() + UART_SWITCH_DELAY;
+          smStep = 4;
+          break;
+
+        case 4:
+          atOpSubmit(smOp, "", "OK", UART_PROBE_TIMEOUT);
+          smStep = 5;
+          break;
+
+        case 5:
+          if (smOp.result == 1) {
+            atOpSubmit(smOp, "&W", "OK", getAdaptiveTimeout(MODEM_RTT_LOCAL));
+            smStep = 6;
+          } else if (++smRetry < UART_VERIFY_RETRIES) {
+            smTimer = millis() + UART_SWITCH_DELAY;
+            smStep = 4;
+          } else {
+            // Enlace no confiable a la nueva velocidad: se intenta devolver el módem a la anterior
+            logMessagef(1, "⚠️  Sin respuesta a %lu baud, volviendo a %lu",
+                        (unsigned long)target, (unsigned long)uartPreviousBaud);
+            snprintf(command, sizeof(command), "+IPR=%lu", (unsigned long)uartPreviousBaud);
+            atOpSubmit(smOp, command, "OK", UART_PROBE_TIMEOUT);
+            smStep = 7;
+          }
+          break;
+
+        case 6:
+          if (smOp.result != 1) logMessage(1, "⚠️  AT&W falló: la velocidad no sobrevive a un reinicio");
+          uartSavedBaud = target;
+          modemUartStore("baud", target);
+          if (uartFailedBaud != 0) modemUartClearFailed();
+          logMessagef(2, "✅ UART del módem a %lu baud", (unsigned long)target);
+          modemUartDone();
+          break;
+
+        default:
+          modemUartNoteFailed(target);
+          modemUartSetBaud(uartPreviousBaud);
+          smAwaiting = false;
+          smRetry = 0;
+          smTimer = millis() + UART_SWITCH_DELAY;
+          modemState = MODEM_STATE_PROBE_AT;
+          break;
+      }
+      break;
+    }
+
+    case MODEM_STATE_CONFIGURE: {
+      if (smAwaiting) {
+        smAwaiting = false;
+        const ModemStep& def = modemSteps[smStep];
+
+        bool ok = (smOp.result == 1);
+        modemStepFinished(smStep, ok, smOp.response);
+
+        if (ok && def.okMessage != NULL) logMessage(2, def.okMessage);
+        if (!ok && def.failMessage != NULL) logMessage(def.failLevel, def.failMessage);
+
+        if (!ok && def.critical) {
+          modemLteFailed();
+          break;
+        }
+
+        smPrevOk = ok;
+        smTimer = millis() + def.postDelay;
+        smStep++;
+        break;
+      }
+
+      while (modemStepSkipped(smStep)) smStep++;
+
+      if (smStep >= SETUP_STEP_COUNT) {
+        if (smLteOk) modemStoreConfigHash();
+        smRegisterStart = millis();
+        modemState = MODEM_STATE_REGISTERING;
+        break;
+      }
+
+      if (smStep == SETUP_STEP_CCID) logMessage(2, "📱 Obteniendo información de la tarjeta SIM");
+      if (smStep == SETUP_STEP_LTE_FIRST) logMessage(2, "🌐 Iniciando conexión LTE");
+
+      const ModemStep& def = modemSteps[smStep];
+      atOpSubmit(smOp, def.command, def.expected, modemStepTimeout(def));
+      smAwaiting = true;
+      break;
+    }
+
+    case MODEM_STATE_REGISTERING: {
+      // Despierta con las URC +CEREG y +APP PDP; +CNACT? solo confirma al entrar
+      // y cada LTE_REGISTER_RECHECK por si alguna se perdió
+      bool active = smPdpActive;
+      if (smAwaiting) {
+        smAwaiting = false;
+        active = active || smOp.result == 1;
+      } else if (!active) {
+        atOpSubmit(smOp, "+CNACT?", "+CNACT: 0,1", 2000);
+        smAwaiting = true;
+        break;
+      }
+
+      if (active) {
+        logMessagef(2, "✅ Conectado a la red LTE (%lums)", millis() - smRegisterStart);
+        modemInfoRequest(MODEM_INFO_CELL);
+        modemInfoRequest(MODEM_INFO_IP);
+
+        if (smOpenTcp) {
+          logMessage(2, "✅ Conexión LTE establecida, iniciando TCP persistente");
+          smStep = smFast ? 0 : 1;
+          modemState = MODEM_STATE_TCP_CONNECT;
+        } else {
+          modemState = MODEM_STATE_READY;
+        }
+        break;
+      }
+
+      unsigned long elapsed = millis() - smRegisterStart;
+      if (elapsed >= LTE_REGISTER_TIMEOUT) {
+        logMessage(0, "❌ Timeout: No se pudo conectar a la red LTE");
+        modemLteFailed();
+        break;
+      }
+
+      unsigned long wait = LTE_REGISTER_TIMEOUT - elapsed;
+      smTimer = millis() + (wait < LTE_REGISTER_RECHECK ? wait : LTE_REGISTER_RECHECK);
+      break;
+    }
+
+    case MODEM_STATE_TCP_CONNECT:
+      if (!smAwaiting && smStep == 0) {
+        atOpSubmit(smOp, "+CASTATE?", "+CASTATE: 0,1", 2000);
+        smAwaiting = true;
+        break;
+      }
+
+      if (smStep == 0) {
+        smAwaiting = false;
+        if (tcpFinishOpen(smOp.result)) {
+          logMessage(2, "⚡ Conexión TCP persistente existente reutilizada");
+          consecutiveFailures = 0;
+          modemFinishStartup(MODEM_STATE_READY);
+        } else {
+          smStep = 1;
+        }
+        break;
+      }
+
+      if (!smAwaiting) {
+        int8_t tls = tcpTlsPoll();
+        if (tls == 0) break;
+
+        smAwaiting = true;
+        if (tls < 0) {
+          smOp.result = -1;
+          break;
+        }
+
+        logMessage(2, "🔌 Inicializando conexión TCP persistente");
+        tcpConnected = false;
+        tcpReconnectAttempts = 0;
+        char command[AT_COMMAND_MAX];
+        if (!tcpFormatOpenCommand(command, sizeof(command)) ||
+            !atOpSubmit(smOp, command, "+CAOPEN: 0,0", tcpPersistentOpenTimeout())) {
+          smOp.result = -1;
+        }
+        break;
+      }
+
+      smAwaiting = false;
+      if (tcpFinishOpen(smOp.result)) {
+        logMessage(2, "✅ Conexión TCP persistente establecida");
+        consecutiveFailures = 0;
+        logMessage(2, "🔗 Conexión TCP persistente mantenida para futuras operaciones");
+      } else {
+        logMessage(0, "❌ Falló inicialización de conexión TCP persistente");
+        logMessage(1, "⚠️  Fallo estableciendo TCP persistente");
+        consecutiveFailures++;
+      }
+      modemFinishStartup(MODEM_STATE_READY);
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * Avanza todas las máquinas de estado del módem
+ */
+void modemPoll() {
+  atEnginePoll();
+  modemLifecyclePoll();
+  modemPowerPoll();
+  tcpPersistentPoll();
+  transportPoll();
+  modemInfoPoll();
+  logPoll();
+  memPoll();
+}
+
+/**
+ * Alimenta el analizador con el UART hasta que decide o vence el plazo
+ * @return Resultado de atScanFeed(), o 0 si venció el plazo
+ */
+static int8_t atScanWait(AtResponseScanner& sc, uint32_t timeout_ms) {
+  uint32_t start = millis();
+
+  while (millis() - start < timeout_ms) {
+    while (SerialAT.available()) {
+      int8_t result = atScanFeed(sc, SerialAT.read());
+      if (result != 0) return result;
+    }
+    delay(1);
+  }
+
+  return 0;
+}
+
+/**
+ * Envía datos TCP con gestión robusta de errores
+ * @param data - Datos a enviar
+ * @param dataLen - Longitud de los datos
+ * @param crlf - Terminar el envío con CRLF
  * @param timeout_ms - Timeout en milisegundos
  * @return true si el envío es exitoso
  */
-bool tcpSendData(const String& datos, uint32_t timeout_ms) {
-  logMessage(3, "📤 Enviando " + String(datos.length()) + " bytes por TCP");
+static bool tcpSendBytes(const uint8_t* data, size_t dataLen, bool crlf, uint32_t timeout_ms) {
+  logMessagef(3, "📤 Enviando %u bytes por TCP", (unsigned)dataLen);
+
+  atEngineDrain();
+
+  flushPortSerial();
+  while (SerialAT.available()) SerialAT.read();
+
+  const size_t len = dataLen + (crlf ? 2 : 0);
+
+  char command[24];
+  snprintf(command, sizeof(command), "+CASEND=0,%u", (unsigned)len);
+  modem.sendAT(command);
+  unsigned long startMicros = micros();
+  uint32_t txBytes = strlen(command) + 4;
+
+  char response[AT_RESPONSE_MAX];
+  AtResponseScanner sc;
+  atScanBegin(sc, "", response, sizeof(response), command);
+  atScanPrompt(sc, ">");
+
+  int8_t prompt = atScanWait(sc, timeout_ms);
+  if (prompt != 1) {
+    logMessage(0, prompt == 0 ? "❌ Timeout esperando prompt '>' para envío"
+                              : "❌ Error del módem antes del prompt '>'");
+    modemStatsRecord(command, prompt, micros() - startMicros, txBytes, 0);
+    return false;
+  }
+  SerialAT.write(data, dataLen);
+  if (crlf) SerialAT.print("\r\n");
+  txBytes += len;
+
+  atScanExpect(sc, "");
+  int8_t result = atScanWait(sc, timeout_ms);
+  modemStatsRecord(command, result, micros() - startMicros, txBytes, 0);
+
+  if (result == 1) {
+    logMessage(3, "✅ Datos TCP enviados exitosamente");
+    return true;
+  }
+
+  if (result == -1) {
+    logMessage(0, "❌ Error en envío TCP");
+    return false;
+  }
+
+  logMessage(0, "❌ Timeout en envío TCP");
+  return false;
+}
+
+#if !GSMLTE_STATIC_ALLOC
+bool tcpSendData(const String& datos, uint32_t timeout_ms) {
+  return tcpSendBytes((const uint8_t*)datos.c_str(), datos.length(), true, timeout_ms);
+}
+#endif
+
+bool tcpSendData(const uint8_t* data, size_t len, uint32_t timeout_ms) {
+  return tcpSendBytes(data, len, false, timeout_ms);
+}
+
+
+
+/**
+ * Mensaje incluido en un envío, con su callback de finalización
+ */
+struct TcpBatchEntry {
+  TcpSendCallback callback;
+  void* ctx;
+  uint16_t end;        ///< Fin del mensaje dentro de los datos del envío
+  bool store;          ///< Guardar en flash si el envío falla
+};
+
+/**
+ * Envío pendiente en la cola de un socket
+ * @details Los datos se guardan ya terminados en CRLF en un buffer fijo; un
+ * lote es un envío con varios mensajes que aún no está listo (ready=false)
+ */
+struct TcpSendJob {
+  uint8_t data[TCP_CASEND_MAX];
+  uint16_t len;
+  uint32_t timeout;
+  TcpBatchEntry entries[TCP_BATCH_MAX_MESSAGES];
+  uint8_t count;
+  bool ready;
+  bool replay;
+  uint32_t ackEnd;       ///< Bytes escritos en la conexión al terminar este envío
+  uint8_t merged;        ///< Envíos siguientes de la cola copiados en este (ventana)
+};
+
+/**
+ * Mensaje escrito que espera la confirmación del servidor (ventana)
+ * @details El envío deja su lugar en la cola con el OK de +CASEND; de cada
+ * mensaje solo queda su callback y hasta qué byte debe confirmarse
+ */
+struct TcpInflight {
+  TcpSendCallback callback;
+  void* ctx;
+  uint32_t ackEnd;       ///< Bytes escritos en la conexión al terminar el envío
+  unsigned long ackBy;   ///< Plazo de confirmación
+};
+
+/**
+ * Fases de la máquina de estados de cada socket TCP
+ */
+enum TcpPhase {
+  TCP_PHASE_IDLE,
+  TCP_PHASE_CHECK,
+  TCP_PHASE_KEEPALIVE,
+  TCP_PHASE_CLOSE,
+  TCP_PHASE_REOPEN,
+  TCP_PHASE_OPEN,
+  TCP_PHASE_SEND,
+  TCP_PHASE_RECV,
+  TCP_PHASE_ACK
+};
+
+#define TCP_SEND_QUEUE_SIZE 4
+#define TCP_INFLIGHT_MAX 32              ///< Mensajes escritos sin confirmar por socket (ventana)
+#define TCP_RECONNECT_INTERVAL 5000
+#define TCP_BACKOFF_BASE 2000            ///< Espera tras la primera falla de reconexión
+#define TCP_BACKOFF_MAX 120000
+#define TCP_BREAKER_COOLDOWN 300000      ///< Circuito abierto tras agotar la escalada
+#define TCP_BREAKER_COOLDOWN_MAX 3600000
+#define TCP_REPLAY_TIMEOUT 15000
+#define TCP_ACK_POLL_INTERVAL 250        ///< Espera entre consultas +CAACK con envíos en vuelo
+#define TCP_ACK_TIMEOUT 15000            ///< Plazo mínimo para que el servidor confirme un envío
+#define TCP_COMPRESS_MIN 64              ///< Envíos más cortos no se comprimen
+#define TCP_TLS_CA_FILE "gsmlte_ca.crt"   ///< Nombres en /customer/ del sistema de archivos del módem
+#define TCP_TLS_CERT_FILE "gsmlte_cl.crt"
+#define TCP_TLS_KEY_FILE "gsmlte_cl.key"
+#define TCP_TLS_UPLOAD_TIMEOUT 10000     ///< Plazo de +CFSWFILE (también su tiempo de entrada)
+#define TCP_TLS_OPEN_TIMEOUT 30000       ///< +CAOPEN con TLS incluye el handshake
+#define TCP_DNS_QUERY_TIMEOUT 15000      ///< Espera de la respuesta +CDNSGIP tras el OK
+#define TCP_DNS_RETRY_INTERVAL 60000     ///< Nueva consulta tras una resolución fallida
+#define TCP_RX_MASK (TCP_RX_RING_SIZE - 1)
+#define TCP_INFLIGHT_MASK (TCP_INFLIGHT_MAX - 1)
+
+#if (TCP_INFLIGHT_MAX & TCP_INFLIGHT_MASK) != 0 || TCP_INFLIGHT_MAX < TCP_BATCH_MAX_MESSAGES
+#error "TCP_INFLIGHT_MAX debe ser potencia de 2 y no menor que TCP_BATCH_MAX_MESSAGES"
+#endif
+
+/**
+ * Estado de un canal +CAOPEN del módem
+ * @details El índice en tcpSockets es el identificador de conexión del
+ * SIM7080G. Cada socket tiene su propia máquina de estados, operación AT,
+ * cola de envíos y buffer de recepción, de modo que sus comandos se
+ * intercalan en la cola AT sin esperar a los demás. El socket 0 es la
+ * conexión persistente hacia modemConfig.
+ */
+struct TcpSocket {
+  bool inUse;
+  bool closing;
+  char host[MODEM_HOST_MAX];
+  char port[MODEM_PORT_MAX];
+
+  bool connected;
+  bool stateConfirmed;
+  unsigned long lastActivity;
+  int reconnectAttempts;
+  unsigned long retryAt;             ///< Próxima reconexión programada
+  uint8_t failures;                  ///< Reconexiones fallidas seguidas (backoff)
+
+  TcpPhase phase;
+  AtOp op;
+  unsigned long timer;
+  bool jobActive;
+  bool jobRetried;
+
+  TcpSendJob sendQueue[TCP_SEND_QUEUE_SIZE];
+  uint8_t sendHead;
+  uint8_t sendCount;
+  TcpSendJob* batchCurrent;
+  unsigned long batchOpened;
+  TcpInflight inflight[TCP_INFLIGHT_MAX];
+  uint8_t inflightHead;
+  uint8_t inflightCount;             ///< Mensajes escritos sin confirmar (ventana)
+  uint32_t txTotal;                  ///< Bytes escritos con +CASEND desde la apertura
+  uint32_t txAcked;                  ///< Bytes confirmados por el servidor (+CAACK)
+  unsigned long ackPollAt;
+  bool ackStalled;                   ///< La última consulta +CAACK no confirmó nada
+
+  uint8_t rxRing[TCP_RX_RING_SIZE];
+  volatile size_t rxHead;
+  volatile size_t rxTail;
+  bool rxPending;
+  size_t rxRequested;
+  size_t rxHeadBefore;
+  TcpReceiveCallback rxCallback;
+  void* rxCallbackCtx;
+};
+
+static TcpSocket tcpSockets[TCP_POOL_SIZE];
+
+bool& tcpConnected = tcpSockets[0].connected;
+unsigned long& lastTcpActivity = tcpSockets[0].lastActivity;
+int& tcpReconnectAttempts = tcpSockets[0].reconnectAttempts;
+
+static size_t tcpBatchLimit = 0;
+static unsigned long tcpBatchMaxLatency = 0;
+static size_t tcpSendWindow = 0;
+
+/**
+ * Buffer único para el envío comprimido en curso; el socket dueño lo libera
+ * al terminar su envío y mientras tanto los demás envían sin comprimir
+ */
+static bool tcpCompressEnabled = false;
+static uint8_t tcpPackBuffer[TCP_CASEND_MAX];
+static TcpSocket* tcpPackOwner = NULL;
+
+/**
+ * TLS del socket 0, resuelto por el módem (+CSSLCFG/+CASSLCFG)
+ * @details Los certificados se suben y convierten una sola vez por
+ * dispositivo (hash en NVS); el contexto SSL se configura una vez por arranque
+ * del módem y cada reconexión solo repite +CAOPEN. Los PEM son del llamador.
+ */
+static bool tlsEnabled = false;
+static const char* tlsCaCert = NULL;
+static const char* tlsClientCert = NULL;
+static const char* tlsClientKey = NULL;
+static bool tlsApplied = false;        ///< Contexto SSL configurado en este arranque del módem
+static bool tlsUpload = false;         ///< Los certificados del módem no coinciden con los PEM
+static bool tlsAwaiting = false;
+static uint8_t tlsStep = 0;
+static AtOp tlsOp;
+
+/**
+ * Fases de la resolución del servidor
+ */
+enum DnsPhase {
+  DNS_PHASE_IDLE,     ///< Esperando dnsTimer para consultar
+  DNS_PHASE_QUERY,    ///< +CDNSGIP en la cola AT
+  DNS_PHASE_WAIT      ///< OK recibido, esperando la URC +CDNSGIP
+};
+
+/**
+ * Dirección resuelta del servidor del socket 0
+ * @details Los candidatos para +CAOPEN son, en orden, la dirección resuelta
+ * (o la guardada en NVS), las alternativas configuradas y por último el
+ * nombre, que el módem resuelve por su cuenta. Una apertura fallida pasa al
+ * siguiente candidato; una resolución exitosa vuelve al primero.
+ */
+static bool dnsEnabled = false;
+static bool dnsLoaded = false;
+static unsigned long dnsTtl = TCP_DNS_TTL_DEFAULT;
+static char dnsAddress[TCP_DNS_ADDRESS_MAX];
+static uint32_t dnsHostHash = 0;           ///< Nombre al que corresponde dnsAddress
+static char dnsFallbacks[TCP_DNS_FALLBACK_MAX][TCP_DNS_ADDRESS_MAX];
+static uint8_t dnsFallbackCount = 0;
+static uint8_t dnsCandidate = 0;
+static bool dnsOpenIssued = false;         ///< El último +CAOPEN del socket 0 usó un candidato
+static DnsPhase dnsPhase = DNS_PHASE_IDLE;
+static bool dnsReplied = false;
+static unsigned long dnsTimer = 0;
+static AtOp dnsOp;
+
+/**
+ * Escalada de recuperación de la conexión persistente
+ * @details Cada falla aleja el siguiente intento con backoff exponencial y
+ * jitter. Agotados los intentos de un nivel se pasa al siguiente (socket,
+ * PDP, RF, PWRKEY); si el último falla se abre el circuito. Tras el
+ * enfriamiento (semiabierto) se repite la escalada completa.
+ */
+static TcpRecoverStage tcpRecoverLevel = TCP_RECOVER_SOCKET;
+static TcpBreakerState tcpBreaker = TCP_BREAKER_CLOSED;
+static uint8_t tcpRecoverFailures = 0;
+static uint8_t tcpBreakerTrips = 0;
+static bool tcpRecoverAwaiting = false;
+
+static bool tcpOfflineEnabled = false;
+static bool tcpReplayActive = false;
+static unsigned long tcpReplayRetryAt = 0;
+static ModemStoreCursor tcpReplayCursor;
+
+/**
+ * Identificador de conexión (+CAOPEN) de un socket
+ */
+static int tcpSocketId(const TcpSocket& s) {
+  return (int)(&s - tcpSockets);
+}
+
+/**
+ * Indica si el socket está asignado; el socket 0 siempre lo está
+ */
+static bool tcpSocketInUse(const TcpSocket& s) {
+  return &s == tcpSockets || s.inUse;
+}
+
+/**
+ * Obtiene un socket asignado a partir de su identificador
+ * @return Socket, o NULL si el identificador no es válido o está libre
+ */
+static TcpSocket* tcpSocketGet(int id) {
+  if (id < 0 || id >= TCP_POOL_SIZE) return NULL;
+  TcpSocket* s = &tcpSockets[id];
+  return tcpSocketInUse(*s) ? s : NULL;
+}
+
+/**
+ * Registra confirmación pasiva de que la conexión está abierta
+ */
+static void tcpConfirmActive(TcpSocket& s) {
+  s.connected = true;
+  s.stateConfirmed = true;
+  s.lastActivity = millis();
+}
+
+/**
+ * Marca el estado de la conexión como desconocido (requiere +CASTATE?)
+ */
+static void tcpMarkUnknown(TcpSocket& s) {
+  s.stateConfirmed = false;
+}
+
+/**
+ * Marca la conexión como cerrada por el módem
+ */
+static void tcpMarkClosed(TcpSocket& s) {
+  if (s.connected) {
+    logMessagef(1, "⚠️  Conexión TCP %d cerrada (notificación del módem)", tcpSocketId(s));
+  }
+  s.connected = false;
+  s.stateConfirmed = true;
+}
+
+/**
+ * Indica si el estado abierto de la conexión se conoce sin consultar al módem
+ * @details La confirmación caduca tras tcpKeepAliveInterval sin actividad
+ * @return true si la conexión está confirmada como abierta
+ */
+static bool tcpStateKnown(const TcpSocket& s) {
+  return s.connected && s.stateConfirmed &&
+         (millis() - s.lastActivity <= tcpKeepAliveInterval);
+}
+
+/**
+ * Espera antes del siguiente intento: exponencial con jitter
+ * @details La mitad del intervalo es fija y la otra aleatoria, para que los
+ * equipos que perdieron la red a la vez no reconecten sincronizados
+ * @param failures - Fallas consecutivas (1 = primera)
+ */
+static unsigned long tcpBackoffDelay(uint8_t failures) {
+  unsigned long delay = TCP_BACKOFF_BASE;
+  while (failures > 1 && delay < TCP_BACKOFF_MAX) {
+    delay <<= 1;
+    failures--;
+  }
+  if (delay > TCP_BACKOFF_MAX) delay = TCP_BACKOFF_MAX;
+  return delay / 2 + random(delay / 2 + 1);
+}
+
+/**
+ * Cierra el circuito tras una apertura exitosa de la conexión persistente
+ */
+static void tcpRecoverReset() {
+  if (tcpBreaker != TCP_BREAKER_CLOSED || tcpRecoverLevel != TCP_RECOVER_SOCKET) {
+    logMessage(2, "✅ Conexión persistente recuperada, circuito cerrado");
+  }
+  tcpRecoverLevel = TCP_RECOVER_SOCKET;
+  tcpBreaker = TCP_BREAKER_CLOSED;
+  tcpRecoverFailures = 0;
+  tcpBreakerTrips = 0;
+  tcpRecoverAwaiting = false;
+}
+
+/**
+ * Abre el circuito: sin reconexiones hasta que pase el enfriamiento
+ * @details El enfriamiento se duplica en cada apertura consecutiva
+ */
+static void tcpRecoverTrip(TcpSocket& s) {
+  unsigned long cooldown = TCP_BREAKER_COOLDOWN;
+  for (uint8_t i = 0; i < tcpBreakerTrips && cooldown < TCP_BREAKER_COOLDOWN_MAX; ++i) {
+    cooldown <<= 1;
+  }
+  if (cooldown > TCP_BREAKER_COOLDOWN_MAX) cooldown = TCP_BREAKER_COOLDOWN_MAX;
+  cooldown = cooldown - cooldown / 4 + random(cooldown / 4 + 1);
+
+  if (tcpBreakerTrips < 255) tcpBreakerTrips++;
+  tcpBreaker = TCP_BREAKER_OPEN;
+  tcpRecoverLevel = TCP_RECOVER_SOCKET;
+  tcpRecoverAwaiting = false;
+  s.reconnectAttempts = 0;
+  s.retryAt = millis() + cooldown;
+  modemStatsNoteBreakerTrip();
+  logMessagef(0, "⛔ Circuito abierto: sin reconexiones TCP por %lus", cooldown / 1000);
+}
+
+/**
+ * Programa el siguiente intento tras una reconexión fallida
+ */
+static void tcpScheduleRetry(TcpSocket& s) {
+  if (&s != tcpSockets) {
+    if (s.failures < 255) s.failures++;
+    s.retryAt = millis() + tcpBackoffDelay(s.failures);
+    return;
+  }
+
+  if (tcpRecoverFailures < 255) tcpRecoverFailures++;
+  unsigned long delay = tcpBackoffDelay(tcpRecoverFailures);
+  s.retryAt = millis() + delay;
+  logMessagef(2, "⏳ Próximo intento de reconexión TCP en %lums", delay);
+}
+
+/**
+ * Ejecuta el siguiente nivel de la escalada (PDP, RF o PWRKEY)
+ * @details Todos reinician la etapa LTE, que reabre la conexión persistente
+ * al registrarse; el resultado se evalúa cuando la máquina de estados termina
+ */
+static void tcpRecoverEscalate(TcpSocket& s) {
+  tcpRecoverLevel = (TcpRecoverStage)(tcpRecoverLevel + 1);
+  tcpRecoverAwaiting = true;
+  s.reconnectAttempts = 0;
+  s.retryAt = millis();
+  modemStatsNoteLteRestart();
+
+  switch (tcpRecoverLevel) {
+    case TCP_RECOVER_PDP:
+      logMessage(1, "🔄 Escalada: reactivando contexto PDP (+CNACT)");
+      modemSubmitAT("+CNACT=0,0", "OK", getAdaptiveTimeout(MODEM_RTT_NETWORK), NULL, NULL);
+      modemBeginLte(true);
+      break;
+
+    case TCP_RECOVER_RF:
+      logMessage(1, "🔄 Escalada: reiniciando RF (+CFUN)");
+      modemSubmitAT("+CFUN=0", "OK", 10000, NULL, NULL);
+      modemSubmitAT("+CFUN=1", "OK", 10000, NULL, NULL);
+      modemBeginLte(true);
+      break;
+
+    default:
+      logMessage(0, "🔄 Escalada: ciclo de encendido del módem (PWRKEY)");
+      modemPowerCycleAsync();
+      break;
+  }
+}
+
+TcpBreakerState tcpBreakerState() {
+  return tcpBreaker;
+}
+
+TcpRecoverStage tcpRecoverStage() {
+  return tcpRecoverLevel;
+}
+
+/**
+ * Decide el siguiente paso de recuperación de la conexión persistente
+ */
+static void tcpRecoverStep(TcpSocket& s) {
+  if (tcpRecoverAwaiting) {
+    tcpRecoverAwaiting = false;
+    logMessage(1, "⚠️  El nivel de recuperación no restableció la conexión");
+    tcpScheduleRetry(s);
+    return;
+  }
+
+  if (tcpBreaker == TCP_BREAKER_OPEN) {
+    // La prueba recorre de nuevo la escalada: un intento de socket y luego
+    // PDP, RF y PWRKEY; el circuito solo vuelve a abrirse si falla el último
+    logMessage(2, "🔌 Circuito semiabierto: probando la conexión persistente");
+    tcpBreaker = TCP_BREAKER_HALF_OPEN;
+    tcpRecoverFailures = 0;
+    s.reconnectAttempts = MAX_RECONNECT_ATTEMPTS - 1;
+    tcpBeginReconnect(s);
+    return;
+  }
+
+  if (tcpRecoverLevel == TCP_RECOVER_SOCKET && s.reconnectAttempts < MAX_RECONNECT_ATTEMPTS) {
+    tcpBeginReconnect(s);
+    return;
+  }
+
+  if (tcpRecoverLevel == TCP_RECOVER_POWER) {
+    tcpRecoverTrip(s);
+    return;
+  }
+
+  tcpRecoverEscalate(s);
+}
+
+/**
+ * Reinicia el estado de los sockets al terminar el arranque del módem
+ * @param reused - true en arranque rápido: los canales pueden seguir abiertos
+ * y quedan sin confirmar. Si no, el módem se reinició y todos están cerrados.
+ */
+static void tcpPoolStartupReset(bool reused) {
+  for (int i = 1; i < TCP_POOL_SIZE; ++i) {
+    TcpSocket& s = tcpSockets[i];
+    if (!reused) s.connected = false;
+    s.stateConfirmed = false;
+    s.reconnectAttempts = 0;
+  }
+}
+
+/**
+ * Lee un entero decimal de una línea URC no terminada en NUL
+ * @param p - Posición actual; avanza tras el número
+ * @param end - Fin de la línea
+ * @return Valor leído, o -1 si no hay dígitos
+ */
+static int tcpUrcParseInt(const char*& p, const char* end) {
+  while (p < end && (*p == ' ' || *p == ',')) p++;
+  if (p >= end || *p < '0' || *p > '9') return -1;
+
+  int value = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10 + (*p++ - '0');
+  }
+  return value;
+}
+
+/**
+ * Handler URC de estado de conexión: +CASTATE, +CADATAIND, +CAURC y +APP PDP
+ * @details El identificador de conexión de cada línea selecciona el socket
+ */
+static void tcpUrcHandler(const char* line, size_t len, void* ctx) {
+  if (urcLineMatches(line, len, "+APP PDP", true)) modemInfoInvalidate(MODEM_INFO_IP);
+
+  if (urcLineMatches(line, len, "+APP PDP: 0,ACTIVE", false)) {
+    smPdpActive = true;
+    if (modemState == MODEM_STATE_REGISTERING) smTimer = millis();
+    return;
+  }
+
+  if (urcLineMatches(line, len, "+APP PDP: 0,DEACTIVE", false)) {
+    smPdpActive = false;
+    for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+      if (tcpSocketInUse(tcpSockets[i])) tcpMarkClosed(tcpSockets[i]);
+    }
+    return;
+  }
+
+  const char* end = line + len;
+  const char* p = (const char*)memchr(line, ':', len);
+  if (p == NULL) return;
+  p++;
+
+  bool dataIndication = urcLineMatches(line, len, "+CADATAIND", true);
+  if (urcLineMatches(line, len, "+CAURC", true)) {
+    if (!urcLineMatches(line, len, "+CAURC: \"recv\"", true)) return;
+    p = line + strlen("+CAURC: \"recv\"");
+    dataIndication = true;
+  }
+
+  TcpSocket* s = tcpSocketGet(tcpUrcParseInt(p, end));
+  if (s == NULL) return;
+
+  if (dataIndication) {
+    s->rxPending = true;
+    tcpConfirmActive(*s);
+    return;
+  }
+
+  int state = tcpUrcParseInt(p, end);
+  if (state == 0) {
+    tcpMarkClosed(*s);
+  } else if (state == 1) {
+    tcpConfirmActive(*s);
+  }
+}
+
+/**
+ * Handler URC de registro de red (+CEREG)
+ */
+static void ceregUrcHandler(const char* line, size_t len, void* ctx) {
+  const char* p = (const char*)memchr(line, ':', len);
+  if (p == NULL) return;
+
+  int status = atoi(p + 1);
+  if (urcIsSolicited()) {
+    const char* comma = (const char*)memchr(p, ',', len - (p - line));
+    if (comma == NULL) return;
+    status = atoi(comma + 1);
+  }
+
+  // Registrado (propia red o roaming): el contexto PDP suele seguir enseguida
+  if ((status == 1 || status == 5) && modemState == MODEM_STATE_REGISTERING) smTimer = millis();
+
+  if (status != networkRegStatus) {
+    networkRegStatus = status;
+    modemInfoInvalidate(MODEM_INFO_OPERATOR);
+    modemInfoInvalidate(MODEM_INFO_CELL);
+    logMessagef(3, "🌐 Registro de red: estado %d", status);
+  }
+}
+
+/**
+ * Copia el campo entre comillas número index de una línea URC
+ * @return false si la línea tiene menos campos o no cabe en el buffer
+ */
+static bool urcCopyQuoted(const char* line, size_t len, uint8_t index, char* dst, size_t size) {
+  const char* end = line + len;
+  const char* p = line;
+  for (uint8_t field = 0; p < end; ++field) {
+    const char* open = (const char*)memchr(p, '"', end - p);
+    if (open == NULL) return false;
+    const char* close = (const char*)memchr(open + 1, '"', end - open - 1);
+    if (close == NULL) return false;
+    if (field == index) {
+      size_t n = close - open - 1;
+      if (n == 0 || n >= size) return false;
+      memcpy(dst, open + 1, n);
+      dst[n] = '\0';
+      return true;
+    }
+    p = close + 1;
+  }
+  return false;
+}
+
+/**
+ * Guarda en NVS la dirección resuelta (solo si cambió)
+ */
+static void tcpResolverStore() {
+  Preferences prefs;
+  if (!prefs.begin(MODEM_NVS_NAMESPACE, false)) return;
+
+  char stored[TCP_DNS_ADDRESS_MAX] = "";
+  prefs.getString("dns", stored, sizeof(stored));
+  if (strcmp(stored, dnsAddress) != 0 || prefs.getUInt("dnshost", 0) != dnsHostHash) {
+    prefs.putString("dns", dnsAddress);
+    prefs.putUInt("dnshost", dnsHostHash);
+  }
+  prefs.end();
+}
+
+/**
+ * Handler URC del resultado de +CDNSGIP
+ * @details "+CDNSGIP: 1,"<nombre>","<ip1>"[,"<ip2>"]" o "+CDNSGIP: 0,<error>".
+ * El SIM7080G no informa el TTL del registro, así que la vigencia es la
+ * configurada con tcpResolverConfigure().
+ */
+static void dnsUrcHandler(const char* line, size_t len, void* ctx) {
+  if (dnsPhase == DNS_PHASE_IDLE) return;
+
+  const char* p = (const char*)memchr(line, ':', len);
+  if (p == NULL) return;
+  const char* end = line + len;
+  int status = tcpUrcParseInt(++p, end);
+
+  char address[TCP_DNS_ADDRESS_MAX];
+  dnsReplied = true;
+  if (status != 1 || !urcCopyQuoted(line, len, 1, address, sizeof(address))) {
+    logMessagef(1, "⚠️  No se pudo resolver %s, se mantiene la dirección anterior",
+                modemConfig.serverIP);
+    dnsTimer = millis() + TCP_DNS_RETRY_INTERVAL;
+    return;
+  }
+
+  dnsTimer = millis() + dnsTtl;
+  dnsCandidate = 0;
+  if (strcmp(address, dnsAddress) == 0) return;
+
+  copyBounded(dnsAddress, sizeof(dnsAddress), address);
+  dnsHostHash = modemHash(2166136261UL, modemConfig.serverIP, strlen(modemConfig.serverIP) + 1);
+  tcpResolverStore();
+  logMessagef(2, "🌐 %s resuelto a %s", modemConfig.serverIP, dnsAddress);
+}
+
+/**
+ * Registra los handlers URC internos la primera vez que se necesitan
+ */
+static void modemEnsureUrcHandlers() {
+  static bool registered = false;
+  if (registered) return;
+  registered = true;
+
+  urcRegisterHandler("+CASTATE", tcpUrcHandler, NULL);
+  urcRegisterHandler("+CADATAIND", tcpUrcHandler, NULL);
+  urcRegisterHandler("+CAURC", tcpUrcHandler, NULL);
+  urcRegisterHandler("+APP PDP", tcpUrcHandler, NULL);
+  urcRegisterHandler("+CEREG", ceregUrcHandler, NULL);
+  urcRegisterHandler("+CDNSGIP", dnsUrcHandler, NULL);
+}
+
+int modemRegistrationStatus() {
+  return networkRegStatus;
+}
+
+/**
+ * Pasos de configuración TLS del módem
+ */
+enum TlsStep {
+  TLS_STEP_FS_INIT,
+  TLS_STEP_WRITE_CA,
+  TLS_STEP_WRITE_CERT,
+  TLS_STEP_WRITE_KEY,
+  TLS_STEP_FS_TERM,
+  TLS_STEP_CONVERT_CA,
+  TLS_STEP_CONVERT_CERT,
+  TLS_STEP_UPLOAD_LAST = TLS_STEP_CONVERT_CERT,
+  TLS_STEP_VERSION,
+  TLS_STEP_RTC,
+  TLS_STEP_SNI,
+  TLS_STEP_ENABLE,
+  TLS_STEP_INDEX,
+  TLS_STEP_CACERT,
+  TLS_STEP_CERT,
+  TLS_STEP_COUNT
+};
+
+/**
+ * Definición de un paso TLS
+ */
+struct TlsStepDef {
+  char command[AT_COMMAND_MAX];
+  const char* payload;          ///< Contenido de +CFSWFILE (NULL si no sube archivo)
+  unsigned long timeout;
+};
+
+/**
+ * Construye el comando de un paso TLS
+ * @return false si el paso no aplica a la configuración actual
+ */
+static bool tcpTlsBuildStep(uint8_t step, TlsStepDef& def) {
+  const char* file = NULL;
+  def.payload = NULL;
+  def.timeout = 2000;
+
+  if (step <= TLS_STEP_UPLOAD_LAST && !tlsUpload) return false;
+
+  switch (step) {
+    case TLS_STEP_FS_INIT:
+      copyBounded(def.command, sizeof(def.command), "+CFSINIT");
+      return true;
+    case TLS_STEP_WRITE_CA:
+      def.payload = tlsCaCert;
+      file = TCP_TLS_CA_FILE;
+      break;
+    case TLS_STEP_WRITE_CERT:
+      def.payload = tlsClientCert;
+      file = TCP_TLS_CERT_FILE;
+      break;
+    case TLS_STEP_WRITE_KEY:
+      def.payload = tlsClientKey;
+      file = TCP_TLS_KEY_FILE;
+      break;
+    case TLS_STEP_FS_TERM:
+      copyBounded(def.command, sizeof(def.command), "+CFSTERM");
+      return true;
+    case TLS_STEP_CONVERT_CA:
+      if (tlsCaCert == NULL) return false;
+      snprintf(def.command, sizeof(def.command), "+CSSLCFG=\"convert\",2,\"%s\"", TCP_TLS_CA_FILE);
+      return true;
+    case TLS_STEP_CONVERT_CERT:
+      if (tlsClientCert == NULL) return false;
+      snprintf(def.command, sizeof(def.command), "+CSSLCFG=\"convert\",1,\"%s\",\"%s\"",
+               TCP_TLS_CERT_FILE, TCP_TLS_KEY_FILE);
+      return true;
+    case TLS_STEP_VERSION:
+      copyBounded(def.command, sizeof(def.command), "+CSSLCFG=\"sslversion\",0,3");
+      return true;
+    case TLS_STEP_RTC:
+      // Sin hora de red el reloj del módem no sirve para validar vigencias
+      copyBounded(def.command, sizeof(def.command), "+CSSLCFG=\"ignorertctime\",0,1");
+      return true;
+    case TLS_STEP_SNI:
+      snprintf(def.command, sizeof(def.command), "+CSSLCFG=\"sni\",0,\"%s\"", modemConfig.serverIP);
+      return true;
+    case TLS_STEP_ENABLE:
+      copyBounded(def.command, sizeof(def.command), "+CASSLCFG=0,\"SSL\",1");
+      return true;
+    case TLS_STEP_INDEX:
+      copyBounded(def.command, sizeof(def.command), "+CASSLCFG=0,\"CRINDEX\",0");
+      return true;
+    case TLS_STEP_CACERT:
+      if (tlsCaCert == NULL) return false;
+      snprintf(def.command, sizeof(def.command), "+CASSLCFG=0,\"CACERT\",\"%s\"", TCP_TLS_CA_FILE);
+      return true;
+    case TLS_STEP_CERT:
+      if (tlsClientCert == NULL) return false;
+      snprintf(def.command, sizeof(def.command), "+CASSLCFG=0,\"CERT\",\"%s\"", TCP_TLS_CERT_FILE);
+      return true;
+    default:
+      return false;
+  }
+
+  if (def.payload == NULL) return false;
+  snprintf(def.command, sizeof(def.command), "+CFSWFILE=3,\"%s\",0,%u,%u", file,
+           (unsigned)strlen(def.payload), (unsigned)TCP_TLS_UPLOAD_TIMEOUT);
+  def.timeout = TCP_TLS_UPLOAD_TIMEOUT + 2000;
+  return true;
+}
+
+/**
+ * Hash de los certificados configurados y sus nombres en el módem
+ */
+static uint32_t tcpTlsHash() {
+  const char* parts[] = {
+    TCP_TLS_CA_FILE, tlsCaCert, TCP_TLS_CERT_FILE, tlsClientCert, TCP_TLS_KEY_FILE, tlsClientKey
+  };
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); ++i) {
+    const char* part = parts[i] != NULL ? parts[i] : "";
+    hash = modemHash(hash, part, strlen(part) + 1);
+  }
+  return hash;
+}
+
+/**
+ * Obliga a reconfigurar el contexto SSL antes del próximo +CAOPEN
+ */
+static void tcpTlsInvalidate() {
+  tlsApplied = false;
+  tlsAwaiting = false;
+  tlsStep = 0;
+}
+
+/**
+ * Avanza la configuración TLS del módem
+ * @return 1=Lista (o TLS desactivado), -1=Falló, 0=En curso
+ */
+static int8_t tcpTlsPoll() {
+  if (!tlsEnabled || tlsApplied) return 1;
+  if (tlsOp.pending) return 0;
+
+  if (tlsAwaiting) {
+    tlsAwaiting = false;
+    if (tlsOp.result != 1) {
+      logMessagef(0, "❌ Falló configuración TLS del módem (paso %u)", (unsigned)tlsStep);
+      tlsStep = 0;
+      return -1;
+    }
+    tlsStep++;
+  }
+
+  if (tlsStep == 0) {
+    Preferences prefs;
+    uint32_t stored = 0;
+    if (prefs.begin(MODEM_NVS_NAMESPACE, true)) {
+      stored = prefs.getUInt("tls", 0);
+      prefs.end();
+    }
+    tlsUpload = (tlsCaCert != NULL || tlsClientCert != NULL) && stored != tcpTlsHash();
+    logMessage(2, tlsUpload ? "🔐 Cargando certificados TLS en el módem" :
+                              "🔐 Configurando TLS del módem");
+  }
+
+  TlsStepDef def;
+  while (tlsStep < TLS_STEP_COUNT && !tcpTlsBuildStep(tlsStep, def)) tlsStep++;
+
+  if (tlsStep >= TLS_STEP_COUNT) {
+    if (tlsUpload) {
+      Preferences prefs;
+      if (prefs.begin(MODEM_NVS_NAMESPACE, false)) {
+        prefs.putUInt("tls", tcpTlsHash());
+        prefs.end();
+      }
+      logMessage(3, "💾 Certificados TLS guardados en el módem");
+    }
+    tlsApplied = true;
+    tlsStep = 0;
+    logMessage(2, "✅ TLS del módem configurado");
+    return 1;
+  }
+
+  bool queued = def.payload != NULL ?
+      atOpSubmitUpload(tlsOp, def.command, def.timeout,
+                       reinterpret_cast<const uint8_t*>(def.payload), strlen(def.payload)) :
+      atOpSubmit(tlsOp, def.command, "", def.timeout);
+  if (!queued) return 0;
+
+  tlsAwaiting = true;
+  return 0;
+}
+
+/**
+ * Indica si el nombre ya es una dirección IP (no hay nada que resolver)
+ */
+static bool tcpIsAddressLiteral(const char* host) {
+  if (strchr(host, ':') != NULL) return true;
+  for (; *host != '\0'; ++host) {
+    if ((*host < '0' || *host > '9') && *host != '.') return false;
+  }
+  return true;
+}
+
+/**
+ * Lee de NVS la última dirección resuelta; queda vencida para confirmarla en
+ * segundo plano, pero sirve desde ya para conectar sin consultar DNS
+ */
+static void tcpResolverLoad() {
+  if (dnsLoaded) return;
+  dnsLoaded = true;
+
+  Preferences prefs;
+  if (prefs.begin(MODEM_NVS_NAMESPACE, true)) {
+    dnsAddress[0] = '\0';
+    prefs.getString("dns", dnsAddress, sizeof(dnsAddress));
+    dnsHostHash = prefs.getUInt("dnshost", 0);
+    prefs.end();
+  }
+  dnsTimer = millis();
+}
+
+/**
+ * Indica si la resolución puede consultar al módem ahora
+ */
+static bool tcpResolverActive() {
+  return dnsEnabled && modemInitialized && !modemIsStarting() && modemPowerAwake() &&
+         !tcpIsAddressLiteral(modemConfig.serverIP);
+}
+
+/**
+ * Dirección con la que abrir el socket 0
+ */
+static const char* tcpResolverHost() {
+  if (!dnsEnabled || tcpIsAddressLiteral(modemConfig.serverIP)) return modemConfig.serverIP;
+  tcpResolverLoad();
+
+  uint32_t host = modemHash(2166136261UL, modemConfig.serverIP, strlen(modemConfig.serverIP) + 1);
+  if (host != dnsHostHash) dnsAddress[0] = '\0';
+
+  if (dnsCandidate == 0 && dnsAddress[0] == '\0') dnsCandidate = 1;
+  if (dnsCandidate > dnsFallbackCount + 1) dnsCandidate = 0;
+
+  dnsOpenIssued = true;
+  if (dnsCandidate == 0) return dnsAddress;
+  if (dnsCandidate <= dnsFallbackCount) return dnsFallbacks[dnsCandidate - 1];
+  return modemConfig.serverIP;
+}
+
+/**
+ * Registra el resultado de un +CAOPEN del socket 0
+ * @details Si falló se prueba el siguiente candidato; si falló la dirección
+ * resuelta se vuelve a consultar de inmediato
+ */
+static void tcpResolverOpenResult(bool ok) {
+  if (!dnsOpenIssued) return;
+  dnsOpenIssued = false;
+  if (ok) return;
+
+  if (dnsCandidate == 0) dnsTimer = millis();
+  dnsCandidate = (dnsCandidate + 1) % (dnsFallbackCount + 2);
+}
+
+/**
+ * Avanza la resolución del servidor en segundo plano
+ */
+static void tcpResolverPoll() {
+  if (!tcpResolverActive() || dnsOp.pending) return;
+  tcpResolverLoad();
+
+  switch (dnsPhase) {
+    case DNS_PHASE_IDLE: {
+      if (!modemTimerExpired(dnsTimer)) return;
+      char command[AT_COMMAND_MAX];
+      snprintf(command, sizeof(command), "+CDNSGIP=\"%s\",1,10000", modemConfig.serverIP);
+      if (!atOpSubmit(dnsOp, command, "", 2000)) return;
+      dnsReplied = false;
+      dnsPhase = DNS_PHASE_QUERY;
+      return;
+    }
+
+    case DNS_PHASE_QUERY:
+      if (dnsOp.result == 1) {
+        dnsPhase = DNS_PHASE_WAIT;
+        if (!dnsReplied) dnsTimer = millis() + TCP_DNS_QUERY_TIMEOUT;
+        return;
+      }
+      logMessagef(1, "⚠️  +CDNSGIP rechazado para %s", modemConfig.serverIP);
+      dnsTimer = millis() + TCP_DNS_RETRY_INTERVAL;
+      dnsPhase = DNS_PHASE_IDLE;
+      return;
+
+    case DNS_PHASE_WAIT:
+      if (dnsReplied) {
+        dnsPhase = DNS_PHASE_IDLE;
+      } else if (modemTimerExpired(dnsTimer)) {
+        logMessagef(1, "⚠️  Sin respuesta DNS para %s", modemConfig.serverIP);
+        dnsTimer = millis() + TCP_DNS_RETRY_INTERVAL;
+        dnsPhase = DNS_PHASE_IDLE;
+      }
+      return;
+  }
+}
+
+/**
+ * Plazo de +CAOPEN de un socket (con TLS incluye el handshake)
+ */
+static unsigned long tcpOpenTimeout(const TcpSocket& s) {
+  unsigned long timeout = getAdaptiveTimeout();
+  if (tlsEnabled && &s == tcpSockets && timeout < TCP_TLS_OPEN_TIMEOUT) {
+    timeout = TCP_TLS_OPEN_TIMEOUT;
+  }
+  return timeout;
+}
+
+static unsigned long tcpPersistentOpenTimeout() {
+  return tcpOpenTimeout(tcpSockets[0]);
+}
+
+/**
+ * Construye el comando de apertura de un socket hacia su servidor
+ * @param buffer - Buffer de salida
+ * @param size - Capacidad del buffer
+ * @return false si el comando no cabe en el buffer
+ */
+static bool tcpSocketFormatOpen(const TcpSocket& s, char* buffer, size_t size) {
+  bool primary = &s == tcpSockets;
+  int len = snprintf(buffer, size, "+CAOPEN=%d,0,\"TCP\",\"%s\",%s", tcpSocketId(s),
+                     primary ? tcpResolverHost() : s.host,
+                     primary ? modemConfig.serverPort : s.port);
+  return len > 0 && (size_t)len < size;
+}
+
+/**
+ * Construye el comando de apertura TCP hacia el servidor configurado
+ * @param buffer - Buffer de salida
+ * @param size - Capacidad del buffer
+ * @return false si el comando no cabe en el buffer
+ */
+static bool tcpFormatOpenCommand(char* buffer, size_t size) {
+  return tcpSocketFormatOpen(tcpSockets[0], buffer, size);
+}
+
+/**
+ * Construye la respuesta esperada "<prefijo> <id>,<valor>" de un socket
+ */
+static void tcpSocketExpected(const TcpSocket& s, const char* prefix, int value,
+                              char* buffer, size_t size) {
+  snprintf(buffer, size, "%s %d,%d", prefix, tcpSocketId(s), value);
+}
+
+/**
+ * Encola un +CASTATE? que confirma que el socket sigue abierto
+ */
+static bool tcpSubmitStateQuery(TcpSocket& s, unsigned long timeout) {
+  char expected[AT_EXPECTED_MAX];
+  tcpSocketExpected(s, "+CASTATE:", 1, expected, sizeof(expected));
+  return atOpSubmit(s.op, "+CASTATE?", expected, timeout);
+}
+
+/**
+ * Encola el +CAOPEN de un socket
+ */
+static bool tcpSubmitOpen(TcpSocket& s) {
+  char command[AT_COMMAND_MAX];
+  char expected[AT_EXPECTED_MAX];
+  if (!tcpSocketFormatOpen(s, command, sizeof(command))) return false;
+  tcpSocketExpected(s, "+CAOPEN:", 0, expected, sizeof(expected));
+  return atOpSubmit(s.op, command, expected, tcpOpenTimeout(s));
+}
+
+/**
+ * Abre la conexión TCP de forma bloqueante
+ * @return Resultado de +CAOPEN: 1=Abierta, -1=Error, 0=Timeout
+ */
+static int8_t tcpOpenBlocking() {
+  char command[AT_COMMAND_MAX];
+  if (!tcpFormatOpenCommand(command, sizeof(command))) return -1;
+
+  int8_t tls;
+  while ((tls = tcpTlsPoll()) == 0) {
+    atEnginePoll();
+    logPoll();
+    delay(1);
+  }
+  if (tls < 0) return -1;
+
+  return sendATCommandBuf(command, "+CAOPEN: 0,0", NULL, 0, tcpPersistentOpenTimeout());
+}
+
+/**
+ * Actualiza el estado de un socket tras un intento de apertura
+ * @param result - Resultado del comando +CAOPEN
+ * @return true si la conexión quedó establecida
+ */
+static bool tcpSocketFinishOpen(TcpSocket& s, int8_t result) {
+  if (&s == tcpSockets) tcpResolverOpenResult(result == 1);
+  if (result != 1) {
+    tcpMarkUnknown(s);
+    return false;
+  }
+
+  // Una conexión nueva no confirma lo escrito en la anterior
+  tcpAckFail(s);
+  s.txTotal = 0;
+  s.txAcked = 0;
+
+  tcpConfirmActive(s);
+  s.reconnectAttempts = 0;
+  s.failures = 0;
+  if (&s == tcpSockets) tcpRecoverReset();
+  return true;
+}
+
+/**
+ * Actualiza el estado tras un intento de apertura de la conexión persistente
+ * @param result - Resultado del comando +CAOPEN o +CASTATE?
+ * @return true si la conexión quedó establecida
+ */
+static bool tcpFinishOpen(int8_t result) {
+  tcpPoolStartupReset(smFast);
+  return tcpSocketFinishOpen(tcpSockets[0], result);
+}
+
+/**
+ * Inicializa la conexión TCP persistente
+ * @return true si la conexión se establece exitosamente
+ */
+bool tcpInitPersistent() {
+  logMessage(2, "🔌 Inicializando conexión TCP persistente");
+  
+  tcpConnected = false;
+  tcpReconnectAttempts = 0;
+  
+  if (tcpSocketFinishOpen(tcpSockets[0], tcpOpenBlocking() == 1 ? 1 : -1)) {
+    logMessage(2, "✅ Conexión TCP persistente establecida");
+    return true;
+  }
+  
+  logMessage(0, "❌ Falló inicialización de conexión TCP persistente");
+  return false;
+}
+
+/**
+ * Verifica si la conexión TCP persistente está activa
+ * @return true si la conexión está activa
+ */
+bool tcpIsPersistentActive() {
+  TcpSocket& s = tcpSockets[0];
+  if (!s.connected) {
+    return false;
+  }
+  
+  if (tcpStateKnown(s)) {
+    return true;
+  }
+  
+  if (sendATCommand("+CASTATE?", "+CASTATE: 0,1", 5000)) {
+    tcpConfirmActive(s);
+    return true;
+  }
+  
+  logMessage(1, "⚠️  Conexión TCP persistente perdida - marcando como desconectada");
+  s.connected = false;
+  tcpMarkUnknown(s);
+  return false;
+}
+
+/**
+ * Mantiene la conexión TCP persistente enviando keep-alive
+ * @return true si la conexión sigue activa
+ */
+bool tcpKeepAlivePersistent() {
+  TcpSocket& s = tcpSockets[0];
+  unsigned long currentTime = millis();
+  
+  if (s.connected && (currentTime - s.lastActivity > tcpKeepAliveInterval)) {
+    logMessage(3, "💓 Enviando keep-alive TCP persistente");
+    
+    if (sendATCommand("+CASTATE?", "+CASTATE: 0,1", 5000)) {
+      tcpConfirmActive(s);
+      logMessage(3, "✅ Keep-alive TCP exitoso");
+      return true;
+    } else {
+      logMessage(1, "⚠️  Keep-alive TCP falló - conexión perdida");
+      s.connected = false;
+      tcpMarkUnknown(s);
+      return false;
+    }
+  }
+  
+  return s.connected;
+}
+
+/**
+ * Reconecta la conexión TCP persistente si se perdió
+ * @return true si se reconectó exitosamente
+ */
+bool tcpReconnectPersistent() {
+  if (tcpConnected) {
+    return true;
+  }
+  
+  TcpSocket& s = tcpSockets[0];
+  if (tcpBreaker == TCP_BREAKER_OPEN || !modemTimerExpired(s.retryAt) || modemIsStarting() ||
+      s.phase != TCP_PHASE_IDLE) {
+    logMessage(1, "⏳ Reconexión TCP persistente en espera (backoff o circuito abierto)");
+    return false;
+  }
+
+  // Un paso de la escalada (socket, PDP, RF o PWRKEY), bombeando modemPoll() hasta su desenlace
+  tcpRecoverStep(s);
+  while (!tcpConnected && (modemIsStarting() || s.phase != TCP_PHASE_IDLE)) {
+    modemPoll();
+    delay(1);
+  }
+
+  if (tcpConnected) {
+    logMessage(2, "✅ Reconexión TCP persistente exitosa");
+    return true;
+  }
+  
+  logMessage(1, "⚠️  Falló reconexión TCP persistente");
+  return false;
+}
+
+/**
+ * Callback de espera para la versión bloqueante de tcpSendPersistent
+ */
+static void tcpSyncSendCallback(bool success, void* ctx) {
+  int8_t* state = static_cast<int8_t*>(ctx);
+  *state = success ? 1 : -1;
+}
+
+/**
+ * Envía datos usando la conexión TCP persistente
+ * @param datos Datos a enviar
+ * @param timeout_ms Timeout en milisegundos
+ * @return true si el envío es exitoso
+ */
+bool tcpSendPersistent(const char* data, size_t len, uint32_t timeout_ms) {
+  int8_t state = 0;
+  if (!tcpSendPersistentAsync(data, len, timeout_ms, tcpSyncSendCallback, &state)) {
+    return false;
+  }
+
+  while (state == 0) {
+    modemPoll();
+    delay(1);
+  }
+
+  return state == 1;
+}
+
+#if !GSMLTE_STATIC_ALLOC
+bool tcpSendPersistent(const String& datos, uint32_t timeout_ms) {
+  return tcpSendPersistent(datos.c_str(), datos.length(), timeout_ms);
+}
+#endif
+
+/**
+ * Espacio libre en el buffer circular de recepción de un socket
+ */
+static size_t tcpRxFree(const TcpSocket& s) {
+  return TCP_RX_RING_SIZE - (s.rxHead - s.rxTail);
+}
+
+/**
+ * Obtiene el tramo contiguo libre del buffer de recepción
+ * @param span - Inicio del tramo
+ * @return Bytes que pueden escribirse en el tramo
+ */
+static size_t tcpRxWriteSpan(TcpSocket* s, uint8_t** span) {
+  size_t index = s->rxHead & TCP_RX_MASK;
+  size_t room = tcpRxFree(*s);
+  if (room > TCP_RX_RING_SIZE - index) room = TCP_RX_RING_SIZE - index;
+  *span = s->rxRing + index;
+  return room;
+}
+
+/**
+ * Confirma bytes escritos en el tramo obtenido con tcpRxWriteSpan()
+ */
+static void tcpRxCommit(TcpSocket* s, size_t len) {
+  s->rxHead += len;
+  tcpMemNote();
+}
+
+size_t tcpSocketAvailable(int id) {
+  TcpSocket* s = tcpSocketGet(id);
+  return s != NULL ? s->rxHead - s->rxTail : 0;
+}
+
+size_t tcpSocketPeekSpan(int id, const uint8_t** data) {
+  TcpSocket* s = tcpSocketGet(id);
+  if (s == NULL) return 0;
+
+  size_t index = s->rxTail & TCP_RX_MASK;
+  size_t len = s->rxHead - s->rxTail;
+  if (len > TCP_RX_RING_SIZE - index) len = TCP_RX_RING_SIZE - index;
+  *data = s->rxRing + index;
+  return len;
+}
+
+void tcpSocketConsume(int id, size_t len) {
+  TcpSocket* s = tcpSocketGet(id);
+  if (s == NULL) return;
+
+  size_t available = s->rxHead - s->rxTail;
+  s->rxTail += (len < available) ? len : available;
+}
+
+size_t tcpSocketRead(int id, uint8_t* buffer, size_t len) {
+  size_t copied = 0;
+
+  while (copied < len) {
+    const uint8_t* span;
+    size_t n = tcpSocketPeekSpan(id, &span);
+    if (n == 0) break;
+    if (n > len - copied) n = len - copied;
+    memcpy(buffer + copied, span, n);
+    tcpSocketConsume(id, n);
+    copied += n;
+  }
+  return copied;
+}
+
+void tcpSocketSetReceiveCallback(int id, TcpReceiveCallback callback, void* ctx) {
+  TcpSocket* s = tcpSocketGet(id);
+  if (s == NULL) return;
+
+  s->rxCallbackCtx = ctx;
+  s->rxCallback = callback;
+}
+
+size_t tcpAvailable() {
+  return tcpSocketAvailable(0);
+}
+
+size_t tcpPeekSpan(const uint8_t** data) {
+  return tcpSocketPeekSpan(0, data);
+}
+
+void tcpConsume(size_t len) {
+  tcpSocketConsume(0, len);
+}
+
+size_t tcpRead(uint8_t* buffer, size_t len) {
+  return tcpSocketRead(0, buffer, len);
+}
+
+int tcpRead() {
+  uint8_t c;
+  return tcpSocketRead(0, &c, 1) == 1 ? c : -1;
+}
+
+void tcpSetReceiveCallback(TcpReceiveCallback callback, void* ctx) {
+  tcpSocketSetReceiveCallback(0, callback, ctx);
+}
+
+/**
+ * Entrega los datos recibidos al callback registrado, por tramos sin copia
+ */
+static void tcpRxDeliver(TcpSocket& s) {
+  if (s.rxCallback == NULL) return;
+
+  int id = tcpSocketId(s);
+  const uint8_t* span;
+  size_t n;
+  while ((n = tcpSocketPeekSpan(id, &span)) > 0) {
+    s.rxCallback(span, n, s.rxCallbackCtx);
+    tcpSocketConsume(id, n);
+  }
+}
+
+/**
+ * Solicita al módem el siguiente bloque de datos recibidos
+ * @details El bloque se limita al espacio libre del buffer y a TCP_RX_CHUNK,
+ * de modo que la respuesta completa cabe en el buffer RX del UART
+ */
+static void tcpSubmitRecv(TcpSocket& s) {
+  size_t len = tcpRxFree(s);
+  if (len > TCP_RX_CHUNK) len = TCP_RX_CHUNK;
+
+  char command[24];
+  snprintf(command, sizeof(command), "+CARECV=%d,%u", tcpSocketId(s), (unsigned)len);
+
+  s.rxRequested = len;
+  s.rxHeadBefore = s.rxHead;
+  if (!atOpSubmitRecv(s.op, command, getAdaptiveTimeout(), &s)) {
+    s.op.result = -1;
+  }
+  s.phase = TCP_PHASE_RECV;
+}
+
+/**
+ * Informa la ocupación de las colas de envío y los anillos de recepción
+ */
+static void tcpMemNote() {
+  size_t jobs = 0;
+  size_t rx = 0;
+  for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+    jobs += tcpSockets[i].sendCount;
+    rx += tcpSockets[i].rxHead - tcpSockets[i].rxTail;
+  }
+  memNote(MEM_POOL_TCP_TX, jobs * sizeof(TcpSendJob), TCP_POOL_SIZE * sizeof(tcpSockets[0].sendQueue));
+  memNote(MEM_POOL_TCP_RX, rx, TCP_POOL_SIZE * TCP_RX_RING_SIZE);
+}
+
+/**
+ * Reserva un envío al final de la cola de un socket
+ * @return Envío vacío no listo, o NULL si la cola está llena
+ */
+static TcpSendJob* tcpQueueReserve(TcpSocket& s, uint32_t timeout_ms) {
+  if (s.sendCount >= TCP_SEND_QUEUE_SIZE) {
+    logMessagef(1, "⚠️  Cola de envío TCP %d llena, descartando datos", tcpSocketId(s));
+    return NULL;
+  }
+
+  TcpSendJob* job = &s.sendQueue[(s.sendHead + s.sendCount) % TCP_SEND_QUEUE_SIZE];
+  job->len = 0;
+  job->timeout = timeout_ms;
+  job->count = 0;
+  job->ready = false;
+  job->replay = false;
+  job->merged = 0;
+  s.sendCount++;
+  tcpMemNote();
+  return job;
+}
+
+/**
+ * Agrega un mensaje a un envío reservado
+ * @param raw - No agregar CRLF (registros binarios, ver gsmlte_frame.h)
+ */
+static void tcpJobAppend(TcpSendJob* job, const char* data, size_t len, bool raw,
+                         uint32_t timeout_ms, TcpSendCallback callback, void* ctx, bool store) {
+  memcpy(job->data + job->len, data, len);
+  if (!raw) {
+    memcpy(job->data + job->len + len, "\r\n", 2);
+    len += 2;
+  }
+  job->len += len;
+  if (timeout_ms > job->timeout) job->timeout = timeout_ms;
+
+  TcpBatchEntry& entry = job->entries[job->count++];
+  entry.callback = callback;
+  entry.ctx = ctx;
+  entry.end = job->len;
+  entry.store = store;
+}
+
+/**
+ * Marca como listo el lote en construcción de un socket
+ */
+static void tcpBatchFlush(TcpSocket& s) {
+  if (s.batchCurrent == NULL) return;
+
+  logMessagef(3, "📦 Lote TCP %d: %u mensajes, %u bytes", tcpSocketId(s),
+              (unsigned)s.batchCurrent->count, (unsigned)s.batchCurrent->len);
+
+  s.batchCurrent->ready = true;
+  s.batchCurrent = NULL;
+}
+
+bool tcpBatchFlush() {
+  for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+    tcpBatchFlush(tcpSockets[i]);
+  }
+  return true;
+}
+
+/**
+ * Agrega un mensaje al lote en construcción de un socket
+ * @return true si el mensaje quedó agrupado
+ */
+static bool tcpBatchAppend(TcpSocket& s, const char* data, size_t len, bool raw,
+                           uint32_t timeout_ms, TcpSendCallback callback, void* ctx, bool store) {
+  size_t framedLen = len + (raw ? 0 : 2);
+
+  if (s.batchCurrent != NULL &&
+      (s.batchCurrent->len + framedLen > tcpBatchLimit ||
+       s.batchCurrent->count >= TCP_BATCH_MAX_MESSAGES)) {
+    tcpBatchFlush(s);
+  }
+
+  if (s.batchCurrent == NULL) {
+    s.batchCurrent = tcpQueueReserve(s, 0);
+    if (s.batchCurrent == NULL) return false;
+    s.batchOpened = millis();
+  }
+
+  tcpJobAppend(s.batchCurrent, data, len, raw, timeout_ms, callback, ctx, store);
+
+  if (s.batchCurrent->len >= tcpBatchLimit) tcpBatchFlush(s);
+  return true;
+}
+
+/**
+ * Envía el lote en construcción cuando supera la latencia máxima
+ */
+static void tcpBatchPoll(TcpSocket& s) {
+  if (s.batchCurrent == NULL) return;
+  if (millis() - s.batchOpened >= tcpBatchMaxLatency) {
+    tcpBatchFlush(s);
+  }
+}
+
+void tcpSendWindowConfigure(size_t windowBytes) {
+  tcpSendWindow = windowBytes;
+  if (windowBytes > 0) {
+    logMessagef(2, "🔧 Envío TCP en ventana: hasta %u bytes sin confirmar", (unsigned)windowBytes);
+  } else {
+    logMessage(2, "🔧 Envío TCP en ventana desactivado");
+  }
+}
+
+void tcpCompressionConfigure(bool enable) {
+  tcpCompressEnabled = enable;
+  logMessagef(2, "🔧 Compresión LZ4 de envíos TCP %s", enable ? "activada" : "desactivada");
+}
+
+void tcpResolverConfigure(bool enable, unsigned long ttlMs) {
+  dnsEnabled = enable;
+  dnsTtl = ttlMs > 0 ? ttlMs : TCP_DNS_TTL_DEFAULT;
+  dnsCandidate = 0;
+  if (enable) {
+    logMessagef(2, "🔧 Resolución DNS del servidor activada (vigencia %lus)", dnsTtl / 1000);
+  } else {
+    logMessage(2, "🔧 Resolución DNS del servidor desactivada");
+  }
+}
+
+bool tcpResolverSetFallbacks(const char* const* addresses, size_t count) {
+  if (count > TCP_DNS_FALLBACK_MAX) return false;
+  for (size_t i = 0; i < count; ++i) {
+    if (addresses[i] == NULL || strlen(addresses[i]) >= TCP_DNS_ADDRESS_MAX) return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    copyBounded(dnsFallbacks[i], sizeof(dnsFallbacks[i]), addresses[i]);
+  }
+  dnsFallbackCount = (uint8_t)count;
+  dnsCandidate = 0;
+  return true;
+}
+
+const char* tcpResolverAddress() {
+  tcpResolverLoad();
+  uint32_t host = modemHash(2166136261UL, modemConfig.serverIP, strlen(modemConfig.serverIP) + 1);
+  return dnsAddress[0] != '\0' && host == dnsHostHash ? dnsAddress : NULL;
+}
+
+bool tcpTlsConfigure(bool enable, const char* caCertPem, const char* clientCertPem,
+                     const char* clientKeyPem) {
+  const char* pems[] = { caCertPem, clientCertPem, clientKeyPem };
+  for (size_t i = 0; i < sizeof(pems) / sizeof(pems[0]); ++i) {
+    if (pems[i] != NULL && (pems[i][0] == '\0' || strlen(pems[i]) > TCP_TLS_FILE_MAX)) {
+      logMessage(0, "❌ Certificado TLS vacío o demasiado grande");
+      return false;
+    }
+  }
+  if ((clientCertPem == NULL) != (clientKeyPem == NULL)) {
+    logMessage(0, "❌ El certificado de cliente TLS requiere su clave privada");
+    return false;
+  }
+
+  tlsEnabled = enable;
+  tlsCaCert = caCertPem;
+  tlsClientCert = clientCertPem;
+  tlsClientKey = clientKeyPem;
+  tcpTlsInvalidate();
+
+  if (!enable) {
+    logMessage(2, "🔧 TLS de la conexión persistente desactivado");
+  } else if (caCertPem == NULL) {
+    logMessage(1, "⚠️  TLS sin CA: canal cifrado pero sin verificar el servidor");
+  } else {
+    logMessage(2, "🔧 TLS de la conexión persistente activado");
+  }
+  return true;
+}
+
+void tcpBatchConfigure(size_t maxBytes, unsigned long maxLatencyMs) {
+  tcpBatchFlush();
+
+  if (maxBytes > TCP_CASEND_MAX) maxBytes = TCP_CASEND_MAX;
+  tcpBatchLimit = maxBytes;
+  tcpBatchMaxLatency = maxLatencyMs;
+
+  if (maxBytes == 0) {
+    logMessage(2, "🔧 Agrupación de envíos TCP desactivada");
+  } else {
+    logMessagef(2, "🔧 Agrupación de envíos TCP: hasta %u bytes o %lums",
+                (unsigned)maxBytes, maxLatencyMs);
+  }
+}
+
+/**
+ * Encola un mensaje en un socket, agrupándolo si la agrupación está activa
+ * @param raw - Enviar los datos tal cual, sin CRLF
+ * @param store - Guardar el mensaje en flash si el envío falla
+ */
+static bool tcpSocketEnqueue(int id, const char* data, size_t len, bool raw, uint32_t timeout_ms,
+                             TcpSendCallback callback, void* ctx, bool store) {
+  TcpSocket* s = tcpSocketGet(id);
+  if (s == NULL || s->closing) {
+    logMessagef(0, "❌ Socket TCP %d no está abierto", id);
+    return false;
+  }
+
+  size_t framedLen = len + (raw ? 0 : 2);
+  if (framedLen == 0 || framedLen > TCP_CASEND_MAX) {
+    logMessagef(0, "❌ Datos TCP demasiado largos (%u bytes)", (unsigned)len);
+    return false;
+  }
+
+  if (tcpBatchLimit > 0 && framedLen <= tcpBatchLimit) {
+    return tcpBatchAppend(*s, data, len, raw, timeout_ms, callback, ctx, store);
+  }
+
+  tcpBatchFlush(*s);
+
+  TcpSendJob* job = tcpQueueReserve(*s, timeout_ms);
+  if (job == NULL) return false;
+
+  tcpJobAppend(job, data, len, raw, timeout_ms, callback, ctx, store);
+  job->ready = true;
+  return true;
+}
+
+bool tcpSocketSendAsync(int id, const char* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx) {
+  return tcpSocketEnqueue(id, data, len, false, timeout_ms, callback, ctx, false);
+}
+
+bool tcpSendPersistentAsync(const char* data, size_t len, uint32_t timeout_ms,
+                            TcpSendCallback callback, void* ctx) {
+  return tcpSocketEnqueue(0, data, len, false, timeout_ms, callback, ctx, true);
+}
+
+bool tcpSendBinaryAsync(const uint8_t* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx) {
+  return tcpSocketEnqueue(0, (const char*)data, len, true, timeout_ms, callback, ctx, true);
+}
+
+#if !GSMLTE_STATIC_ALLOC
+bool tcpSendPersistentAsync(const String& datos, uint32_t timeout_ms,
+                            TcpSendCallback callback, void* ctx) {
+  return tcpSocketEnqueue(0, datos.c_str(), datos.length(), false, timeout_ms, callback, ctx, true);
+}
+#endif
+
+/**
+ * Guarda en flash los mensajes de un envío fallido que lo solicitaron
+ * @details Los mensajes consecutivos se guardan como un solo registro
+ */
+static void tcpOfflineCapture(const TcpSendJob& job) {
+  uint16_t start = 0;
+  uint16_t runStart = 0;
+  bool inRun = false;
+
+  for (uint8_t i = 0; i <= job.count; ++i) {
+    bool store = i < job.count && job.entries[i].store;
+    if (store && !inRun) {
+      runStart = start;
+      inRun = true;
+    }
+    if (!store && inRun) {
+      if (modemStoreAppend(job.data + runStart, start - runStart)) {
+        logMessagef(1, "💾 Envío fallido guardado en flash (%u bytes)", (unsigned)(start - runStart));
+      }
+      inRun = false;
+    }
+    if (i < job.count) start = job.entries[i].end;
+  }
+}
+
+/**
+ * Quita de la cola el envío de la cabeza y los que se copiaron en él
+ */
+static void tcpQueuePop(TcpSocket& s) {
+  uint8_t slots = 1 + s.sendQueue[s.sendHead].merged;
+  s.sendHead = (s.sendHead + slots) % TCP_SEND_QUEUE_SIZE;
+  s.sendCount -= slots;
+  tcpMemNote();
+}
+
+/**
+ * Libera el envío en la cabeza de la cola e invoca sus callbacks
+ */
+static void tcpReleaseHead(TcpSocket& s, bool success) {
+  TcpSendJob& job = s.sendQueue[s.sendHead];
+  TcpBatchEntry entries[TCP_BATCH_MAX_MESSAGES];
+  uint8_t count = job.count;
+  memcpy(entries, job.entries, count * sizeof(TcpBatchEntry));
+
+  if (!success && tcpOfflineEnabled && !job.replay) {
+    tcpOfflineCapture(job);
+  }
+
+  tcpQueuePop(s);
+
+  for (uint8_t i = 0; i < count; ++i) {
+    if (entries[i].callback != NULL) {
+      entries[i].callback(success, entries[i].ctx);
+    }
+  }
+}
+
+/**
+ * Saca el mensaje más antiguo de los que están en vuelo e invoca su callback
+ */
+static void tcpInflightRelease(TcpSocket& s, bool success) {
+  TcpInflight entry = s.inflight[s.inflightHead];
+  s.inflightHead = (s.inflightHead + 1) & TCP_INFLIGHT_MASK;
+  s.inflightCount--;
+  if (entry.callback != NULL) entry.callback(success, entry.ctx);
+}
+
+/**
+ * Falla los envíos en vuelo: la conexión que debía confirmarlos se perdió
+ * @details Sus datos ya no están en la cola, así que no se guardan en flash
+ */
+static void tcpAckFail(TcpSocket& s) {
+  if (s.inflightCount == 0) return;
+
+  logMessagef(1, "⚠️  %u mensajes TCP %d sin confirmar (%lu bytes)", (unsigned)s.inflightCount,
+              tcpSocketId(s), (unsigned long)(s.txTotal - s.txAcked));
+  s.txAcked = s.txTotal;
+  while (s.inflightCount > 0) tcpInflightRelease(s, false);
+}
+
+/**
+ * Finaliza el envío activo, libera su lugar e invoca los callbacks
+ * @details Con envíos en vuelo delante solo se llega aquí si la conexión
+ * falló, así que esos también se dan por fallidos
+ */
+static void tcpFinishJob(TcpSocket& s, bool success) {
+  tcpAckFail(s);
+  if (tcpPackOwner == &s) tcpPackOwner = NULL;
 
-  flushPortSerial();
-  while (SerialAT.available()) SerialAT.read();
+  s.phase = TCP_PHASE_IDLE;
+  s.jobActive = false;
+  tcpReleaseHead(s, success);
+}
+
+/**
+ * Siguiente envío por escribir (la cola solo tiene envíos sin escribir)
+ * @return Envío, o NULL si la cola está vacía
+ */
+static TcpSendJob* tcpNextJob(TcpSocket& s) {
+  if (s.sendCount == 0) return NULL;
+  return &s.sendQueue[s.sendHead];
+}
 
-  const size_t len = datos.length() + 2;
+/**
+ * Indica si el siguiente envío está listo y cabe en la ventana
+ */
+static bool tcpNextJobReady(TcpSocket& s) {
+  TcpSendJob* job = tcpNextJob(s);
+  if (job == NULL || !job->ready) return false;
+  if (s.inflightCount == 0) return true;
+  return (s.txTotal - s.txAcked) + job->len <= tcpSendWindow &&
+         s.inflightCount + job->count <= TCP_INFLIGHT_MAX;
+}
 
-  modem.sendAT(String("+CASEND=0,") + String(len));
-  if (!waitForToken(SerialAT, ">", timeout_ms)) {
-    logMessage(0, "❌ Timeout esperando prompt '>' para envío");
-    return false;
+/**
+ * Deja en vuelo los mensajes del envío recién escrito y libera su lugar en la cola
+ */
+static void tcpAckQueue(TcpSocket& s) {
+  TcpSendJob& job = *tcpNextJob(s);
+  unsigned long now = millis();
+  unsigned long limit = job.timeout > TCP_ACK_TIMEOUT ? job.timeout : TCP_ACK_TIMEOUT;
+
+  if (tcpPackOwner == &s) tcpPackOwner = NULL;
+  s.txTotal = job.ackEnd;
+  if (s.inflightCount == 0) s.ackPollAt = now + TCP_ACK_POLL_INTERVAL;
+  s.ackStalled = false;
+  for (uint8_t i = 0; i < job.count; ++i) {
+    TcpInflight& entry = s.inflight[(s.inflightHead + s.inflightCount) & TCP_INFLIGHT_MASK];
+    entry.callback = job.entries[i].callback;
+    entry.ctx = job.entries[i].ctx;
+    entry.ackEnd = job.ackEnd;
+    entry.ackBy = now + limit;
+    s.inflightCount++;
   }
-  modem.sendAT(datos);
-  modem.sendAT("\r\n");
 
-  const char* okTokens[] = { "CADATAIND: 0", "SEND OK", "OK" };
-  const char* errTokens[] = { "SEND FAIL", "ERROR", "+CME ERROR", "+CMS ERROR" };
+  tcpQueuePop(s);
+  s.phase = TCP_PHASE_IDLE;
+  s.jobActive = false;
 
-  int8_t result = waitForAnyToken(SerialAT,
-                                  okTokens, sizeof(okTokens) / sizeof(okTokens[0]),
-                                  errTokens, sizeof(errTokens) / sizeof(errTokens[0]),
-                                  timeout_ms);
+  logMessagef(3, "📤 TCP %d: %u mensajes en vuelo, %lu bytes sin confirmar", tcpSocketId(s),
+              (unsigned)s.inflightCount, (unsigned long)(s.txTotal - s.txAcked));
+}
 
-  if (result == 1) {
-    logMessage(3, "✅ Datos TCP enviados exitosamente");
-    return true;
+/**
+ * Aplica una respuesta +CAACK: <total>,<sin confirmar> y completa los envíos confirmados
+ * @details El total del módem incluye lo escrito antes de abrir este socket;
+ * solo se usa la cantidad sin confirmar, que corresponde a lo último escrito
+ */
+static void tcpAckUpdate(TcpSocket& s, const char* response) {
+  const char* line = strstr(response, "+CAACK:");
+  const char* comma = line != NULL ? strchr(line, ',') : NULL;
+  if (comma == NULL) return;
+
+  uint32_t unacked = (uint32_t)strtoul(comma + 1, NULL, 10);
+  uint32_t outstanding = s.txTotal - s.txAcked;
+  if (unacked > outstanding) unacked = outstanding;
+
+  uint32_t acked = s.txTotal - unacked;
+  s.ackStalled = acked == s.txAcked;
+  if (s.ackStalled) return;
+  s.txAcked = acked;
+  tcpConfirmActive(s);
+
+  while (s.inflightCount > 0 && (int32_t)(s.inflight[s.inflightHead].ackEnd - acked) <= 0) {
+    tcpInflightRelease(s, true);
   }
+  logMessagef(3, "✅ TCP %d: %lu bytes confirmados, %u mensajes en vuelo", tcpSocketId(s),
+              (unsigned long)acked, (unsigned)s.inflightCount);
+}
 
-  if (result == -1) {
-    logMessage(0, "❌ Error en envío TCP");
+/**
+ * Indica si la ventana retiene el siguiente envío (bytes o anillo en vuelo llenos)
+ */
+static bool tcpWindowFull(TcpSocket& s) {
+  TcpSendJob* job = tcpNextJob(s);
+  return s.inflightCount > 0 && job != NULL && job->ready && !tcpNextJobReady(s);
+}
+
+/**
+ * Consulta +CAACK cuando toca, o falla los envíos que vencieron sin confirmar
+ * @details Con la ventana llena se consulta en seguida en vez de esperar
+ * TCP_ACK_POLL_INTERVAL; si esa consulta no confirmó nada, la siguiente espera
+ * @return true si se encoló la consulta
+ */
+static bool tcpAckPoll(TcpSocket& s) {
+  if (modemTimerExpired(s.inflight[s.inflightHead].ackBy)) {
+    logMessagef(1, "⚠️  El servidor no confirmó los envíos TCP %d a tiempo", tcpSocketId(s));
+    tcpAckFail(s);
+    tcpMarkUnknown(s);
     return false;
   }
+  if (!modemTimerExpired(s.ackPollAt) && (s.ackStalled || !tcpWindowFull(s))) return false;
 
-  logMessage(0, "❌ Timeout en envío TCP");
-  return false;
+  char command[16];
+  snprintf(command, sizeof(command), "+CAACK=%d", tcpSocketId(s));
+  s.ackPollAt = millis() + TCP_ACK_POLL_INTERVAL;
+  if (!atOpSubmit(s.op, command, "", getAdaptiveTimeout())) return false;
+  s.phase = TCP_PHASE_ACK;
+  return true;
 }
 
+/**
+ * Copia en el envío activo los siguientes envíos listos de la cola que quepan
+ * @details Solo con ventana: la confirmación es por byte, así que cada mensaje
+ * conserva su callback aunque viajen en el mismo +CASEND, y ninguno espera
+ * más de lo que ya esperaba en la cola
+ */
+static void tcpJobCoalesce(TcpSocket& s, TcpSendJob& job) {
+  if (job.replay) return;
+
+  while (1 + job.merged < s.sendCount) {
+    const TcpSendJob& next = s.sendQueue[(s.sendHead + 1 + job.merged) % TCP_SEND_QUEUE_SIZE];
+    if (!next.ready || next.replay) break;
+    if (job.len + next.len > TCP_CASEND_MAX || job.count + next.count > TCP_BATCH_MAX_MESSAGES) break;
+    if ((s.txTotal - s.txAcked) + job.len + next.len > tcpSendWindow) break;
+    if (s.inflightCount + job.count + next.count > TCP_INFLIGHT_MAX) break;
 
+    memcpy(job.data + job.len, next.data, next.len);
+    for (uint8_t i = 0; i < next.count; ++i) {
+      TcpBatchEntry& entry = job.entries[job.count++];
+      entry = next.entries[i];
+      entry.end += job.len;
+    }
+    job.len += next.len;
+    if (next.timeout > job.timeout) job.timeout = next.timeout;
+    job.merged++;
+  }
+}
 
 /**
- * Inicializa la conexión TCP persistente
- * @return true si la conexión se establece exitosamente
+ * Encola el +CASEND del envío activo
  */
-bool tcpInitPersistent() {
-  logMessage(2, "🔌 Inicializando conexión TCP persistente");
-  
-  tcpConnected = false;
-  tcpReconnectAttempts = 0;
-  
-  String openCommand = "+CAOPEN=0,0,\"TCP\",\"" + modemConfig.serverIP + "\"," + modemConfig.serverPort;
-  if (sendATCommand(openCommand, "+CAOPEN: 0,0", getAdaptiveTimeout())) {
-    tcpConnected = true;
-    lastTcpActivity = millis();
-    logMessage(2, "✅ Conexión TCP persistente establecida");
-    return true;
+static void tcpSubmitSend(TcpSocket& s) {
+  TcpSendJob& job = *tcpNextJob(s);
+  if (tcpSendWindow > 0) tcpJobCoalesce(s, job);
+  const uint8_t* payload = job.data;
+  size_t len = job.len;
+
+  if (tcpPackOwner == &s) tcpPackOwner = NULL;
+  if (tcpCompressEnabled && tcpPackOwner == NULL && job.len >= TCP_COMPRESS_MIN) {
+    unsigned long startMicros = micros();
+    size_t packed = lzPackBlock(job.data, job.len, tcpPackBuffer, sizeof(tcpPackBuffer));
+    modemStatsNoteCompression(job.len, packed, micros() - startMicros);
+    if (packed > 0) {
+      tcpPackOwner = &s;
+      payload = tcpPackBuffer;
+      len = packed;
+    }
   }
-  
-  logMessage(0, "❌ Falló inicialización de conexión TCP persistente");
-  return false;
+
+  if (payload == tcpPackBuffer) {
+    logMessagef(3, "📤 Enviando %u bytes por TCP %d (comprimidos de %u)", (unsigned)len,
+                tcpSocketId(s), (unsigned)job.len);
+  } else {
+    logMessagef(3, "📤 Enviando %u bytes por TCP %d", (unsigned)len, tcpSocketId(s));
+  }
+
+  char command[24];
+  snprintf(command, sizeof(command), "+CASEND=%d,%u", tcpSocketId(s), (unsigned)len);
+  job.ackEnd = s.txTotal + (uint32_t)len;
+  if (!atOpSubmit(s.op, command, "OK", job.timeout, payload, len)) {
+    s.op.result = -1;
+  }
+  s.phase = TCP_PHASE_SEND;
 }
 
 /**
- * Verifica si la conexión TCP persistente está activa
- * @return true si la conexión está activa
+ * Resuelve el resultado de una reconexión
  */
-bool tcpIsPersistentActive() {
-  if (!tcpConnected) {
-    return false;
+static void tcpReconnectFinished(TcpSocket& s, bool success) {
+  if (!s.jobActive) {
+    s.phase = TCP_PHASE_IDLE;
+    return;
   }
-  
-  if (sendATCommand("+CASTATE?", "+CASTATE: 0,1", 5000)) {
-    lastTcpActivity = millis();
-    return true;
+
+  if (success) {
+    tcpSubmitSend(s);
+  } else {
+    logMessagef(0, "❌ No se pudo establecer conexión TCP %d para envío", tcpSocketId(s));
+    tcpFinishJob(s, false);
   }
-  
-  logMessage(1, "⚠️  Conexión TCP persistente perdida - marcando como desconectada");
-  tcpConnected = false;
-  return false;
 }
 
 /**
- * Mantiene la conexión TCP persistente enviando keep-alive
- * @return true si la conexión sigue activa
+ * Inicia una reconexión no bloqueante (+CACLOSE, espera, +CAOPEN)
+ * @details El +CACLOSE previo también libera un canal que el módem haya
+ * dejado abierto de una sesión anterior del ESP32
  */
-bool tcpKeepAlivePersistent() {
-  unsigned long currentTime = millis();
-  
-  if (tcpConnected && (currentTime - lastTcpActivity > tcpKeepAliveInterval)) {
-    logMessage(3, "💓 Enviando keep-alive TCP persistente");
-    
-    if (sendATCommand("+CASTATE?", "+CASTATE: 0,1", 5000)) {
-      lastTcpActivity = currentTime;
-      logMessage(3, "✅ Keep-alive TCP exitoso");
-      return true;
-    } else {
-      logMessage(1, "⚠️  Keep-alive TCP falló - conexión perdida");
-      tcpConnected = false;
-      return false;
+static void tcpBeginReconnect(TcpSocket& s) {
+  tcpAckFail(s);
+
+  if (s.reconnectAttempts >= MAX_RECONNECT_ATTEMPTS) {
+    logMessage(0, "❌ Máximo número de reconexiones TCP alcanzado");
+    tcpReconnectFinished(s, false);
+    return;
+  }
+
+  if ((&s == tcpSockets && tcpBreaker == TCP_BREAKER_OPEN) || !modemTimerExpired(s.retryAt)) {
+    logMessagef(1, "⏳ Reconexión TCP %d en espera (backoff o circuito abierto)", tcpSocketId(s));
+    tcpReconnectFinished(s, false);
+    return;
+  }
+
+  s.reconnectAttempts++;
+  modemStatsNoteReconnect();
+  logMessagef(2, "🔄 Intentando reconexión TCP %d (intento %d/%d)",
+              tcpSocketId(s), s.reconnectAttempts, MAX_RECONNECT_ATTEMPTS);
+
+  char command[16];
+  snprintf(command, sizeof(command), "+CACLOSE=%d", tcpSocketId(s));
+  atOpSubmit(s.op, command, "OK", 3000);
+  s.phase = TCP_PHASE_CLOSE;
+}
+
+/**
+ * Programa keep-alive o reconexión cuando no hay envíos pendientes
+ * @details Solo la conexión persistente (socket 0) escala (tcpRecoverStep());
+ * los demás sockets reintentan con backoff hasta TCP_BACKOFF_MAX
+ */
+static void tcpMaintenanceStep(TcpSocket& s) {
+  if (!modemInitialized) return;
+
+  unsigned long now = millis();
+
+  if (s.connected) {
+    if (!modemPowerKeepAliveSuppressed() && now - s.lastActivity > tcpKeepAliveInterval) {
+      logMessagef(3, "💓 Enviando keep-alive TCP %d", tcpSocketId(s));
+      tcpSubmitStateQuery(s, 5000);
+      s.phase = TCP_PHASE_KEEPALIVE;
     }
+    return;
   }
-  
-  return tcpConnected;
+
+  if (!modemTimerExpired(s.retryAt)) return;
+
+  if (&s == tcpSockets) {
+    tcpRecoverStep(s);
+    return;
+  }
+
+  if (s.reconnectAttempts >= MAX_RECONNECT_ATTEMPTS) {
+    s.reconnectAttempts = MAX_RECONNECT_ATTEMPTS - 1;
+  }
+  tcpBeginReconnect(s);
 }
 
 /**
- * Reconecta la conexión TCP persistente si se perdió
- * @return true si se reconectó exitosamente
+ * Cierra un socket secundario: falla sus envíos pendientes y libera el canal
  */
-bool tcpReconnectPersistent() {
-  if (tcpConnected) {
-    return true;
+static void tcpSocketFinishClose(TcpSocket& s) {
+  int id = tcpSocketId(s);
+  s.batchCurrent = NULL;
+  while (s.sendCount > 0) {
+    tcpFinishJob(s, false);
   }
-  
-  if (tcpReconnectAttempts >= MAX_RECONNECT_ATTEMPTS) {
-    logMessage(0, "❌ Máximo número de reconexiones TCP alcanzado");
+
+  char command[16];
+  snprintf(command, sizeof(command), "+CACLOSE=%d", id);
+  modemSubmitAT(command, "OK", getAdaptiveTimeout(), NULL, NULL);
+
+  s.inUse = false;
+  s.closing = false;
+  s.connected = false;
+  s.stateConfirmed = false;
+  s.reconnectAttempts = 0;
+  s.failures = 0;
+  s.phase = TCP_PHASE_IDLE;
+  s.rxHead = s.rxTail = 0;
+  s.rxPending = false;
+  s.rxCallback = NULL;
+  s.rxCallbackCtx = NULL;
+  logMessagef(2, "✅ Socket TCP %d cerrado", id);
+}
+
+/**
+ * Resultado del reenvío de un lote guardado en flash
+ */
+static void tcpOfflineReplayDone(bool success, void* ctx) {
+  tcpReplayActive = false;
+
+  if (success) {
+    modemStoreCommit(tcpReplayCursor);
+    logMessagef(2, "✅ Lote guardado reenviado, quedan %u bytes en flash",
+                (unsigned)modemStorePending());
+  } else {
+    tcpReplayRetryAt = millis() + TCP_RECONNECT_INTERVAL;
+  }
+}
+
+/**
+ * Encola un lote de registros guardados en flash cuando la conexión está libre
+ * @details Los registros se leen directamente al buffer del envío, así que el
+ * reenvío no usa más RAM que un envío normal; los envíos nuevos tienen prioridad
+ * @return true si se encoló un lote
+ */
+static bool tcpOfflineReplay(TcpSocket& s) {
+  if (!tcpOfflineEnabled || tcpReplayActive || !s.connected) return false;
+  if (tcpNextJob(s) != NULL || s.sendCount >= TCP_SEND_QUEUE_SIZE) return false;
+  if (modemStorePending() == 0 || !modemTimerExpired(tcpReplayRetryAt)) return false;
+
+  TcpSendJob* job = tcpQueueReserve(s, TCP_REPLAY_TIMEOUT);
+  if (job == NULL) return false;
+
+  size_t len = modemStoreRead(job->data, sizeof(job->data), tcpReplayCursor);
+  if (len == 0) {
+    // Solo había registros inválidos: se liberan y se devuelve el lugar reservado
+    s.sendCount--;
+    modemStoreCommit(tcpReplayCursor);
     return false;
   }
-  
-  tcpReconnectAttempts++;
-  logMessage(2, "🔄 Intentando reconexión TCP persistente (intento " + String(tcpReconnectAttempts) + "/" + String(MAX_RECONNECT_ATTEMPTS) + ")");
-  
-  sendATCommand("+CACLOSE=0", "OK", 3000);
-  delay(1000);
-  
-  String openCommand = "+CAOPEN=0,0,\"TCP\",\"" + modemConfig.serverIP + "\"," + modemConfig.serverPort;
-  if (sendATCommand(openCommand, "+CAOPEN: 0,0", getAdaptiveTimeout())) {
-    tcpConnected = true;
-    lastTcpActivity = millis();
-    tcpReconnectAttempts = 0;
-    logMessage(2, "✅ Reconexión TCP persistente exitosa");
-    return true;
+
+  job->len = len;
+  job->replay = true;
+  job->entries[0].callback = tcpOfflineReplayDone;
+  job->entries[0].ctx = NULL;
+  job->entries[0].end = len;
+  job->entries[0].store = false;
+  job->count = 1;
+  job->ready = true;
+  tcpReplayActive = true;
+
+  logMessagef(2, "📦 Reenviando %u bytes guardados en flash", (unsigned)len);
+  return true;
+}
+
+/**
+ * Avanza la máquina de estados de un socket sin bloquear
+ */
+static void tcpSocketPoll(TcpSocket& s) {
+  switch (s.phase) {
+    case TCP_PHASE_IDLE:
+      if (s.rxPending && s.connected && tcpRxFree(s) >= TCP_RX_MIN_FREE) {
+        tcpSubmitRecv(s);
+        break;
+      }
+
+      if (s.inflightCount > 0 && !s.connected) tcpAckFail(s);
+
+      if (tcpNextJobReady(s)) {
+        s.jobActive = true;
+        s.jobRetried = false;
+
+        if (tcpStateKnown(s)) {
+          tcpSubmitSend(s);
+        } else if (s.connected) {
+          tcpSubmitStateQuery(s, 5000);
+          s.phase = TCP_PHASE_CHECK;
+        } else {
+          tcpBeginReconnect(s);
+        }
+        break;
+      }
+
+      if (s.inflightCount > 0 && tcpAckPoll(s)) break;
+      if (&s == tcpSockets && tcpOfflineReplay(s)) break;
+
+      tcpMaintenanceStep(s);
+      break;
+
+    case TCP_PHASE_CHECK:
+      if (s.op.result == 1) {
+        tcpConfirmActive(s);
+        tcpSubmitSend(s);
+      } else {
+        logMessagef(1, "⚠️  Conexión TCP %d perdida - marcando como desconectada", tcpSocketId(s));
+        s.connected = false;
+        tcpMarkUnknown(s);
+        tcpBeginReconnect(s);
+      }
+      break;
+
+    case TCP_PHASE_KEEPALIVE:
+      if (s.op.result == 1) {
+        tcpConfirmActive(s);
+        logMessage(3, "✅ Keep-alive TCP exitoso");
+        s.phase = TCP_PHASE_IDLE;
+      } else {
+        logMessagef(1, "⚠️  Keep-alive TCP %d falló - conexión perdida", tcpSocketId(s));
+        s.connected = false;
+        tcpMarkUnknown(s);
+        tcpBeginReconnect(s);
+      }
+      break;
+
+    case TCP_PHASE_CLOSE:
+      s.timer = millis() + LONG_DELAY;
+      s.phase = TCP_PHASE_REOPEN;
+      break;
+
+    case TCP_PHASE_REOPEN:
+      if (!modemTimerExpired(s.timer)) break;
+      if (&s == tcpSockets) {
+        int8_t tls = tcpTlsPoll();
+        if (tls == 0) break;
+        if (tls < 0) {
+          s.op.result = -1;
+          s.phase = TCP_PHASE_OPEN;
+          break;
+        }
+      }
+      if (!tcpSubmitOpen(s)) {
+        s.op.result = -1;
+      }
+      s.phase = TCP_PHASE_OPEN;
+      break;
+
+    case TCP_PHASE_OPEN:
+      if (tcpSocketFinishOpen(s, s.op.result)) {
+        logMessagef(2, "✅ Reconexión TCP %d exitosa", tcpSocketId(s));
+        tcpReconnectFinished(s, true);
+      } else {
+        logMessagef(1, "⚠️  Falló reconexión TCP %d", tcpSocketId(s));
+        tcpScheduleRetry(s);
+        tcpReconnectFinished(s, false);
+      }
+      break;
+
+    case TCP_PHASE_SEND:
+      if (s.op.result == 1 && tcpSendWindow > 0) {
+        tcpConfirmActive(s);
+        tcpAckQueue(s);
+      } else if (s.op.result == 1) {
+        tcpConfirmActive(s);
+        logMessagef(3, "✅ Datos enviados exitosamente por TCP %d", tcpSocketId(s));
+        tcpFinishJob(s, true);
+      } else if (!s.jobRetried) {
+        s.jobRetried = true;
+        logMessage(1, "⚠️  Fallo en envío TCP - intentando reconectar");
+        s.connected = false;
+        tcpMarkUnknown(s);
+        tcpBeginReconnect(s);
+      } else {
+        tcpFinishJob(s, false);
+      }
+      break;
+
+    case TCP_PHASE_RECV: {
+      size_t received = s.rxHead - s.rxHeadBefore;
+      if (s.op.result == 1) {
+        if (received > 0) {
+          tcpConfirmActive(s);
+          logMessagef(3, "📥 Recibidos %u bytes por TCP %d", (unsigned)received, tcpSocketId(s));
+        }
+        if (received < s.rxRequested) s.rxPending = false;
+      } else {
+        logMessage(1, "⚠️  Fallo leyendo datos TCP recibidos");
+        s.rxPending = false;
+        tcpMarkUnknown(s);
+      }
+      s.phase = TCP_PHASE_IDLE;
+      break;
+    }
+
+    case TCP_PHASE_ACK:
+      if (s.op.result == 1) tcpAckUpdate(s, s.op.response);
+      s.phase = TCP_PHASE_IDLE;
+      break;
   }
-  
-  logMessage(1, "⚠️  Falló reconexión TCP persistente");
-  return false;
 }
 
 /**
- * Envía datos usando la conexión TCP persistente
- * @param datos Datos a enviar
- * @param timeout_ms Timeout en milisegundos
- * @return true si el envío es exitoso
+ * Avanza los sockets del pool sin bloquear
+ * @details Cada socket tiene a lo sumo una operación AT en curso; al recorrerlos
+ * en cada llamada sus comandos quedan intercalados en la cola AT
  */
-bool tcpSendPersistent(const String& datos, uint32_t timeout_ms) {
-  if (!tcpIsPersistentActive()) {
-    if (!tcpReconnectPersistent()) {
-      logMessage(0, "❌ No se pudo establecer conexión TCP persistente para envío");
-      return false;
+static void tcpPersistentPoll() {
+  static bool wasAsleep = false;
+  bool awake = modemPowerAwake();
+
+  for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+    TcpSocket& s = tcpSockets[i];
+    if (!tcpSocketInUse(s)) continue;
+
+    tcpBatchPoll(s);
+    tcpRxDeliver(s);
+
+    // Tras PSM el módem pudo cerrar la conexión sin avisar: se verifica antes de enviar
+    if (awake && wasAsleep) tcpMarkUnknown(s);
+
+    if (modemIsStarting() || !awake || s.op.pending) continue;
+
+    if (s.closing) {
+      tcpSocketFinishClose(s);
+    } else {
+      tcpSocketPoll(s);
     }
   }
-  
-  logMessage(3, "📤 Enviando " + String(datos.length()) + " bytes por TCP persistente");
-  
-  if (tcpSendData(datos, timeout_ms)) {
-    lastTcpActivity = millis();
-    logMessage(3, "✅ Datos enviados exitosamente por TCP persistente");
-    return true;
-  } else {
-    logMessage(1, "⚠️  Fallo en envío TCP - intentando reconectar");
-    tcpConnected = false;
-    
-    if (tcpReconnectPersistent()) {
-      if (tcpSendData(datos, timeout_ms)) {
-        lastTcpActivity = millis();
-        logMessage(2, "✅ Datos enviados tras reconexión TCP");
-        return true;
+
+  tcpResolverPoll();
+  wasAsleep = !awake;
+}
+
+bool tcpTrafficPending() {
+  for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+    const TcpSocket& s = tcpSockets[i];
+    if (!tcpSocketInUse(s)) continue;
+    if (s.closing || s.inflightCount > 0) return true;
+    if (s.sendCount > 0 && s.sendQueue[s.sendHead].ready) return true;
+  }
+  return false;
+}
+
+/**
+ * Acerca el plazo de espera a un temporizador; uno ya vencido da 1 ms para
+ * no girar en vacío mientras otra condición lo retiene
+ */
+static void modemWaitUntil(unsigned long& wait, unsigned long deadline) {
+  long remaining = (long)(deadline - millis());
+  unsigned long ms = remaining > 0 ? (unsigned long)remaining : 1;
+  if (ms < wait) wait = ms;
+}
+
+/**
+ * Plazo de los sockets: 0 si alguno tiene trabajo listo
+ */
+static unsigned long tcpPollTimeout() {
+  unsigned long wait = ULONG_MAX;
+  bool awake = modemPowerAwake();
+
+  for (int i = 0; i < TCP_POOL_SIZE; ++i) {
+    TcpSocket& s = tcpSockets[i];
+    if (!tcpSocketInUse(s)) continue;
+
+    if (s.rxCallback != NULL && s.rxHead != s.rxTail) return 0;
+    if (s.batchCurrent != NULL) modemWaitUntil(wait, s.batchOpened + tcpBatchMaxLatency);
+
+    if (modemIsStarting() || !awake || s.op.pending) continue;
+    if (s.closing) return 0;
+
+    if (s.phase == TCP_PHASE_REOPEN) {
+      // Con la configuración TLS en curso el socket despierta al completarse
+      if (&s != tcpSockets || !tlsOp.pending) modemWaitUntil(wait, s.timer);
+      continue;
+    }
+    if (s.phase != TCP_PHASE_IDLE) return 0;
+
+    if (s.rxPending && s.connected && tcpRxFree(s) >= TCP_RX_MIN_FREE) return 0;
+    if (tcpNextJobReady(s)) return 0;
+    if (s.inflightCount > 0) {
+      if (!s.ackStalled && tcpWindowFull(s)) return 0;
+      modemWaitUntil(wait, s.ackPollAt);
+      modemWaitUntil(wait, s.inflight[s.inflightHead].ackBy);
+    }
+
+    if (&s == tcpSockets && tcpOfflineEnabled && !tcpReplayActive && s.connected &&
+        tcpNextJob(s) == NULL && modemStorePending() > 0) {
+      modemWaitUntil(wait, tcpReplayRetryAt);
+    }
+
+    if (!modemInitialized) continue;
+    if (s.connected) {
+      if (!modemPowerKeepAliveSuppressed()) {
+        modemWaitUntil(wait, s.lastActivity + tcpKeepAliveInterval + 1);
       }
+    } else {
+      modemWaitUntil(wait, s.retryAt);
     }
   }
-  
-  return false;
+
+  if (tcpResolverActive() && !dnsOp.pending) {
+    if (dnsPhase == DNS_PHASE_QUERY) return 0;
+    modemWaitUntil(wait, dnsTimer);
+  }
+  return wait;
+}
+
+unsigned long modemPollTimeout() {
+  if (SerialAT.available() > 0) return 0;
+  if (!atBusy && atQueueCount > 0) return 0;
+
+  unsigned long wait = MODEM_POLL_MAX_WAIT;
+  if (atBusy) modemWaitUntil(wait, atStart + atActiveTimeout);
+  if (modemIsStarting() && !smOp.pending && !tlsOp.pending) modemWaitUntil(wait, smTimer);
+
+  unsigned long next[] = {
+    tcpPollTimeout(), modemPowerPollTimeout(), transportPollTimeout(),
+    modemInfoPollTimeout(), logPollTimeout()
+  };
+  for (size_t i = 0; i < sizeof(next) / sizeof(next[0]); ++i) {
+    if (next[i] < wait) wait = next[i];
+  }
+  return wait;
+}
+
+int tcpSocketOpen(const char* host, const char* port) {
+  for (int id = 1; id < TCP_POOL_SIZE; ++id) {
+    TcpSocket& s = tcpSockets[id];
+    if (s.inUse) continue;
+
+    if (!copyBounded(s.host, sizeof(s.host), host) ||
+        !copyBounded(s.port, sizeof(s.port), port)) {
+      logMessagef(0, "❌ Destino TCP demasiado largo: %s:%s", host, port);
+      return -1;
+    }
+
+    s.inUse = true;
+    s.retryAt = millis();
+    logMessagef(2, "🔌 Socket TCP %d asignado a %s:%s", id, host, port);
+    return id;
+  }
+
+  logMessage(1, "⚠️  No hay sockets TCP libres");
+  return -1;
+}
+
+void tcpSocketClose(int id) {
+  if (id == 0) return;
+
+  TcpSocket* s = tcpSocketGet(id);
+  if (s != NULL) s->closing = true;
+}
+
+bool tcpSocketIsConnected(int id) {
+  TcpSocket* s = tcpSocketGet(id);
+  return s != NULL && !s->closing && s->connected;
+}
+
+bool tcpOfflineBegin() {
+  if (!modemStoreBegin()) return false;
+
+  tcpOfflineEnabled = true;
+  logMessage(2, "💾 Envíos fallidos se guardarán en flash para reenvío");
+  return true;
+}
+
+size_t tcpOfflinePending() {
+  return modemStorePending();
+}
+
+bool tcpOfflineStore(const uint8_t* frame, size_t len) {
+  if (!tcpOfflineEnabled) return false;
+  return modemStoreAppend(frame, len);
 }
 
 /**
@@ -736,27 +4257,11 @@ void tcpClosePersistent() {
 
 /**
  * Gestiona el mantenimiento de la conexión TCP persistente
- * Debe llamarse periódicamente desde el loop principal
+ * Debe llamarse periódicamente desde el loop principal; no bloquea:
+ * keep-alive, reconexión y reinicio LTE avanzan dentro de modemPoll()
  */
 void tcpMaintainPersistent() {
-  if (!modemInitialized) {
-    return;
-  }
-  
-  if (!tcpKeepAlivePersistent()) {
-    if (!tcpReconnectPersistent()) {
-      logMessage(1, "⚠️  No se pudo mantener conexión TCP persistente");
-      
-      if (tcpReconnectAttempts >= MAX_RECONNECT_ATTEMPTS) {
-        logMessage(0, "🔄 Reiniciando módem por fallas TCP persistentes");
-        tcpClosePersistent();
-        
-        if (startLTE()) {
-          tcpInitPersistent();
-        }
-      }
-    }
-  }
+  modemPoll();
 }
 
 /**
@@ -765,7 +4270,7 @@ void tcpMaintainPersistent() {
  */
 void tcpConfigurePersistent(unsigned long keepAliveIntervalMs) {
   tcpKeepAliveInterval = keepAliveIntervalMs;
-  logMessage(2, "🔧 TCP persistente configurado: keep-alive cada " + String(keepAliveIntervalMs) + "ms");
+  logMessagef(2, "🔧 TCP persistente configurado: keep-alive cada %lums", keepAliveIntervalMs);
 }
 
 
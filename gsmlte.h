@@ -27,15 +27,14 @@
  * void setup() {
  *   Serial.begin(115200);
  *   tcpConfigurePersistent(30000);  // Keep-alive cada 30s
- *   setupModem();                   // Configurar módem
+ *   setupModemAsync();              // Configurar módem sin bloquear
  * }
  * 
  * void loop() {
- *   tcpMaintainPersistent();        // Mantener conexión
- *   if (tcpIsPersistentActive()) {
- *     tcpSendPersistent("datos", 5000);
+ *   modemPoll();                    // Avanzar módem y mantener conexión
+ *   if (tcpConnected && tiempoDeEnviar()) {
+ *     tcpSendPersistentAsync("datos", 5000, NULL, NULL);
  *   }
- *   delay(5000);
  * }
  * @endcode
  */
@@ -45,10 +44,23 @@
 
 #include <stdint.h>
 #include "Arduino.h"
-
-#define UART_BAUD 115200
+#include "gsmlte_log.h"
+#include "gsmlte_mem.h"
+#include "gsmlte_profile.h"
+
+#define UART_BAUD 115200           ///< Velocidad de fábrica del SIM7080G y de respaldo
+#define UART_BAUD_FAST 921600      ///< Velocidad a negociar con +IPR (0 = mantener UART_BAUD)
+#define UART_FLOW_CONTROL 0        ///< 1 = control de flujo RTS/CTS (+IFC=2,2; requiere PIN_RTS/PIN_CTS)
+#define UART_RTS_THRESHOLD 100     ///< Bytes en la FIFO de recepción que desactivan RTS
+#define UART_SWITCH_DELAY 100      ///< Espera tras cambiar de velocidad (ms)
+#define UART_VERIFY_RETRIES 3      ///< Sondas AT para confirmar la nueva velocidad
+#define UART_PROBE_TIMEOUT 500     ///< Timeout de cada sonda de confirmación (ms)
+#define UART_BAUD_RETRY_BOOTS 20   ///< Arranques sin volver a pedir una velocidad que falló
+#define SERIAL_AT_RX_BUFFER 4096   ///< Buffer de recepción del driver UART (lo llena la interrupción)
 #define PIN_TX 10
 #define PIN_RX 11
+#define PIN_RTS -1                 ///< GPIO hacia RTS del módem (-1 = sin conectar)
+#define PIN_CTS -1                 ///< GPIO desde CTS del módem (-1 = sin conectar)
 #define PWRKEY_PIN 9
 #define LED_PIN 12
 
@@ -57,11 +69,43 @@
 #define LONG_DELAY 1000
 #define MODEM_PWRKEY_DELAY 2000
 #define MODEM_STABILIZE_DELAY 2000
-
-#define DB_SERVER_IP "dp01.lolaberries.com.mx"
-#define TCP_PORT "12607"
-
-#define MODEM_NETWORK_MODE 38
+#define MODEM_POLL_MAX_WAIT 1000   ///< Tope de modemPollTimeout() para lo que no tiene plazo propio
+
+#define AT_COMMAND_MAX 128
+#define AT_EXPECTED_MAX 32
+#define AT_RESPONSE_MAX 512
+
+#define RTT_LOCAL_FLOOR 1000       ///< Piso y techo del timeout adaptativo por clase (ms)
+#define RTT_LOCAL_CEILING 5000
+#define RTT_SOCKET_FLOOR 1500
+#define RTT_SOCKET_CEILING 15000
+#define RTT_NETWORK_FLOOR 2000
+#define RTT_NETWORK_CEILING 30000
+#define RTT_GRANULARITY 100        ///< Margen mínimo sobre SRTT (ms)
+#define RTT_MAX_BACKOFF 3          ///< Duplicaciones máximas del RTO tras timeouts
+
+#define MODEM_HOST_MAX 64
+#define MODEM_PORT_MAX 8
+#define MODEM_APN_MAX 32
+#define MODEM_ICCID_MAX 24
+
+#define TCP_CASEND_MAX 1460
+#define TCP_BATCH_MAX_MESSAGES 16
+
+#define TCP_RX_RING_SIZE 2048   ///< Buffer circular de recepción (potencia de 2)
+#define TCP_RX_CHUNK 512        ///< Máximo por +CARECV; debe caber en SERIAL_AT_RX_BUFFER
+#define TCP_RX_MIN_FREE 64      ///< Espacio libre mínimo para pedir más datos
+
+#define TCP_POOL_SIZE 2         ///< Canales +CAOPEN simultáneos (el 0 es la conexión persistente)
+#define TCP_TLS_FILE_MAX 10240  ///< Tamaño máximo de cada PEM que se sube al módem
+#define TCP_DNS_ADDRESS_MAX 46  ///< Dirección IPv4 o IPv6 en texto, con terminador
+#define TCP_DNS_FALLBACK_MAX 3  ///< Direcciones alternativas del servidor
+#define TCP_DNS_TTL_DEFAULT 3600000UL ///< Vigencia de una resolución (+CDNSGIP no informa el TTL)
+
+#define DB_SERVER_IP MODEM_PROFILE_SERVER
+#define TCP_PORT MODEM_PROFILE_PORT
+
+#define MODEM_NETWORK_MODE MODEM_PROFILE_NETWORK_MODE
 #define CAT_M 1
 #define NB_IOT 2
 #define CAT_M_NB_IOT 3
@@ -72,18 +116,23 @@
 #define SerialAT Serial1
 #define SerialMon Serial
 #define PDP_CONTEXT 1
-#define APN "\"em\""
+#define APN MODEM_PROFILE_APN
 
 
 
 /**
  * @struct ModemConfig
  * @brief Estructura de configuración dinámica del módem
+ * @details initModemConfig() la llena desde el perfil de compilación
+ * (gsmlte_profile.h); el primer setupModem*() la llama si la aplicación no
+ * lo hizo antes, y los reinicios siguientes no. El servidor y el puerto
+ * pueden cambiarse en tiempo de ejecución; apn, networkMode y bandMode solo informan el perfil, porque los
+ * comandos del arranque ya vienen armados en la tabla de pasos.
  */
 struct ModemConfig {
-  String serverIP;
-  String serverPort;
-  String apn;
+  char serverIP[MODEM_HOST_MAX];
+  char serverPort[MODEM_PORT_MAX];
+  char apn[MODEM_APN_MAX];
   int networkMode;
   int bandMode;
   int maxRetries;
@@ -91,34 +140,112 @@ struct ModemConfig {
   bool enableDebug;
 };
 
+extern ModemConfig modemConfig;
+
+/**
+ * @enum ModemState
+ * @brief Estados de la máquina de arranque no bloqueante del módem
+ */
+enum ModemState {
+  MODEM_STATE_OFF,          ///< Arranque no iniciado
+  MODEM_STATE_POWER_PULSE,  ///< Secuencia PWRKEY en curso
+  MODEM_STATE_PROBE_AT,     ///< Esperando respuesta AT
+  MODEM_STATE_UART,         ///< Negociando velocidad y control de flujo del UART
+  MODEM_STATE_CONFIGURE,    ///< Ejecutando comandos de configuración
+  MODEM_STATE_REGISTERING,  ///< Esperando registro y contexto PDP activo
+  MODEM_STATE_TCP_CONNECT,  ///< Abriendo conexión TCP persistente
+  MODEM_STATE_READY,        ///< Arranque completado
+  MODEM_STATE_FAILED        ///< Arranque completado sin conexión LTE
+};
+
+/**
+ * @brief Callback de finalización de un comando AT asíncrono
+ * @param result 1=Respuesta esperada, -1=Error, 0=Timeout
+ * @param response Cuerpo de la respuesta recibida (válido solo durante el callback)
+ * @param ctx Contexto de usuario pasado al encolar
+ */
+typedef void (*ATCallback)(int8_t result, const char* response, void* ctx);
+
+/**
+ * @brief Callback de finalización de un envío TCP asíncrono
+ * @param success true si el envío fue exitoso
+ * @param ctx Contexto de usuario pasado al encolar
+ */
+typedef void (*TcpSendCallback)(bool success, void* ctx);
+
+/**
+ * @brief Callback de recepción TCP
+ * @param data Tramo contiguo dentro del buffer de recepción (válido solo durante el callback)
+ * @param len Longitud del tramo
+ * @param ctx Contexto de usuario pasado al registrar
+ */
+typedef void (*TcpReceiveCallback)(const uint8_t* data, size_t len, void* ctx);
+
+#if GSMLTE_STATIC_ALLOC
+extern char iccidsim0[MODEM_ICCID_MAX];
+#else
 extern String iccidsim0;
+#endif
 extern int signalsim0;
 extern bool modemInitialized;
+extern int consecutiveFailures;
 
-extern bool tcpConnected;
-extern unsigned long lastTcpActivity;
+extern bool& tcpConnected;             ///< Estado del socket 0
+extern unsigned long& lastTcpActivity;
 extern unsigned long tcpKeepAliveInterval;
-extern int tcpReconnectAttempts;
+extern int& tcpReconnectAttempts;
 
 
 
 /**
- * @brief Sistema de logging estructurado con niveles
- * @param level Nivel de log (0=Error, 1=Warning, 2=Info, 3=Debug)
- * @param message Mensaje a loguear
+ * @brief Inicializa la configuración del módem
  */
-void logMessage(int level, const String& message);
+void initModemConfig();
 
 /**
- * @brief Inicializa la configuración del módem
+ * @enum ModemRttClass
+ * @brief Clases de comandos AT con estimador de RTT propio
  */
-void initModemConfig();
+enum ModemRttClass {
+  MODEM_RTT_LOCAL = 0,      ///< Respondidos por el módem (+CSQ, +CPIN, ...)
+  MODEM_RTT_SOCKET = 1,     ///< Canales TCP (+CAOPEN, +CASEND, +CARECV, ...)
+  MODEM_RTT_NETWORK = 2,    ///< Radio y PDP (+CNACT, +CFUN, +CGATT, +COPS)
+  MODEM_RTT_CLASSES = 3
+};
 
 /**
- * @brief Obtiene timeout adaptativo según calidad de señal
+ * @struct ModemRttInfo
+ * @brief Estado de un estimador de RTT (milisegundos)
+ */
+struct ModemRttInfo {
+  uint32_t srtt;
+  uint32_t rttvar;
+  uint32_t rto;            ///< Timeout actual, con piso, techo y backoff
+  uint32_t samples;
+  uint32_t timeouts;
+};
+
+/**
+ * @brief Obtiene el timeout adaptativo de una clase de comandos
+ * @details RTO = SRTT + 4*RTTVAR (Jacobson/Karels) alimentado por el tiempo
+ * de cada comando AT completado. Cada timeout duplica el RTO hasta la
+ * siguiente respuesta. Antes de la primera muestra se usa la estimación por
+ * calidad de señal. El resultado se acota a RTT_*_FLOOR y RTT_*_CEILING.
+ * @param cls Clase del comando (por omisión, la de los canales TCP)
  * @return Timeout en milisegundos
  */
-unsigned long getAdaptiveTimeout();
+unsigned long getAdaptiveTimeout(ModemRttClass cls = MODEM_RTT_SOCKET);
+
+/**
+ * @brief Clase de RTT de un comando (sin prefijo "AT")
+ */
+ModemRttClass modemRttClassOf(const char* command);
+
+/**
+ * @brief Obtiene el estado del estimador de una clase
+ * @return false si la clase no existe
+ */
+bool modemRttGet(ModemRttClass cls, ModemRttInfo& info);
 
 /**
  * @brief Limpia el buffer serial del módem
@@ -129,10 +256,165 @@ void flushPortSerial();
  * @brief Envía comando AT y espera respuesta
  * @param command Comando AT a enviar
  * @param expectedResponse Respuesta esperada
- * @param timeout Timeout en milisegundos
+ * @param timeout Timeout máximo en milisegundos (retorna antes si llega el resultado final)
  * @return true si se recibe la respuesta esperada
  */
+bool sendATCommand(const char* command, const char* expectedResponse, unsigned long timeout);
+#if !GSMLTE_STATIC_ALLOC
 bool sendATCommand(const String& command, const String& expectedResponse, unsigned long timeout);
+#endif
+
+/**
+ * @brief Envía comando AT capturando la respuesta en un buffer del llamador
+ * @details Versión sin memoria dinámica de sendATCommandResponse(). La
+ * respuesta se trunca a responseSize-1 bytes y siempre termina en NUL.
+ * @param command Comando AT a enviar (sin prefijo "AT", máximo AT_COMMAND_MAX-1)
+ * @param expectedResponse Respuesta esperada (vacía = basta con OK)
+ * @param response Buffer de salida (puede ser NULL)
+ * @param responseSize Capacidad del buffer de salida
+ * @param timeout Timeout máximo en milisegundos
+ * @return 1=Respuesta esperada, -1=Error, 0=Timeout
+ */
+int8_t sendATCommandBuf(const char* command, const char* expectedResponse,
+                        char* response, size_t responseSize, unsigned long timeout);
+
+/**
+ * @brief Envía comando AT con formato printf
+ * @param expectedResponse Respuesta esperada (vacía = basta con OK)
+ * @param timeout Timeout máximo en milisegundos
+ * @param format Formato printf del comando (sin prefijo "AT")
+ * @return 1=Respuesta esperada, -1=Error o comando demasiado largo, 0=Timeout
+ */
+int8_t sendATCommandf(const char* expectedResponse, unsigned long timeout, const char* format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Envía comando AT y captura la respuesta hasta el resultado final
+ * @details Analiza la respuesta de forma incremental y retorna con el código
+ * final (OK/ERROR/+CME ERROR/+CMS ERROR), sin esperar el timeout completo. El
+ * resultado es 1 si la respuesta esperada apareció antes del código final;
+ * las que el módem envía después del OK (URC) no cuentan.
+ * @param command Comando AT a enviar (sin prefijo "AT")
+ * @param expectedResponse Respuesta esperada (vacía = basta con OK)
+ * @param response Cuerpo de la respuesta recibida
+ * @param timeout Timeout máximo en milisegundos
+ * @return 1=Respuesta esperada, -1=Error, 0=Timeout
+ */
+#if !GSMLTE_STATIC_ALLOC
+int8_t sendATCommandResponse(const String& command, const String& expectedResponse,
+                             String& response, unsigned long timeout);
+#endif
+
+/**
+ * @brief Encola un comando AT para ejecución no bloqueante
+ * @details El comando se envía y se procesa dentro de modemPoll(). Al llegar
+ * el código final o el timeout se invoca el callback; la respuesta esperada
+ * debe llegar antes del código final.
+ * @param command Comando AT a enviar (sin prefijo "AT")
+ * @param expectedResponse Respuesta esperada (vacía = basta con OK)
+ * @param timeout Timeout máximo en milisegundos
+ * @param callback Función a invocar al completar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return true si el comando fue encolado, false si la cola está llena
+ * @warning No llamar funciones bloqueantes desde el callback
+ */
+bool modemSubmitAT(const char* command, const char* expectedResponse, unsigned long timeout,
+                   ATCallback callback, void* ctx);
+#if !GSMLTE_STATIC_ALLOC
+bool modemSubmitAT(const String& command, const String& expectedResponse, unsigned long timeout,
+                   ATCallback callback, void* ctx);
+#endif
+
+/**
+ * @brief Avanza el motor AT y las máquinas de estado del módem sin bloquear
+ * @details Procesa los bytes disponibles del UART, completa comandos,
+ * avanza el arranque y mantiene la conexión TCP persistente (keep-alive,
+ * reconexión, envíos en cola). Debe llamarse en cada iteración de loop().
+ */
+void modemPoll();
+
+/**
+ * @brief Milisegundos que pueden pasar sin llamar a modemPoll()
+ * @details Mínimo entre el timeout del comando AT en curso, los
+ * temporizadores del arranque, keep-alive, reconexión, lotes y reenvíos, el
+ * despertar de PSM, el caché de información y el vaciado del registro. Los
+ * bytes que lleguen del módem antes del plazo requieren llamar a modemPoll()
+ * en seguida (schedWait() despierta con ellos).
+ * @return 0 si hay trabajo pendiente; a lo sumo MODEM_POLL_MAX_WAIT
+ */
+unsigned long modemPollTimeout();
+
+/**
+ * @brief Indica si el motor AT no tiene comandos activos ni en cola
+ * @return true si el motor está libre
+ */
+bool modemIsIdle();
+
+/**
+ * @brief Indica si la máquina de arranque está en curso
+ * @return true mientras el arranque (o reinicio LTE) no ha finalizado
+ */
+bool modemIsStarting();
+
+/**
+ * @brief Obtiene el estado actual de la máquina de arranque
+ * @return Estado del módem
+ */
+ModemState modemGetState();
+
+/**
+ * @brief Último estado de registro de red reportado por +CEREG
+ * @return 1=registrado, 5=roaming, 2=buscando, -1=desconocido (ver 3GPP 27.007)
+ */
+int modemRegistrationStatus();
+
+/**
+ * @brief Inicia la configuración del módem sin bloquear
+ * @details Equivalente a setupModem(); la secuencia avanza en modemPoll().
+ */
+void setupModemAsync();
+
+/**
+ * @brief Inicia el arranque rápido del módem sin bloquear
+ * @details Omite el pulso PWRKEY si el módem ya responde a AT (si no
+ * responde ejecuta la secuencia completa de encendido), omite la
+ * configuración de radio y PDP cuyo hash coincide con el guardado en NVS
+ * tras el último arranque exitoso, no reactiva un contexto PDP ya activo y
+ * reutiliza la conexión TCP si sigue abierta.
+ */
+void setupModemFastAsync();
+
+/**
+ * @brief Borra de NVS la configuración guardada por el arranque rápido
+ * @details El siguiente arranque rápido vuelve a aplicar toda la configuración
+ */
+void modemForgetConfig();
+
+/**
+ * @brief Configura la velocidad y el control de flujo del UART del módem
+ * @details Se aplica en el siguiente arranque: tras la primera respuesta AT
+ * se pide la velocidad con +IPR, se confirma con sondas AT y se guarda con
+ * AT&W y en NVS, así los arranques siguientes abren el UART directamente a
+ * esa velocidad. Si la confirmación falla se vuelve a la velocidad anterior
+ * y esa velocidad no se vuelve a pedir durante UART_BAUD_RETRY_BOOTS
+ * arranques (o hasta modemForgetConfig() o un cambio de baud). Si el módem no
+ * responde a la velocidad guardada, la sonda de arranque prueba también
+ * UART_BAUD y la velocidad pedida.
+ * @param baud Velocidad a negociar (0 = UART_BAUD)
+ * @param flowControl true para RTS/CTS (requiere PIN_RTS y PIN_CTS conectados)
+ */
+void modemUartConfigure(uint32_t baud, bool flowControl);
+
+/**
+ * @brief Velocidad actual del UART del módem
+ */
+uint32_t modemUartBaud();
+
+/**
+ * @brief Inicia la conexión LTE sin bloquear
+ * @details Equivalente a startLTE(); la secuencia avanza en modemPoll().
+ */
+void startLTEAsync();
 
 /**
  * @brief Inicia comunicación GSM/LTE con el módem
@@ -141,6 +423,8 @@ void startGsm();
 
 /**
  * @brief Diagnóstico completo del estado del módem
+ * @details Verifica la comunicación AT y muestra el caché de gsmlte_info.h
+ * sin repetir una consulta por campo
  */
 void diagnosticoModem();
 
@@ -168,7 +452,18 @@ bool startLTE();
  * @param timeout_ms Timeout en milisegundos
  * @return true si el envío es exitoso
  */
+#if !GSMLTE_STATIC_ALLOC
 bool tcpSendData(const String& datos, uint32_t timeout_ms);
+#endif
+
+/**
+ * @brief Envía bytes tal cual (sin CRLF), p. ej. registros de gsmlte_frame.h
+ * @param data Datos a enviar, sin copia intermedia
+ * @param len Longitud de los datos
+ * @param timeout_ms Timeout en milisegundos
+ * @return true si el envío es exitoso
+ */
+bool tcpSendData(const uint8_t* data, size_t len, uint32_t timeout_ms);
 
 
 
@@ -184,8 +479,10 @@ bool tcpInitPersistent();
 
 /**
  * @brief Verifica si la conexión TCP persistente está activa
- * @details Consulta el estado de la conexión TCP mediante comandos AT y 
- * actualiza el estado interno de la conexión.
+ * @details El estado se sigue de forma pasiva (URCs +CASTATE/+CADATAIND,
+ * resultado de aperturas y envíos). Solo consulta +CASTATE? al módem cuando
+ * el estado es desconocido o la última confirmación superó el intervalo de
+ * keep-alive.
  * @return true si la conexión está activa y funcional, false si está desconectada
  * @note Esta función actualiza lastTcpActivity si la conexión está activa
  */
@@ -201,10 +498,50 @@ bool tcpIsPersistentActive();
  */
 bool tcpKeepAlivePersistent();
 
+/**
+ * @enum TcpRecoverStage
+ * @brief Niveles de la escalada de recuperación de la conexión persistente
+ */
+enum TcpRecoverStage {
+  TCP_RECOVER_SOCKET = 0,   ///< +CACLOSE/+CAOPEN (MAX_RECONNECT_ATTEMPTS intentos)
+  TCP_RECOVER_PDP = 1,      ///< +CNACT=0,0 y etapa LTE
+  TCP_RECOVER_RF = 2,       ///< +CFUN=0/1 y etapa LTE
+  TCP_RECOVER_POWER = 3     ///< +CPOWD y arranque completo con PWRKEY
+};
+
+/**
+ * @enum TcpBreakerState
+ * @brief Estado del circuito de reconexión
+ */
+enum TcpBreakerState {
+  TCP_BREAKER_CLOSED = 0,     ///< Reconexiones permitidas
+  TCP_BREAKER_OPEN = 1,       ///< Escalada agotada: sin intentos hasta el enfriamiento
+  TCP_BREAKER_HALF_OPEN = 2   ///< Escalada de prueba tras el enfriamiento
+};
+
+/**
+ * @brief Estado del circuito de reconexión de la conexión persistente
+ * @details Tras una pérdida de conexión modemPoll() reintenta con backoff
+ * exponencial con jitter (TCP_BACKOFF_BASE a TCP_BACKOFF_MAX) y escala por
+ * TcpRecoverStage sin bloquear. Si el ciclo de encendido tampoco la
+ * restablece, el circuito se abre por TCP_BREAKER_COOLDOWN (duplicándose en
+ * cada apertura seguida). Después la prueba repite la escalada completa
+ * (socket, PDP, RF, PWRKEY) y el circuito solo se vuelve a abrir si falla.
+ * Mientras el circuito está abierto los envíos fallan de inmediato.
+ */
+TcpBreakerState tcpBreakerState();
+
+/**
+ * @brief Nivel actual de la escalada de recuperación
+ */
+TcpRecoverStage tcpRecoverStage();
+
 /**
  * @brief Reconecta la conexión TCP persistente si se perdió
- * @details Intenta reestablecer la conexión TCP si se detectó una desconexión.
- * Incluye lógica de reintentos con límite máximo.
+ * @details Versión bloqueante de la escalada de modemPoll(): ejecuta el
+ * siguiente paso (socket, PDP, RF o PWRKEY, ver tcpBreakerState()) y bombea
+ * modemPoll() hasta su desenlace. Respeta el backoff y el circuito; en espera
+ * o con el módem arrancando retorna false sin intentar.
  * @return true si se reconectó exitosamente, false si falló la reconexión
  * @note Incrementa el contador de intentos de reconexión
  */
@@ -216,7 +553,291 @@ bool tcpReconnectPersistent();
  * @param timeout_ms Timeout en milisegundos
  * @return true si el envío es exitoso
  */
+#if !GSMLTE_STATIC_ALLOC
 bool tcpSendPersistent(const String& datos, uint32_t timeout_ms);
+#endif
+
+/**
+ * @brief Versión sin memoria dinámica de tcpSendPersistent()
+ * @param data Datos a enviar (sin CRLF final)
+ * @param len Longitud de los datos (máximo TCP_CASEND_MAX-2)
+ * @param timeout_ms Timeout en milisegundos
+ * @return true si el envío es exitoso
+ */
+bool tcpSendPersistent(const char* data, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief Encola datos para envío no bloqueante por la conexión TCP persistente
+ * @details Verifica la conexión, reconecta si es necesario y reintenta una vez
+ * tras una falla, igual que tcpSendPersistent(), pero avanzando en modemPoll().
+ * @param datos Datos a enviar
+ * @param timeout_ms Timeout en milisegundos
+ * @param callback Función a invocar al completar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return true si los datos fueron encolados
+ */
+#if !GSMLTE_STATIC_ALLOC
+bool tcpSendPersistentAsync(const String& datos, uint32_t timeout_ms,
+                            TcpSendCallback callback, void* ctx);
+#endif
+
+/**
+ * @brief Versión sin memoria dinámica de tcpSendPersistentAsync()
+ * @details Los datos se copian a un buffer fijo de la cola; el llamador
+ * puede reutilizar su buffer en cuanto la función retorna.
+ * @param data Datos a enviar (sin CRLF final)
+ * @param len Longitud de los datos (máximo TCP_CASEND_MAX-2)
+ * @param timeout_ms Timeout en milisegundos
+ * @param callback Función a invocar al completar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return true si los datos fueron encolados
+ */
+bool tcpSendPersistentAsync(const char* data, size_t len, uint32_t timeout_ms,
+                            TcpSendCallback callback, void* ctx);
+
+/**
+ * @brief Igual que tcpSendPersistentAsync() pero sin agregar CRLF
+ * @details Para registros binarios que se delimitan por su longitud
+ * (gsmlte_frame.h). Se agrupan y se guardan en flash igual que los de texto.
+ * @param data Datos a enviar (se copian)
+ * @param len Longitud de los datos (1..TCP_CASEND_MAX)
+ * @param timeout_ms Timeout en milisegundos
+ * @param callback Función a invocar al completar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return true si los datos fueron encolados
+ */
+bool tcpSendBinaryAsync(const uint8_t* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx);
+
+/**
+ * @brief Activa la agrupación de envíos TCP persistentes en un solo +CASEND
+ * @details Con la agrupación activa, tcpSendPersistentAsync() y
+ * tcpSendPersistent() acumulan cada mensaje (con su CRLF) en un buffer
+ * acotado. El lote se envía al alcanzar maxBytes, TCP_BATCH_MAX_MESSAGES o
+ * maxLatencyMs desde el primer mensaje; el resultado se reporta a cada
+ * mensaje por separado. El servidor recibe el mismo flujo de bytes.
+ * @param maxBytes Tamaño máximo del lote (0 = desactivar, máximo TCP_CASEND_MAX)
+ * @param maxLatencyMs Tiempo máximo que un mensaje espera en el lote
+ */
+void tcpBatchConfigure(size_t maxBytes, unsigned long maxLatencyMs);
+
+/**
+ * @brief Activa el envío en ventana: varios +CASEND sin esperar al servidor
+ * @details Sin ventana cada envío termina con el OK de +CASEND y el siguiente
+ * espera su turno. Con ventana el OK libera el lugar del envío en la cola y
+ * sus mensajes quedan "en vuelo" (hasta TCP_INFLIGHT_MAX por socket): el
+ * siguiente se escribe en seguida, junto con los demás que ya esperan en la
+ * cola y quepan en un +CASEND, mientras los bytes sin confirmar no superen
+ * windowBytes. +CAACK indica cuántos bytes confirmó el servidor; se consulta
+ * cada TCP_ACK_POLL_INTERVAL ms, o en seguida si la ventana retiene un envío.
+ * El callback de cada mensaje se invoca al confirmarse sus bytes (true), o
+ * con false si la conexión se pierde o el servidor no confirma en
+ * TCP_ACK_TIMEOUT ms (o el timeout del envío, si es mayor). Un mensaje ya
+ * escrito que falla así no se guarda en flash: sus datos ya no están.
+ * @param windowBytes Bytes sin confirmar permitidos (0 = desactivar); no
+ * conviene superar el buffer de envío del módem
+ */
+void tcpSendWindowConfigure(size_t windowBytes);
+
+/**
+ * @brief Activa la compresión LZ4 de los envíos asíncronos antes de +CASEND
+ * @details Cada envío de al menos 64 bytes (típicamente un lote de
+ * tcpBatchConfigure() o un reenvío desde flash) se comprime con
+ * lzPackBlock() y sale con el encabezado LZ_BLOCK_MARK que el servidor usa
+ * para detectarlo. Si no resulta más corto se envía tal cual. La memoria de
+ * trabajo es fija: la tabla hash de gsmlte_lz.cpp y un buffer de
+ * TCP_CASEND_MAX bytes. La razón y el tiempo de CPU se acumulan en
+ * modemStatsCompression().
+ * @param enable true para comprimir
+ */
+void tcpCompressionConfigure(bool enable);
+
+/**
+ * @brief Cifra la conexión persistente (socket 0) con el TLS del SIM7080G
+ * @details Los PEM se suben al sistema de archivos del módem (+CFSWFILE) y se
+ * convierten con +CSSLCFG solo cuando cambian: un hash en NVS recuerda lo
+ * cargado, así que los arranques siguientes no repiten la subida. El contexto
+ * SSL (+CSSLCFG/+CASSLCFG) se aplica una vez por arranque del módem y las
+ * reconexiones solo repiten +CAOPEN, cuyo plazo sube a 30 s por el handshake.
+ * El SIM7080G no expone reanudación de sesiones, así que cada +CAOPEN hace un
+ * handshake completo; el keep-alive por +CASTATE evita reabrir sin necesidad.
+ * Debe llamarse antes de setupModemAsync(); los PEM deben seguir válidos.
+ * @param enable true para usar TLS
+ * @param caCertPem CA que valida al servidor (NULL = cifrar sin verificar)
+ * @param clientCertPem Certificado de cliente (NULL = sin autenticación mutua)
+ * @param clientKeyPem Clave privada del certificado de cliente
+ * @return false si un PEM está vacío, excede TCP_TLS_FILE_MAX o falta la clave
+ */
+bool tcpTlsConfigure(bool enable, const char* caCertPem, const char* clientCertPem,
+                     const char* clientKeyPem);
+
+/**
+ * @brief Resuelve el servidor persistente con +CDNSGIP y conecta por IP
+ * @details La dirección se consulta en segundo plano una vez que el módem está
+ * listo, se guarda en RAM y en NVS y se renueva al vencer ttlMs. +CAOPEN usa
+ * la dirección guardada, así las reconexiones no pagan una consulta DNS por
+ * aire; tras un reinicio la de NVS sirve de inmediato y se confirma en segundo
+ * plano. Si una apertura falla se prueban las alternativas de
+ * tcpResolverSetFallbacks() y por último el nombre. Sin efecto si
+ * modemConfig.serverIP ya es una dirección IP.
+ * @param enable true para resolver y conectar por IP
+ * @param ttlMs Vigencia de la dirección resuelta (0 = TCP_DNS_TTL_DEFAULT)
+ */
+void tcpResolverConfigure(bool enable, unsigned long ttlMs);
+
+/**
+ * @brief Define direcciones alternativas del servidor persistente
+ * @details Se copian; reemplazan a las anteriores.
+ * @param addresses Direcciones IP en texto
+ * @param count Cantidad (máximo TCP_DNS_FALLBACK_MAX)
+ * @return false si son demasiadas o alguna no cabe en TCP_DNS_ADDRESS_MAX
+ */
+bool tcpResolverSetFallbacks(const char* const* addresses, size_t count);
+
+/**
+ * @brief Obtiene la dirección resuelta del servidor persistente
+ * @return Dirección IP en texto, o NULL si aún no se resolvió
+ */
+const char* tcpResolverAddress();
+
+/**
+ * @brief Envía de inmediato el lote en construcción
+ * @return true si no había lote o quedó encolado para envío
+ */
+bool tcpBatchFlush();
+
+/**
+ * @brief Bytes recibidos por TCP pendientes de leer
+ * @details Al llegar +CADATAIND, modemPoll() trae los datos con +CARECV en
+ * bloques de hasta TCP_RX_CHUNK bytes a un buffer circular de
+ * TCP_RX_RING_SIZE bytes. Si el buffer se llena deja de pedir datos y el
+ * módem los retiene (control de flujo de TCP), por lo que el UART nunca
+ * recibe más de un bloque a la vez.
+ * @return Bytes disponibles
+ */
+size_t tcpAvailable();
+
+/**
+ * @brief Lee datos recibidos por TCP
+ * @param buffer Destino
+ * @param len Máximo de bytes a leer
+ * @return Bytes leídos
+ */
+size_t tcpRead(uint8_t* buffer, size_t len);
+
+/**
+ * @brief Lee un byte recibido por TCP
+ * @return Byte leído, o -1 si no hay datos
+ */
+int tcpRead();
+
+/**
+ * @brief Obtiene sin copiar el tramo contiguo de datos recibidos
+ * @param data Inicio del tramo dentro del buffer de recepción
+ * @return Longitud del tramo (0 si no hay datos); liberar con tcpConsume()
+ */
+size_t tcpPeekSpan(const uint8_t** data);
+
+/**
+ * @brief Libera datos recibidos ya procesados
+ * @param len Bytes a liberar
+ */
+void tcpConsume(size_t len);
+
+/**
+ * @brief Registra un callback que recibe los datos sin copia
+ * @details Se invoca desde modemPoll() con tramos del buffer circular; los
+ * datos se liberan al retornar. Con la tarea del módem activa el callback
+ * corre en esa tarea. NULL vuelve al modo tcpRead().
+ * @param callback Función a invocar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ */
+void tcpSetReceiveCallback(TcpReceiveCallback callback, void* ctx);
+
+/**
+ * @brief Asigna un socket adicional del pool hacia otro servidor
+ * @details El SIM7080G mantiene varios canales +CAOPEN a la vez; el socket 0
+ * es la conexión persistente y los demás se abren con esta función (por
+ * ejemplo un canal de comandos/OTA junto al de telemetría). La apertura,
+ * keep-alive y reconexión avanzan dentro de modemPoll() igual que en el
+ * socket 0, pero un socket adicional nunca provoca reinicio LTE.
+ * @param host Servidor (IP o nombre)
+ * @param port Puerto
+ * @return Identificador de socket (1..TCP_POOL_SIZE-1), o -1 si no hay libres
+ */
+int tcpSocketOpen(const char* host, const char* port);
+
+/**
+ * @brief Cierra un socket adicional y libera su lugar en el pool
+ * @details Los envíos pendientes se reportan como fallidos. El socket 0 se
+ * cierra con tcpClosePersistent().
+ * @param id Identificador devuelto por tcpSocketOpen()
+ */
+void tcpSocketClose(int id);
+
+/**
+ * @brief Indica si un socket del pool está conectado
+ * @param id Identificador de socket (0 = conexión persistente)
+ */
+bool tcpSocketIsConnected(int id);
+
+/**
+ * @brief Indica si algún socket tiene un envío listo o un cierre pendiente
+ * @details Lo usa gsmlte_power.h para despertar el módem solo cuando hay
+ * algo que transmitir
+ */
+bool tcpTrafficPending();
+
+/**
+ * @brief Encola un envío por un socket del pool sin bloquear
+ * @details Cada socket tiene su propia cola; los envíos de distintos sockets
+ * se intercalan en la cola AT. Para id 0 equivale a tcpSendPersistentAsync(),
+ * salvo que un envío fallido no se guarda en la cola en flash.
+ * @param id Identificador de socket
+ * @param data Datos a enviar (se copian)
+ * @param len Longitud de los datos (máximo TCP_CASEND_MAX-2)
+ * @param timeout_ms Timeout del envío en milisegundos
+ * @param callback Función invocada al finalizar (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return true si el envío fue encolado
+ */
+bool tcpSocketSendAsync(int id, const char* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx);
+
+/**
+ * @brief Equivalentes por socket de tcpAvailable(), tcpRead(), tcpPeekSpan(),
+ * tcpConsume() y tcpSetReceiveCallback(); cada socket tiene su propio buffer
+ */
+size_t tcpSocketAvailable(int id);
+size_t tcpSocketRead(int id, uint8_t* buffer, size_t len);
+size_t tcpSocketPeekSpan(int id, const uint8_t** data);
+void tcpSocketConsume(int id, size_t len);
+void tcpSocketSetReceiveCallback(int id, TcpReceiveCallback callback, void* ctx);
+
+/**
+ * @brief Activa la cola persistente en flash para envíos fallidos
+ * @details Monta LittleFS (ver gsmlte_store.h). Desde entonces, un envío por
+ * la conexión persistente que falla tras su reintento de reconexión se guarda
+ * en flash en lugar de descartarse. Cuando la conexión está disponible y no
+ * hay envíos nuevos, modemPoll() reenvía lo guardado en lotes de hasta
+ * TCP_CASEND_MAX bytes y borra cada lote al confirmarse su envío. El callback
+ * del envío original igual informa la falla.
+ * @return true si la partición quedó montada
+ */
+bool tcpOfflineBegin();
+
+/**
+ * @brief Bytes guardados en flash pendientes de reenvío
+ */
+size_t tcpOfflinePending();
+
+/**
+ * @brief Guarda en flash un mensaje para reenviarlo por la conexión persistente
+ * @param frame Mensaje tal como se envía (terminado en CRLF)
+ * @param len Longitud (máximo TCP_CASEND_MAX)
+ * @return false si la cola en flash no está activa o la escritura falló
+ */
+bool tcpOfflineStore(const uint8_t* frame, size_t len);
 
 /**
  * @brief Cierra la conexión TCP persistente
@@ -226,6 +847,7 @@ void tcpClosePersistent();
 /**
  * @brief Gestiona el mantenimiento de la conexión TCP persistente
  * @brief Debe llamarse periódicamente desde el loop principal
+ * @note No bloquea; equivale a modemPoll()
  */
 void tcpMaintainPersistent();
 
@@ -237,6 +859,7 @@ void tcpConfigurePersistent(unsigned long keepAliveIntervalMs);
 
 /**
  * @brief Obtiene información de la tarjeta SIM y calidad de señal
+ * @details Usa el caché de gsmlte_info.h; solo consulta los valores vencidos
  */
 void getIccid();
 
@@ -0,0 +1,182 @@
+/**
+ * @file gsmlte_frame.cpp
+ * @brief Implementación de los registros binarios de telemetría
+ *
+ * @details frameBegin() reserva 2 bytes para la longitud; si el contenido
+ * resulta menor a 128 bytes, frameEnd() lo desplaza un byte para usar la
+ * forma corta del varint. Un registro que no cabe se sigue "escribiendo"
+ * sin tocar el buffer (overflow) y frameEnd() lo descarta.
+ */
+
+#include "gsmlte_frame.h"
+#include <string.h>
+
+uint16_t frameCrc16(const uint8_t* data, size_t len, uint16_t crc) {
+  static const uint16_t table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+
+  for (size_t i = 0; i < len; ++i) {
+    crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ (data[i] >> 4)) & 0x0F]);
+    crc = (uint16_t)((crc << 4) ^ table[((crc >> 12) ^ data[i]) & 0x0F]);
+  }
+  return crc;
+}
+
+/**
+ * Escribe un varint en la posición del registro abierto
+ */
+static void frameWriteVarint(FrameWriter& w, uint32_t value) {
+  do {
+    if (w.overflow || w.pos >= w.size) {
+      w.overflow = true;
+      return;
+    }
+    uint8_t b = value & 0x7F;
+    value >>= 7;
+    w.buffer[w.pos++] = value ? (b | 0x80) : b;
+  } while (value);
+}
+
+/**
+ * Lee un varint acotado a 32 bits
+ * @return Bytes leídos (0 si está incompleto o es demasiado largo)
+ */
+static size_t frameReadVarint(const uint8_t* data, size_t len, uint32_t& value) {
+  value = 0;
+  for (size_t i = 0; i < len && i < 5; ++i) {
+    value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) return i + 1;
+  }
+  return 0;
+}
+
+void frameWriterInit(FrameWriter& w, uint8_t* buffer, size_t size) {
+  w.buffer = buffer;
+  w.size = size;
+  frameWriterReset(w);
+}
+
+void frameWriterReset(FrameWriter& w) {
+  w.len = 0;
+  w.pos = 0;
+  w.lastTimestamp = 0;
+  w.openTimestamp = 0;
+  w.hasTimestamp = false;
+  w.open = false;
+  w.overflow = false;
+}
+
+bool frameBegin(FrameWriter& w, uint8_t schema, uint32_t timestamp) {
+  if (w.open || schema > FRAME_SCHEMA_MAX) return false;
+
+  w.open = true;
+  w.openTimestamp = timestamp;
+  w.overflow = w.len + 3 > w.size;
+  if (w.overflow) return true;
+
+  w.buffer[w.len] = w.hasTimestamp ? (schema | FRAME_FLAG_DELTA) : schema;
+  w.pos = w.len + 3;
+  frameWriteVarint(w, w.hasTimestamp ? timestamp - w.lastTimestamp : timestamp);
+  return true;
+}
+
+void framePutUint(FrameWriter& w, uint32_t value) {
+  if (!w.open) return;
+  frameWriteVarint(w, value);
+}
+
+void framePutInt(FrameWriter& w, int32_t value) {
+  framePutUint(w, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+void framePutBytes(FrameWriter& w, const uint8_t* data, size_t len) {
+  if (!w.open) return;
+  frameWriteVarint(w, len);
+  if (w.overflow || w.pos + len > w.size) {
+    w.overflow = true;
+    return;
+  }
+  memcpy(w.buffer + w.pos, data, len);
+  w.pos += len;
+}
+
+bool frameEnd(FrameWriter& w) {
+  if (!w.open) return false;
+  w.open = false;
+
+  size_t contentLen = w.pos - (w.len + 3);
+  if (w.overflow || contentLen > FRAME_PAYLOAD_MAX || w.pos + 2 > w.size) {
+    w.overflow = false;
+    w.pos = w.len;
+    return false;
+  }
+
+  uint8_t* record = w.buffer + w.len;
+  size_t headerLen;
+  if (contentLen < 0x80) {
+    record[1] = (uint8_t)contentLen;
+    memmove(record + 2, record + 3, contentLen);
+    headerLen = 2;
+  } else {
+    record[1] = (uint8_t)((contentLen & 0x7F) | 0x80);
+    record[2] = (uint8_t)(contentLen >> 7);
+    headerLen = 3;
+  }
+
+  size_t recordLen = headerLen + contentLen;
+  uint16_t crc = frameCrc16(record, recordLen);
+  record[recordLen] = crc & 0xFF;
+  record[recordLen + 1] = crc >> 8;
+
+  w.len += recordLen + 2;
+  w.pos = w.len;
+  w.lastTimestamp = w.openTimestamp;
+  w.hasTimestamp = true;
+  return true;
+}
+
+int frameDecode(const uint8_t* data, size_t len, FrameRecord& record, uint32_t& lastTimestamp) {
+  if (len < 2) return 0;
+  if ((data[0] & FRAME_SCHEMA_MASK) > FRAME_SCHEMA_MAX) return -1;
+
+  uint32_t contentLen;
+  size_t lenBytes = frameReadVarint(data + 1, len - 1, contentLen);
+  if (lenBytes == 0) return (len - 1 >= 2) ? -1 : 0;
+  if (lenBytes > 2 || contentLen > FRAME_PAYLOAD_MAX) return -1;
+
+  size_t headerLen = 1 + lenBytes;
+  size_t total = headerLen + contentLen + 2;
+  if (len < total) return 0;
+
+  uint16_t crc = (uint16_t)data[total - 2] | ((uint16_t)data[total - 1] << 8);
+  if (frameCrc16(data, headerLen + contentLen) != crc) return -1;
+
+  const uint8_t* content = data + headerLen;
+  uint32_t timestamp;
+  size_t tsBytes = frameReadVarint(content, contentLen, timestamp);
+  if (tsBytes == 0) return -1;
+
+  record.schema = data[0] & FRAME_SCHEMA_MASK;
+  record.timestamp = (data[0] & FRAME_FLAG_DELTA) ? lastTimestamp + timestamp : timestamp;
+  record.fields = content + tsBytes;
+  record.fieldsLen = contentLen - tsBytes;
+  record.pos = 0;
+  lastTimestamp = record.timestamp;
+  return (int)total;
+}
+
+bool frameGetUint(FrameRecord& record, uint32_t& value) {
+  size_t n = frameReadVarint(record.fields + record.pos, record.fieldsLen - record.pos, value);
+  if (n == 0) return false;
+  record.pos += n;
+  return true;
+}
+
+bool frameGetInt(FrameRecord& record, int32_t& value) {
+  uint32_t raw;
+  if (!frameGetUint(record, raw)) return false;
+  value = (int32_t)((raw >> 1) ^ (0U - (raw & 1)));
+  return true;
+}
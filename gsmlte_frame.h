@@ -0,0 +1,141 @@
+/**
+ * @file gsmlte_frame.h
+ * @brief Registros binarios compactos para telemetría
+ * @version 3.0
+ *
+ * @details Cada registro se codifica directamente en un buffer del llamador,
+ * sin String ni memoria dinámica:
+ *
+ *   | tipo (1) | len (varint) | marca de tiempo (varint) | campos | crc16 (2, LE) |
+ *
+ * - tipo: bits 0-6 = esquema (FRAME_SCHEMA_MAX), bit 7 = la marca de tiempo
+ *   es la diferencia con el registro anterior del mismo buffer.
+ * - len: bytes de la marca de tiempo y los campos.
+ * - campos: enteros en varint (7 bits por byte, LSB primero); los enteros con
+ *   signo usan zigzag para que los valores negativos pequeños ocupen un byte.
+ * - crc16: CRC-16/CCITT-FALSE sobre tipo, len y contenido.
+ *
+ * El esquema indica al servidor qué campos siguen y en qué orden. El primer
+ * registro de cada buffer lleva la marca absoluta, por lo que un envío
+ * perdido no afecta a los siguientes y los buffers guardados en flash para
+ * reenvío pueden concatenarse. Los registros se delimitan por su longitud y
+ * se envían sin CRLF (tcpSendBinaryAsync(), tcpSendData()).
+ *
+ * @example
+ * @code
+ * static uint8_t tx[64];
+ * FrameWriter w;
+ * frameWriterInit(w, tx, sizeof(tx));
+ * frameBegin(w, 1, millis());
+ * framePutInt(w, signalsim0);
+ * if (frameEnd(w)) tcpSendBinaryAsync(tx, w.len, 10000, NULL, NULL);
+ * @endcode
+ */
+
+#ifndef GSMLTE_FRAME_H
+#define GSMLTE_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FRAME_SCHEMA_MAX 0x7E      ///< 0x7F reservado: tipo 0xFF marca envíos comprimidos (gsmlte_lz.h)
+#define FRAME_FLAG_DELTA 0x80
+#define FRAME_SCHEMA_MASK 0x7F
+#define FRAME_PAYLOAD_MAX 16383     ///< Máximo representable con len de 2 bytes
+#define FRAME_OVERHEAD_MAX 5        ///< tipo + len + crc
+
+/**
+ * @struct FrameWriter
+ * @brief Estado del codificador sobre un buffer fijo
+ */
+struct FrameWriter {
+  uint8_t* buffer;
+  size_t size;
+  size_t len;              ///< Bytes de registros completos
+  size_t pos;              ///< Posición de escritura del registro abierto
+  uint32_t lastTimestamp;  ///< Marca del último registro completo
+  uint32_t openTimestamp;  ///< Marca del registro abierto
+  bool hasTimestamp;       ///< Hay registro anterior en el buffer
+  bool open;
+  bool overflow;           ///< El registro abierto no cupo
+};
+
+/**
+ * @struct FrameRecord
+ * @brief Registro decodificado; los campos se leen en orden con frameGet*()
+ */
+struct FrameRecord {
+  uint8_t schema;
+  uint32_t timestamp;      ///< Marca absoluta (ya resuelta la diferencia)
+  const uint8_t* fields;
+  size_t fieldsLen;
+  size_t pos;
+};
+
+/**
+ * @brief Asocia un buffer al codificador y lo vacía
+ */
+void frameWriterInit(FrameWriter& w, uint8_t* buffer, size_t size);
+
+/**
+ * @brief Vacía el buffer; el siguiente registro lleva marca absoluta
+ */
+void frameWriterReset(FrameWriter& w);
+
+/**
+ * @brief Abre un registro
+ * @param schema Identificador de esquema (0..FRAME_SCHEMA_MAX)
+ * @param timestamp Marca de tiempo (p. ej. millis())
+ * @return false si el esquema no es válido o ya hay un registro abierto
+ */
+bool frameBegin(FrameWriter& w, uint8_t schema, uint32_t timestamp);
+
+/**
+ * @brief Agrega un entero sin signo al registro abierto
+ */
+void framePutUint(FrameWriter& w, uint32_t value);
+
+/**
+ * @brief Agrega un entero con signo (zigzag) al registro abierto
+ */
+void framePutInt(FrameWriter& w, int32_t value);
+
+/**
+ * @brief Agrega bytes precedidos de su longitud en varint
+ */
+void framePutBytes(FrameWriter& w, const uint8_t* data, size_t len);
+
+/**
+ * @brief Cierra el registro abierto: escribe la longitud y el CRC
+ * @return false si el registro no cupo; se descarta y el buffer queda como antes
+ */
+bool frameEnd(FrameWriter& w);
+
+/**
+ * @brief Decodifica el siguiente registro de un flujo
+ * @param data Bytes recibidos
+ * @param len Bytes disponibles
+ * @param record Registro decodificado
+ * @param lastTimestamp Marca del registro anterior; se actualiza
+ * @return Bytes consumidos, 0 si el registro está incompleto o -1 si es
+ * inválido (CRC o longitud)
+ */
+int frameDecode(const uint8_t* data, size_t len, FrameRecord& record, uint32_t& lastTimestamp);
+
+/**
+ * @brief Lee el siguiente campo sin signo del registro
+ * @return false si no quedan campos
+ */
+bool frameGetUint(FrameRecord& record, uint32_t& value);
+
+/**
+ * @brief Lee el siguiente campo con signo del registro
+ */
+bool frameGetInt(FrameRecord& record, int32_t& value);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (polinomio 0x1021, valor inicial 0xFFFF)
+ */
+uint16_t frameCrc16(const uint8_t* data, size_t len, uint16_t crc = 0xFFFF);
+
+#endif
@@ -0,0 +1,322 @@
+/**
+ * @file gsmlte_info.cpp
+ * @brief Implementación del caché de información del módem
+ *
+ * @details Las respuestas se analizan sobre el cuerpo que entrega el motor AT
+ * (líneas separadas por CRLF). Un campo vencido conserva su último valor para
+ * mostrarlo con su edad; solo modemInfoValid() distingue si sigue vigente.
+ * Tras una lectura fallida se espera INFO_RETRY_DELAY antes de volver a
+ * consultar, para no ocupar el UART si el módem no soporta un comando.
+ */
+
+#include "gsmlte_info.h"
+#include "gsmlte.h"
+#include "gsmlte_power.h"
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INFO_RETRY_DELAY 5000
+
+static const char* const infoCommands[MODEM_INFO_FIELDS] = {
+  "+CCID", "+CGSN", "+COPS?", "+CPSI?", "+CSQ", "+CNACT?"
+};
+
+/** Vigencia de cada campo (0 = permanente) */
+static const unsigned long infoTtl[MODEM_INFO_FIELDS] = {
+  0, 0, INFO_TTL_NETWORK, INFO_TTL_CELL, INFO_TTL_SIGNAL, INFO_TTL_NETWORK
+};
+
+static const char* const infoNames[MODEM_INFO_FIELDS] = {
+  "ICCID", "IMEI", "Operador", "Celda", "Señal", "IP"
+};
+
+static ModemInfo info;
+static uint8_t infoValidMask = 0;
+static uint8_t infoWantedMask = 0;
+static bool infoBusy = false;
+static unsigned long infoRetryAt = 0;
+
+/**
+ * Busca la línea que empieza con un prefijo
+ * @return Inicio del valor (tras "prefijo: "), o NULL si no está
+ */
+static const char* infoFindValue(const char* response, const char* prefix) {
+  size_t n = strlen(prefix);
+  const char* line = response;
+  while (*line != '\0') {
+    while (*line == '\r' || *line == '\n') line++;
+    if (strncmp(line, prefix, n) == 0 && line[n] == ':') {
+      const char* value = line + n + 1;
+      while (*value == ' ') value++;
+      return value;
+    }
+    const char* end = strchr(line, '\n');
+    if (end == NULL) break;
+    line = end + 1;
+  }
+  return NULL;
+}
+
+/**
+ * Copia la primera secuencia alfanumérica al inicio de una línea (ICCID, IMEI)
+ */
+static bool infoCopyNumber(const char* response, const char* prefix, char* dst, size_t size) {
+  const char* line = infoFindValue(response, prefix);
+  if (line == NULL) line = response;
+
+  while (*line != '\0') {
+    while (*line == '\r' || *line == '\n' || *line == ' ') line++;
+    if (*line >= '0' && *line <= '9') {
+      size_t len = 0;
+      while (len + 1 < size && ((line[len] >= '0' && line[len] <= '9') ||
+                                (line[len] >= 'A' && line[len] <= 'F'))) {
+        dst[len] = line[len];
+        len++;
+      }
+      dst[len] = '\0';
+      return len > 0;
+    }
+    const char* end = strchr(line, '\n');
+    if (end == NULL) break;
+    line = end + 1;
+  }
+  return false;
+}
+
+/**
+ * Copia el texto entre comillas que sigue a la posición dada
+ */
+static void infoCopyQuoted(const char* p, char* dst, size_t size) {
+  dst[0] = '\0';
+  const char* open = strchr(p, '"');
+  if (open == NULL) return;
+  const char* close = strchr(open + 1, '"');
+  if (close == NULL) return;
+
+  size_t len = (size_t)(close - open - 1);
+  if (len >= size) len = size - 1;
+  memcpy(dst, open + 1, len);
+  dst[len] = '\0';
+}
+
+/**
+ * Separa los campos de +CPSI (modo, estado, MCC-MNC, TAC, celda, PCI, banda,
+ * EARFCN, BW DL, BW UL, RSRQ, RSRP, RSSI, SNR)
+ */
+static bool infoParseCpsi(const char* response) {
+  const char* value = infoFindValue(response, "+CPSI");
+  if (value == NULL) return false;
+
+  char line[96];
+  size_t len = strcspn(value, "\r\n");
+  if (len >= sizeof(line)) len = sizeof(line) - 1;
+  memcpy(line, value, len);
+  line[len] = '\0';
+
+  const char* fields[14];
+  size_t count = 0;
+  char* p = line;
+  while (count < 14) {
+    fields[count++] = p;
+    char* comma = strchr(p, ',');
+    if (comma == NULL) break;
+    *comma = '\0';
+    p = comma + 1;
+  }
+
+  strncpy(info.systemMode, fields[0], sizeof(info.systemMode) - 1);
+  info.systemMode[sizeof(info.systemMode) - 1] = '\0';
+  info.band = 0;
+  info.rsrp = info.rsrq = info.rssi = info.snr = 0;
+
+  if (count == 14 && strncmp(fields[0], "LTE", 3) == 0) {
+    const char* band = strstr(fields[6], "BAND");
+    if (band != NULL) info.band = (uint8_t)atoi(band + 4);
+    info.rsrq = (int16_t)atoi(fields[10]);
+    info.rsrp = (int16_t)atoi(fields[11]);
+    info.rssi = (int16_t)atoi(fields[12]);
+    info.snr = (int16_t)atoi(fields[13]);
+  }
+  return true;
+}
+
+/**
+ * Obtiene la dirección del contexto PDP 0 de +CNACT?
+ */
+static bool infoParseCnact(const char* response) {
+  const char* line = strstr(response, "+CNACT: 0,");
+  if (line == NULL) return false;
+
+  if (atoi(line + 10) == 1) {
+    infoCopyQuoted(line, info.ip, sizeof(info.ip));
+  } else {
+    info.ip[0] = '\0';
+  }
+  return true;
+}
+
+bool modemInfoUpdate(ModemInfoField field, const char* response) {
+  bool ok = false;
+
+  switch (field) {
+    case MODEM_INFO_ICCID:
+      ok = infoCopyNumber(response, "+CCID", info.iccid, sizeof(info.iccid));
+#if GSMLTE_STATIC_ALLOC
+      if (ok) snprintf(iccidsim0, sizeof(iccidsim0), "%s", info.iccid);
+#else
+      if (ok) iccidsim0 = info.iccid;
+#endif
+      break;
+
+    case MODEM_INFO_IMEI:
+      ok = infoCopyNumber(response, "+CGSN", info.imei, sizeof(info.imei));
+      break;
+
+    case MODEM_INFO_OPERATOR: {
+      const char* value = infoFindValue(response, "+COPS");
+      if (value != NULL) {
+        infoCopyQuoted(value, info.operatorName, sizeof(info.operatorName));
+        ok = true;
+      }
+      break;
+    }
+
+    case MODEM_INFO_CELL:
+      ok = infoParseCpsi(response);
+      break;
+
+    case MODEM_INFO_SIGNAL: {
+      const char* value = infoFindValue(response, "+CSQ");
+      if (value != NULL) {
+        info.csq = (int8_t)atoi(value);
+        signalsim0 = info.csq;
+        ok = true;
+      }
+      break;
+    }
+
+    case MODEM_INFO_IP:
+      ok = infoParseCnact(response);
+      break;
+
+    default:
+      return false;
+  }
+
+  if (!ok) return false;
+
+  info.updated[field] = millis();
+  infoValidMask |= (uint8_t)(1u << field);
+  infoWantedMask &= (uint8_t)~(1u << field);
+  return true;
+}
+
+bool modemInfoValid(ModemInfoField field) {
+  if (field >= MODEM_INFO_FIELDS || (infoValidMask & (1u << field)) == 0) return false;
+  return infoTtl[field] == 0 || millis() - info.updated[field] < infoTtl[field];
+}
+
+unsigned long modemInfoAge(ModemInfoField field) {
+  if (field >= MODEM_INFO_FIELDS || info.updated[field] == 0) return ULONG_MAX;
+  return millis() - info.updated[field];
+}
+
+void modemInfoInvalidate(ModemInfoField field) {
+  if (field >= MODEM_INFO_FIELDS) return;
+  infoValidMask &= (uint8_t)~(1u << field);
+}
+
+void modemInfoRequest(ModemInfoField field) {
+  if (field >= MODEM_INFO_FIELDS) return;
+  infoWantedMask |= (uint8_t)(1u << field);
+}
+
+const ModemInfo& modemInfo() {
+  for (uint8_t f = 0; f < MODEM_INFO_FIELDS; ++f) {
+    if (!modemInfoValid((ModemInfoField)f)) infoWantedMask |= (uint8_t)(1u << f);
+  }
+  return info;
+}
+
+bool modemInfoRefresh(ModemInfoField field) {
+  if (field >= MODEM_INFO_FIELDS) return false;
+
+  char response[AT_RESPONSE_MAX];
+  const char* command = infoCommands[field];
+  if (sendATCommandBuf(command, "", response, sizeof(response),
+                       getAdaptiveTimeout(modemRttClassOf(command))) != 1) {
+    return false;
+  }
+  return modemInfoUpdate(field, response);
+}
+
+static void infoDone(int8_t result, const char* response, void* ctx) {
+  ModemInfoField field = (ModemInfoField)(uintptr_t)ctx;
+  infoBusy = false;
+
+  if (result != 1 || !modemInfoUpdate(field, response)) {
+    infoWantedMask &= (uint8_t)~(1u << field);
+    infoRetryAt = millis() + INFO_RETRY_DELAY;
+    logMessagef(3, "⚠️  No se pudo leer %s del módem", infoNames[field]);
+  }
+}
+
+void modemInfoPoll() {
+  if (infoWantedMask == 0 || infoBusy) return;
+  if ((long)(millis() - infoRetryAt) < 0) return;
+  if (modemIsStarting() || modemGetState() == MODEM_STATE_OFF) return;
+  if (!modemPowerAwake() || !modemIsIdle()) return;
+
+  uint8_t field = 0;
+  while ((infoWantedMask & (1u << field)) == 0) field++;
+
+  const char* command = infoCommands[field];
+  if (modemSubmitAT(command, "", getAdaptiveTimeout(modemRttClassOf(command)),
+                    infoDone, (void*)(uintptr_t)field)) {
+    infoBusy = true;
+  }
+}
+
+unsigned long modemInfoPollTimeout() {
+  if (infoWantedMask == 0 || infoBusy) return ULONG_MAX;
+  if (modemIsStarting() || modemGetState() == MODEM_STATE_OFF) return ULONG_MAX;
+  if (!modemPowerAwake() || !modemIsIdle()) return ULONG_MAX;
+
+  long remaining = (long)(infoRetryAt - millis());
+  return remaining > 0 ? (unsigned long)remaining : 0;
+}
+
+/**
+ * Imprime una línea "campo: valor (edad)", o "sin dato" si nunca se leyó
+ */
+static void infoPrintLine(Print& out, ModemInfoField field, const char* value) {
+  unsigned long age = modemInfoAge(field);
+  if (age == ULONG_MAX) {
+    out.printf("%s: sin dato\r\n", infoNames[field]);
+    return;
+  }
+  out.printf("%s: %s (%lus%s)\r\n", infoNames[field], value, age / 1000,
+             modemInfoValid(field) ? "" : ", vencido");
+}
+
+void modemInfoPrint(Print& out) {
+  char value[96];
+
+  infoPrintLine(out, MODEM_INFO_ICCID, info.iccid);
+  infoPrintLine(out, MODEM_INFO_IMEI, info.imei);
+  infoPrintLine(out, MODEM_INFO_OPERATOR,
+                info.operatorName[0] != '\0' ? info.operatorName : "sin registro");
+
+  if (info.band != 0) {
+    snprintf(value, sizeof(value), "%s banda %u, RSRP %d dBm, RSRQ %d dB, RSSI %d dBm, SNR %d dB",
+             info.systemMode, (unsigned)info.band, info.rsrp, info.rsrq, info.rssi, info.snr);
+  } else {
+    snprintf(value, sizeof(value), "%s", info.systemMode);
+  }
+  infoPrintLine(out, MODEM_INFO_CELL, value);
+
+  snprintf(value, sizeof(value), "CSQ %d", info.csq);
+  infoPrintLine(out, MODEM_INFO_SIGNAL, value);
+  infoPrintLine(out, MODEM_INFO_IP, info.ip[0] != '\0' ? info.ip : "PDP inactivo");
+}
@@ -0,0 +1,133 @@
+/**
+ * @file gsmlte_info.h
+ * @brief Caché de información del módem, la SIM y la red
+ * @version 3.0
+ *
+ * @details Cada campo sale de un solo comando AT y guarda el momento de su
+ * última lectura:
+ *
+ * | Campo                 | Comando    | Vigencia                              |
+ * |-----------------------|------------|---------------------------------------|
+ * | MODEM_INFO_ICCID      | +CCID      | permanente                            |
+ * | MODEM_INFO_IMEI       | +CGSN      | permanente                            |
+ * | MODEM_INFO_OPERATOR   | +COPS?     | INFO_TTL_NETWORK o cambio de +CEREG   |
+ * | MODEM_INFO_CELL       | +CPSI?     | INFO_TTL_CELL o cambio de +CEREG      |
+ * | MODEM_INFO_SIGNAL     | +CSQ       | INFO_TTL_SIGNAL                       |
+ * | MODEM_INFO_IP         | +CNACT?    | INFO_TTL_NETWORK o URC "+APP PDP"     |
+ *
+ * La lectura nunca bloquea: modemInfo() devuelve los valores guardados y
+ * marca como pedidos los campos vencidos; modemInfoPoll() los actualiza de a
+ * uno cuando el motor AT está libre y el módem despierto. El arranque y el
+ * registro LTE alimentan el caché con las respuestas que ya obtienen, así que
+ * normalmente no hace falta ningún comando adicional.
+ *
+ * @example
+ * @code
+ * const ModemInfo& info = modemInfo();
+ * if (modemInfoValid(MODEM_INFO_CELL)) Serial.printf("RSRP %d dBm\n", info.rsrp);
+ * @endcode
+ */
+
+#ifndef GSMLTE_INFO_H
+#define GSMLTE_INFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Arduino.h"
+
+#define INFO_TTL_SIGNAL 30000
+#define INFO_TTL_CELL 60000
+#define INFO_TTL_NETWORK 300000
+
+/**
+ * @enum ModemInfoField
+ * @brief Campos del caché; cada uno corresponde a un comando AT
+ */
+enum ModemInfoField {
+  MODEM_INFO_ICCID = 0,
+  MODEM_INFO_IMEI = 1,
+  MODEM_INFO_OPERATOR = 2,
+  MODEM_INFO_CELL = 3,      ///< Modo, banda, RSRP, RSRQ, RSSI y SNR
+  MODEM_INFO_SIGNAL = 4,    ///< CSQ (también en signalsim0)
+  MODEM_INFO_IP = 5,
+  MODEM_INFO_FIELDS = 6
+};
+
+/**
+ * @struct ModemInfo
+ * @brief Valores guardados; consultar modemInfoValid() antes de usar un campo
+ */
+struct ModemInfo {
+  char iccid[24];
+  char imei[20];
+  char operatorName[24];
+  char systemMode[16];      ///< "LTE CAT-M1", "LTE NB-IOT", "NO SERVICE", ...
+  uint8_t band;             ///< Banda E-UTRAN (0 = desconocida)
+  int16_t rsrp;             ///< dBm
+  int16_t rsrq;             ///< dB
+  int16_t rssi;             ///< dBm
+  int16_t snr;              ///< dB
+  int8_t csq;               ///< 0-31, 99 = desconocido
+  char ip[16];              ///< Vacío si el contexto PDP no está activo
+  unsigned long updated[MODEM_INFO_FIELDS];  ///< millis() de la última lectura
+};
+
+/**
+ * @brief Obtiene el caché sin bloquear
+ * @details Los campos vencidos quedan pedidos y se actualizan en modemPoll()
+ */
+const ModemInfo& modemInfo();
+
+/**
+ * @brief Indica si un campo tiene un valor leído y vigente
+ */
+bool modemInfoValid(ModemInfoField field);
+
+/**
+ * @brief Milisegundos desde la última lectura de un campo
+ * @return Edad del valor, o ULONG_MAX si nunca se leyó
+ */
+unsigned long modemInfoAge(ModemInfoField field);
+
+/**
+ * @brief Descarta el valor de un campo; se vuelve a leer al pedirlo
+ */
+void modemInfoInvalidate(ModemInfoField field);
+
+/**
+ * @brief Pide leer un campo aunque esté vigente
+ */
+void modemInfoRequest(ModemInfoField field);
+
+/**
+ * @brief Guarda un campo a partir de la respuesta de su comando
+ * @param field Campo
+ * @param response Cuerpo de la respuesta (como la entrega el motor AT)
+ * @return false si la respuesta no contiene el campo
+ */
+bool modemInfoUpdate(ModemInfoField field, const char* response);
+
+/**
+ * @brief Lee un campo con un comando bloqueante
+ * @return true si el campo quedó actualizado
+ */
+bool modemInfoRefresh(ModemInfoField field);
+
+/**
+ * @brief Actualiza de a un campo pedido cuando el motor AT está libre
+ * @note Se llama desde modemPoll()
+ */
+void modemInfoPoll();
+
+/**
+ * @brief Milisegundos hasta que modemInfoPoll() tenga un campo para leer
+ * @return ULONG_MAX si no hay campos pedidos o el motor AT está ocupado
+ */
+unsigned long modemInfoPollTimeout();
+
+/**
+ * @brief Imprime el caché con la edad de cada campo
+ */
+void modemInfoPrint(Print& out);
+
+#endif
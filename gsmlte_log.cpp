@@ -0,0 +1,853 @@
+/**
+ * @file gsmlte_log.cpp
+ * @brief Implementación del registro asíncrono
+ *
+ * @details El anillo es multiproductor / monoconsumidor: logHead se reserva
+ * con compare-exchange y cada ranura tiene su bandera ready, que el productor
+ * publica al terminar de escribirla. El consumidor avanza logTail solo sobre
+ * ranuras publicadas, en orden; una ranura reservada y aún no publicada
+ * detiene el vaciado hasta que su productor termina.
+ *
+ * La tabla del límite de frecuencia se actualiza sin exclusión: una carrera
+ * entre tareas solo puede dejar pasar o contar de más algún mensaje.
+ *
+ * En modo binario cada formato recibe como número su posición en una tabla
+ * hash abierta indexada por la dirección del literal; la definición se encola
+ * antes del primer mensaje que la usa.
+ */
+
+#include "gsmlte_log.h"
+#include "gsmlte.h"
+#include "gsmlte_frame.h"
+#include <atomic>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define LOG_SLOT_BINARY 0x80        ///< La ranura guarda un registro binario
+#define LOG_OUT_MAX (LOG_MESSAGE_MAX + 64)
+
+/**
+ * @struct LogSlot
+ * @brief Ranura del anillo
+ */
+struct LogSlot {
+  std::atomic<uint8_t> ready;
+  uint8_t level;
+  uint8_t kind;             ///< LOG_RECORD_* | LOG_FLAG_TRUNCATED | LOG_SLOT_BINARY
+  uint8_t len;              ///< Bytes en data
+  uint16_t suppressed;      ///< Mensajes de la misma etiqueta omitidos antes de este
+  uint32_t timestamp;
+  char data[LOG_MESSAGE_MAX];  ///< Texto, o id + argumentos (binario)
+};
+
+/**
+ * @struct LogRate
+ * @brief Ventana del límite de frecuencia de una etiqueta
+ */
+struct LogRate {
+  uint32_t tag;
+  uint32_t windowStart;
+  uint16_t count;
+  uint16_t suppressed;
+};
+
+/**
+ * @struct LogSpec
+ * @brief Conversión printf analizada
+ */
+struct LogSpec {
+  char conv;                ///< 'd', 's', 'f', ... o '%'
+  char length;              ///< 0, 'h', 'H' (hh), 'l', 'q' (ll), 'z', 'j', 't'
+  size_t len;               ///< Caracteres desde el '%' inclusive
+};
+
+static LogSlot logRing[LOG_RING_SLOTS];
+static std::atomic<uint32_t> logHead(0);
+static std::atomic<uint32_t> logTail(0);
+static std::atomic<uint32_t> logDroppedPending(0);
+static std::atomic<uint32_t> logWritten(0);
+static std::atomic<uint32_t> logDropped(0);
+static uint32_t logSuppressed = 0;
+static uint8_t logHighWater = 0;
+
+static LogRate logRates[LOG_RATE_SLOTS];
+static std::atomic<const char*> logDict[LOG_DICT_SLOTS];
+static const char logTextFormat[] = "%s";
+static LogFormat logFormat = LOG_FORMAT_TEXT;
+
+static uint8_t logOut[LOG_OUT_MAX];
+static size_t logOutLen = 0;
+static size_t logOutPos = 0;
+static TaskHandle_t logTaskHandle = NULL;
+
+bool logEnabled(int level) {
+  if (!modemConfig.enableDebug && level > 2) return false;
+  if (level > 1 && millis() < LOG_QUIET_BOOT) return false;
+  return true;
+}
+
+static const char* logLevelName(int level) {
+  switch (level) {
+    case 0: return "ERROR";
+    case 1: return "WARN";
+    case 2: return "INFO";
+    case 3: return "DEBUG";
+    default: return "UNKN";
+  }
+}
+
+/**
+ * FNV-1a del texto; con skipDigits los números no cambian la etiqueta
+ */
+static uint32_t logHashText(const char* text, bool skipDigits) {
+  uint32_t h = 2166136261u;
+  for (; *text != '\0'; ++text) {
+    if (skipDigits && *text >= '0' && *text <= '9') continue;
+    h = (h ^ (uint8_t)*text) * 16777619u;
+  }
+  return h;
+}
+
+/**
+ * Mezcla la dirección de un literal de formato
+ */
+static uint32_t logHashPointer(const void* p) {
+  uint32_t x = (uint32_t)(uintptr_t)p;
+  x ^= x >> 16;
+  x *= 0x7FEB352Du;
+  x ^= x >> 15;
+  return x;
+}
+
+static size_t logVarintLen(uint64_t value) {
+  size_t n = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    n++;
+  }
+  return n;
+}
+
+static size_t logPutVarint(uint8_t* out, uint64_t value) {
+  size_t n = 0;
+  do {
+    uint8_t b = value & 0x7F;
+    value >>= 7;
+    out[n++] = value ? (b | 0x80) : b;
+  } while (value);
+  return n;
+}
+
+/**
+ * Lee un varint acotado a 64 bits
+ * @return Bytes leídos (0 si está incompleto o es demasiado largo)
+ */
+static size_t logGetVarint(const uint8_t* data, size_t len, uint64_t& value) {
+  value = 0;
+  for (size_t i = 0; i < len && i < 10; ++i) {
+    value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) return i + 1;
+  }
+  return 0;
+}
+
+/**
+ * Analiza una conversión printf a partir de su '%'
+ * @return false si la conversión no se puede enviar en binario
+ */
+static bool logParseSpec(const char* p, LogSpec& spec) {
+  const char* s = p + 1;
+  while (*s != '\0' && strchr("-+ #0", *s) != NULL) s++;
+  while (*s >= '0' && *s <= '9') s++;
+  if (*s == '.') {
+    s++;
+    while (*s >= '0' && *s <= '9') s++;
+  }
+
+  spec.length = 0;
+  if (*s == 'h') {
+    spec.length = *s++;
+    if (*s == 'h') { spec.length = 'H'; s++; }
+  } else if (*s == 'l') {
+    spec.length = *s++;
+    if (*s == 'l') { spec.length = 'q'; s++; }
+  } else if (*s == 'z' || *s == 'j' || *s == 't') {
+    spec.length = *s++;
+  }
+
+  spec.conv = *s;
+  spec.len = (size_t)(s - p) + (*s != '\0' ? 1 : 0);
+  return *s != '\0' && strchr("diuoxXcspfFeEgGaA%", *s) != NULL;
+}
+
+static bool logFormatSupported(const char* format) {
+  for (const char* p = format; *p != '\0'; ++p) {
+    if (*p != '%') continue;
+    LogSpec spec;
+    if (!logParseSpec(p, spec)) return false;
+    p += spec.len - 1;
+  }
+  return strlen(format) < LOG_MESSAGE_MAX - 1;
+}
+
+/**
+ * Aplica el límite de frecuencia a una etiqueta
+ * @param suppressed Omitidos desde el último mensaje que pasó
+ * @return false si el mensaje se omite
+ */
+static bool logRateAllow(int level, uint32_t tag, uint16_t& suppressed) {
+  suppressed = 0;
+  if (level == 0) return true;
+
+  LogRate& r = logRates[tag % LOG_RATE_SLOTS];
+  uint32_t now = millis();
+  if (r.tag != tag) {
+    r.tag = tag;
+    r.windowStart = now;
+    r.count = 0;
+    r.suppressed = 0;
+  } else if (now - r.windowStart >= LOG_RATE_WINDOW) {
+    r.windowStart = now;
+    r.count = 0;
+  }
+
+  if (r.count >= LOG_RATE_BURST) {
+    if (r.suppressed < 0xFFFF) r.suppressed++;
+    logSuppressed++;
+    return false;
+  }
+
+  r.count++;
+  suppressed = r.suppressed;
+  r.suppressed = 0;
+  return true;
+}
+
+/**
+ * Reserva la siguiente ranura
+ * @return NULL si el anillo está lleno (el mensaje se cuenta como descartado)
+ */
+static LogSlot* logReserve() {
+  uint32_t head = logHead.load(std::memory_order_relaxed);
+  uint32_t tail;
+  do {
+    tail = logTail.load(std::memory_order_acquire);
+    if ((int32_t)(head - tail) >= LOG_RING_SLOTS) {
+      logDropped.fetch_add(1, std::memory_order_relaxed);
+      logDroppedPending.fetch_add(1, std::memory_order_relaxed);
+      return NULL;
+    }
+  } while (!logHead.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed));
+
+  uint32_t used = head + 1 - tail;
+  if (used > logHighWater) logHighWater = (uint8_t)used;
+  return &logRing[head & (LOG_RING_SLOTS - 1)];
+}
+
+static void logCommit(LogSlot* slot) {
+  logWritten.fetch_add(1, std::memory_order_relaxed);
+  slot->ready.store(1, std::memory_order_release);
+}
+
+static LogSlot* logReserveMessage(int level, uint16_t suppressed) {
+  LogSlot* slot = logReserve();
+  if (slot == NULL) return NULL;
+  slot->level = (uint8_t)(level & 0x03);
+  slot->suppressed = suppressed;
+  slot->timestamp = millis();
+  return slot;
+}
+
+/**
+ * Encola la definición de un formato
+ */
+static bool logQueueDefinition(int id, const char* format) {
+  LogSlot* slot = logReserve();
+  if (slot == NULL) return false;
+
+  size_t len = strlen(format);
+  slot->level = 0;
+  slot->kind = LOG_SLOT_BINARY | LOG_RECORD_FORMAT;
+  slot->suppressed = 0;
+  slot->timestamp = millis();
+  slot->data[0] = (char)id;
+  memcpy(slot->data + 1, format, len);
+  slot->len = (uint8_t)(len + 1);
+  logCommit(slot);
+  return true;
+}
+
+/**
+ * Busca o asigna el número de un formato; la primera vez encola su definición
+ * @return Número del formato, o -1 si no puede enviarse en binario
+ */
+static int logDictId(const char* format) {
+  uint32_t i = logHashPointer(format) % LOG_DICT_SLOTS;
+
+  for (uint32_t n = 0; n < LOG_DICT_SLOTS; ++n, i = (i + 1) % LOG_DICT_SLOTS) {
+    const char* entry = logDict[i].load(std::memory_order_acquire);
+    if (entry == format) return (int)i;
+    if (entry != NULL) continue;
+
+    if (!logFormatSupported(format)) return -1;
+    if (logDict[i].compare_exchange_strong(entry, format, std::memory_order_acq_rel)) {
+      if (logQueueDefinition((int)i, format)) return (int)i;
+      // Sin definición el host no podría decodificar: se reintenta la próxima vez
+      logDict[i].store(NULL, std::memory_order_release);
+      return -1;
+    }
+    if (entry == format) return (int)i;
+  }
+  return -1;
+}
+
+/**
+ * Guarda un mensaje ya formateado: como texto, o como registro "%s" si textId >= 0
+ */
+static void logStoreText(LogSlot* slot, int textId, const char* text, size_t len) {
+  if (textId < 0) {
+    if (len > LOG_MESSAGE_MAX) len = LOG_MESSAGE_MAX;
+    if (text != slot->data) memcpy(slot->data, text, len);
+    slot->kind = LOG_RECORD_MESSAGE;
+    slot->len = (uint8_t)len;
+    return;
+  }
+
+  uint8_t* d = (uint8_t*)slot->data;
+  slot->kind = LOG_SLOT_BINARY | LOG_RECORD_MESSAGE;
+  if (len > LOG_MESSAGE_MAX - 3) {
+    len = LOG_MESSAGE_MAX - 3;
+    slot->kind |= LOG_FLAG_TRUNCATED;
+  }
+  size_t pos = 0;
+  d[pos++] = (uint8_t)textId;
+  pos += logPutVarint(d + pos, len);
+  memcpy(d + pos, text, len);
+  slot->len = (uint8_t)(pos + len);
+}
+
+/**
+ * Codifica los argumentos en el orden del formato
+ * @param truncated Queda en true si no cupieron todos
+ * @return Bytes escritos
+ */
+static size_t logEncodeArgs(uint8_t* out, size_t size, const char* format, va_list args,
+                            bool& truncated) {
+  size_t pos = 0;
+
+  for (const char* p = format; *p != '\0'; ++p) {
+    if (*p != '%') continue;
+    LogSpec spec;
+    logParseSpec(p, spec);
+    p += spec.len - 1;
+
+    uint64_t value = 0;
+    switch (spec.conv) {
+      case '%':
+        continue;
+
+      case 'd':
+      case 'i': {
+        int64_t v;
+        if (spec.length == 'q' || spec.length == 'j') v = va_arg(args, long long);
+        else if (spec.length == 'l' || spec.length == 't') v = va_arg(args, long);
+        else if (spec.length == 'z') v = (int64_t)(intptr_t)va_arg(args, size_t);
+        else v = va_arg(args, int);
+        value = ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+        break;
+      }
+
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        if (spec.length == 'q' || spec.length == 'j') value = va_arg(args, unsigned long long);
+        else if (spec.length == 'l' || spec.length == 't') value = va_arg(args, unsigned long);
+        else if (spec.length == 'z') value = va_arg(args, size_t);
+        else value = va_arg(args, unsigned int);
+        break;
+
+      case 'c':
+        value = (uint8_t)va_arg(args, int);
+        break;
+
+      case 'p':
+        value = (uintptr_t)va_arg(args, void*);
+        break;
+
+      case 's': {
+        const char* s = va_arg(args, const char*);
+        if (s == NULL) s = "(null)";
+        if (pos + 2 > size) {
+          truncated = true;
+          return pos;
+        }
+        size_t len = strlen(s);
+        if (len > size - pos - 2) {
+          len = size - pos - 2;
+          truncated = true;
+        }
+        pos += logPutVarint(out + pos, len);
+        memcpy(out + pos, s, len);
+        pos += len;
+        continue;
+      }
+
+      default: {
+        double d = va_arg(args, double);
+        if (pos + sizeof(d) > size) {
+          truncated = true;
+          return pos;
+        }
+        memcpy(out + pos, &d, sizeof(d));
+        pos += sizeof(d);
+        continue;
+      }
+    }
+
+    if (pos + logVarintLen(value) > size) {
+      truncated = true;
+      return pos;
+    }
+    pos += logPutVarint(out + pos, value);
+  }
+  return pos;
+}
+
+void logWrite(int level, const char* message) {
+  uint16_t suppressed;
+  if (!logRateAllow(level, logHashText(message, true), suppressed)) return;
+
+  int textId = logFormat == LOG_FORMAT_BINARY ? logDictId(logTextFormat) : -1;
+  LogSlot* slot = logReserveMessage(level, suppressed);
+  if (slot == NULL) return;
+
+  logStoreText(slot, textId, message, strlen(message));
+  logCommit(slot);
+}
+
+#if !GSMLTE_STATIC_ALLOC
+void logWrite(int level, const String& message) {
+  logWrite(level, message.c_str());
+}
+#endif
+
+void logWritef(int level, const char* format, ...) {
+  uint16_t suppressed;
+  if (!logRateAllow(level, logHashPointer(format), suppressed)) return;
+
+  int id = -1;
+  int textId = -1;
+  if (logFormat == LOG_FORMAT_BINARY) {
+    id = logDictId(format);
+    if (id < 0) textId = logDictId(logTextFormat);
+  }
+
+  LogSlot* slot = logReserveMessage(level, suppressed);
+  if (slot == NULL) return;
+
+  va_list args;
+  va_start(args, format);
+  if (id >= 0) {
+    bool truncated = false;
+    slot->data[0] = (char)id;
+    size_t len = logEncodeArgs((uint8_t*)slot->data + 1, LOG_MESSAGE_MAX - 1, format, args, truncated);
+    slot->kind = LOG_SLOT_BINARY | LOG_RECORD_MESSAGE | (truncated ? LOG_FLAG_TRUNCATED : 0);
+    slot->len = (uint8_t)(len + 1);
+  } else if (textId >= 0) {
+    char text[LOG_MESSAGE_MAX];
+    int n = vsnprintf(text, sizeof(text), format, args);
+    size_t len = n < 0 ? 0 : ((size_t)n >= sizeof(text) ? sizeof(text) - 1 : (size_t)n);
+    logStoreText(slot, textId, text, len);
+  } else {
+    int n = vsnprintf(slot->data, LOG_MESSAGE_MAX, format, args);
+    size_t len = n < 0 ? 0 : ((size_t)n >= LOG_MESSAGE_MAX ? LOG_MESSAGE_MAX - 1 : (size_t)n);
+    logStoreText(slot, -1, slot->data, len);
+  }
+  va_end(args);
+
+  logCommit(slot);
+}
+
+void logSetFormat(LogFormat format) {
+  if (format == LOG_FORMAT_BINARY) {
+    for (size_t i = 0; i < LOG_DICT_SLOTS; ++i) logDict[i].store(NULL, std::memory_order_relaxed);
+  }
+  logFormat = format;
+}
+
+/**
+ * Cierra un registro binario en logOut: longitud y CRC
+ */
+static size_t logFinishRecord(size_t pos) {
+  logOut[0] = LOG_SYNC;
+  logOut[1] = (uint8_t)(pos - 2);
+  uint16_t crc = frameCrc16(logOut + 1, pos - 1);
+  logOut[pos++] = (uint8_t)(crc & 0xFF);
+  logOut[pos++] = (uint8_t)(crc >> 8);
+  return pos;
+}
+
+/**
+ * Prepara en logOut el aviso de mensajes descartados
+ */
+static size_t logFormatDropped(uint32_t dropped) {
+  uint32_t now = millis();
+
+  if (logFormat == LOG_FORMAT_BINARY) {
+    size_t pos = 2;
+    logOut[pos++] = (uint8_t)(1 | (LOG_RECORD_DROPPED << 4));
+    pos += logPutVarint(logOut + pos, now);
+    pos += logPutVarint(logOut + pos, dropped);
+    return logFinishRecord(pos);
+  }
+
+  int n = snprintf((char*)logOut, sizeof(logOut),
+                   "[%lums] WARN: ⚠️  %lu mensajes de log descartados (anillo lleno)\r\n",
+                   (unsigned long)now, (unsigned long)dropped);
+  return n < 0 ? 0 : ((size_t)n >= sizeof(logOut) ? sizeof(logOut) - 1 : (size_t)n);
+}
+
+/**
+ * Prepara en logOut la línea o el registro de una ranura
+ */
+static size_t logFormatSlot(const LogSlot& slot) {
+  if (slot.kind & LOG_SLOT_BINARY) {
+    uint8_t record = slot.kind & 0x0F & ~LOG_FLAG_TRUNCATED;
+    size_t pos = 2;
+    logOut[pos++] = (uint8_t)(slot.level | (slot.kind & LOG_FLAG_TRUNCATED) | (record << 4));
+    if (record == LOG_RECORD_MESSAGE) {
+      logOut[pos++] = (uint8_t)slot.data[0];
+      pos += logPutVarint(logOut + pos, slot.timestamp);
+      pos += logPutVarint(logOut + pos, slot.suppressed);
+      memcpy(logOut + pos, slot.data + 1, slot.len - 1);
+      pos += slot.len - 1;
+    } else {
+      memcpy(logOut + pos, slot.data, slot.len);
+      pos += slot.len;
+    }
+    return logFinishRecord(pos);
+  }
+
+  // Se reservan 2 bytes para el CRLF
+  const size_t limit = sizeof(logOut) - 2;
+  int n = snprintf((char*)logOut, limit + 1, "[%lums] %s: %.*s", (unsigned long)slot.timestamp,
+                   logLevelName(slot.level), (int)slot.len, slot.data);
+  size_t len = n < 0 ? 0 : ((size_t)n > limit ? limit : (size_t)n);
+  if (slot.suppressed > 0 && len < limit) {
+    n = snprintf((char*)logOut + len, limit + 1 - len, " (%u similares omitidos)",
+                 (unsigned)slot.suppressed);
+    len = n < 0 ? len : (len + (size_t)n > limit ? limit : len + (size_t)n);
+  }
+  logOut[len++] = '\r';
+  logOut[len++] = '\n';
+  return len;
+}
+
+/**
+ * Toma el siguiente mensaje del anillo y lo deja listo en logOut
+ * @return false si no hay nada publicado
+ */
+static bool logPrepareNext() {
+  logOutPos = 0;
+  logOutLen = 0;
+
+  uint32_t tail = logTail.load(std::memory_order_relaxed);
+  LogSlot& slot = logRing[tail & (LOG_RING_SLOTS - 1)];
+  if (tail != logHead.load(std::memory_order_acquire) &&
+      slot.ready.load(std::memory_order_acquire)) {
+    logOutLen = logFormatSlot(slot);
+    slot.ready.store(0, std::memory_order_relaxed);
+    logTail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Los descartes se informan al alcanzar al productor, después de lo anterior
+  uint32_t dropped = logDroppedPending.exchange(0, std::memory_order_relaxed);
+  if (dropped > 0) {
+    logOutLen = logFormatDropped(dropped);
+    return true;
+  }
+  return false;
+}
+
+size_t logDrain(size_t budget) {
+  size_t written = 0;
+
+  while (written < budget) {
+    if (logOutPos == logOutLen && !logPrepareNext()) break;
+
+    int room = Serial.availableForWrite();
+    if (room <= 0) break;
+
+    size_t n = logOutLen - logOutPos;
+    if (n > (size_t)room) n = (size_t)room;
+    if (n > budget - written) n = budget - written;
+    n = Serial.write(logOut + logOutPos, n);
+    if (n == 0) break;
+
+    logOutPos += n;
+    written += n;
+  }
+  return written;
+}
+
+void logFlush() {
+  while (logOutPos < logOutLen || logPrepareNext()) {
+    size_t n = Serial.write(logOut + logOutPos, logOutLen - logOutPos);
+    if (n == 0) break;
+    logOutPos += n;
+  }
+  Serial.flush();
+}
+
+void logPoll() {
+  if (logTaskHandle != NULL) return;
+
+  uint32_t pending = logHead.load(std::memory_order_relaxed) - logTail.load(std::memory_order_relaxed);
+  if (modemIsIdle() || pending >= LOG_RING_SLOTS / 2) {
+    logDrain(LOG_DRAIN_BUDGET);
+  }
+}
+
+unsigned long logPollTimeout() {
+  if (logTaskHandle != NULL) return ULONG_MAX;
+
+  uint32_t pending = logHead.load(std::memory_order_relaxed) - logTail.load(std::memory_order_relaxed);
+  if (pending == 0 && logOutPos == logOutLen &&
+      logDroppedPending.load(std::memory_order_relaxed) == 0) {
+    return ULONG_MAX;
+  }
+  if (!modemIsIdle() && pending < LOG_RING_SLOTS / 2) return ULONG_MAX;
+  return Serial.availableForWrite() > 0 ? 0 : LOG_TASK_PERIOD;
+}
+
+#if GSMLTE_STATIC_ALLOC
+static StaticTask_t logTaskState;
+static StackType_t logTaskStack[LOG_TASK_STACK];
+#endif
+
+static void logTaskMain(void* arg) {
+  (void)arg;
+  for (;;) {
+    logDrain(LOG_OUT_MAX);
+    vTaskDelay(pdMS_TO_TICKS(LOG_TASK_PERIOD));
+  }
+}
+
+bool logTaskStart(int core) {
+  if (logTaskHandle != NULL) return true;
+
+#if GSMLTE_STATIC_ALLOC
+  logTaskHandle = xTaskCreateStaticPinnedToCore(logTaskMain, "gsmlte_log", LOG_TASK_STACK, NULL,
+                                                LOG_TASK_PRIORITY, logTaskStack, &logTaskState, core);
+  if (logTaskHandle == NULL) {
+#else
+  if (xTaskCreatePinnedToCore(logTaskMain, "gsmlte_log", LOG_TASK_STACK, NULL,
+                              LOG_TASK_PRIORITY, &logTaskHandle, core) != pdPASS) {
+#endif
+    logTaskHandle = NULL;
+    logMessage(0, "❌ No se pudo crear la tarea de registro");
+    return false;
+  }
+  return true;
+}
+
+LogStats logStats() {
+  LogStats s;
+  s.written = logWritten.load(std::memory_order_relaxed);
+  s.dropped = logDropped.load(std::memory_order_relaxed);
+  s.suppressed = logSuppressed;
+  s.pending = (uint8_t)(logHead.load(std::memory_order_relaxed) - logTail.load(std::memory_order_relaxed));
+  s.highWater = logHighWater;
+  return s;
+}
+
+void logDecoderInit(LogDecoder& decoder) {
+  for (size_t i = 0; i < LOG_DICT_SLOTS; ++i) decoder.formats[i][0] = '\0';
+}
+
+/**
+ * Agrega texto a la línea decodificada
+ */
+static void logAppend(char* out, size_t outSize, size_t& pos, const char* text, size_t len) {
+  if (pos + 1 >= outSize) return;
+  if (len > outSize - 1 - pos) len = outSize - 1 - pos;
+  memcpy(out + pos, text, len);
+  pos += len;
+  out[pos] = '\0';
+}
+
+/**
+ * Aplica una conversión a un argumento decodificado
+ * @return false si el registro no trae el argumento
+ */
+static bool logDecodeArg(const LogSpec& spec, const char* specText, const uint8_t* args,
+                         size_t argsLen, size_t& argPos, char* text, size_t textSize) {
+  // Especificador sin modificador de longitud, para pasar el valor ya ampliado
+  char fmt[24];
+  size_t flen = 0;
+  size_t keep = spec.len - 1;
+  if (spec.length == 'H' || spec.length == 'q') keep -= 2;
+  else if (spec.length != 0) keep -= 1;
+  if (keep >= sizeof(fmt) - 4) return false;
+  memcpy(fmt, specText, keep);
+  flen = keep;
+
+  if (spec.conv == 's') {
+    uint64_t len;
+    size_t n = logGetVarint(args + argPos, argsLen - argPos, len);
+    if (n == 0 || len > argsLen - argPos - n) return false;
+    char value[LOG_MESSAGE_MAX];
+    if (len >= sizeof(value)) len = sizeof(value) - 1;
+    memcpy(value, args + argPos + n, (size_t)len);
+    value[len] = '\0';
+    argPos += n + (size_t)len;
+    fmt[flen++] = 's';
+    fmt[flen] = '\0';
+    snprintf(text, textSize, fmt, value);
+    return true;
+  }
+
+  if (strchr("fFeEgGaA", spec.conv) != NULL) {
+    double d;
+    if (argsLen - argPos < sizeof(d)) return false;
+    memcpy(&d, args + argPos, sizeof(d));
+    argPos += sizeof(d);
+    fmt[flen++] = spec.conv;
+    fmt[flen] = '\0';
+    snprintf(text, textSize, fmt, d);
+    return true;
+  }
+
+  uint64_t value;
+  size_t n = logGetVarint(args + argPos, argsLen - argPos, value);
+  if (n == 0) return false;
+  argPos += n;
+
+  if (spec.conv == 'c') {
+    fmt[flen++] = 'c';
+    fmt[flen] = '\0';
+    snprintf(text, textSize, fmt, (int)value);
+  } else if (spec.conv == 'p') {
+    snprintf(text, textSize, "0x%llx", (unsigned long long)value);
+  } else {
+    fmt[flen++] = 'l';
+    fmt[flen++] = 'l';
+    fmt[flen++] = spec.conv;
+    fmt[flen] = '\0';
+    if (spec.conv == 'd' || spec.conv == 'i') {
+      long long v = (long long)((value >> 1) ^ (~(value & 1) + 1));
+      snprintf(text, textSize, fmt, v);
+    } else {
+      snprintf(text, textSize, fmt, (unsigned long long)value);
+    }
+  }
+  return true;
+}
+
+int logDecode(LogDecoder& decoder, const uint8_t* data, size_t len, char* out, size_t outSize) {
+  if (outSize > 0) out[0] = '\0';
+  if (len < 1) return 0;
+  if (data[0] != LOG_SYNC) return -1;
+  if (len < 2) return 0;
+
+  size_t contentLen = data[1];
+  size_t total = 2 + contentLen + 2;
+  if (contentLen < 1) return -1;
+  if (len < total) return 0;
+
+  uint16_t crc = (uint16_t)(data[2 + contentLen] | (data[3 + contentLen] << 8));
+  if (frameCrc16(data + 1, contentLen + 1) != crc) return -1;
+
+  const uint8_t* p = data + 2;
+  const uint8_t* end = p + contentLen;
+  uint8_t type = *p++;
+  uint8_t level = type & 0x03;
+  uint8_t record = type >> 4;
+  size_t pos = 0;
+  char text[LOG_OUT_MAX];
+  uint64_t timestamp;
+  uint64_t count;
+  size_t n;
+
+  switch (record) {
+    case LOG_RECORD_FORMAT: {
+      if (p >= end) return -1;
+      uint8_t id = *p++;
+      size_t flen = (size_t)(end - p);
+      if (flen >= LOG_MESSAGE_MAX) flen = LOG_MESSAGE_MAX - 1;
+      memcpy(decoder.formats[id], p, flen);
+      decoder.formats[id][flen] = '\0';
+      return (int)total;
+    }
+
+    case LOG_RECORD_DROPPED:
+      n = logGetVarint(p, (size_t)(end - p), timestamp);
+      if (n == 0) return -1;
+      p += n;
+      if (logGetVarint(p, (size_t)(end - p), count) == 0) return -1;
+      snprintf(out, outSize, "[%llums] WARN: %llu mensajes de log descartados (anillo lleno)",
+               (unsigned long long)timestamp, (unsigned long long)count);
+      return (int)total;
+
+    case LOG_RECORD_MESSAGE:
+      break;
+
+    default:
+      return (int)total;
+  }
+
+  if (p >= end) return -1;
+  uint8_t id = *p++;
+  n = logGetVarint(p, (size_t)(end - p), timestamp);
+  if (n == 0) return -1;
+  p += n;
+  n = logGetVarint(p, (size_t)(end - p), count);
+  if (n == 0) return -1;
+  p += n;
+
+  snprintf(text, sizeof(text), "[%llums] %s: ", (unsigned long long)timestamp, logLevelName(level));
+  logAppend(out, outSize, pos, text, strlen(text));
+
+  const char* format = decoder.formats[id];
+  if (format[0] == '\0') {
+    snprintf(text, sizeof(text), "<formato %u desconocido>", (unsigned)id);
+    logAppend(out, outSize, pos, text, strlen(text));
+    return (int)total;
+  }
+
+  size_t argsLen = (size_t)(end - p);
+  size_t argPos = 0;
+  bool complete = true;
+  for (const char* f = format; *f != '\0'; ++f) {
+    if (*f != '%') {
+      logAppend(out, outSize, pos, f, 1);
+      continue;
+    }
+
+    LogSpec spec;
+    if (!logParseSpec(f, spec)) break;
+    if (spec.conv == '%') {
+      logAppend(out, outSize, pos, "%", 1);
+    } else if (logDecodeArg(spec, f, p, argsLen, argPos, text, sizeof(text))) {
+      logAppend(out, outSize, pos, text, strlen(text));
+    } else {
+      complete = false;
+      break;
+    }
+    f += spec.len - 1;
+  }
+
+  if (!complete || (type & LOG_FLAG_TRUNCATED)) logAppend(out, outSize, pos, "…", strlen("…"));
+  if (count > 0) {
+    snprintf(text, sizeof(text), " (%llu similares omitidos)", (unsigned long long)count);
+    logAppend(out, outSize, pos, text, strlen(text));
+  }
+  return (int)total;
+}
@@ -0,0 +1,210 @@
+/**
+ * @file gsmlte_log.h
+ * @brief Registro asíncrono con anillo sin bloqueo y límite de frecuencia
+ * @version 3.0
+ *
+ * @details logMessage() y logMessagef() no escriben en Serial: formatean el
+ * mensaje en una ranura de un anillo fijo (LOG_RING_SLOTS x LOG_MESSAGE_MAX)
+ * y vuelven de inmediato. La marca de tiempo se toma al registrar. El anillo
+ * se vacía después, sin bloquear, desde modemPoll() cuando el motor AT está
+ * libre (o si el anillo pasa de la mitad), o desde una tarea propia con
+ * logTaskStart(). Solo se escriben los bytes que caben en el buffer de
+ * transmisión de Serial, así el registro nunca frena el camino AT.
+ *
+ * - Varios productores reservan ranuras con una operación atómica; hay un
+ *   solo consumidor (quien vacía el anillo). Con el anillo lleno el mensaje
+ *   se descarta y se informa la cantidad perdida en la siguiente línea.
+ * - Niveles: 0 = Error, 1 = Warning, 2 = Info, 3 = Debug. Los niveles
+ *   mayores a LOG_LEVEL_MAX se eliminan al compilar (ni siquiera se evalúan
+ *   los argumentos); el resto se filtra en tiempo de ejecución con
+ *   modemConfig.enableDebug y el silencio de LOG_QUIET_BOOT.
+ * - Límite por etiqueta: cada formato (o texto, sin contar los dígitos) puede
+ *   emitir LOG_RATE_BURST mensajes cada LOG_RATE_WINDOW ms; el excedente se
+ *   cuenta y se informa junto al siguiente mensaje de la misma etiqueta. Los
+ *   errores nunca se limitan.
+ *
+ * Formato binario (logSetFormat(LOG_FORMAT_BINARY)): cada formato se envía
+ * una sola vez como definición y los mensajes llevan solo su número y los
+ * argumentos, lo que reduce los bytes por línea y el costo de formatear:
+ *
+ *   | 0xA5 | len (1) | tipo (1) | contenido | crc16 (2, LE) |
+ *
+ * - tipo: bits 0-1 = nivel, bit 2 = argumentos truncados, bits 4-7 = registro
+ *   (LOG_RECORD_MESSAGE, LOG_RECORD_FORMAT, LOG_RECORD_DROPPED).
+ * - mensaje: id (1) | marca (varint) | omitidos (varint) | argumentos.
+ * - definición: id (1) | texto del formato.
+ * - descartados: marca (varint) | cantidad (varint).
+ * - argumentos en el orden del formato: enteros en varint (con signo en
+ *   zigzag), cadenas con su longitud en varint, reales como double de 8
+ *   bytes (LE).
+ * - crc16: frameCrc16() sobre len, tipo y contenido.
+ *
+ * logDecode() reconstruye las líneas de texto a partir de los bytes recibidos;
+ * no usa Serial ni el anillo, así que sirve también en el equipo receptor.
+ *
+ * @note Un formato con especificadores no soportados ('*', %n, long double)
+ * se envía ya formateado, como texto.
+ *
+ * @example
+ * @code
+ * logSetFormat(LOG_FORMAT_BINARY);
+ * logTaskStart();                    // opcional: vaciar desde una tarea
+ * logMessagef(2, "CSQ %d", signalsim0);
+ * @endcode
+ */
+
+#ifndef GSMLTE_LOG_H
+#define GSMLTE_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Arduino.h"
+#include "gsmlte_mem.h"
+
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX 3           ///< Nivel máximo compilado (definir en las opciones de compilación)
+#endif
+
+#define LOG_RING_SLOTS 32         ///< Ranuras del anillo (potencia de 2)
+#define LOG_MESSAGE_MAX 160       ///< Bytes por mensaje (texto o registro binario)
+#define LOG_QUIET_BOOT 30000      ///< Solo errores y advertencias durante el arranque (ms)
+#define LOG_RATE_SLOTS 16         ///< Etiquetas con límite simultáneo
+#define LOG_RATE_BURST 10         ///< Mensajes por etiqueta y ventana
+#define LOG_RATE_WINDOW 1000      ///< Ventana del límite (ms)
+#define LOG_DRAIN_BUDGET 256      ///< Bytes escritos por llamada desde modemPoll()
+#define LOG_DICT_SLOTS 256        ///< Formatos distintos en modo binario
+#define LOG_TASK_STACK 3072
+#define LOG_TASK_PRIORITY 1       ///< Igual que el loop de Arduino: comparten el core por turnos
+#define LOG_TASK_CORE 1
+#define LOG_TASK_PERIOD 10        ///< Espera entre vaciados de la tarea (ms)
+
+#define LOG_SYNC 0xA5
+#define LOG_RECORD_MESSAGE 0
+#define LOG_RECORD_FORMAT 1
+#define LOG_RECORD_DROPPED 2
+#define LOG_FLAG_TRUNCATED 0x04
+
+/**
+ * @brief Registra un mensaje
+ * @param level Nivel de log (0=Error, 1=Warning, 2=Info, 3=Debug)
+ * @param message Mensaje (const char*, o String salvo con GSMLTE_STATIC_ALLOC)
+ */
+#define logMessage(level, message) \
+  do { if ((level) <= LOG_LEVEL_MAX && logEnabled(level)) logWrite((level), (message)); } while (0)
+
+/**
+ * @brief Registra un mensaje con formato printf sin construir objetos String
+ * @details El formato y los argumentos solo se evalúan si el nivel está habilitado
+ */
+#define logMessagef(level, ...) \
+  do { if ((level) <= LOG_LEVEL_MAX && logEnabled(level)) logWritef((level), __VA_ARGS__); } while (0)
+
+/**
+ * @enum LogFormat
+ * @brief Formato de salida por Serial
+ */
+enum LogFormat {
+  LOG_FORMAT_TEXT = 0,      ///< "[123ms] INFO: mensaje"
+  LOG_FORMAT_BINARY = 1     ///< Registros binarios para logDecode()
+};
+
+/**
+ * @struct LogStats
+ * @brief Contadores del registro
+ */
+struct LogStats {
+  uint32_t written;         ///< Mensajes que entraron al anillo
+  uint32_t dropped;         ///< Descartados por anillo lleno
+  uint32_t suppressed;      ///< Omitidos por el límite de frecuencia
+  uint8_t pending;          ///< Ranuras ocupadas ahora
+  uint8_t highWater;        ///< Máximo de ranuras ocupadas
+};
+
+/**
+ * @brief Indica si un nivel está habilitado en tiempo de ejecución
+ */
+bool logEnabled(int level);
+
+/**
+ * @brief Escribe un mensaje en el anillo (usar logMessage())
+ */
+void logWrite(int level, const char* message);
+#if !GSMLTE_STATIC_ALLOC
+void logWrite(int level, const String& message);
+#endif
+
+/**
+ * @brief Formatea un mensaje en el anillo (usar logMessagef())
+ */
+void logWritef(int level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Selecciona el formato de salida
+ * @details Llamar al inicio, antes de registrar desde otras tareas; al pasar
+ * a binario se vuelven a enviar las definiciones de formato
+ */
+void logSetFormat(LogFormat format);
+
+/**
+ * @brief Escribe en Serial lo pendiente sin esperar
+ * @param budget Máximo de bytes a escribir
+ * @return Bytes escritos
+ * @note Un solo consumidor: no llamar si la tarea de logTaskStart() corre
+ */
+size_t logDrain(size_t budget);
+
+/**
+ * @brief Escribe todo lo pendiente esperando a Serial (antes de reiniciar)
+ */
+void logFlush();
+
+/**
+ * @brief Vacía el anillo si el motor AT está libre o el anillo pasa de la mitad
+ * @note Se llama desde modemPoll(); no hace nada si corre la tarea de registro
+ */
+void logPoll();
+
+/**
+ * @brief Milisegundos hasta que logPoll() pueda escribir
+ * @return 0 si hay mensajes y lugar en Serial, ULONG_MAX si no hay nada que
+ * escribir, corre la tarea de registro o se espera al motor AT
+ */
+unsigned long logPollTimeout();
+
+/**
+ * @brief Crea una tarea de baja prioridad que vacía el anillo
+ * @return true si la tarea corre
+ */
+bool logTaskStart(int core = LOG_TASK_CORE);
+
+/**
+ * @brief Obtiene los contadores del registro
+ */
+LogStats logStats();
+
+/**
+ * @struct LogDecoder
+ * @brief Formatos recibidos por el decodificador (solo en el equipo receptor)
+ */
+struct LogDecoder {
+  char formats[LOG_DICT_SLOTS][LOG_MESSAGE_MAX];
+};
+
+/**
+ * @brief Olvida los formatos recibidos
+ */
+void logDecoderInit(LogDecoder& decoder);
+
+/**
+ * @brief Decodifica el siguiente registro binario de un flujo
+ * @param decoder Formatos recibidos; se actualiza con las definiciones
+ * @param data Bytes recibidos
+ * @param len Bytes disponibles
+ * @param out Línea reconstruida, sin CRLF ("" para una definición)
+ * @param outSize Tamaño de out
+ * @return Bytes consumidos, 0 si el registro está incompleto o -1 si es
+ * inválido (sincronismo o CRC); ante -1 descartar un byte y reintentar
+ */
+int logDecode(LogDecoder& decoder, const uint8_t* data, size_t len, char* out, size_t outSize);
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file gsmlte_lz.cpp
+ * @brief Implementación del compresor LZ4 de bloque
+ *
+ * @details Cada secuencia LZ4 es un token (4 bits de literales, 4 bits de
+ * coincidencia - 4), extensiones de 255, los literales, el desplazamiento
+ * (2 bytes, LE) y la extensión de la coincidencia. Las reglas del formato
+ * exigen que los últimos 5 bytes sean literales y que la última coincidencia
+ * empiece al menos 12 bytes antes del final.
+ */
+
+#include "gsmlte_lz.h"
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MF_LIMIT 12
+
+static uint16_t lzTable[1 << LZ_HASH_BITS];
+
+static inline uint32_t lzRead32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint32_t lzHash(uint32_t v) {
+  return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * Escribe la extensión de una longitud (bytes de 255 y el resto)
+ */
+static uint8_t* lzWriteLength(uint8_t* op, size_t len) {
+  while (len >= 255) {
+    *op++ = 255;
+    len -= 255;
+  }
+  *op++ = (uint8_t)len;
+  return op;
+}
+
+/**
+ * Escribe una secuencia: literales [anchor, ip) y coincidencia opcional
+ * @return Nueva posición de salida, o NULL si no cabe
+ */
+static uint8_t* lzWriteSequence(uint8_t* op, uint8_t* end, const uint8_t* anchor, size_t litLen,
+                                uint16_t offset, size_t matchLen) {
+  size_t need = 1 + litLen + litLen / 255 + 1 + (matchLen > 0 ? 2 + matchLen / 255 + 1 : 0);
+  if ((size_t)(end - op) < need) return NULL;
+
+  uint8_t* token = op++;
+  *token = (uint8_t)((litLen >= 15 ? 15 : litLen) << 4);
+  if (litLen >= 15) op = lzWriteLength(op, litLen - 15);
+  memcpy(op, anchor, litLen);
+  op += litLen;
+
+  if (matchLen > 0) {
+    *op++ = offset & 0xFF;
+    *op++ = offset >> 8;
+    size_t ml = matchLen - LZ_MIN_MATCH;
+    *token |= (uint8_t)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) op = lzWriteLength(op, ml - 15);
+  }
+  return op;
+}
+
+size_t lzCompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+  if (len > LZ_MAX_INPUT) return 0;
+
+  uint8_t* op = dst;
+  uint8_t* opEnd = dst + capacity;
+  size_t anchor = 0;
+
+  if (len > LZ_MF_LIMIT) {
+    memset(lzTable, 0, sizeof(lzTable));
+    const size_t mfLimit = len - LZ_MF_LIMIT;
+    const size_t matchLimit = len - LZ_LAST_LITERALS;
+    size_t ip = 0;
+
+    while (ip < mfLimit) {
+      uint32_t seq = lzRead32(src + ip);
+      uint32_t h = lzHash(seq);
+      size_t candidate = lzTable[h];
+      lzTable[h] = (uint16_t)(ip + 1);
+
+      if (candidate == 0 || lzRead32(src + candidate - 1) != seq) {
+        ip++;
+        continue;
+      }
+      candidate--;
+
+      size_t matchLen = LZ_MIN_MATCH;
+      while (ip + matchLen < matchLimit && src[candidate + matchLen] == src[ip + matchLen]) {
+        matchLen++;
+      }
+
+      op = lzWriteSequence(op, opEnd, src + anchor, ip - anchor, (uint16_t)(ip - candidate), matchLen);
+      if (op == NULL) return 0;
+
+      ip += matchLen;
+      anchor = ip;
+      if (ip - 2 < mfLimit) lzTable[lzHash(lzRead32(src + ip - 2))] = (uint16_t)(ip - 1);
+    }
+  }
+
+  op = lzWriteSequence(op, opEnd, src + anchor, len - anchor, 0, 0);
+  if (op == NULL) return 0;
+  return op - dst;
+}
+
+/**
+ * Lee la extensión de una longitud
+ * @return false si el bloque termina antes
+ */
+static bool lzReadLength(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+  uint8_t b;
+  do {
+    if (ip >= end) return false;
+    b = *ip++;
+    len += b;
+  } while (b == 255);
+  return true;
+}
+
+int lzDecompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+  const uint8_t* ip = src;
+  const uint8_t* end = src + len;
+  size_t op = 0;
+
+  while (ip < end) {
+    uint8_t token = *ip++;
+
+    size_t litLen = token >> 4;
+    if (litLen == 15 && !lzReadLength(ip, end, litLen)) return -1;
+    if ((size_t)(end - ip) < litLen || capacity - op < litLen) return -1;
+    memcpy(dst + op, ip, litLen);
+    ip += litLen;
+    op += litLen;
+
+    if (ip >= end) break;
+
+    if (end - ip < 2) return -1;
+    size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) return -1;
+
+    size_t matchLen = token & 0x0F;
+    if (matchLen == 15 && !lzReadLength(ip, end, matchLen)) return -1;
+    matchLen += LZ_MIN_MATCH;
+    if (capacity - op < matchLen) return -1;
+
+    for (size_t i = 0; i < matchLen; ++i, ++op) {
+      dst[op] = dst[op - offset];
+    }
+  }
+
+  return (int)op;
+}
+
+size_t lzPackBlock(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+  if (capacity <= LZ_BLOCK_HEADER || len <= LZ_BLOCK_HEADER) return 0;
+
+  size_t limit = capacity - LZ_BLOCK_HEADER;
+  if (limit > len - LZ_BLOCK_HEADER - 1) limit = len - LZ_BLOCK_HEADER - 1;
+
+  size_t packed = lzCompress(src, len, dst + LZ_BLOCK_HEADER, limit);
+  if (packed == 0) return 0;
+
+  dst[0] = LZ_BLOCK_MARK;
+  dst[1] = packed & 0xFF;
+  dst[2] = packed >> 8;
+  dst[3] = len & 0xFF;
+  dst[4] = len >> 8;
+  return packed + LZ_BLOCK_HEADER;
+}
+
+int lzUnpackBlock(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity, size_t& consumed) {
+  if (len < LZ_BLOCK_HEADER) return 0;
+  if (src[0] != LZ_BLOCK_MARK) return -1;
+
+  size_t packed = (size_t)src[1] | ((size_t)src[2] << 8);
+  size_t original = (size_t)src[3] | ((size_t)src[4] << 8);
+  if (original > capacity) return -1;
+  if (len < LZ_BLOCK_HEADER + packed) return 0;
+
+  int n = lzDecompress(src + LZ_BLOCK_HEADER, packed, dst, original);
+  if (n < 0 || (size_t)n != original) return -1;
+
+  consumed = LZ_BLOCK_HEADER + packed;
+  return n;
+}
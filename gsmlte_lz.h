@@ -0,0 +1,76 @@
+/**
+ * @file gsmlte_lz.h
+ * @brief Compresión LZ4 (formato de bloque) con memoria de trabajo fija
+ * @version 3.0
+ *
+ * @details Compresor voraz de una sola pasada con una tabla hash de
+ * 2^LZ_HASH_BITS posiciones (uint16_t) como única memoria de trabajo; la
+ * ventana es el propio buffer de entrada, por lo que no se copia. La salida
+ * es un bloque LZ4 estándar que el servidor puede descomprimir con
+ * LZ4_decompress_safe() o con lzDecompress().
+ *
+ * En la conexión TCP cada envío comprimido va precedido de un encabezado:
+ *
+ *   | LZ_BLOCK_MARK (0xFF) | len comprimido (2, LE) | len original (2, LE) | bloque LZ4 |
+ *
+ * El byte 0xFF no aparece al inicio de una línea de texto ni de un registro
+ * de gsmlte_frame.h, así que el servidor distingue los envíos comprimidos
+ * de los que no lo están mirando el primer byte.
+ *
+ * @example
+ * @code
+ * uint8_t packed[TCP_CASEND_MAX];
+ * size_t n = lzPackBlock(data, len, packed, sizeof(packed));  // 0 = no conviene
+ * @endcode
+ */
+
+#ifndef GSMLTE_LZ_H
+#define GSMLTE_LZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LZ_HASH_BITS 8
+#define LZ_BLOCK_MARK 0xFF
+#define LZ_BLOCK_HEADER 5
+#define LZ_MAX_INPUT 65535
+
+/**
+ * @brief Comprime un buffer en formato de bloque LZ4
+ * @param src Datos originales (hasta LZ_MAX_INPUT bytes)
+ * @param len Longitud de los datos
+ * @param dst Destino
+ * @param capacity Capacidad del destino
+ * @return Bytes escritos, o 0 si el resultado no cabe en el destino
+ */
+size_t lzCompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+
+/**
+ * @brief Descomprime un bloque LZ4 validando cada referencia
+ * @param src Bloque comprimido
+ * @param len Longitud del bloque
+ * @param dst Destino
+ * @param capacity Capacidad del destino
+ * @return Bytes descomprimidos, o -1 si el bloque es inválido o no cabe
+ */
+int lzDecompress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+
+/**
+ * @brief Comprime y agrega el encabezado de envío comprimido
+ * @return Bytes escritos (encabezado incluido), o 0 si no resulta más corto
+ * que el original
+ */
+size_t lzPackBlock(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+
+/**
+ * @brief Descomprime un envío con encabezado LZ_BLOCK_MARK
+ * @param src Datos recibidos (desde LZ_BLOCK_MARK)
+ * @param len Bytes disponibles
+ * @param dst Destino de los datos originales
+ * @param capacity Capacidad del destino
+ * @param consumed Bytes del envío comprimido consumidos de src
+ * @return Bytes originales, 0 si el envío está incompleto o -1 si es inválido
+ */
+int lzUnpackBlock(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity, size_t& consumed);
+
+#endif
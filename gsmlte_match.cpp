@@ -0,0 +1,46 @@
+/**
+ * @file gsmlte_match.cpp
+ * @brief Implementación de la búsqueda incremental de tokens
+ * 
+ * @details La tabla de fallos se calcula al iniciar cada búsqueda; al
+ * coincidir, el estado vuelve al borde del token para admitir solapamientos.
+ */
+
+#include "gsmlte_match.h"
+#include <string.h>
+
+bool tokenKmpBegin(TokenKmp& k, const char* token) {
+  size_t len = strlen(token);
+  k.token = token;
+  k.state = 0;
+
+  if (len >= MATCH_TOKEN_MAX) {
+    k.len = 0;
+    return false;
+  }
+  k.len = (uint8_t)len;
+
+  if (len == 0) return true;
+
+  k.fail[0] = 0;
+  uint8_t j = 0;
+  for (uint8_t i = 1; i < k.len; ++i) {
+    while (j > 0 && token[i] != token[j]) j = k.fail[j - 1];
+    if (token[i] == token[j]) j++;
+    k.fail[i] = j;
+  }
+  return true;
+}
+
+bool tokenKmpFeed(TokenKmp& k, char c) {
+  if (k.len == 0) return false;
+
+  while (k.state > 0 && c != k.token[k.state]) k.state = k.fail[k.state - 1];
+  if (c == k.token[k.state]) k.state++;
+
+  if (k.state == k.len) {
+    k.state = k.fail[k.len - 1];
+    return true;
+  }
+  return false;
+}
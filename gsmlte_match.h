@@ -0,0 +1,55 @@
+/**
+ * @file gsmlte_match.h
+ * @brief Búsqueda incremental de tokens en el flujo del módem
+ * @version 3.0
+ * 
+ * @details TokenKmp reconoce un token byte a byte sin acumular la respuesta,
+ * con tabla de fallos KMP. Es el único buscador del flujo AT: el analizador
+ * de respuestas (atScanFeed() en gsmlte.cpp) lo usa para la respuesta
+ * esperada de cada comando, también en los envíos bloqueantes, y los códigos
+ * finales se reconocen por línea.
+ * 
+ * @example
+ * @code
+ * TokenKmp k;
+ * tokenKmpBegin(k, "+CASTATE: 0,1");
+ * if (tokenKmpFeed(k, c)) { ... }     // el token termina en este byte
+ * @endcode
+ */
+
+#ifndef GSMLTE_MATCH_H
+#define GSMLTE_MATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MATCH_TOKEN_MAX 32
+
+/**
+ * @struct TokenKmp
+ * @brief Búsqueda incremental de un solo token
+ */
+struct TokenKmp {
+  const char* token;
+  uint8_t len;
+  uint8_t state;
+  uint8_t fail[MATCH_TOKEN_MAX];
+};
+
+/**
+ * @brief Inicia la búsqueda de un token
+ * @param k Estado de la búsqueda
+ * @param token Token a buscar (debe permanecer válido; vacío nunca coincide)
+ * @return false si el token excede MATCH_TOKEN_MAX-1 caracteres
+ */
+bool tokenKmpBegin(TokenKmp& k, const char* token);
+
+/**
+ * @brief Avanza la búsqueda con un byte
+ * @param k Estado de la búsqueda
+ * @param c Byte recibido
+ * @return true si el token termina en este byte
+ */
+bool tokenKmpFeed(TokenKmp& k, char c);
+
+#endif
@@ -0,0 +1,183 @@
+/**
+ * @file gsmlte_mem.cpp
+ * @brief Implementación del presupuesto de memoria
+ *
+ * @details memNote() solo compara y guarda: se llama desde los puntos donde
+ * crece cada buffer, siempre en el contexto de modemPoll(). El registro puede
+ * escribirse desde otras tareas, así que su ocupación se toma de logStats()
+ * al consultar. heap_caps_get_info() recorre el heap con el candado tomado,
+ * por eso memPoll() solo lo lee cada MEM_SAMPLE_INTERVAL.
+ */
+
+#include "gsmlte_mem.h"
+#include "gsmlte.h"
+#include <esp_heap_caps.h>
+#include <stdarg.h>
+#include <limits.h>
+
+static MemPoolStats memPools[MEM_POOL_COUNT] = {
+  { "at_queue", 0, 0, 0 },
+  { "at_response", 0, 0, 0 },
+  { "tcp_tx", 0, 0, 0 },
+  { "tcp_rx", 0, 0, 0 },
+  { "transport", 0, 0, 0 },
+  { "log", 0, 0, 0 },
+};
+
+static bool memBaseline = false;
+static uint32_t memBaselineFree = 0;
+static uint32_t memBaselineBlocks = 0;
+static uint32_t memMaxBlocks = 0;
+static uint32_t memMinLargest = UINT32_MAX;
+static unsigned long memLastSample = 0;
+static bool memSampled = false;
+
+void memNote(MemPoolId pool, size_t used, size_t capacity) {
+  MemPoolStats& p = memPools[pool];
+  p.capacity = capacity;
+  p.used = used;
+  if (used > p.peak) p.peak = used;
+}
+
+/**
+ * Lee el heap de 8 bits (el que usan malloc y new)
+ */
+static MemHeapStats memReadHeap() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+
+  MemHeapStats h;
+  h.total = heap_caps_get_total_size(MALLOC_CAP_8BIT);
+  h.free = info.total_free_bytes;
+  h.minFree = info.minimum_free_bytes;
+  h.largestBlock = info.largest_free_block;
+  if (info.largest_free_block < memMinLargest) memMinLargest = info.largest_free_block;
+  h.minLargestBlock = memMinLargest;
+  h.blocks = info.allocated_blocks;
+  h.baseline = memBaseline;
+  h.baselineFree = memBaselineFree;
+  h.blocksSinceBaseline = memBaseline ? (int32_t)(info.allocated_blocks - memBaselineBlocks) : 0;
+  return h;
+}
+
+void memMarkBaseline(bool replace) {
+  if (memBaseline && !replace) return;
+
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  memBaseline = true;
+  memBaselineFree = info.total_free_bytes;
+  memBaselineBlocks = info.allocated_blocks;
+  memMaxBlocks = info.allocated_blocks;
+
+  logMessagef(2, "🧮 Línea base de memoria: %lu bytes libres, %lu bloques en uso",
+              (unsigned long)memBaselineFree, (unsigned long)memBaselineBlocks);
+}
+
+void memPoll() {
+  if (memSampled && millis() - memLastSample < MEM_SAMPLE_INTERVAL) return;
+  memSampled = true;
+  memLastSample = millis();
+
+  MemHeapStats h = memReadHeap();
+  if (!h.baseline || h.blocks <= memMaxBlocks) return;
+  memMaxBlocks = h.blocks;
+
+#if GSMLTE_STATIC_ALLOC
+  logMessagef(1, "⚠️  Memoria dinámica tras el arranque: %ld bloques nuevos, %lu bytes libres",
+              (long)h.blocksSinceBaseline, (unsigned long)h.free);
+#endif
+}
+
+MemHeapStats memHeapStats() {
+  return memReadHeap();
+}
+
+bool memPoolGet(MemPoolId pool, MemPoolStats& out) {
+  if ((unsigned)pool >= MEM_POOL_COUNT) return false;
+
+  if (pool == MEM_POOL_LOG) {
+    LogStats log = logStats();
+    memPools[pool].capacity = (uint32_t)LOG_RING_SLOTS * LOG_MESSAGE_MAX;
+    memPools[pool].used = (uint32_t)log.pending * LOG_MESSAGE_MAX;
+    memPools[pool].peak = (uint32_t)log.highWater * LOG_MESSAGE_MAX;
+  }
+  out = memPools[pool];
+  return true;
+}
+
+void memResetPeaks() {
+  for (uint8_t i = 0; i < MEM_POOL_COUNT; ++i) memPools[i].peak = memPools[i].used;
+  memMinLargest = UINT32_MAX;
+}
+
+void memPrint(Print& out) {
+  MemHeapStats h = memHeapStats();
+
+  out.println("=== MEMORIA ===");
+  out.printf("Heap: %lu libres de %lu, mínimo %lu, bloque mayor %lu (mínimo %lu), %lu bloques en uso\r\n",
+             (unsigned long)h.free, (unsigned long)h.total, (unsigned long)h.minFree,
+             (unsigned long)h.largestBlock, (unsigned long)h.minLargestBlock,
+             (unsigned long)h.blocks);
+  if (h.baseline) {
+    out.printf("Desde la línea base: %ld bytes libres, %ld bloques en uso\r\n",
+               (long)h.free - (long)h.baselineFree, (long)h.blocksSinceBaseline);
+  }
+  out.printf("Modo estático: %s\r\n", GSMLTE_STATIC_ALLOC ? "sí" : "no");
+
+  for (uint8_t i = 0; i < MEM_POOL_COUNT; ++i) {
+    MemPoolStats p;
+    memPoolGet((MemPoolId)i, p);
+    if (p.capacity == 0) continue;
+    out.printf("%-12s %6lu/%-6lu pico %6lu (%u%%)\r\n", p.name, (unsigned long)p.used,
+               (unsigned long)p.capacity, (unsigned long)p.peak,
+               (unsigned)((uint64_t)p.peak * 100 / p.capacity));
+  }
+}
+
+/**
+ * Agrega texto con formato al buffer
+ * @return false si no cupo
+ */
+static bool memAppend(char* buffer, size_t size, size_t& pos, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static bool memAppend(char* buffer, size_t size, size_t& pos, const char* format, ...) {
+  if (pos >= size) return false;
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer + pos, size - pos, format, args);
+  va_end(args);
+
+  if (len < 0 || (size_t)len >= size - pos) return false;
+  pos += len;
+  return true;
+}
+
+size_t memFormat(char* buffer, size_t size) {
+  size_t pos = 0;
+  MemHeapStats h = memHeapStats();
+
+  if (!memAppend(buffer, size, pos, "{\"heap\":[%lu,%lu,%lu,%lu,%lu],\"grow\":%ld,\"pool\":{",
+                 (unsigned long)h.free, (unsigned long)h.minFree, (unsigned long)h.largestBlock,
+                 (unsigned long)h.minLargestBlock, (unsigned long)h.blocks,
+                 (long)h.blocksSinceBaseline)) {
+    return 0;
+  }
+
+  bool first = true;
+  for (uint8_t i = 0; i < MEM_POOL_COUNT; ++i) {
+    MemPoolStats p;
+    memPoolGet((MemPoolId)i, p);
+    if (p.capacity == 0) continue;
+    if (!memAppend(buffer, size, pos, "%s\"%s\":[%lu,%lu,%lu]", first ? "" : ",", p.name,
+                   (unsigned long)p.used, (unsigned long)p.peak, (unsigned long)p.capacity)) {
+      return 0;
+    }
+    first = false;
+  }
+
+  if (!memAppend(buffer, size, pos, "}}")) return 0;
+  return pos;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file gsmlte_mem.h
+ * @brief Presupuesto de memoria: estado del heap y ocupación de los buffers fijos
+ * @version 3.0
+ *
+ * @details Todos los buffers de la biblioteca tienen tamaño fijo al compilar;
+ * cada módulo informa aquí cuánto ocupa de los suyos (cola AT, respuesta AT,
+ * colas de envío y anillos de recepción de los sockets, cola de transporte y
+ * anillo del registro) y se guarda el máximo. El heap se lee con
+ * heap_caps_get_info(): libre, mínimo histórico, bloque libre más grande
+ * (fragmentación) y bloques en uso. Al llegar por primera vez a
+ * MODEM_STATE_READY se toma una línea base, y el crecimiento de bloques en
+ * uso desde entonces indica memoria que no se devuelve.
+ *
+ * Con -DGSMLTE_STATIC_ALLOC=1 la biblioteca no reserva memoria dinámica
+ * después de setupModem(): desaparecen las sobrecargas con String (usar las
+ * de const char* o datos y longitud), iccidsim0 pasa a ser un arreglo y las
+ * colas y tareas FreeRTOS usan almacenamiento estático. LittleFS
+ * (gsmlte_store.h) y WiFi (gsmlte_transport.h) reservan internamente, por lo
+ * que no forman parte de la garantía. En este modo memPoll() avisa si los
+ * bloques en uso superan el máximo visto desde la línea base.
+ *
+ * @example
+ * @code
+ * memPrint(Serial);                           // volcado legible
+ *
+ * char json[256];
+ * size_t len = memFormat(json, sizeof(json));
+ * if (len > 0) tcpSendPersistentAsync(json, len, 5000, NULL, NULL);  // telemetría
+ * @endcode
+ */
+
+#ifndef GSMLTE_MEM_H
+#define GSMLTE_MEM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Arduino.h"
+
+#ifndef GSMLTE_STATIC_ALLOC
+#define GSMLTE_STATIC_ALLOC 0     ///< 1 = sin String ni memoria dinámica tras setupModem()
+#endif
+
+#define MEM_SAMPLE_INTERVAL 10000 ///< Lectura del heap desde memPoll() (ms)
+
+/**
+ * @enum MemPoolId
+ * @brief Buffers fijos de la biblioteca
+ */
+enum MemPoolId {
+  MEM_POOL_AT_QUEUE = 0,      ///< Comandos AT en espera
+  MEM_POOL_AT_RESPONSE = 1,   ///< Respuesta de un comando (AT_RESPONSE_MAX)
+  MEM_POOL_TCP_TX = 2,        ///< Colas de envío de todos los sockets
+  MEM_POOL_TCP_RX = 3,        ///< Anillos de recepción de todos los sockets
+  MEM_POOL_TRANSPORT = 4,     ///< Buffer de la cola de transporte
+  MEM_POOL_LOG = 5,           ///< Anillo del registro, en mensajes de LOG_MESSAGE_MAX
+  MEM_POOL_COUNT = 6
+};
+
+/**
+ * @struct MemPoolStats
+ * @brief Ocupación de un buffer fijo (bytes)
+ */
+struct MemPoolStats {
+  const char* name;
+  uint32_t capacity;        ///< Reservado al compilar (0 = el módulo no se usó)
+  uint32_t used;            ///< Ocupado ahora
+  uint32_t peak;            ///< Máximo desde el arranque
+};
+
+/**
+ * @struct MemHeapStats
+ * @brief Estado del heap (bytes)
+ */
+struct MemHeapStats {
+  uint32_t total;
+  uint32_t free;
+  uint32_t minFree;           ///< Mínimo libre desde el arranque del ESP32
+  uint32_t largestBlock;      ///< Bloque libre más grande ahora
+  uint32_t minLargestBlock;   ///< Menor bloque libre más grande visto por memPoll()
+  uint32_t blocks;            ///< Bloques en uso
+  bool baseline;              ///< true si ya se tomó la línea base
+  uint32_t baselineFree;      ///< Libre en la línea base
+  int32_t blocksSinceBaseline; ///< Bloques en uso ganados desde la línea base
+};
+
+/**
+ * @brief Informa la ocupación actual de un buffer (lo llama cada módulo)
+ * @param pool Buffer
+ * @param used Bytes ocupados
+ * @param capacity Bytes reservados
+ */
+void memNote(MemPoolId pool, size_t used, size_t capacity);
+
+/**
+ * @brief Toma la línea base del heap
+ * @param replace false para conservar una línea base anterior
+ * @note La biblioteca la toma sola al llegar a MODEM_STATE_READY
+ */
+void memMarkBaseline(bool replace = true);
+
+/**
+ * @brief Lee el heap cada MEM_SAMPLE_INTERVAL
+ * @note Se llama desde modemPoll(); no adelanta el plazo de modemPollTimeout()
+ */
+void memPoll();
+
+/**
+ * @brief Lee el estado del heap
+ */
+MemHeapStats memHeapStats();
+
+/**
+ * @brief Obtiene la ocupación de un buffer
+ * @return false si el buffer no existe
+ */
+bool memPoolGet(MemPoolId pool, MemPoolStats& out);
+
+/**
+ * @brief Borra los máximos de los buffers
+ * @note El del registro sigue a LogStats::highWater
+ */
+void memResetPeaks();
+
+/**
+ * @brief Imprime el heap y los buffers en formato legible
+ * @param out Destino (p. ej. Serial)
+ */
+void memPrint(Print& out);
+
+/**
+ * @brief Serializa el heap y los buffers en JSON compacto para telemetría
+ * @param buffer Buffer de salida
+ * @param size Capacidad del buffer
+ * @return Longitud escrita, o 0 si no cabe en el buffer
+ */
+size_t memFormat(char* buffer, size_t size);
+
+#endif
@@ -0,0 +1,402 @@
+/**
+ * @file gsmlte_power.cpp
+ * @brief Implementación del ahorro de energía PSM / eDRX
+ *
+ * @details Los temporizadores se codifican como en 3GPP TS 24.008: T3412
+ * extendido (GPRS Timer 3) y T3324 (GPRS Timer 2) usan 3 bits de unidad y
+ * 5 bits de valor; el ciclo eDRX es un índice de 4 bits (TS 24.008, tabla
+ * 10.5.5.32). Se elige la unidad más fina en la que el valor cabe, redondeando
+ * hacia arriba para no pedir menos de lo solicitado.
+ *
+ * El despertar es una secuencia no bloqueante: sonda "AT"; si no responde,
+ * pulso PWRKEY y sondas cada POWER_WAKE_POLL hasta "OK" ("EXIT PSM" adelanta
+ * la sonda siguiente).
+ */
+
+#include "gsmlte_power.h"
+#include "gsmlte.h"
+#include "gsmlte_urc.h"
+#include <string.h>
+#include <limits.h>
+
+/**
+ * Unidad de un temporizador GPRS: código de 3 bits y segundos por paso
+ */
+struct PowerTimerUnit {
+  uint8_t code;
+  uint32_t seconds;
+};
+
+static const PowerTimerUnit powerT3412Units[] = {
+  { 3, 2 }, { 4, 30 }, { 5, 60 }, { 0, 600 }, { 1, 3600 }, { 2, 36000 }, { 6, 1152000 }
+};
+
+static const PowerTimerUnit powerT3324Units[] = {
+  { 0, 2 }, { 1, 60 }, { 2, 360 }
+};
+
+/** Ciclos eDRX de CAT-M (WB-S1) en ms, indexados por su código */
+static const uint32_t powerEdrxCycles[16] = {
+  5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+  143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760
+};
+
+enum PowerWakePhase {
+  POWER_PHASE_PROBE,
+  POWER_PHASE_PROBING,
+  POWER_PHASE_PULSE,
+  POWER_PHASE_RELEASE,
+  POWER_PHASE_WAIT
+};
+
+#define POWER_APPLY_STEPS 3
+
+static bool powerConfigured = false;
+static ModemPowerMode powerMode = MODEM_POWER_MODE_ON;
+static char powerT3412[9];
+static char powerT3324[9];
+static char powerEdrx[5];
+static uint8_t powerApplyStep = 0;
+
+static ModemPowerState powerState = MODEM_POWER_ACTIVE;
+static unsigned long powerStateSince = 0;
+static ModemPowerTimes powerStats;
+
+static PowerWakePhase powerWakePhase = POWER_PHASE_PROBE;
+static bool powerPulsed = false;
+static int8_t powerProbeResult = 0;
+static unsigned long powerWakeStart = 0;
+static unsigned long powerTimer = 0;
+
+/**
+ * Escribe los bits menos significativos de un valor como texto "0"/"1"
+ */
+static void powerFormatBits(uint8_t value, uint8_t bits, char* out) {
+  for (uint8_t i = 0; i < bits; ++i) {
+    out[i] = (value & (1u << (bits - 1 - i))) ? '1' : '0';
+  }
+  out[bits] = '\0';
+}
+
+/**
+ * Codifica un temporizador GPRS con la unidad más fina en que cabe
+ * @param seconds Duración solicitada
+ * @param granted Duración que representa el valor codificado
+ * @return Byte del temporizador (unidad en bits 5-7, valor en bits 0-4)
+ */
+static uint8_t powerEncodeTimer(uint32_t seconds, const PowerTimerUnit* units, size_t count,
+                                uint32_t& granted) {
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t value = (seconds + units[i].seconds - 1) / units[i].seconds;
+    if (value <= 31) {
+      granted = value * units[i].seconds;
+      return (uint8_t)((units[i].code << 5) | value);
+    }
+  }
+
+  const PowerTimerUnit& last = units[count - 1];
+  granted = 31 * last.seconds;
+  return (uint8_t)((last.code << 5) | 31);
+}
+
+/**
+ * Índice del mayor ciclo eDRX que no supera el intervalo
+ */
+static uint8_t powerEncodeEdrx(unsigned long intervalMs) {
+  uint8_t code = 0;
+  for (uint8_t i = 0; i < 16; ++i) {
+    if (powerEdrxCycles[i] <= intervalMs) code = i;
+  }
+  return code;
+}
+
+/**
+ * Acumula el tramo en curso al estado actual
+ */
+static void powerAccount() {
+  unsigned long now = millis();
+  powerStats.ms[powerState] += now - powerStateSince;
+  powerStateSince = now;
+}
+
+static void powerSetState(ModemPowerState state) {
+  if (state == powerState) return;
+  powerAccount();
+  powerState = state;
+  logMessagef(3, "🔋 Estado de energía: %s", modemPowerStateName(state));
+}
+
+/**
+ * Busca un texto dentro de una línea no terminada en NUL
+ */
+static bool powerLineContains(const char* line, size_t len, const char* text) {
+  size_t n = strlen(text);
+  for (size_t i = 0; i + n <= len; ++i) {
+    if (memcmp(line + i, text, n) == 0) return true;
+  }
+  return false;
+}
+
+/**
+ * Termina el despertar: los envíos acumulados salen en esta ventana
+ */
+static void powerWakeFinished(bool success) {
+  if (success) {
+    powerStats.wakes++;
+    logMessagef(3, "🔋 Módem despierto en %lums", millis() - powerWakeStart);
+  } else {
+    powerStats.wakeFailures++;
+    logMessage(1, "⚠️  El módem no salió de PSM; se deja a la recuperación de la conexión");
+  }
+  powerSetState(MODEM_POWER_ACTIVE);
+  tcpBatchFlush();
+}
+
+/**
+ * Handler de +CPSMSTATUS: "ENTER PSM" / "EXIT PSM"
+ */
+static void powerUrcHandler(const char* line, size_t len, void* ctx) {
+  if (powerLineContains(line, len, "ENTER PSM")) {
+    if (powerState == MODEM_POWER_WAKING) return;
+    powerStats.psmEntries++;
+    powerSetState(MODEM_POWER_PSM);
+  } else if (powerLineContains(line, len, "EXIT PSM")) {
+    if (powerState == MODEM_POWER_WAKING) {
+      // La sonda siguiente confirma el UART (y su éxito normaliza el RTO local)
+      if (powerWakePhase == POWER_PHASE_PROBE) powerTimer = millis();
+    } else {
+      powerSetState(MODEM_POWER_ACTIVE);
+    }
+  }
+}
+
+static void powerProbeDone(int8_t result, const char* response, void* ctx) {
+  powerProbeResult = result;
+  if (powerWakePhase == POWER_PHASE_PROBING) powerWakePhase = POWER_PHASE_WAIT;
+}
+
+static void powerApplyDone(int8_t result, const char* response, void* ctx) {
+  if (result != 1) {
+    logMessagef(1, "⚠️  El módem rechazó la configuración de %s", (const char*)ctx);
+  }
+}
+
+/**
+ * Envía el siguiente comando de configuración de ahorro
+ */
+static void powerApplyPoll() {
+  if (powerApplyStep >= POWER_APPLY_STEPS) return;
+
+  char command[48];
+  const char* label;
+
+  switch (powerMode) {
+    case MODEM_POWER_MODE_PSM:
+      if (powerApplyStep == 0) {
+        snprintf(command, sizeof(command), "+CPSMSTATUS=1");
+        label = "URC PSM";
+      } else if (powerApplyStep == 1) {
+        snprintf(command, sizeof(command), "+CEDRXS=0");
+        label = "eDRX";
+      } else {
+        snprintf(command, sizeof(command), "+CPSMS=1,,,\"%s\",\"%s\"", powerT3412, powerT3324);
+        label = "PSM";
+      }
+      break;
+
+    case MODEM_POWER_MODE_EDRX:
+      if (powerApplyStep == 0) {
+        snprintf(command, sizeof(command), "+CPSMS=0");
+        label = "PSM";
+      } else if (powerApplyStep == 1) {
+        snprintf(command, sizeof(command), "+CEDRXS=1,%d,\"%s\"", POWER_EDRX_ACT, powerEdrx);
+        label = "eDRX";
+      } else {
+        powerApplyStep++;
+        return;
+      }
+      break;
+
+    default:
+      if (powerApplyStep == 0) {
+        snprintf(command, sizeof(command), "+CPSMS=0");
+        label = "PSM";
+      } else if (powerApplyStep == 1) {
+        snprintf(command, sizeof(command), "+CEDRXS=0");
+        label = "eDRX";
+      } else {
+        powerApplyStep++;
+        return;
+      }
+      break;
+  }
+
+  if (modemSubmitAT(command, "OK", 5000, powerApplyDone, (void*)label)) {
+    powerApplyStep++;
+  }
+}
+
+/**
+ * Avanza la secuencia de despertar
+ */
+static void powerWakePoll() {
+  unsigned long now = millis();
+
+  switch (powerWakePhase) {
+    case POWER_PHASE_PROBE:
+      if ((long)(now - powerTimer) < 0) break;
+      powerProbeResult = 0;
+      powerWakePhase = POWER_PHASE_PROBING;
+      if (!modemSubmitAT("", "OK", POWER_PROBE_TIMEOUT, powerProbeDone, NULL)) {
+        powerWakePhase = POWER_PHASE_PROBE;
+      }
+      break;
+
+    case POWER_PHASE_PROBING:
+      break;
+
+    case POWER_PHASE_WAIT:
+      if (powerProbeResult == 1) {
+        powerWakeFinished(true);
+      } else if (!powerPulsed) {
+        powerWakePhase = POWER_PHASE_PULSE;
+      } else if (now - powerWakeStart >= POWER_WAKE_TIMEOUT) {
+        powerWakeFinished(false);
+      } else {
+        powerTimer = now + POWER_WAKE_POLL;
+        powerWakePhase = POWER_PHASE_PROBE;
+      }
+      break;
+
+    case POWER_PHASE_PULSE:
+      logMessage(3, "🔌 Pulso PWRKEY para salir de PSM");
+      digitalWrite(PWRKEY_PIN, HIGH);
+      powerTimer = now + POWER_WAKE_PULSE;
+      powerPulsed = true;
+      powerWakePhase = POWER_PHASE_RELEASE;
+      break;
+
+    case POWER_PHASE_RELEASE:
+      if ((long)(now - powerTimer) < 0) break;
+      digitalWrite(PWRKEY_PIN, LOW);
+      powerTimer = now + POWER_WAKE_POLL;
+      powerWakePhase = POWER_PHASE_PROBE;
+      break;
+  }
+}
+
+void modemPowerConfigure(ModemPowerMode mode, unsigned long intervalMs, unsigned long activeTimeMs) {
+  static bool registered = false;
+  if (!registered) {
+    registered = true;
+    urcRegisterHandler("+CPSMSTATUS", powerUrcHandler, NULL);
+    powerStateSince = millis();
+  }
+
+  powerMode = mode;
+  powerConfigured = true;
+  powerApplyStep = 0;
+
+  uint32_t tau;
+  uint32_t active;
+  uint32_t tauSeconds = (intervalMs + 999) / 1000;
+  if (tauSeconds == 0) tauSeconds = 1;
+  powerFormatBits(powerEncodeTimer(tauSeconds, powerT3412Units,
+                                   sizeof(powerT3412Units) / sizeof(powerT3412Units[0]), tau),
+                  8, powerT3412);
+  powerFormatBits(powerEncodeTimer((activeTimeMs + 999) / 1000, powerT3324Units,
+                                   sizeof(powerT3324Units) / sizeof(powerT3324Units[0]), active),
+                  8, powerT3324);
+  uint8_t edrx = powerEncodeEdrx(intervalMs);
+  powerFormatBits(edrx, 4, powerEdrx);
+
+  if (mode == MODEM_POWER_MODE_PSM) {
+    logMessagef(2, "🔋 PSM: TAU %lus (\"%s\"), activo %lus (\"%s\")",
+                (unsigned long)tau, powerT3412, (unsigned long)active, powerT3324);
+  } else if (mode == MODEM_POWER_MODE_EDRX) {
+    logMessagef(2, "🔋 eDRX: ciclo %lums (\"%s\")", (unsigned long)powerEdrxCycles[edrx], powerEdrx);
+  } else {
+    logMessage(2, "🔋 Ahorro de energía desactivado");
+  }
+}
+
+ModemPowerMode modemPowerMode() {
+  return powerMode;
+}
+
+ModemPowerState modemPowerState() {
+  return powerState;
+}
+
+bool modemPowerAwake() {
+  return powerState == MODEM_POWER_ACTIVE;
+}
+
+bool modemPowerKeepAliveSuppressed() {
+  return powerMode != MODEM_POWER_MODE_ON;
+}
+
+void modemPowerPoll() {
+  if (!powerConfigured) return;
+
+  if (modemIsStarting()) {
+    // El arranque reconfigura el módem: se aplica todo de nuevo al terminar
+    powerApplyStep = 0;
+    powerSetState(MODEM_POWER_ACTIVE);
+    return;
+  }
+  if (modemGetState() == MODEM_STATE_OFF) return;
+
+  if (powerState == MODEM_POWER_ACTIVE) {
+    powerApplyPoll();
+  } else if (powerState == MODEM_POWER_PSM) {
+    if (!tcpTrafficPending()) return;
+    logMessage(3, "🔋 Envíos listos: despertando módem");
+    powerPulsed = false;
+    powerWakeStart = millis();
+    powerTimer = powerWakeStart;
+    powerWakePhase = POWER_PHASE_PROBE;
+    powerSetState(MODEM_POWER_WAKING);
+  } else {
+    powerWakePoll();
+  }
+}
+
+unsigned long modemPowerPollTimeout() {
+  if (!powerConfigured || modemIsStarting() || modemGetState() == MODEM_STATE_OFF) return ULONG_MAX;
+
+  if (powerState == MODEM_POWER_ACTIVE) {
+    return powerApplyStep < POWER_APPLY_STEPS ? 0 : ULONG_MAX;
+  }
+  if (powerState == MODEM_POWER_PSM) {
+    // Solo un envío listo despierta al módem
+    return tcpTrafficPending() ? 0 : ULONG_MAX;
+  }
+
+  switch (powerWakePhase) {
+    case POWER_PHASE_PROBE:
+    case POWER_PHASE_RELEASE: {
+      long remaining = (long)(powerTimer - millis());
+      return remaining > 0 ? (unsigned long)remaining : 0;
+    }
+    case POWER_PHASE_PROBING:
+      return ULONG_MAX;
+    default:
+      return 0;
+  }
+}
+
+ModemPowerTimes modemPowerTimes() {
+  ModemPowerTimes times = powerStats;
+  if (powerConfigured) times.ms[powerState] += millis() - powerStateSince;
+  return times;
+}
+
+const char* modemPowerStateName(ModemPowerState state) {
+  switch (state) {
+    case MODEM_POWER_ACTIVE: return "activo";
+    case MODEM_POWER_PSM: return "PSM";
+    case MODEM_POWER_WAKING: return "despertando";
+    default: return "?";
+  }
+}
@@ -0,0 +1,136 @@
+/**
+ * @file gsmlte_power.h
+ * @brief Ahorro de energía del SIM7080G (PSM / eDRX) con despertar al enviar
+ * @version 3.0
+ *
+ * @details Al terminar cada arranque se configuran los temporizadores de red
+ * a partir del intervalo de envío de la aplicación:
+ *
+ * - PSM (+CPSMS): T3412 (TAU periódico) es el menor valor representable que
+ *   no sea menor al intervalo, así cada envío regular reinicia el TAU y el
+ *   módem no despierta solo entre envíos; T3324 (tiempo activo) cubre la
+ *   respuesta del servidor antes de dormir.
+ * - eDRX (+CEDRXS): el mayor ciclo de paginación que no supera el intervalo,
+ *   de modo que los datos del servidor esperan a lo sumo un intervalo.
+ *
+ * Con el ahorro activo no se envían keep-alive (+CASTATE? periódico): la
+ * conexión se verifica antes del siguiente envío. En PSM el UART no responde,
+ * así que los sockets no emiten comandos; los envíos se acumulan en su cola
+ * (o en el lote de tcpBatchConfigure()) y al haber uno listo se despierta el
+ * módem con un pulso PWRKEY. Lo acumulado sale en esa misma ventana con radio
+ * encendida y el módem vuelve a PSM al vencer T3324.
+ *
+ * El estado se sigue con los URC de +CPSMSTATUS ("ENTER PSM" / "EXIT PSM").
+ * El tiempo en ciclo eDRX no es visible por AT y se cuenta como activo.
+ *
+ * @warning El pulso de despertar solo se emite si el módem no responde a
+ * "AT"; un pulso largo con el módem despierto lo apagaría.
+ *
+ * @example
+ * @code
+ * modemPowerConfigure(MODEM_POWER_MODE_PSM, 60000);
+ * tcpBatchConfigure(1024, 5000);  // un despertar por lote
+ * @endcode
+ */
+
+#ifndef GSMLTE_POWER_H
+#define GSMLTE_POWER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define POWER_ACTIVE_TIME 10000     ///< T3324 por defecto (ms)
+#define POWER_EDRX_ACT 4            ///< Tipo de acceso de +CEDRXS: 4 = CAT-M (WB-S1)
+#define POWER_PROBE_TIMEOUT 500     ///< Sonda AT antes del pulso de despertar
+#define POWER_WAKE_PULSE 1000       ///< Duración del pulso PWRKEY para salir de PSM
+#define POWER_WAKE_TIMEOUT 10000    ///< Espera máxima de "EXIT PSM" tras el pulso
+#define POWER_WAKE_POLL 1000        ///< Intervalo de sondas AT mientras despierta
+
+/**
+ * @enum ModemPowerMode
+ * @brief Modo de ahorro solicitado a la red
+ */
+enum ModemPowerMode {
+  MODEM_POWER_MODE_ON = 0,    ///< Sin ahorro: PSM y eDRX desactivados
+  MODEM_POWER_MODE_EDRX = 1,  ///< Paginación extendida; el UART sigue disponible
+  MODEM_POWER_MODE_PSM = 2    ///< Sueño profundo entre envíos
+};
+
+/**
+ * @enum ModemPowerState
+ * @brief Estado de energía observado del módem
+ */
+enum ModemPowerState {
+  MODEM_POWER_ACTIVE = 0,     ///< Despierto (incluye ciclo eDRX)
+  MODEM_POWER_PSM = 1,        ///< En PSM: UART y radio apagados
+  MODEM_POWER_WAKING = 2,     ///< Despertando para enviar
+  MODEM_POWER_STATES = 3
+};
+
+/**
+ * @struct ModemPowerTimes
+ * @brief Tiempo acumulado en cada estado de energía
+ */
+struct ModemPowerTimes {
+  uint32_t ms[MODEM_POWER_STATES];  ///< Milisegundos por ModemPowerState
+  uint32_t psmEntries;              ///< Entradas a PSM
+  uint32_t wakes;                   ///< Despertares por envío
+  uint32_t wakeFailures;            ///< Despertares sin respuesta del módem
+};
+
+/**
+ * @brief Configura el ahorro de energía
+ * @details Los comandos se envían al terminar el arranque en curso (y en cada
+ * arranque posterior); puede llamarse antes de setupModemAsync().
+ * @param mode Modo de ahorro
+ * @param intervalMs Intervalo entre envíos de la aplicación
+ * @param activeTimeMs Tiempo despierto tras la última actividad (T3324)
+ */
+void modemPowerConfigure(ModemPowerMode mode, unsigned long intervalMs,
+                         unsigned long activeTimeMs = POWER_ACTIVE_TIME);
+
+/**
+ * @brief Modo de ahorro configurado
+ */
+ModemPowerMode modemPowerMode();
+
+/**
+ * @brief Estado de energía actual
+ */
+ModemPowerState modemPowerState();
+
+/**
+ * @brief Indica si los sockets pueden emitir comandos AT
+ * @return false mientras el módem está en PSM o despertando
+ */
+bool modemPowerAwake();
+
+/**
+ * @brief Indica si se omiten los keep-alive periódicos
+ * @return true si hay un modo de ahorro configurado
+ */
+bool modemPowerKeepAliveSuppressed();
+
+/**
+ * @brief Avanza la configuración y el despertar sin bloquear
+ * @note Se llama desde modemPoll()
+ */
+void modemPowerPoll();
+
+/**
+ * @brief Milisegundos hasta que modemPowerPoll() tenga trabajo
+ * @return 0 si hay trabajo listo, ULONG_MAX si solo espera un evento
+ */
+unsigned long modemPowerPollTimeout();
+
+/**
+ * @brief Obtiene el tiempo acumulado por estado (incluye el tramo en curso)
+ */
+ModemPowerTimes modemPowerTimes();
+
+/**
+ * @brief Nombre de un estado de energía para registros y estadísticas
+ */
+const char* modemPowerStateName(ModemPowerState state);
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file gsmlte_profile.h
+ * @brief Perfiles de compilación del módem: modo de red, bandas, APN y servidor
+ * @version 3.0
+ *
+ * @details Todo lo que no cambia entre equipos de una misma flota se fija al
+ * compilar. MODEM_PROFILE elige el perfil y cada valor puede reemplazarse por
+ * separado con -D. Los comandos de configuración del arranque se arman aquí
+ * por concatenación de literales, de modo que la tabla de pasos de gsmlte.cpp
+ * queda en flash y el arranque la recorre sin formatear nada en tiempo de
+ * ejecución.
+ *
+ * | Perfil                      | Red                               | Transporte            |
+ * |-----------------------------|-----------------------------------|-----------------------|
+ * | MODEM_PROFILE_STANDARD      | CAT-M (+CMNB=1) y bandas NB-IoT   | Celular               |
+ * | MODEM_PROFILE_CATM          | Solo CAT-M                        | Celular               |
+ * | MODEM_PROFILE_NBIOT         | Solo NB-IoT                       | Celular               |
+ * | MODEM_PROFILE_WIFI_FIRST    | Igual que STANDARD                | WiFi con respaldo LTE |
+ *
+ * @example
+ * @code
+ * // arduino-cli compile --build-property "build.extra_flags=-DMODEM_PROFILE=MODEM_PROFILE_NBIOT"
+ * // platformio.ini:  build_flags = -DMODEM_PROFILE=MODEM_PROFILE_CATM -DMODEM_PROFILE_APN=\"internet.itelcel.com\"
+ * @endcode
+ */
+
+#ifndef GSMLTE_PROFILE_H
+#define GSMLTE_PROFILE_H
+
+#define MODEM_PROFILE_STANDARD 0
+#define MODEM_PROFILE_CATM 1
+#define MODEM_PROFILE_NBIOT 2
+#define MODEM_PROFILE_WIFI_FIRST 3
+
+#ifndef MODEM_PROFILE
+#define MODEM_PROFILE MODEM_PROFILE_STANDARD
+#endif
+
+#define MODEM_PROFILE_STR_(x) #x
+#define MODEM_PROFILE_STR(x) MODEM_PROFILE_STR_(x)
+
+// Valores comunes a todos los perfiles
+
+#ifndef MODEM_PROFILE_SERVER
+#define MODEM_PROFILE_SERVER "dp01.lolaberries.com.mx"
+#endif
+#ifndef MODEM_PROFILE_PORT
+#define MODEM_PROFILE_PORT "12607"
+#endif
+#ifndef MODEM_PROFILE_APN
+#define MODEM_PROFILE_APN "em"
+#endif
+#ifndef MODEM_PROFILE_NETWORK_MODE
+#define MODEM_PROFILE_NETWORK_MODE 38       ///< +CNMP: 38 = solo LTE
+#endif
+#ifndef MODEM_PROFILE_BANDS_CATM
+#define MODEM_PROFILE_BANDS_CATM "2,4,5"
+#endif
+#ifndef MODEM_PROFILE_BANDS_NBIOT
+#define MODEM_PROFILE_BANDS_NBIOT "2,4,5"
+#endif
+
+// Valores de cada perfil; un comando de bandas NULL omite el paso
+
+#if MODEM_PROFILE == MODEM_PROFILE_STANDARD || MODEM_PROFILE == MODEM_PROFILE_WIFI_FIRST
+#define MODEM_PROFILE_BAND_MODE_DEFAULT 1
+#define MODEM_PROFILE_CMD_BANDS_CATM "+CBANDCFG=\"CAT-M\"," MODEM_PROFILE_BANDS_CATM
+#define MODEM_PROFILE_CMD_BANDS_NBIOT "+CBANDCFG=\"NB-IOT\""
+#define MODEM_PROFILE_WIFI (MODEM_PROFILE == MODEM_PROFILE_WIFI_FIRST)
+#elif MODEM_PROFILE == MODEM_PROFILE_CATM
+#define MODEM_PROFILE_BAND_MODE_DEFAULT 1
+#define MODEM_PROFILE_CMD_BANDS_CATM "+CBANDCFG=\"CAT-M\"," MODEM_PROFILE_BANDS_CATM
+#define MODEM_PROFILE_CMD_BANDS_NBIOT NULL
+#define MODEM_PROFILE_WIFI 0
+#elif MODEM_PROFILE == MODEM_PROFILE_NBIOT
+#define MODEM_PROFILE_BAND_MODE_DEFAULT 2
+#define MODEM_PROFILE_CMD_BANDS_CATM NULL
+#define MODEM_PROFILE_CMD_BANDS_NBIOT "+CBANDCFG=\"NB-IOT\"," MODEM_PROFILE_BANDS_NBIOT
+#define MODEM_PROFILE_WIFI 0
+#else
+#error "MODEM_PROFILE desconocido (ver gsmlte_profile.h)"
+#endif
+
+#ifndef MODEM_PROFILE_BAND_MODE
+#define MODEM_PROFILE_BAND_MODE MODEM_PROFILE_BAND_MODE_DEFAULT  ///< +CMNB: 1 = CAT-M, 2 = NB-IoT, 3 = ambos
+#endif
+
+// Comandos del arranque
+
+#define MODEM_PROFILE_CMD_NETWORK_MODE "+CNMP=" MODEM_PROFILE_STR(MODEM_PROFILE_NETWORK_MODE)
+#define MODEM_PROFILE_CMD_BAND_MODE "+CMNB=" MODEM_PROFILE_STR(MODEM_PROFILE_BAND_MODE)
+#define MODEM_PROFILE_CMD_PDP "+CGDCONT=1,\"IP\",\"" MODEM_PROFILE_APN "\""
+
+#endif
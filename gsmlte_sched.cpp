@@ -0,0 +1,185 @@
+/**
+ * @file gsmlte_sched.cpp
+ * @brief Implementación del montículo de temporizadores y la espera por eventos
+ *
+ * @details schedHeap guarda índices de schedTimers ordenados por plazo; cada
+ * temporizador recuerda su posición en el montículo para reprogramarlo o
+ * detenerlo en O(log n). Los avisos de onReceive() llegan como notificación
+ * de tarea: si llegan mientras el loop trabaja, la siguiente espera vuelve
+ * en seguida, así no se pierde ningún evento entre el sondeo y el sueño.
+ */
+
+#include "gsmlte_sched.h"
+#include <limits.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+struct SchedTimer {
+  unsigned long deadline;
+  unsigned long period;
+  SchedCallback callback;
+  void* ctx;
+  int8_t heapPos;           ///< -1 = detenido
+};
+
+static SchedTimer schedTimers[SCHED_MAX_TIMERS];
+static uint8_t schedTimerCount = 0;
+static uint8_t schedHeap[SCHED_MAX_TIMERS];
+static uint8_t schedHeapCount = 0;
+
+static HardwareSerial* schedPorts[SCHED_MAX_WATCH];
+static uint8_t schedPortCount = 0;
+static TaskHandle_t schedWaiter = NULL;
+static SchedStats schedCounters;
+
+/**
+ * Indica si el temporizador a vence antes que b
+ */
+static bool schedBefore(uint8_t a, uint8_t b) {
+  return (long)(schedTimers[a].deadline - schedTimers[b].deadline) < 0;
+}
+
+static void schedPlace(uint8_t pos, uint8_t id) {
+  schedHeap[pos] = id;
+  schedTimers[id].heapPos = (int8_t)pos;
+}
+
+static void schedSiftUp(uint8_t pos) {
+  uint8_t id = schedHeap[pos];
+  while (pos > 0) {
+    uint8_t parent = (uint8_t)((pos - 1) / 2);
+    if (!schedBefore(id, schedHeap[parent])) break;
+    schedPlace(pos, schedHeap[parent]);
+    pos = parent;
+  }
+  schedPlace(pos, id);
+}
+
+static void schedSiftDown(uint8_t pos) {
+  uint8_t id = schedHeap[pos];
+  for (;;) {
+    uint8_t child = (uint8_t)(2 * pos + 1);
+    if (child >= schedHeapCount) break;
+    if (child + 1 < schedHeapCount && schedBefore(schedHeap[child + 1], schedHeap[child])) child++;
+    if (!schedBefore(schedHeap[child], id)) break;
+    schedPlace(pos, schedHeap[child]);
+    pos = child;
+  }
+  schedPlace(pos, id);
+}
+
+static void schedInsert(uint8_t id) {
+  schedPlace(schedHeapCount++, id);
+  schedSiftUp(schedTimers[id].heapPos);
+}
+
+static void schedRemove(uint8_t id) {
+  int8_t pos = schedTimers[id].heapPos;
+  if (pos < 0) return;
+
+  schedTimers[id].heapPos = -1;
+  uint8_t last = schedHeap[--schedHeapCount];
+  if (pos == schedHeapCount) return;
+
+  schedPlace((uint8_t)pos, last);
+  schedSiftUp((uint8_t)pos);
+  schedSiftDown((uint8_t)schedTimers[last].heapPos);
+}
+
+int schedAdd(unsigned long delayMs, unsigned long periodMs, SchedCallback callback, void* ctx) {
+  if (callback == NULL || schedTimerCount >= SCHED_MAX_TIMERS) return -1;
+
+  uint8_t id = schedTimerCount++;
+  SchedTimer& t = schedTimers[id];
+  t.deadline = millis() + delayMs;
+  t.period = periodMs;
+  t.callback = callback;
+  t.ctx = ctx;
+  t.heapPos = -1;
+  schedInsert(id);
+  return id;
+}
+
+bool schedSet(int id, unsigned long delayMs) {
+  if (id < 0 || id >= schedTimerCount) return false;
+
+  schedRemove((uint8_t)id);
+  schedTimers[id].deadline = millis() + delayMs;
+  schedInsert((uint8_t)id);
+  return true;
+}
+
+void schedCancel(int id) {
+  if (id < 0 || id >= schedTimerCount) return;
+  schedRemove((uint8_t)id);
+}
+
+unsigned long schedRun() {
+  while (schedHeapCount > 0) {
+    uint8_t id = schedHeap[0];
+    SchedTimer& t = schedTimers[id];
+    unsigned long now = millis();
+    long remaining = (long)(t.deadline - now);
+    if (remaining > 0) return (unsigned long)remaining;
+
+    // Se reprograma antes del callback para que este pueda llamar a schedSet()
+    schedRemove(id);
+    if (t.period > 0) {
+      t.deadline += t.period;
+      if ((long)(t.deadline - now) <= 0) t.deadline = now + t.period;
+      schedInsert(id);
+    }
+
+    schedCounters.fired++;
+    t.callback(t.ctx);
+  }
+  return ULONG_MAX;
+}
+
+/**
+ * Aviso de onReceive(); corre en la tarea de eventos del UART
+ */
+static void schedOnReceive() {
+  schedNotify();
+}
+
+void schedWatch(HardwareSerial& port) {
+  schedWaiter = xTaskGetCurrentTaskHandle();
+  for (uint8_t i = 0; i < schedPortCount; ++i) {
+    if (schedPorts[i] == &port) return;
+  }
+  if (schedPortCount >= SCHED_MAX_WATCH) return;
+
+  schedPorts[schedPortCount++] = &port;
+  port.onReceive(schedOnReceive);
+}
+
+void schedNotify() {
+  TaskHandle_t waiter = schedWaiter;
+  if (waiter != NULL) xTaskNotifyGive(waiter);
+}
+
+void schedWait(unsigned long timeoutMs) {
+  if (timeoutMs == 0) return;
+  for (uint8_t i = 0; i < schedPortCount; ++i) {
+    if (schedPorts[i]->available() > 0) return;
+  }
+
+  schedWaiter = xTaskGetCurrentTaskHandle();
+  TickType_t ticks = portMAX_DELAY;
+  if (timeoutMs != ULONG_MAX) {
+    ticks = (TickType_t)((uint64_t)timeoutMs * configTICK_RATE_HZ / 1000);
+    if (ticks == 0) ticks = 1;
+  }
+
+  unsigned long start = millis();
+  uint32_t notified = ulTaskNotifyTake(pdTRUE, ticks);
+
+  schedCounters.waits++;
+  if (notified > 0) schedCounters.eventWakes++;
+  schedCounters.sleptMs += millis() - start;
+}
+
+SchedStats schedStats() {
+  return schedCounters;
+}
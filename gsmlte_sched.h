@@ -0,0 +1,117 @@
+/**
+ * @file gsmlte_sched.h
+ * @brief Temporizadores del sketch y espera hasta el próximo plazo o evento
+ * @version 3.0
+ *
+ * @details Montículo mínimo de plazos con capacidad fija (SCHED_MAX_TIMERS),
+ * sin memoria dinámica. schedRun() ejecuta los temporizadores vencidos y
+ * devuelve cuánto falta para el siguiente; schedWait() duerme la tarea
+ * hasta ese plazo o hasta que llegue un byte por un puerto vigilado con
+ * schedWatch(), lo que ocurra primero.
+ *
+ * - Los periódicos se reprograman sobre su plazo anterior (deadline +=
+ *   period), así el intervalo no acumula el tiempo de proceso. Si se
+ *   atrasan más de un periodo se saltan los perdidos en lugar de
+ *   ejecutarse en ráfaga.
+ * - Los plazos se comparan con aritmética de millis() circular.
+ * - Los temporizadores se crean una vez (normalmente en setup()) y se
+ *   reprograman con schedSet(); los de un solo disparo conservan su
+ *   identificador al vencer.
+ * - Los callbacks corren en la tarea que llama a schedRun().
+ *
+ * Los plazos internos de la biblioteca (keep-alive, reconexión, despertar
+ * de PSM, timeouts AT) no se registran aquí: modemPollTimeout() los
+ * informa y el loop espera el mínimo de ambos.
+ *
+ * @example
+ * @code
+ * int sendTimer = schedAdd(0, 60000, onSendTimer, NULL);
+ *
+ * void loop() {
+ *   unsigned long wait = schedRun();
+ *   modemPoll();
+ *   unsigned long modemWait = modemPollTimeout();
+ *   schedWait(modemWait < wait ? modemWait : wait);
+ * }
+ * @endcode
+ */
+
+#ifndef GSMLTE_SCHED_H
+#define GSMLTE_SCHED_H
+
+#include <stdint.h>
+#include "Arduino.h"
+
+#define SCHED_MAX_TIMERS 8
+#define SCHED_MAX_WATCH 2         ///< Puertos que despiertan schedWait()
+
+/**
+ * @brief Función invocada al vencer un temporizador
+ */
+typedef void (*SchedCallback)(void* ctx);
+
+/**
+ * @struct SchedStats
+ * @brief Contadores de espera del loop
+ */
+struct SchedStats {
+  uint32_t waits;           ///< Llamadas a schedWait() que durmieron
+  uint32_t eventWakes;      ///< Despertares antes del plazo (UART u otra tarea)
+  uint32_t sleptMs;         ///< Tiempo total dormido
+  uint32_t fired;           ///< Callbacks ejecutados
+};
+
+/**
+ * @brief Crea un temporizador
+ * @param delayMs Tiempo hasta el primer disparo
+ * @param periodMs Periodo (0 = un solo disparo)
+ * @param callback Función a invocar
+ * @param ctx Contexto del callback
+ * @return Identificador, o -1 si no hay lugar
+ */
+int schedAdd(unsigned long delayMs, unsigned long periodMs, SchedCallback callback, void* ctx);
+
+/**
+ * @brief Reprograma un temporizador para dentro de delayMs
+ * @details Un periódico sigue con su periodo a partir del nuevo plazo
+ * @return false si el identificador no es válido
+ */
+bool schedSet(int id, unsigned long delayMs);
+
+/**
+ * @brief Detiene un temporizador sin liberarlo (schedSet() lo reanuda)
+ */
+void schedCancel(int id);
+
+/**
+ * @brief Ejecuta los temporizadores vencidos
+ * @return Milisegundos hasta el próximo plazo (ULONG_MAX si no hay ninguno)
+ */
+unsigned long schedRun();
+
+/**
+ * @brief Despierta schedWait() cuando lleguen bytes por un puerto
+ * @details Usa HardwareSerial::onReceive(); llamar desde la tarea que
+ * espera. No aplica a la consola USB CDC, que debe sondearse
+ */
+void schedWatch(HardwareSerial& port);
+
+/**
+ * @brief Despierta schedWait() desde otra tarea
+ */
+void schedNotify();
+
+/**
+ * @brief Duerme hasta timeoutMs o hasta un evento
+ * @details Vuelve en seguida si un puerto vigilado ya tiene datos o si hubo
+ * un evento desde la última espera
+ * @param timeoutMs Tiempo máximo (0 = no esperar, ULONG_MAX = sin límite)
+ */
+void schedWait(unsigned long timeoutMs);
+
+/**
+ * @brief Obtiene los contadores de espera
+ */
+SchedStats schedStats();
+
+#endif
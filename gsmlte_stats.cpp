@@ -0,0 +1,302 @@
+/**
+ * @file gsmlte_stats.cpp
+ * @brief Implementación de las estadísticas por comando AT
+ * 
+ * @details La tabla es un arreglo estático con búsqueda lineal por prefijo;
+ * con STATS_MAX_COMMANDS entradas el costo es menor que el de un comando AT.
+ * Registrar una muestra no reserva memoria ni imprime.
+ */
+
+#include "gsmlte_stats.h"
+#include "gsmlte.h"
+#include "gsmlte_power.h"
+#include <stdarg.h>
+#include <string.h>
+
+static ModemCommandStats statsTable[STATS_MAX_COMMANDS];
+static uint8_t statsCount = 0;
+static uint32_t statsReconnects = 0;
+static uint32_t statsLteRestarts = 0;
+static uint32_t statsDropped = 0;
+static uint32_t statsBreakerTrips = 0;
+static ModemCompressionStats statsCompression;
+
+/**
+ * Obtiene la longitud del prefijo de un comando (hasta '=' o '?')
+ */
+static size_t statsPrefixLength(const char* command) {
+  size_t len = 0;
+  while (command[len] != '\0' && command[len] != '=' && command[len] != '?' &&
+         len < STATS_PREFIX_MAX - 1) {
+    len++;
+  }
+  return len;
+}
+
+/**
+ * Busca o crea la entrada de un prefijo
+ * @return Entrada, o NULL si la tabla está llena
+ */
+static ModemCommandStats* statsLookup(const char* command) {
+  size_t len = statsPrefixLength(command);
+
+  for (uint8_t i = 0; i < statsCount; ++i) {
+    if (strncmp(statsTable[i].prefix, command, len) == 0 &&
+        statsTable[i].prefix[len] == '\0') {
+      return &statsTable[i];
+    }
+  }
+
+  if (statsCount >= STATS_MAX_COMMANDS) return NULL;
+
+  ModemCommandStats* entry = &statsTable[statsCount++];
+  memset(entry, 0, sizeof(*entry));
+  memcpy(entry->prefix, command, len);
+  entry->prefix[len] = '\0';
+  entry->minUs = UINT32_MAX;
+  return entry;
+}
+
+/**
+ * Calcula la cubeta del histograma de una latencia
+ */
+static uint8_t statsBucket(uint32_t latencyUs) {
+  uint8_t bucket = 0;
+  latencyUs >>= 10;
+  while (latencyUs != 0 && bucket < STATS_HIST_BUCKETS - 1) {
+    latencyUs >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+void modemStatsRecord(const char* command, int8_t result, uint32_t latencyUs,
+                      uint32_t bytesTx, uint32_t bytesRx) {
+  ModemCommandStats* entry = statsLookup(command);
+  if (entry == NULL) {
+    statsDropped++;
+    return;
+  }
+
+  if (result == 1) {
+    entry->ok++;
+  } else if (result == -1) {
+    entry->errors++;
+  } else {
+    entry->timeouts++;
+  }
+
+  entry->bytesTx += bytesTx;
+  entry->bytesRx += bytesRx;
+  entry->totalUs += latencyUs;
+  if (latencyUs < entry->minUs) entry->minUs = latencyUs;
+  if (latencyUs > entry->maxUs) entry->maxUs = latencyUs;
+  entry->histogram[statsBucket(latencyUs)]++;
+}
+
+void modemStatsNoteReconnect() {
+  statsReconnects++;
+}
+
+void modemStatsNoteLteRestart() {
+  statsLteRestarts++;
+}
+
+void modemStatsNoteBreakerTrip() {
+  statsBreakerTrips++;
+}
+
+void modemStatsNoteCompression(size_t rawLen, size_t packedLen, uint32_t cpuUs) {
+  statsCompression.attempts++;
+  statsCompression.totalUs += cpuUs;
+  if (cpuUs > statsCompression.maxUs) statsCompression.maxUs = cpuUs;
+  if (packedLen == 0) return;
+
+  statsCompression.compressed++;
+  statsCompression.bytesIn += rawLen;
+  statsCompression.bytesOut += packedLen;
+}
+
+ModemCompressionStats modemStatsCompression() {
+  return statsCompression;
+}
+
+uint8_t modemStatsCount() {
+  return statsCount;
+}
+
+bool modemStatsGet(uint8_t index, ModemCommandStats& out) {
+  if (index >= statsCount) return false;
+  out = statsTable[index];
+  return true;
+}
+
+ModemLinkStats modemStatsLink() {
+  ModemLinkStats link;
+  link.tcpReconnects = statsReconnects;
+  link.lteRestarts = statsLteRestarts;
+  link.consecutiveFailures = consecutiveFailures;
+  link.tcpReconnectAttempts = tcpReconnectAttempts;
+  link.droppedCommands = statsDropped;
+  link.breakerTrips = statsBreakerTrips;
+  return link;
+}
+
+void modemStatsReset() {
+  statsCount = 0;
+  statsReconnects = 0;
+  statsLteRestarts = 0;
+  statsDropped = 0;
+  statsBreakerTrips = 0;
+  memset(&statsCompression, 0, sizeof(statsCompression));
+}
+
+/**
+ * Cantidad total de muestras de una entrada
+ */
+static uint32_t statsSamples(const ModemCommandStats& entry) {
+  return entry.ok + entry.errors + entry.timeouts;
+}
+
+void modemStatsPrint(Print& out) {
+  out.println("=== ESTADÍSTICAS DEL MÓDEM ===");
+
+  for (uint8_t i = 0; i < statsCount; ++i) {
+    const ModemCommandStats& e = statsTable[i];
+    uint32_t samples = statsSamples(e);
+    uint32_t avgUs = samples > 0 ? (uint32_t)(e.totalUs / samples) : 0;
+
+    out.printf("AT%-10s n=%lu ok=%lu err=%lu to=%lu tx=%lu rx=%lu min=%luus avg=%luus max=%luus\r\n",
+               e.prefix, (unsigned long)samples, (unsigned long)e.ok,
+               (unsigned long)e.errors, (unsigned long)e.timeouts,
+               (unsigned long)e.bytesTx, (unsigned long)e.bytesRx,
+               (unsigned long)(samples > 0 ? e.minUs : 0), (unsigned long)avgUs,
+               (unsigned long)e.maxUs);
+
+    out.print("  hist:");
+    for (uint8_t b = 0; b < STATS_HIST_BUCKETS; ++b) {
+      if (e.histogram[b] == 0) continue;
+      out.printf(" <%lums:%lu", (unsigned long)(1UL << b), (unsigned long)e.histogram[b]);
+    }
+    out.println();
+  }
+
+  ModemLinkStats link = modemStatsLink();
+  out.printf("Reconexiones TCP: %lu, reinicios LTE: %lu, fallas consecutivas: %d, intentos actuales: %d\r\n",
+             (unsigned long)link.tcpReconnects, (unsigned long)link.lteRestarts,
+             link.consecutiveFailures, link.tcpReconnectAttempts);
+  if (link.breakerTrips > 0) {
+    out.printf("Aperturas del circuito de reconexión: %lu\r\n", (unsigned long)link.breakerTrips);
+  }
+  if (link.droppedCommands > 0) {
+    out.printf("Muestras sin lugar en la tabla: %lu\r\n", (unsigned long)link.droppedCommands);
+  }
+
+  static const char* const rttNames[MODEM_RTT_CLASSES] = { "local", "socket", "red" };
+  for (uint8_t c = 0; c < MODEM_RTT_CLASSES; ++c) {
+    ModemRttInfo rtt;
+    if (!modemRttGet((ModemRttClass)c, rtt) || rtt.samples == 0) continue;
+    out.printf("RTT %-6s srtt=%lums rttvar=%lums rto=%lums n=%lu to=%lu\r\n", rttNames[c],
+               (unsigned long)rtt.srtt, (unsigned long)rtt.rttvar, (unsigned long)rtt.rto,
+               (unsigned long)rtt.samples, (unsigned long)rtt.timeouts);
+  }
+
+  const ModemCompressionStats& lz = statsCompression;
+  if (lz.attempts > 0) {
+    out.printf("Compresión: %lu/%lu envíos, %lu -> %lu bytes (%lu%%), cpu avg=%luus max=%luus\r\n",
+               (unsigned long)lz.compressed, (unsigned long)lz.attempts,
+               (unsigned long)lz.bytesIn, (unsigned long)lz.bytesOut,
+               (unsigned long)(lz.bytesIn > 0 ? (uint64_t)lz.bytesOut * 100 / lz.bytesIn : 100),
+               (unsigned long)(lz.totalUs / lz.attempts), (unsigned long)lz.maxUs);
+  }
+
+  if (modemPowerMode() != MODEM_POWER_MODE_ON) {
+    ModemPowerTimes pw = modemPowerTimes();
+    out.printf("Energía: activo %lus, PSM %lus, despertando %lus; entradas a PSM: %lu, despertares: %lu (fallidos %lu)\r\n",
+               (unsigned long)(pw.ms[MODEM_POWER_ACTIVE] / 1000), (unsigned long)(pw.ms[MODEM_POWER_PSM] / 1000),
+               (unsigned long)(pw.ms[MODEM_POWER_WAKING] / 1000), (unsigned long)pw.psmEntries,
+               (unsigned long)pw.wakes, (unsigned long)pw.wakeFailures);
+  }
+}
+
+/**
+ * Agrega texto con formato a un buffer acotado
+ * @return false si el texto no cupo
+ */
+static bool statsAppend(char* buffer, size_t size, size_t& pos, const char* format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static bool statsAppend(char* buffer, size_t size, size_t& pos, const char* format, ...) {
+  if (pos >= size) return false;
+
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer + pos, size - pos, format, args);
+  va_end(args);
+
+  if (len < 0 || (size_t)len >= size - pos) return false;
+  pos += len;
+  return true;
+}
+
+size_t modemStatsFormat(char* buffer, size_t size) {
+  size_t pos = 0;
+  ModemLinkStats link = modemStatsLink();
+
+  const ModemCompressionStats& lz = statsCompression;
+
+  if (!statsAppend(buffer, size, pos, "{\"rc\":%lu,\"lte\":%lu,\"cf\":%d,"
+                   "\"lz\":[%lu,%lu,%lu,%lu,%lu],",
+                   (unsigned long)link.tcpReconnects, (unsigned long)link.lteRestarts,
+                   link.consecutiveFailures, (unsigned long)lz.compressed,
+                   (unsigned long)lz.bytesIn, (unsigned long)lz.bytesOut,
+                   (unsigned long)(lz.attempts > 0 ? lz.totalUs / lz.attempts : 0),
+                   (unsigned long)lz.maxUs)) {
+    return 0;
+  }
+
+  ModemPowerTimes pw = modemPowerTimes();
+  if (!statsAppend(buffer, size, pos, "\"pw\":[%lu,%lu,%lu,%lu],",
+                   (unsigned long)(pw.ms[MODEM_POWER_ACTIVE] / 1000),
+                   (unsigned long)(pw.ms[MODEM_POWER_PSM] / 1000),
+                   (unsigned long)(pw.ms[MODEM_POWER_WAKING] / 1000), (unsigned long)pw.wakes)) {
+    return 0;
+  }
+
+  for (uint8_t c = 0; c < MODEM_RTT_CLASSES; ++c) {
+    ModemRttInfo rtt;
+    modemRttGet((ModemRttClass)c, rtt);
+    if (!statsAppend(buffer, size, pos, "%s[%lu,%lu,%lu]", c > 0 ? "," : "\"rtt\":[",
+                     (unsigned long)rtt.srtt, (unsigned long)rtt.rttvar, (unsigned long)rtt.rto)) {
+      return 0;
+    }
+  }
+  if (!statsAppend(buffer, size, pos, "],\"cmd\":[")) return 0;
+
+  for (uint8_t i = 0; i < statsCount; ++i) {
+    const ModemCommandStats& e = statsTable[i];
+    uint32_t samples = statsSamples(e);
+
+    if (!statsAppend(buffer, size, pos, "%s{\"p\":\"%s\",\"ok\":%lu,\"err\":%lu,\"to\":%lu,"
+                     "\"tx\":%lu,\"rx\":%lu,\"avg\":%lu,\"max\":%lu,\"h\":[",
+                     i > 0 ? "," : "", e.prefix, (unsigned long)e.ok,
+                     (unsigned long)e.errors, (unsigned long)e.timeouts,
+                     (unsigned long)e.bytesTx, (unsigned long)e.bytesRx,
+                     (unsigned long)(samples > 0 ? e.totalUs / samples : 0),
+                     (unsigned long)e.maxUs)) {
+      return 0;
+    }
+
+    for (uint8_t b = 0; b < STATS_HIST_BUCKETS; ++b) {
+      if (!statsAppend(buffer, size, pos, "%s%lu", b > 0 ? "," : "",
+                       (unsigned long)e.histogram[b])) {
+        return 0;
+      }
+    }
+
+    if (!statsAppend(buffer, size, pos, "]}")) return 0;
+  }
+
+  if (!statsAppend(buffer, size, pos, "]}")) return 0;
+  return pos;
+}
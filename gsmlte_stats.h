@@ -0,0 +1,160 @@
+/**
+ * @file gsmlte_stats.h
+ * @brief Estadísticas de latencia y resultado por comando AT
+ * @version 3.0
+ * 
+ * @details El motor AT registra cada comando al finalizar: latencia en
+ * microsegundos (histograma logarítmico), resultado (éxito/error/timeout) y
+ * bytes enviados/recibidos. Las entradas se agrupan por prefijo del comando
+ * (texto hasta '=' o '?', p. ej. "+CASEND" o "+CNACT") en una tabla de
+ * tamaño fijo. También se cuentan reconexiones TCP, reinicios LTE y el
+ * resultado de la compresión de envíos (razón y tiempo de CPU), y se muestra
+ * el estado de los estimadores de RTT de getAdaptiveTimeout() y el tiempo en
+ * cada estado de energía (gsmlte_power.h).
+ * 
+ * El histograma usa STATS_HIST_BUCKETS potencias de dos: la cubeta 0 cubre
+ * menos de 1024 us y la cubeta i cubre [2^(9+i), 2^(10+i)) us; la última
+ * acumula todo lo mayor.
+ * 
+ * @example
+ * @code
+ * modemStatsPrint(Serial);                       // volcado legible
+ * 
+ * char json[512];
+ * if (modemStatsFormat(json, sizeof(json)) > 0) {
+ *   tcpSendPersistentAsync(json, 5000, NULL, NULL);  // telemetría
+ * }
+ * @endcode
+ */
+
+#ifndef GSMLTE_STATS_H
+#define GSMLTE_STATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "Arduino.h"
+
+#define STATS_MAX_COMMANDS 24
+#define STATS_PREFIX_MAX 12
+#define STATS_HIST_BUCKETS 16
+
+/**
+ * @struct ModemCommandStats
+ * @brief Estadísticas acumuladas de un prefijo de comando
+ */
+struct ModemCommandStats {
+  char prefix[STATS_PREFIX_MAX];
+  uint32_t ok;
+  uint32_t errors;
+  uint32_t timeouts;
+  uint32_t bytesTx;
+  uint32_t bytesRx;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;
+  uint32_t histogram[STATS_HIST_BUCKETS];
+};
+
+/**
+ * @struct ModemLinkStats
+ * @brief Contadores de la conexión
+ */
+struct ModemLinkStats {
+  uint32_t tcpReconnects;        ///< Reconexiones TCP iniciadas
+  uint32_t lteRestarts;          ///< Escaladas de recuperación (PDP, RF o PWRKEY)
+  int consecutiveFailures;       ///< Valor actual de consecutiveFailures
+  int tcpReconnectAttempts;      ///< Valor actual de tcpReconnectAttempts
+  uint32_t droppedCommands;      ///< Prefijos sin lugar en la tabla
+  uint32_t breakerTrips;         ///< Aperturas del circuito de reconexión
+};
+
+/**
+ * @struct ModemCompressionStats
+ * @brief Resultado de la etapa de compresión de envíos TCP
+ */
+struct ModemCompressionStats {
+  uint32_t attempts;             ///< Envíos que pasaron por el compresor
+  uint32_t compressed;           ///< Envíos que salieron comprimidos
+  uint32_t bytesIn;              ///< Bytes originales de los envíos comprimidos
+  uint32_t bytesOut;             ///< Bytes enviados por esos envíos (con encabezado)
+  uint64_t totalUs;              ///< Tiempo de CPU total del compresor
+  uint32_t maxUs;
+};
+
+/**
+ * @brief Registra el resultado de un comando AT
+ * @param command Comando enviado (sin prefijo "AT")
+ * @param result 1=Respuesta esperada, -1=Error, 0=Timeout
+ * @param latencyUs Latencia desde el envío hasta el resultado
+ * @param bytesTx Bytes escritos al módem (comando y datos)
+ * @param bytesRx Bytes recibidos durante el comando
+ */
+void modemStatsRecord(const char* command, int8_t result, uint32_t latencyUs,
+                      uint32_t bytesTx, uint32_t bytesRx);
+
+/**
+ * @brief Cuenta una reconexión TCP iniciada
+ */
+void modemStatsNoteReconnect();
+
+/**
+ * @brief Cuenta un reinicio de la etapa LTE por fallas TCP
+ */
+void modemStatsNoteLteRestart();
+
+/**
+ * @brief Cuenta una apertura del circuito de reconexión
+ */
+void modemStatsNoteBreakerTrip();
+
+/**
+ * @brief Registra una pasada del compresor de envíos TCP
+ * @param rawLen Bytes originales
+ * @param packedLen Bytes comprimidos con encabezado (0 = se envió sin comprimir)
+ * @param cpuUs Tiempo de CPU de la compresión
+ */
+void modemStatsNoteCompression(size_t rawLen, size_t packedLen, uint32_t cpuUs);
+
+/**
+ * @brief Obtiene los contadores de compresión
+ */
+ModemCompressionStats modemStatsCompression();
+
+/**
+ * @brief Cantidad de prefijos registrados
+ */
+uint8_t modemStatsCount();
+
+/**
+ * @brief Obtiene una copia de las estadísticas de un prefijo
+ * @param index Índice entre 0 y modemStatsCount()-1
+ * @param out Copia de las estadísticas
+ * @return false si el índice no existe
+ */
+bool modemStatsGet(uint8_t index, ModemCommandStats& out);
+
+/**
+ * @brief Obtiene los contadores de la conexión
+ */
+ModemLinkStats modemStatsLink();
+
+/**
+ * @brief Borra todas las estadísticas
+ */
+void modemStatsReset();
+
+/**
+ * @brief Imprime las estadísticas en formato legible
+ * @param out Destino (p. ej. Serial)
+ */
+void modemStatsPrint(Print& out);
+
+/**
+ * @brief Serializa las estadísticas en JSON compacto para telemetría
+ * @param buffer Buffer de salida
+ * @param size Capacidad del buffer
+ * @return Longitud escrita, o 0 si no cabe en el buffer
+ */
+size_t modemStatsFormat(char* buffer, size_t size);
+
+#endif
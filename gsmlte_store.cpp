@@ -0,0 +1,399 @@
+/**
+ * @file gsmlte_store.cpp
+ * @brief Implementación de la cola persistente en flash
+ *
+ * @details Los segmentos se llaman STORE_DIR/<seq> con seq en hexadecimal;
+ * los números son consecutivos desde storeFirstSeq hasta storeLastSeq, que
+ * es el segmento de escritura (puede no existir aún). Cada anexado abre,
+ * escribe y cierra el archivo para que LittleFS confirme el registro.
+ */
+
+#include "gsmlte_store.h"
+#include "gsmlte.h"
+#include <LittleFS.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STORE_MAGIC 0xA5
+#define STORE_HEADER_SIZE 7
+#define STORE_READ_FILE STORE_DIR "/rd"
+
+static bool storeReady = false;
+static uint32_t storeFirstSeq = 0;
+static uint32_t storeLastSeq = 0;
+static uint32_t storeWriteOffset = 0;
+static uint32_t storeReadSeq = 0;
+static uint32_t storeReadOffset = 0;
+static uint32_t storePendingBytes = 0;
+static uint32_t storeDroppedBytes = 0;
+
+/**
+ * CRC-32 (IEEE 802.3) con tabla de 16 entradas
+ */
+static uint32_t storeCrc32(const uint8_t* data, size_t len, uint32_t crc = 0) {
+  static const uint32_t table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+    0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+  };
+
+  crc = ~crc;
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+    crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+  }
+  return ~crc;
+}
+
+/**
+ * Construye la ruta de un segmento
+ */
+static void storeSegmentPath(uint32_t seq, char* path, size_t size) {
+  snprintf(path, size, STORE_DIR "/%08lx", (unsigned long)seq);
+}
+
+/**
+ * Tamaño en flash de un segmento (0 si no existe)
+ */
+static uint32_t storeSegmentSize(uint32_t seq) {
+  char path[24];
+  storeSegmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+  uint32_t size = f.size();
+  f.close();
+  return size;
+}
+
+/**
+ * Borra un segmento
+ */
+static void storeRemoveSegment(uint32_t seq) {
+  char path[24];
+  storeSegmentPath(seq, path, sizeof(path));
+  if (LittleFS.exists(path)) LittleFS.remove(path);
+}
+
+/**
+ * Lee el encabezado de un registro
+ * @return false si no hay un encabezado válido (fin o cola corrupta)
+ */
+static bool storeReadHeader(File& f, uint16_t& len, uint32_t& crc) {
+  uint8_t header[STORE_HEADER_SIZE];
+  if (f.read(header, sizeof(header)) != sizeof(header)) return false;
+  if (header[0] != STORE_MAGIC) return false;
+
+  len = header[1] | (header[2] << 8);
+  crc = (uint32_t)header[3] | ((uint32_t)header[4] << 8) |
+        ((uint32_t)header[5] << 16) | ((uint32_t)header[6] << 24);
+  return len > 0 && len <= STORE_RECORD_MAX;
+}
+
+/**
+ * Recorre un segmento y obtiene el final del último registro válido
+ * @details El CRC se calcula por bloques para no reservar un registro en la pila
+ */
+static uint32_t storeValidLength(uint32_t seq) {
+  char path[24];
+  storeSegmentPath(seq, path, sizeof(path));
+  File f = LittleFS.open(path, "r");
+  if (!f) return 0;
+
+  uint8_t chunk[64];
+  uint32_t valid = 0;
+  uint16_t len;
+  uint32_t crc;
+  while (storeReadHeader(f, len, crc)) {
+    uint32_t computed = 0;
+    size_t remaining = len;
+    while (remaining > 0) {
+      size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+      if (f.read(chunk, n) != n) break;
+      computed = storeCrc32(chunk, n, computed);
+      remaining -= n;
+    }
+    if (remaining > 0 || computed != crc) break;
+    valid += STORE_HEADER_SIZE + len;
+  }
+  f.close();
+  return valid;
+}
+
+/**
+ * Guarda la posición de lectura
+ */
+static void storeSaveReadPosition() {
+  uint8_t record[12];
+  memcpy(record, &storeReadSeq, 4);
+  memcpy(record + 4, &storeReadOffset, 4);
+  uint32_t crc = storeCrc32(record, 8);
+  memcpy(record + 8, &crc, 4);
+
+  File f = LittleFS.open(STORE_READ_FILE, "w");
+  if (!f) return;
+  f.write(record, sizeof(record));
+  f.close();
+}
+
+/**
+ * Carga la posición de lectura guardada
+ * @return false si no existe o es inválida
+ */
+static bool storeLoadReadPosition() {
+  File f = LittleFS.open(STORE_READ_FILE, "r");
+  if (!f) return false;
+
+  uint8_t record[12];
+  bool ok = f.read(record, sizeof(record)) == sizeof(record);
+  f.close();
+
+  uint32_t crc;
+  memcpy(&crc, record + 8, 4);
+  if (!ok || storeCrc32(record, 8) != crc) return false;
+
+  memcpy(&storeReadSeq, record, 4);
+  memcpy(&storeReadOffset, record + 4, 4);
+  return true;
+}
+
+/**
+ * Recalcula los bytes pendientes desde la posición de lectura
+ */
+static void storeRecountPending() {
+  storePendingBytes = 0;
+  for (uint32_t seq = storeReadSeq; seq <= storeLastSeq; ++seq) {
+    storePendingBytes += storeSegmentSize(seq);
+  }
+  storePendingBytes = storePendingBytes > storeReadOffset ? storePendingBytes - storeReadOffset : 0;
+}
+
+/**
+ * Descarta el segmento más antiguo para hacer lugar
+ * @return false si solo queda el segmento de escritura
+ */
+static bool storeDropOldest() {
+  if (storeFirstSeq >= storeLastSeq) return false;
+
+  uint32_t size = storeSegmentSize(storeFirstSeq);
+  uint32_t lost = size;
+  if (storeReadSeq == storeFirstSeq) {
+    lost = size > storeReadOffset ? size - storeReadOffset : 0;
+  } else if (storeReadSeq > storeFirstSeq) {
+    lost = 0;
+  }
+
+  storeRemoveSegment(storeFirstSeq);
+  storeFirstSeq++;
+  if (storeReadSeq < storeFirstSeq) {
+    storeReadSeq = storeFirstSeq;
+    storeReadOffset = 0;
+  }
+
+  storePendingBytes = storePendingBytes > lost ? storePendingBytes - lost : 0;
+  storeDroppedBytes += lost;
+  logMessagef(1, "⚠️  Cola en flash llena: descartados %lu bytes antiguos", (unsigned long)lost);
+  return true;
+}
+
+bool modemStoreBegin() {
+  if (storeReady) return true;
+
+  if (!LittleFS.begin(true)) {
+    logMessage(0, "❌ No se pudo montar LittleFS para la cola de envíos");
+    return false;
+  }
+  if (!LittleFS.exists(STORE_DIR)) LittleFS.mkdir(STORE_DIR);
+
+  bool found = false;
+  File dir = LittleFS.open(STORE_DIR);
+  File entry = dir.openNextFile();
+  while (entry) {
+    const char* name = strrchr(entry.name(), '/');
+    name = name != NULL ? name + 1 : entry.name();
+    char* end;
+    uint32_t seq = strtoul(name, &end, 16);
+    if (*end == '\0' && end - name == 8) {
+      if (!found || seq < storeFirstSeq) storeFirstSeq = seq;
+      if (!found || seq > storeLastSeq) storeLastSeq = seq;
+      found = true;
+    }
+    entry.close();
+    entry = dir.openNextFile();
+  }
+  dir.close();
+
+  if (!found) {
+    storeFirstSeq = storeLastSeq = 0;
+  }
+
+  storeWriteOffset = storeSegmentSize(storeLastSeq);
+  if (storeWriteOffset > 0 && storeValidLength(storeLastSeq) != storeWriteOffset) {
+    logMessage(1, "⚠️  Registro incompleto en la cola en flash, iniciando segmento nuevo");
+    storeLastSeq++;
+    storeWriteOffset = 0;
+  }
+
+  if (!storeLoadReadPosition() || storeReadSeq < storeFirstSeq || storeReadSeq > storeLastSeq) {
+    storeReadSeq = storeFirstSeq;
+    storeReadOffset = 0;
+  }
+
+  storeReady = true;
+  storeRecountPending();
+  logMessagef(2, "💾 Cola en flash lista: %lu bytes pendientes en %lu segmentos",
+              (unsigned long)storePendingBytes, (unsigned long)(storeLastSeq - storeFirstSeq + 1));
+  return true;
+}
+
+bool modemStoreReady() {
+  return storeReady;
+}
+
+bool modemStoreAppend(const uint8_t* data, size_t len) {
+  if (!storeReady || len == 0 || len > STORE_RECORD_MAX) return false;
+
+  uint32_t recordLen = STORE_HEADER_SIZE + len;
+  if (storeWriteOffset > 0 && storeWriteOffset + recordLen > STORE_SEGMENT_SIZE) {
+    storeLastSeq++;
+    storeWriteOffset = 0;
+  }
+
+  while (storeLastSeq - storeFirstSeq + 1 > STORE_MAX_SEGMENTS) {
+    storeDropOldest();
+  }
+  while (LittleFS.totalBytes() - LittleFS.usedBytes() < STORE_MIN_FREE + recordLen) {
+    if (!storeDropOldest()) return false;
+  }
+
+  uint8_t header[STORE_HEADER_SIZE];
+  uint32_t crc = storeCrc32(data, len);
+  header[0] = STORE_MAGIC;
+  header[1] = len & 0xFF;
+  header[2] = len >> 8;
+  header[3] = crc & 0xFF;
+  header[4] = (crc >> 8) & 0xFF;
+  header[5] = (crc >> 16) & 0xFF;
+  header[6] = crc >> 24;
+
+  char path[24];
+  storeSegmentPath(storeLastSeq, path, sizeof(path));
+  File f = LittleFS.open(path, "a");
+  if (!f) return false;
+  size_t written = f.write(header, sizeof(header));
+  written += f.write(data, len);
+  f.close();
+
+  if (written != recordLen) {
+    logMessage(0, "❌ Error escribiendo la cola en flash");
+    storeLastSeq++;
+    storeWriteOffset = 0;
+    return false;
+  }
+
+  storeWriteOffset += recordLen;
+  storePendingBytes += recordLen;
+  return true;
+}
+
+size_t modemStoreRead(uint8_t* buffer, size_t size, ModemStoreCursor& cursor) {
+  cursor.seq = storeReadSeq;
+  cursor.offset = storeReadOffset;
+  cursor.consumed = 0;
+  if (!storeReady) return 0;
+
+  size_t used = 0;
+  while (cursor.seq <= storeLastSeq) {
+    char path[24];
+    storeSegmentPath(cursor.seq, path, sizeof(path));
+    File f = LittleFS.open(path, "r");
+    bool full = false;
+    bool corrupt = false;
+
+    if (f) {
+      f.seek(cursor.offset);
+      uint16_t len;
+      uint32_t crc;
+      while (storeReadHeader(f, len, crc)) {
+        if (used + len > size) {
+          full = true;
+          break;
+        }
+        if (f.read(buffer + used, len) != len || storeCrc32(buffer + used, len) != crc) {
+          logMessage(1, "⚠️  Registro inválido en la cola en flash, saltando segmento");
+          corrupt = true;
+          break;
+        }
+        used += len;
+        cursor.offset += STORE_HEADER_SIZE + len;
+        cursor.consumed += STORE_HEADER_SIZE + len;
+      }
+
+      if (corrupt && cursor.seq == storeLastSeq) {
+        storeLastSeq++;
+        storeWriteOffset = 0;
+      }
+      if (!full && cursor.seq != storeLastSeq && f.size() > cursor.offset) {
+        cursor.consumed += f.size() - cursor.offset;
+      }
+      f.close();
+    }
+
+    if (full || cursor.seq == storeLastSeq) break;
+    cursor.seq++;
+    cursor.offset = 0;
+  }
+  return used;
+}
+
+void modemStoreCommit(const ModemStoreCursor& cursor) {
+  if (!storeReady) return;
+
+  if (cursor.seq < storeFirstSeq) {
+    storeReadSeq = storeFirstSeq;
+    storeReadOffset = 0;
+    storeRecountPending();
+    storeSaveReadPosition();
+    return;
+  }
+
+  while (storeFirstSeq < cursor.seq) {
+    storeRemoveSegment(storeFirstSeq);
+    storeFirstSeq++;
+  }
+  storeReadSeq = cursor.seq;
+  storeReadOffset = cursor.offset;
+  storePendingBytes = storePendingBytes > cursor.consumed ? storePendingBytes - cursor.consumed : 0;
+
+  if (storeReadSeq == storeLastSeq && storeReadOffset >= storeWriteOffset) {
+    if (storeWriteOffset > 0) {
+      storeRemoveSegment(storeLastSeq);
+      storeLastSeq++;
+      storeFirstSeq = storeReadSeq = storeLastSeq;
+      storeReadOffset = storeWriteOffset = 0;
+    }
+    storePendingBytes = 0;
+  }
+
+  storeSaveReadPosition();
+}
+
+size_t modemStorePending() {
+  return storePendingBytes;
+}
+
+uint32_t modemStoreDropped() {
+  return storeDroppedBytes;
+}
+
+void modemStoreClear() {
+  if (!storeReady) return;
+
+  for (uint32_t seq = storeFirstSeq; seq <= storeLastSeq; ++seq) {
+    storeRemoveSegment(seq);
+  }
+  storeLastSeq++;
+  storeFirstSeq = storeReadSeq = storeLastSeq;
+  storeReadOffset = storeWriteOffset = 0;
+  storePendingBytes = 0;
+  storeSaveReadPosition();
+}
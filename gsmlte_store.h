@@ -0,0 +1,111 @@
+/**
+ * @file gsmlte_store.h
+ * @brief Cola persistente en flash (LittleFS) para datos no enviados
+ * @version 3.0
+ *
+ * @details Registro de solo anexado formado por segmentos de hasta
+ * STORE_SEGMENT_SIZE bytes en STORE_DIR. Cada registro lleva un encabezado
+ * con marca, longitud y CRC-32:
+ *
+ *   | 0xA5 | len (2, LE) | crc32 (4, LE) | datos (len) |
+ *
+ * Los segmentos forman un anillo de STORE_MAX_SEGMENTS archivos: al llenarse
+ * se borra el más antiguo. Escribir siempre al final y borrar segmentos
+ * completos reparte el desgaste sobre la partición (LittleFS asigna bloques
+ * nuevos en cada escritura) y evita reescribir un índice por registro. La
+ * posición de lectura se guarda en un archivo pequeño solo al confirmar un
+ * lote, por lo que tras un corte de energía se reenvía a lo sumo el último
+ * lote (entrega al menos una vez).
+ *
+ * Un registro incompleto o con CRC inválido (corte durante la escritura)
+ * marca el fin válido del segmento: el lector salta al siguiente y la
+ * escritura continúa en un segmento nuevo.
+ *
+ * @example
+ * @code
+ * modemStoreBegin();
+ * modemStoreAppend(data, len);
+ *
+ * ModemStoreCursor cursor;
+ * size_t n = modemStoreRead(buffer, sizeof(buffer), cursor);
+ * if (n > 0 && enviar(buffer, n)) {
+ *   modemStoreCommit(cursor);
+ * }
+ * @endcode
+ */
+
+#ifndef GSMLTE_STORE_H
+#define GSMLTE_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define STORE_DIR "/gsmq"
+#define STORE_SEGMENT_SIZE 16384
+#define STORE_MAX_SEGMENTS 16
+#define STORE_RECORD_MAX 1460
+#define STORE_MIN_FREE 8192     ///< Espacio que se deja libre en la partición
+
+/**
+ * @struct ModemStoreCursor
+ * @brief Posición de lectura tras un lote leído con modemStoreRead()
+ */
+struct ModemStoreCursor {
+  uint32_t seq;        ///< Segmento
+  uint32_t offset;     ///< Desplazamiento dentro del segmento
+  uint32_t consumed;   ///< Bytes de flash que libera la confirmación
+};
+
+/**
+ * @brief Monta LittleFS y recupera el estado de la cola
+ * @details Formatea la partición si no puede montarla
+ * @return true si la cola está disponible
+ */
+bool modemStoreBegin();
+
+/**
+ * @brief Indica si la cola fue inicializada con modemStoreBegin()
+ */
+bool modemStoreReady();
+
+/**
+ * @brief Agrega un registro al final de la cola
+ * @param data Datos a guardar
+ * @param len Longitud (1..STORE_RECORD_MAX)
+ * @return false si la cola no está lista o la escritura falló
+ */
+bool modemStoreAppend(const uint8_t* data, size_t len);
+
+/**
+ * @brief Lee registros completos desde la posición de lectura
+ * @details Concatena los registros que caben enteros en el buffer; la
+ * posición no avanza hasta llamar a modemStoreCommit()
+ * @param buffer Destino
+ * @param size Capacidad del buffer (al menos STORE_RECORD_MAX)
+ * @param cursor Posición tras los registros leídos
+ * @return Bytes de datos copiados (0 si no hay registros)
+ */
+size_t modemStoreRead(uint8_t* buffer, size_t size, ModemStoreCursor& cursor);
+
+/**
+ * @brief Confirma un lote: avanza la posición de lectura y borra segmentos consumidos
+ * @param cursor Posición obtenida con modemStoreRead()
+ */
+void modemStoreCommit(const ModemStoreCursor& cursor);
+
+/**
+ * @brief Bytes de flash pendientes de reenvío (incluye encabezados)
+ */
+size_t modemStorePending();
+
+/**
+ * @brief Bytes descartados por falta de espacio desde el arranque
+ */
+uint32_t modemStoreDropped();
+
+/**
+ * @brief Borra todos los registros pendientes
+ */
+void modemStoreClear();
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * @file gsmlte_task.cpp
+ * @brief Implementación de la tarea FreeRTOS dedicada al módem
+ * 
+ * @details La tarea ejecuta las órdenes de modemTaskCommand(), drena la cola
+ * de transmisión hacia tcpSendPersistentAsync(), ejecuta modemPoll() y
+ * publica eventos de envío y de conexión. Los mensajes
+ * se copian por valor en colas FreeRTOS, por lo que productor y consumidor no
+ * comparten memoria. Con GSMLTE_STATIC_ALLOC las colas y la pila de la tarea
+ * son arreglos estáticos (en ESP-IDF la pila se mide en bytes).
+ */
+
+#include "gsmlte_task.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+
+/**
+ * Mensaje de transmisión copiado en la cola de la tarea
+ */
+struct ModemTaskMessage {
+  uint32_t id;
+  uint32_t timeout;
+  uint16_t len;
+  char data[MODEM_TASK_MAX_PAYLOAD + 1];
+};
+
+/**
+ * Orden de la aplicación ejecutada dentro de la tarea
+ */
+struct ModemTaskOrder {
+  ModemTaskCallback fn;
+  void* ctx;
+};
+
+static TaskHandle_t modemTaskHandle = NULL;
+static QueueHandle_t modemTxQueue = NULL;
+static QueueHandle_t modemEventQueue = NULL;
+static QueueHandle_t modemCmdQueue = NULL;
+static bool modemTaskRunSetup = true;
+
+#if GSMLTE_STATIC_ALLOC
+static StaticQueue_t modemTxQueueState;
+static StaticQueue_t modemEventQueueState;
+static StaticQueue_t modemCmdQueueState;
+static uint8_t modemTxQueueStorage[MODEM_TASK_TX_QUEUE_LEN * sizeof(ModemTaskMessage)];
+static uint8_t modemEventQueueStorage[MODEM_TASK_EVENT_QUEUE_LEN * sizeof(ModemTaskEvent)];
+static uint8_t modemCmdQueueStorage[MODEM_TASK_CMD_QUEUE_LEN * sizeof(ModemTaskOrder)];
+static StaticTask_t modemTaskState;
+static StackType_t modemTaskStack[MODEM_TASK_STACK];
+#endif
+
+/**
+ * Publica un evento hacia la aplicación sin bloquear la tarea
+ */
+static void modemTaskPostEvent(ModemTaskEventType type, uint32_t id, bool success) {
+  ModemTaskEvent event;
+  event.type = type;
+  event.id = id;
+  event.success = success;
+
+  if (xQueueSend(modemEventQueue, &event, 0) != pdTRUE) {
+    logMessage(1, "⚠️  Cola de eventos del módem llena, evento descartado");
+  }
+}
+
+/**
+ * Callback de finalización de envío ejecutado dentro de la tarea
+ */
+static void modemTaskSendDone(bool success, void* ctx) {
+  modemTaskPostEvent(MODEM_EVENT_SEND_DONE, (uint32_t)(uintptr_t)ctx, success);
+}
+
+/**
+ * Bucle principal de la tarea del módem
+ */
+static void modemTaskMain(void* arg) {
+  if (modemTaskRunSetup) {
+    setupModemAsync();
+  }
+
+  bool wasStarting = true;
+  bool wasConnected = false;
+  ModemTaskMessage msg;
+  ModemTaskOrder order;
+
+  for (;;) {
+    while (xQueueReceive(modemCmdQueue, &order, 0) == pdTRUE) {
+      order.fn(order.ctx);
+    }
+
+    while (xQueuePeek(modemTxQueue, &msg, 0) == pdTRUE) {
+      if (!tcpSendPersistentAsync(msg.data, msg.len, msg.timeout,
+                                  modemTaskSendDone, (void*)(uintptr_t)msg.id)) {
+        break;
+      }
+      xQueueReceive(modemTxQueue, &msg, 0);
+    }
+
+    modemPoll();
+
+    bool starting = modemIsStarting();
+    if (wasStarting && !starting) {
+      modemTaskPostEvent(MODEM_EVENT_READY, 0, modemGetState() == MODEM_STATE_READY);
+    }
+    wasStarting = starting;
+
+    if (tcpConnected != wasConnected) {
+      modemTaskPostEvent(tcpConnected ? MODEM_EVENT_TCP_UP : MODEM_EVENT_TCP_DOWN, 0, tcpConnected);
+      wasConnected = tcpConnected;
+    }
+
+    vTaskDelay(1);
+  }
+}
+
+bool modemTaskStart(bool runSetup, int core) {
+  if (modemTaskHandle != NULL) return true;
+
+#if GSMLTE_STATIC_ALLOC
+  modemTxQueue = xQueueCreateStatic(MODEM_TASK_TX_QUEUE_LEN, sizeof(ModemTaskMessage),
+                                    modemTxQueueStorage, &modemTxQueueState);
+  modemEventQueue = xQueueCreateStatic(MODEM_TASK_EVENT_QUEUE_LEN, sizeof(ModemTaskEvent),
+                                       modemEventQueueStorage, &modemEventQueueState);
+  modemCmdQueue = xQueueCreateStatic(MODEM_TASK_CMD_QUEUE_LEN, sizeof(ModemTaskOrder),
+                                     modemCmdQueueStorage, &modemCmdQueueState);
+#else
+  modemTxQueue = xQueueCreate(MODEM_TASK_TX_QUEUE_LEN, sizeof(ModemTaskMessage));
+  modemEventQueue = xQueueCreate(MODEM_TASK_EVENT_QUEUE_LEN, sizeof(ModemTaskEvent));
+  modemCmdQueue = xQueueCreate(MODEM_TASK_CMD_QUEUE_LEN, sizeof(ModemTaskOrder));
+#endif
+  if (modemTxQueue == NULL || modemEventQueue == NULL || modemCmdQueue == NULL) {
+    logMessage(0, "❌ No se pudieron crear las colas de la tarea del módem");
+    return false;
+  }
+
+  modemTaskRunSetup = runSetup;
+
+#if GSMLTE_STATIC_ALLOC
+  modemTaskHandle = xTaskCreateStaticPinnedToCore(modemTaskMain, "gsmlte", MODEM_TASK_STACK, NULL,
+                                                  MODEM_TASK_PRIORITY, modemTaskStack,
+                                                  &modemTaskState, core);
+  if (modemTaskHandle == NULL) {
+#else
+  if (xTaskCreatePinnedToCore(modemTaskMain, "gsmlte", MODEM_TASK_STACK, NULL,
+                              MODEM_TASK_PRIORITY, &modemTaskHandle, core) != pdPASS) {
+#endif
+    logMessage(0, "❌ No se pudo crear la tarea del módem");
+    modemTaskHandle = NULL;
+    return false;
+  }
+
+  logMessagef(2, "🧵 Tarea del módem iniciada en core %d", core);
+  return true;
+}
+
+bool modemTaskIsRunning() {
+  return modemTaskHandle != NULL;
+}
+
+bool modemTaskSend(const char* data, size_t len, uint32_t timeout_ms, uint32_t id) {
+  if (modemTxQueue == NULL || len > MODEM_TASK_MAX_PAYLOAD) return false;
+
+  ModemTaskMessage msg;
+  msg.id = id;
+  msg.timeout = timeout_ms;
+  msg.len = len;
+  memcpy(msg.data, data, len);
+  msg.data[len] = '\0';
+
+  return xQueueSend(modemTxQueue, &msg, 0) == pdTRUE;
+}
+
+#if !GSMLTE_STATIC_ALLOC
+bool modemTaskSend(const String& datos, uint32_t timeout_ms, uint32_t id) {
+  return modemTaskSend(datos.c_str(), datos.length(), timeout_ms, id);
+}
+#endif
+
+bool modemTaskCommand(ModemTaskCallback fn, void* ctx) {
+  if (modemCmdQueue == NULL || fn == NULL) return false;
+
+  ModemTaskOrder order;
+  order.fn = fn;
+  order.ctx = ctx;
+  return xQueueSend(modemCmdQueue, &order, 0) == pdTRUE;
+}
+
+bool modemTaskGetEvent(ModemTaskEvent& event, uint32_t waitMs) {
+  if (modemEventQueue == NULL) return false;
+  return xQueueReceive(modemEventQueue, &event, pdMS_TO_TICKS(waitMs)) == pdTRUE;
+}
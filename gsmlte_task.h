@@ -0,0 +1,126 @@
+/**
+ * @file gsmlte_task.h
+ * @brief Modo opcional con tarea FreeRTOS dedicada al módem SIM7080G
+ * @version 3.0
+ * 
+ * @details En este modo una tarea fijada a un núcleo (core 0 por defecto)
+ * es dueña de SerialAT y del objeto TinyGsm y ejecuta modemPoll() de forma
+ * continua. La aplicación entrega datos mediante una cola FreeRTOS y recibe
+ * las finalizaciones de envío y cambios de conexión como eventos, de modo
+ * que la latencia de la aplicación no depende de la latencia del módem.
+ * 
+ * @warning Con la tarea activa, solo las funciones modemTask*() son seguras
+ * desde otras tareas; el resto de la API de gsmlte.h pertenece a la tarea.
+ * Para usarla (diagnóstico, reinicio, consultas) se entrega una función con
+ * modemTaskCommand(), que la tarea ejecuta entre dos modemPoll().
+ * 
+ * @example
+ * @code
+ * void setup() {
+ *   modemTaskStart(true);
+ * }
+ * 
+ * void loop() {
+ *   ModemTaskEvent ev;
+ *   while (modemTaskGetEvent(ev, 0)) {
+ *     if (ev.type == MODEM_EVENT_SEND_DONE) Serial.println(ev.success);
+ *   }
+ *   modemTaskSend("datos", 5000, 1);
+ * }
+ * @endcode
+ */
+
+#ifndef GSMLTE_TASK_H
+#define GSMLTE_TASK_H
+
+#include "gsmlte.h"
+
+#define MODEM_TASK_CORE 0
+#define MODEM_TASK_STACK 8192
+#define MODEM_TASK_PRIORITY 3
+#define MODEM_TASK_TX_QUEUE_LEN 8
+#define MODEM_TASK_EVENT_QUEUE_LEN 16
+#define MODEM_TASK_CMD_QUEUE_LEN 4
+#define MODEM_TASK_MAX_PAYLOAD 256
+
+/**
+ * @enum ModemTaskEventType
+ * @brief Tipos de evento publicados por la tarea del módem
+ */
+enum ModemTaskEventType {
+  MODEM_EVENT_READY,        ///< Arranque del módem finalizado
+  MODEM_EVENT_TCP_UP,       ///< Conexión TCP persistente establecida
+  MODEM_EVENT_TCP_DOWN,     ///< Conexión TCP persistente perdida
+  MODEM_EVENT_SEND_DONE     ///< Envío finalizado (ver success)
+};
+
+/**
+ * @struct ModemTaskEvent
+ * @brief Evento entregado a la aplicación por la tarea del módem
+ */
+struct ModemTaskEvent {
+  ModemTaskEventType type;
+  uint32_t id;
+  bool success;
+};
+
+/**
+ * @brief Función ejecutada dentro de la tarea del módem
+ */
+typedef void (*ModemTaskCallback)(void* ctx);
+
+/**
+ * @brief Crea la tarea del módem fijada a un núcleo
+ * @param runSetup true para ejecutar setupModemAsync() dentro de la tarea
+ * @param core Núcleo donde fijar la tarea
+ * @return true si la tarea quedó en ejecución
+ */
+bool modemTaskStart(bool runSetup, int core = MODEM_TASK_CORE);
+
+/**
+ * @brief Indica si la tarea del módem está en ejecución
+ * @return true si el modo tarea está activo
+ */
+bool modemTaskIsRunning();
+
+/**
+ * @brief Entrega datos a la tarea del módem para envío por TCP persistente
+ * @param data Datos a enviar
+ * @param len Longitud en bytes (máximo MODEM_TASK_MAX_PAYLOAD)
+ * @param timeout_ms Timeout del envío en milisegundos
+ * @param id Identificador devuelto en el evento MODEM_EVENT_SEND_DONE
+ * @return true si los datos fueron encolados, false si la cola está llena
+ */
+bool modemTaskSend(const char* data, size_t len, uint32_t timeout_ms, uint32_t id);
+
+/**
+ * @brief Entrega un String a la tarea del módem para envío por TCP persistente
+ * @param datos Datos a enviar
+ * @param timeout_ms Timeout del envío en milisegundos
+ * @param id Identificador devuelto en el evento MODEM_EVENT_SEND_DONE
+ * @return true si los datos fueron encolados
+ */
+#if !GSMLTE_STATIC_ALLOC
+bool modemTaskSend(const String& datos, uint32_t timeout_ms, uint32_t id);
+#endif
+
+/**
+ * @brief Ejecuta una función en la tarea del módem
+ * @details La función corre en el contexto de la tarea, antes del siguiente
+ * modemPoll(), y puede usar toda la API de gsmlte.h. Una función bloqueante
+ * (p. ej. diagnosticoModem()) detiene la tarea mientras dura.
+ * @param fn Función a ejecutar
+ * @param ctx Contexto entregado a la función
+ * @return true si se encoló, false si la cola de órdenes está llena
+ */
+bool modemTaskCommand(ModemTaskCallback fn, void* ctx);
+
+/**
+ * @brief Obtiene el siguiente evento publicado por la tarea del módem
+ * @param event Evento recibido
+ * @param waitMs Tiempo máximo de espera en milisegundos (0 = no bloquear)
+ * @return true si se obtuvo un evento
+ */
+bool modemTaskGetEvent(ModemTaskEvent& event, uint32_t waitMs);
+
+#endif
@@ -0,0 +1,513 @@
+/**
+ * @file gsmlte_transport.cpp
+ * @brief Implementación del transporte con respaldo celular/WiFi
+ *
+ * @details Los mensajes ocupan tramos contiguos de trBuffer en orden de
+ * llegada; si un mensaje no cabe al final se ubica al inicio. Los tramos se
+ * liberan desde el más antiguo cuando termina (las finalizaciones pueden
+ * llegar fuera de orden entre backends). El backend WiFi mantiene un solo
+ * mensaje en curso y escribe con send() no bloqueante.
+ */
+
+#include "gsmlte_transport.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+
+enum TransportMessageState {
+  TR_MSG_QUEUED,
+  TR_MSG_SENDING,
+  TR_MSG_DONE
+};
+
+/**
+ * Mensaje encolado; los datos (con CRLF) están en trBuffer
+ */
+struct TransportMessage {
+  uint16_t offset;
+  uint16_t len;
+  uint32_t timeout;
+  unsigned long queuedAt;
+  unsigned long sentAt;
+  TcpSendCallback callback;
+  void* ctx;
+  uint8_t state;
+  uint8_t backend;
+  uint8_t attempts;
+  uint8_t triedMask;
+};
+
+enum WifiPhase {
+  WIFI_PHASE_OFF,
+  WIFI_PHASE_WAIT_LINK,
+  WIFI_PHASE_CONNECTING,
+  WIFI_PHASE_READY
+};
+
+static uint8_t trBuffer[TRANSPORT_BUFFER_SIZE];
+static TransportMessage trQueue[TRANSPORT_QUEUE_SIZE];
+static uint8_t trHead = 0;
+static uint8_t trCount = 0;
+static size_t trWritePos = 0;
+
+static bool trUsed = false;
+static TransportKind trActiveKind = TRANSPORT_NONE;
+static uint32_t trRttMs[2] = {0, 0};
+static uint8_t trCellInflight = 0;
+static TcpReceiveCallback trRxCallback = NULL;
+static void* trRxCallbackCtx = NULL;
+
+static WifiPhase wifiPhase = WIFI_PHASE_OFF;
+static char wifiHost[MODEM_HOST_MAX];
+static uint16_t wifiPort = 0;
+static IPAddress wifiAddress;
+static bool wifiResolved = false;
+static int wifiFd = -1;
+static unsigned long wifiTimer = 0;
+static unsigned long wifiRetryAt = 0;
+static TransportMessage* wifiCurrent = NULL;
+static size_t wifiSent = 0;
+
+static const char* trKindName(TransportKind kind) {
+  return kind == TRANSPORT_WIFI ? "WiFi" : (kind == TRANSPORT_CELLULAR ? "celular" : "ninguno");
+}
+
+/**
+ * Incorpora una muestra al RTT suavizado (promedio móvil 1/8)
+ */
+static void trRttSample(TransportKind kind, unsigned long sampleMs) {
+  if (sampleMs == 0) sampleMs = 1;
+  uint32_t& rtt = trRttMs[kind];
+  rtt = (rtt == 0) ? sampleMs : (7 * rtt + sampleMs) / 8;
+}
+
+/**
+ * Reserva un tramo contiguo del buffer
+ * @return Desplazamiento, o -1 si no hay lugar
+ */
+static int trAllocate(size_t len) {
+  if (trCount == 0) {
+    trWritePos = 0;
+    return len <= TRANSPORT_BUFFER_SIZE ? 0 : -1;
+  }
+
+  size_t oldest = trQueue[trHead].offset;
+  size_t start;
+  if (trWritePos >= oldest) {
+    if (trWritePos + len <= TRANSPORT_BUFFER_SIZE) {
+      start = trWritePos;
+    } else if (len < oldest) {
+      start = 0;
+    } else {
+      return -1;
+    }
+  } else if (trWritePos + len < oldest) {
+    start = trWritePos;
+  } else {
+    return -1;
+  }
+  return (int)start;
+}
+
+/**
+ * Informa los bytes ocupados del buffer
+ */
+static void trMemNote() {
+  size_t used = 0;
+  for (uint8_t i = 0; i < trCount; ++i) used += trQueue[(trHead + i) % TRANSPORT_QUEUE_SIZE].len;
+  memNote(MEM_POOL_TRANSPORT, used, sizeof(trBuffer));
+}
+
+/**
+ * Finaliza un mensaje e invoca su callback
+ */
+static void trComplete(TransportMessage* m, bool success) {
+  m->state = TR_MSG_DONE;
+  if (!success) {
+    logMessagef(0, "❌ Mensaje no entregado por ningún transporte (%u bytes)", (unsigned)m->len);
+    tcpOfflineStore(trBuffer + m->offset, m->len);
+  }
+  if (m->callback != NULL) m->callback(success, m->ctx);
+}
+
+/**
+ * Resultado de un intento de envío por un backend
+ * @details Un intento fallido devuelve el mensaje a la cola sin tocar sus
+ * datos; el despacho decide si sale por otro backend o se da por perdido
+ */
+static void trAttemptFinished(TransportMessage* m, TransportKind kind, bool success) {
+  if (success) {
+    trComplete(m, true);
+    return;
+  }
+
+  m->attempts++;
+  m->triedMask |= 1 << kind;
+  m->state = TR_MSG_QUEUED;
+  logMessagef(1, "⚠️  Envío por %s falló, mensaje reencolado (intento %u)",
+              trKindName(kind), (unsigned)m->attempts);
+}
+
+/**
+ * Callback de la cola celular
+ */
+static void trCellDone(bool success, void* ctx) {
+  TransportMessage* m = static_cast<TransportMessage*>(ctx);
+  if (trCellInflight > 0) trCellInflight--;
+  if (success) trRttSample(TRANSPORT_CELLULAR, millis() - m->sentAt);
+  trAttemptFinished(m, TRANSPORT_CELLULAR, success);
+}
+
+/**
+ * Callback de datos recibidos por celular hacia el callback del transporte
+ */
+static void trCellReceive(const uint8_t* data, size_t len, void* ctx) {
+  if (trRxCallback != NULL) trRxCallback(data, len, trRxCallbackCtx);
+}
+
+/**
+ * Cierra el socket WiFi y devuelve el mensaje en curso a la cola
+ */
+static void wifiClose(const char* reason) {
+  if (wifiFd >= 0) {
+    close(wifiFd);
+    wifiFd = -1;
+    logMessagef(1, "⚠️  Conexión TCP por WiFi cerrada: %s", reason);
+  }
+  wifiPhase = WIFI_PHASE_WAIT_LINK;
+  wifiRetryAt = millis() + WIFI_RETRY_INTERVAL;
+
+  if (wifiCurrent != NULL) {
+    TransportMessage* m = wifiCurrent;
+    wifiCurrent = NULL;
+    trAttemptFinished(m, TRANSPORT_WIFI, false);
+  }
+}
+
+/**
+ * Inicia la conexión TCP no bloqueante hacia el servidor
+ */
+static void wifiStartConnect() {
+  if (!wifiResolved) {
+    if (WiFi.hostByName(wifiHost, wifiAddress) != 1) {
+      logMessagef(1, "⚠️  WiFi: no se pudo resolver %s", wifiHost);
+      wifiRetryAt = millis() + WIFI_RETRY_INTERVAL;
+      return;
+    }
+    wifiResolved = true;
+  }
+
+  wifiFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (wifiFd < 0) {
+    wifiRetryAt = millis() + WIFI_RETRY_INTERVAL;
+    return;
+  }
+  fcntl(wifiFd, F_SETFL, fcntl(wifiFd, F_GETFL, 0) | O_NONBLOCK);
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(wifiPort);
+  addr.sin_addr.s_addr = (uint32_t)wifiAddress;
+
+  wifiTimer = millis();
+  if (connect(wifiFd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+    wifiPhase = WIFI_PHASE_READY;
+    trRttSample(TRANSPORT_WIFI, millis() - wifiTimer);
+  } else if (errno == EINPROGRESS) {
+    wifiPhase = WIFI_PHASE_CONNECTING;
+  } else {
+    wifiClose("connect");
+  }
+}
+
+/**
+ * Comprueba si el handshake TCP terminó
+ */
+static void wifiCheckConnect() {
+  fd_set writeSet;
+  FD_ZERO(&writeSet);
+  FD_SET(wifiFd, &writeSet);
+  struct timeval zero = {0, 0};
+
+  if (select(wifiFd + 1, NULL, &writeSet, NULL, &zero) > 0) {
+    int error = 0;
+    socklen_t errorLen = sizeof(error);
+    getsockopt(wifiFd, SOL_SOCKET, SO_ERROR, &error, &errorLen);
+    if (error != 0) {
+      wifiClose("handshake");
+      return;
+    }
+
+    unsigned long rtt = millis() - wifiTimer;
+    trRttSample(TRANSPORT_WIFI, rtt);
+    wifiPhase = WIFI_PHASE_READY;
+    logMessagef(2, "📶 Conexión TCP por WiFi establecida (handshake %lums)", rtt);
+    return;
+  }
+
+  if (millis() - wifiTimer >= WIFI_CONNECT_TIMEOUT) {
+    wifiClose("timeout");
+  }
+}
+
+/**
+ * Lee datos recibidos y escribe el mensaje en curso sin bloquear
+ */
+static void wifiService() {
+  uint8_t buffer[256];
+  int n;
+  while ((n = recv(wifiFd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0) {
+    if (trRxCallback != NULL) trRxCallback(buffer, n, trRxCallbackCtx);
+  }
+  if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+    wifiClose(n == 0 ? "cerrada por el servidor" : "recv");
+    return;
+  }
+
+  if (wifiCurrent == NULL) return;
+  TransportMessage* m = wifiCurrent;
+
+  n = send(wifiFd, trBuffer + m->offset + wifiSent, m->len - wifiSent, MSG_DONTWAIT);
+  if (n > 0) {
+    wifiSent += n;
+    if (wifiSent == m->len) {
+      wifiCurrent = NULL;
+      trAttemptFinished(m, TRANSPORT_WIFI, true);
+    }
+    return;
+  }
+
+  if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    wifiClose("send");
+  } else if (millis() - m->sentAt >= m->timeout) {
+    wifiClose("timeout de envío");
+  }
+}
+
+/**
+ * Avanza la máquina de estados del backend WiFi
+ */
+static void wifiPoll() {
+  if (wifiPhase == WIFI_PHASE_OFF) return;
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (wifiFd >= 0) wifiClose("red WiFi perdida");
+    wifiResolved = false;
+    return;
+  }
+
+  switch (wifiPhase) {
+    case WIFI_PHASE_WAIT_LINK:
+      if ((long)(millis() - wifiRetryAt) >= 0) wifiStartConnect();
+      break;
+    case WIFI_PHASE_CONNECTING:
+      wifiCheckConnect();
+      break;
+    case WIFI_PHASE_READY:
+      wifiService();
+      break;
+    default:
+      break;
+  }
+}
+
+bool transportAvailable(TransportKind kind) {
+  if (kind == TRANSPORT_WIFI) return wifiPhase == WIFI_PHASE_READY;
+  if (kind == TRANSPORT_CELLULAR) return modemInitialized && !modemIsStarting() && tcpConnected;
+  return false;
+}
+
+/**
+ * Elige el backend para mensajes nuevos según disponibilidad y RTT
+ */
+static void trUpdateActive() {
+  bool cell = transportAvailable(TRANSPORT_CELLULAR);
+  bool wifi = transportAvailable(TRANSPORT_WIFI);
+  TransportKind next;
+
+  if (!cell && !wifi) {
+    next = TRANSPORT_NONE;
+  } else if (!wifi) {
+    next = TRANSPORT_CELLULAR;
+  } else if (!cell) {
+    next = TRANSPORT_WIFI;
+  } else {
+    uint32_t cellRtt = trRttMs[TRANSPORT_CELLULAR] != 0 ? trRttMs[TRANSPORT_CELLULAR]
+                                                        : TRANSPORT_CELL_RTT_DEFAULT;
+    uint32_t wifiRtt = trRttMs[TRANSPORT_WIFI];
+    uint32_t margin = 100 + TRANSPORT_SWITCH_MARGIN_PCT;
+
+    if (trActiveKind == TRANSPORT_CELLULAR) {
+      next = wifiRtt * margin < cellRtt * 100 ? TRANSPORT_WIFI : TRANSPORT_CELLULAR;
+    } else if (trActiveKind == TRANSPORT_WIFI) {
+      next = cellRtt * margin < wifiRtt * 100 ? TRANSPORT_CELLULAR : TRANSPORT_WIFI;
+    } else {
+      next = wifiRtt <= cellRtt ? TRANSPORT_WIFI : TRANSPORT_CELLULAR;
+    }
+  }
+
+  if (next != trActiveKind) {
+    logMessagef(2, "🔀 Transporte activo: %s (rtt celular %lums, WiFi %lums)", trKindName(next),
+                (unsigned long)trRttMs[TRANSPORT_CELLULAR], (unsigned long)trRttMs[TRANSPORT_WIFI]);
+    trActiveKind = next;
+  }
+}
+
+/**
+ * Elige el backend para un mensaje; tras una falla prefiere el que no lo intentó
+ */
+static TransportKind trRouteFor(const TransportMessage& m) {
+  if (trActiveKind != TRANSPORT_NONE) {
+    if (!(m.triedMask & (1 << trActiveKind))) return trActiveKind;
+
+    TransportKind other = trActiveKind == TRANSPORT_WIFI ? TRANSPORT_CELLULAR : TRANSPORT_WIFI;
+    if (transportAvailable(other) && !(m.triedMask & (1 << other))) return other;
+    return m.attempts < TRANSPORT_MAX_ATTEMPTS ? trActiveKind : TRANSPORT_NONE;
+  }
+
+  // Sin backend conectado: la cola celular reconecta por su cuenta
+  if (modemInitialized && !modemIsStarting() && m.attempts == 0) return TRANSPORT_CELLULAR;
+  return TRANSPORT_NONE;
+}
+
+/**
+ * Entrega los mensajes encolados a los backends libres
+ */
+static void trDispatch() {
+  unsigned long now = millis();
+
+  for (uint8_t i = 0; i < trCount; ++i) {
+    TransportMessage* m = &trQueue[(trHead + i) % TRANSPORT_QUEUE_SIZE];
+    if (m->state != TR_MSG_QUEUED) continue;
+
+    TransportKind route = trRouteFor(*m);
+    if (route == TRANSPORT_NONE) {
+      if (m->attempts >= TRANSPORT_MAX_ATTEMPTS ||
+          now - m->queuedAt >= (unsigned long)m->timeout * TRANSPORT_MAX_ATTEMPTS) {
+        trComplete(m, false);
+      }
+      continue;
+    }
+
+    if (route == TRANSPORT_WIFI) {
+      if (wifiCurrent != NULL) continue;
+      wifiCurrent = m;
+      wifiSent = 0;
+    } else {
+      if (trCellInflight >= TRANSPORT_CELL_INFLIGHT) continue;
+      if (!tcpSocketSendAsync(0, (const char*)trBuffer + m->offset, m->len - 2, m->timeout,
+                              trCellDone, m)) {
+        continue;
+      }
+      trCellInflight++;
+    }
+
+    m->state = TR_MSG_SENDING;
+    m->backend = route;
+    m->sentAt = now;
+  }
+}
+
+/**
+ * Libera los mensajes terminados más antiguos
+ */
+static void trRelease() {
+  if (trCount == 0 || trQueue[trHead].state != TR_MSG_DONE) return;
+
+  while (trCount > 0 && trQueue[trHead].state == TR_MSG_DONE) {
+    trHead = (trHead + 1) % TRANSPORT_QUEUE_SIZE;
+    trCount--;
+  }
+  trMemNote();
+}
+
+void transportWifiBegin(const char* ssid, const char* password, const char* host, const char* port) {
+  strncpy(wifiHost, host, sizeof(wifiHost) - 1);
+  wifiHost[sizeof(wifiHost) - 1] = '\0';
+  wifiPort = (uint16_t)atoi(port);
+  wifiResolved = false;
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(ssid, password);
+
+  wifiPhase = WIFI_PHASE_WAIT_LINK;
+  wifiRetryAt = millis();
+  trUsed = true;
+  logMessagef(2, "📶 Backend WiFi activado (%s, servidor %s:%s)", ssid, host, port);
+}
+
+bool transportSendAsync(const char* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx) {
+  size_t framedLen = len + 2;
+  if (framedLen > TCP_CASEND_MAX) {
+    logMessagef(0, "❌ Datos TCP demasiado largos (%u bytes)", (unsigned)len);
+    return false;
+  }
+
+  int offset = trCount < TRANSPORT_QUEUE_SIZE ? trAllocate(framedLen) : -1;
+  if (offset < 0) {
+    logMessage(1, "⚠️  Cola de transporte llena, descartando datos");
+    return false;
+  }
+
+  memcpy(trBuffer + offset, data, len);
+  memcpy(trBuffer + offset + len, "\r\n", 2);
+  trWritePos = offset + framedLen;
+
+  trUsed = true;
+  TransportMessage& m = trQueue[(trHead + trCount) % TRANSPORT_QUEUE_SIZE];
+  m.offset = offset;
+  m.len = framedLen;
+  m.timeout = timeout_ms;
+  m.queuedAt = millis();
+  m.sentAt = 0;
+  m.callback = callback;
+  m.ctx = ctx;
+  m.state = TR_MSG_QUEUED;
+  m.backend = TRANSPORT_NONE;
+  m.attempts = 0;
+  m.triedMask = 0;
+  trCount++;
+  trMemNote();
+  return true;
+}
+
+void transportPoll() {
+  if (!trUsed) return;
+
+  wifiPoll();
+  trUpdateActive();
+  if (trCount == 0) return;
+
+  trDispatch();
+  trRelease();
+}
+
+unsigned long transportPollTimeout() {
+  // El socket WiFi no genera eventos propios: se sondea mientras se use
+  if (!trUsed || (wifiPhase == WIFI_PHASE_OFF && trCount == 0)) return ULONG_MAX;
+  return TRANSPORT_POLL_INTERVAL;
+}
+
+TransportKind transportActive() {
+  return trActiveKind;
+}
+
+uint32_t transportRtt(TransportKind kind) {
+  return kind < TRANSPORT_NONE ? trRttMs[kind] : 0;
+}
+
+uint8_t transportPending() {
+  return trCount;
+}
+
+void transportSetReceiveCallback(TcpReceiveCallback callback, void* ctx) {
+  trRxCallbackCtx = ctx;
+  trRxCallback = callback;
+  tcpSetReceiveCallback(callback != NULL ? trCellReceive : NULL, NULL);
+}
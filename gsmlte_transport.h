@@ -0,0 +1,115 @@
+/**
+ * @file gsmlte_transport.h
+ * @brief Transporte único con respaldo celular (SIM7080G) y WiFi (ESP32)
+ * @version 3.0
+ *
+ * @details Los mensajes se encolan una sola vez, ya terminados en CRLF, en
+ * un buffer fijo de TRANSPORT_BUFFER_SIZE bytes. En cada modemPoll() se
+ * entregan al backend elegido:
+ *
+ * - Celular: conexión persistente (socket 0) de gsmlte.h.
+ * - WiFi: socket TCP no bloqueante de lwIP hacia el mismo servidor.
+ *
+ * La ruta se elige por disponibilidad y RTT suavizado de cada backend (en
+ * celular, tiempo hasta "SEND OK"; en WiFi, duración del handshake TCP). Hay
+ * histéresis de TRANSPORT_SWITCH_MARGIN_PCT para no oscilar. Si un envío
+ * falla, el mensaje vuelve a la cola con los mismos bytes y sale por el otro
+ * backend; solo se reporta la falla cuando ningún backend pudo entregarlo.
+ * En ese caso se guarda en la cola en flash si tcpOfflineBegin() está activo.
+ *
+ * @warning No usar junto con la tarea del módem (gsmlte_task.h).
+ *
+ * @example
+ * @code
+ * transportWifiBegin("mi_red", "clave", DB_SERVER_IP, TCP_PORT);
+ * transportSendAsync("datos", 5, 10000, onSent, NULL);
+ * @endcode
+ */
+
+#ifndef GSMLTE_TRANSPORT_H
+#define GSMLTE_TRANSPORT_H
+
+#include "gsmlte.h"
+
+#define TRANSPORT_BUFFER_SIZE 4096
+#define TRANSPORT_QUEUE_SIZE 16
+#define TRANSPORT_MAX_ATTEMPTS 3
+#define TRANSPORT_CELL_INFLIGHT 2          ///< Mensajes entregados a la cola celular a la vez
+#define TRANSPORT_SWITCH_MARGIN_PCT 25
+#define TRANSPORT_CELL_RTT_DEFAULT 1000    ///< RTT supuesto (ms) antes de medir celular
+#define WIFI_CONNECT_TIMEOUT 5000
+#define WIFI_RETRY_INTERVAL 10000
+#define TRANSPORT_POLL_INTERVAL 20         ///< Sondeo del socket WiFi y de la cola (ms)
+
+/**
+ * @enum TransportKind
+ * @brief Backends de transporte
+ */
+enum TransportKind {
+  TRANSPORT_CELLULAR = 0,
+  TRANSPORT_WIFI = 1,
+  TRANSPORT_NONE = 2
+};
+
+/**
+ * @brief Activa el backend WiFi
+ * @details Inicia la asociación en modo estación sin bloquear; la conexión
+ * TCP se abre en modemPoll() cuando la red está disponible. La resolución
+ * del nombre del servidor usa WiFi.hostByName() una vez por asociación.
+ * @param ssid Red WiFi
+ * @param password Clave
+ * @param host Servidor (IP o nombre)
+ * @param port Puerto
+ */
+void transportWifiBegin(const char* ssid, const char* password, const char* host, const char* port);
+
+/**
+ * @brief Encola un mensaje para el mejor backend disponible
+ * @param data Datos (se copian y se les agrega CRLF)
+ * @param len Longitud (máximo TCP_CASEND_MAX-2)
+ * @param timeout_ms Timeout de cada intento y de la espera sin backend disponible
+ * @param callback Función invocada al entregar o agotar los intentos (puede ser NULL)
+ * @param ctx Contexto de usuario para el callback
+ * @return false si la cola está llena o el mensaje es demasiado largo
+ */
+bool transportSendAsync(const char* data, size_t len, uint32_t timeout_ms,
+                        TcpSendCallback callback, void* ctx);
+
+/**
+ * @brief Avanza el backend WiFi y entrega mensajes encolados
+ * @note Se llama desde modemPoll()
+ */
+void transportPoll();
+
+/**
+ * @brief Milisegundos hasta el próximo sondeo del backend WiFi
+ * @return ULONG_MAX si el transporte no se usa
+ */
+unsigned long transportPollTimeout();
+
+/**
+ * @brief Backend por el que salen los mensajes nuevos
+ */
+TransportKind transportActive();
+
+/**
+ * @brief Indica si un backend puede enviar ahora
+ */
+bool transportAvailable(TransportKind kind);
+
+/**
+ * @brief RTT suavizado de un backend en milisegundos (0 si no hay muestras)
+ */
+uint32_t transportRtt(TransportKind kind);
+
+/**
+ * @brief Mensajes en cola (incluye los entregados a un backend sin confirmar)
+ */
+uint8_t transportPending();
+
+/**
+ * @brief Registra el callback de datos recibidos por cualquiera de los backends
+ */
+void transportSetReceiveCallback(TcpReceiveCallback callback, void* ctx);
+
+#endif
@@ -0,0 +1,117 @@
+/**
+ * @file gsmlte_urc.cpp
+ * @brief Implementación del despachador URC con tabla de prefijos
+ * 
+ * @details La clave de cada línea es su prefijo hasta ':' (o la línea completa
+ * si no tiene ':'), limitado a URC_MAX_PREFIX caracteres. La tabla usa hash
+ * FNV-1a con sondeo lineal sobre un arreglo estático.
+ */
+
+#include "gsmlte_urc.h"
+#include <string.h>
+
+/**
+ * Entrada de la tabla de handlers
+ */
+struct UrcEntry {
+  const char* prefix;
+  uint8_t prefixLen;
+  UrcHandler handler;
+  void* ctx;
+};
+
+static UrcEntry urcTable[URC_TABLE_SIZE];
+static bool urcSolicited = false;
+
+/**
+ * Calcula el hash FNV-1a de un prefijo
+ */
+static uint32_t urcHash(const char* text, size_t len) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)text[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * Obtiene la longitud del prefijo de una línea (hasta ':')
+ */
+static size_t urcPrefixLength(const char* line, size_t len) {
+  size_t limit = (len < URC_MAX_PREFIX) ? len : URC_MAX_PREFIX;
+  for (size_t i = 0; i < limit; ++i) {
+    if (line[i] == ':') return i;
+  }
+  return limit;
+}
+
+/**
+ * Busca la entrada de un prefijo
+ * @return Entrada encontrada o NULL
+ */
+static UrcEntry* urcFind(const char* prefix, size_t len) {
+  uint32_t slot = urcHash(prefix, len) % URC_TABLE_SIZE;
+
+  for (size_t probe = 0; probe < URC_TABLE_SIZE; ++probe) {
+    UrcEntry& entry = urcTable[(slot + probe) % URC_TABLE_SIZE];
+    if (entry.prefix == NULL) return NULL;
+    if (entry.prefixLen == len && memcmp(entry.prefix, prefix, len) == 0) return &entry;
+  }
+
+  return NULL;
+}
+
+bool urcRegisterHandler(const char* prefix, UrcHandler handler, void* ctx) {
+  size_t len = strlen(prefix);
+  if (len == 0 || len > URC_MAX_PREFIX) return false;
+
+  UrcEntry* existing = urcFind(prefix, len);
+  if (existing != NULL) {
+    existing->handler = handler;
+    existing->ctx = ctx;
+    return true;
+  }
+
+  uint32_t slot = urcHash(prefix, len) % URC_TABLE_SIZE;
+  for (size_t probe = 0; probe < URC_TABLE_SIZE; ++probe) {
+    UrcEntry& entry = urcTable[(slot + probe) % URC_TABLE_SIZE];
+    if (entry.prefix == NULL) {
+      entry.prefix = prefix;
+      entry.prefixLen = len;
+      entry.handler = handler;
+      entry.ctx = ctx;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool urcDispatchLine(const char* line, size_t len, const char* activeCommand) {
+  if (len == 0 || line[0] == '>') return false;
+
+  size_t prefixLen = urcPrefixLength(line, len);
+  UrcEntry* entry = urcFind(line, prefixLen);
+  if (entry == NULL || entry->handler == NULL) return false;
+
+  urcSolicited = (activeCommand != NULL && strncmp(activeCommand, line, prefixLen) == 0);
+  entry->handler(line, len, entry->ctx);
+
+  bool consumed = !urcSolicited;
+  urcSolicited = false;
+  return consumed;
+}
+
+bool urcIsSolicited() {
+  return urcSolicited;
+}
+
+bool urcLineMatches(const char* line, size_t len, const char* text, bool prefixOnly) {
+  size_t textLen = strlen(text);
+
+  if (len < textLen) return false;
+  if (!prefixOnly && len != textLen) return false;
+
+  return strncmp(line, text, textLen) == 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file gsmlte_urc.h
+ * @brief Despachador de códigos de resultado no solicitados (URC) del SIM7080G
+ * @version 3.0
+ * 
+ * @details El despachador recibe cada línea que llega por SerialAT, tanto
+ * durante un comando como en reposo, y la entrega al handler registrado para
+ * su prefijo (texto hasta ':'), p. ej. "+CAURC", "+CADATAIND", "+CEREG" o
+ * "+APP PDP". La búsqueda usa una tabla hash de tamaño fijo, por lo que el
+ * costo por línea es O(1). Las líneas que son URC se retiran de la respuesta
+ * del comando pendiente, salvo que el comando haya solicitado ese prefijo
+ * (p. ej. "+CASTATE?" recibe su propia línea "+CASTATE: ...").
+ * 
+ * @example
+ * @code
+ * void onCereg(const char* line, size_t len, void* ctx) {
+ *   Serial.write((const uint8_t*)line, len);
+ * }
+ * 
+ * urcRegisterHandler("+CEREG", onCereg, NULL);
+ * @endcode
+ */
+
+#ifndef GSMLTE_URC_H
+#define GSMLTE_URC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define URC_TABLE_SIZE 16
+#define URC_MAX_PREFIX 16
+
+/**
+ * @brief Handler de una línea URC
+ * @param line Línea recibida (sin CR/LF, no terminada en NUL)
+ * @param len Longitud de la línea
+ * @param ctx Contexto de usuario pasado al registrar
+ */
+typedef void (*UrcHandler)(const char* line, size_t len, void* ctx);
+
+/**
+ * @brief Registra un handler para un prefijo URC
+ * @param prefix Prefijo de la línea hasta ':' (p. ej. "+CEREG"); debe ser estático
+ * @param handler Función a invocar (NULL elimina el handler)
+ * @param ctx Contexto de usuario para el handler
+ * @return true si el handler quedó registrado
+ */
+bool urcRegisterHandler(const char* prefix, UrcHandler handler, void* ctx);
+
+/**
+ * @brief Entrega una línea al despachador
+ * @param line Línea recibida (sin CR/LF)
+ * @param len Longitud de la línea
+ * @param activeCommand Comando AT en curso (NULL si no hay ninguno)
+ * @return true si la línea es un URC y debe retirarse de la respuesta del comando
+ */
+bool urcDispatchLine(const char* line, size_t len, const char* activeCommand);
+
+/**
+ * @brief Indica si la línea que se está despachando fue solicitada
+ * @details Válido solo dentro de un handler: true si el comando en curso
+ * comparte el prefijo de la línea (respuesta a una consulta, no URC).
+ * @return true si la línea responde al comando en curso
+ */
+bool urcIsSolicited();
+
+/**
+ * @brief Compara una línea con un texto
+ * @param line Línea a comparar
+ * @param len Longitud de la línea
+ * @param text Texto a comparar
+ * @param prefixOnly true para comparar solo como prefijo
+ * @return true si la línea coincide
+ */
+bool urcLineMatches(const char* line, size_t len, const char* text, bool prefixOnly);
+
+#endif
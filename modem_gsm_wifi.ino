@@ -10,6 +10,7 @@
  * - Conexión TCP persistente con keep-alive
  * - Envío periódico de datos de prueba
  * - Comandos seriales interactivos para control y diagnóstico
+ * - Loop por eventos: duerme hasta el próximo temporizador o byte recibido
  * - Sistema de logging con información detallada
  * 
  * @section hardware Hardware Requerido
@@ -34,7 +35,9 @@
  * - `test`   - Enviar mensaje de prueba
  * - `diag`   - Ejecutar diagnóstico completo del módem
  * - `restart`- Reiniciar configuración del módem
- * - `fast`   - Activar modo configuración rápida
+ * - `fast`   - Reiniciar con arranque rápido (solo aplica cambios de configuración)
+ * - `stats`  - Mostrar estadísticas de latencia por comando AT
+ * - `mem`    - Mostrar heap y ocupación de los buffers de la biblioteca
  * 
  * @section config Configuración
  * - Velocidad serie: 115200 baud
@@ -47,71 +50,411 @@
  */
 
 #include "gsmlte.h"
+#include "gsmlte_task.h"
+#include "gsmlte_stats.h"
+#include "gsmlte_transport.h"
+#include "gsmlte_frame.h"
+#include "gsmlte_power.h"
+#include "gsmlte_info.h"
+#include "gsmlte_sched.h"
+#include "gsmlte_mem.h"
+
+/** 1 = el módem corre en su propia tarea FreeRTOS (core 0) */
+#define USE_MODEM_TASK 0
+
+/** 1 = agrupar envíos en un solo +CASEND (hasta 1024 bytes o 5 s) */
+#define USE_TCP_BATCH 0
+
+/** 1 = varios +CASEND en vuelo, confirmados con +CAACK (hasta 4096 bytes sin confirmar) */
+#define USE_TCP_WINDOW 0
+
+/** 1 = comprimir con LZ4 los lotes y reenvíos antes de +CASEND */
+#define USE_TCP_COMPRESSION 0
+
+/** 1 = cifrar la conexión persistente con el TLS del módem (TLS_CA_PEM valida al servidor) */
+#define USE_TLS 0
+#define TLS_CA_PEM NULL        ///< PEM de la CA, p. ej. una cadena R"(-----BEGIN CERTIFICATE-----...)"
+
+/** 1 = resolver el servidor con +CDNSGIP una vez y reconectar por IP (caché en NVS) */
+#define USE_DNS_CACHE 0
+
+/** 1 = arranque rápido: reutiliza módem encendido y configuración guardada en NVS */
+#define USE_FAST_BOOT 0
+
+/** 1 = guardar envíos fallidos en flash (LittleFS) y reenviarlos al reconectar */
+#define USE_OFFLINE_STORE 0
+
+/** 1 = enviar por WiFi cuando esté disponible, con respaldo celular (por defecto según el perfil) */
+#define USE_WIFI_TRANSPORT MODEM_PROFILE_WIFI
+#define WIFI_SSID "mi_red"
+#define WIFI_PASSWORD "mi_clave"
+
+/** 1 = enviar la telemetría como registros binarios (gsmlte_frame.h) en lugar de texto */
+#define USE_BINARY_FRAMES 0
+#define SCHEMA_STATUS 1        ///< Campos: señal (con signo)
+
+/** 1 = PSM entre envíos: sin keep-alive, el módem despierta al haber datos que enviar */
+#define USE_POWER_SAVE 0
+
+/** 1 = registro en formato binario (decodificar con logDecode(), gsmlte_log.h) */
+#define USE_BINARY_LOG 0
+
+/** Intervalo de envío de estadísticas AT por TCP en ms (0 = no enviar) */
+#define STATS_UPLOAD_INTERVAL 0
+
+/** Sondeo de la consola cuando no puede despertar el loop (USB CDC o tarea del módem) */
+#define CONSOLE_POLL_INTERVAL 50
+#define CONSOLE_LINE_MAX 32    ///< Comando más largo; el resto de la línea se descarta
+
+#if USE_BINARY_FRAMES && (USE_MODEM_TASK || USE_WIFI_TRANSPORT)
+#error "USE_BINARY_FRAMES solo aplica al envío directo por la conexión persistente"
+#endif
+
+// Compilar con -DGSMLTE_STATIC_ALLOC=1 para no usar memoria dinámica (gsmlte_mem.h)
+#if GSMLTE_STATIC_ALLOC && (USE_OFFLINE_STORE || USE_WIFI_TRANSPORT)
+#error "LittleFS y WiFi reservan memoria dinámica: no se pueden usar con GSMLTE_STATIC_ALLOC"
+#endif
 
-unsigned long lastDataSend = 0;
 const unsigned long DATA_SEND_INTERVAL = 60000;
-String testData = "TEST_DATA_FROM_ESP32";
+int sendTimer = -1;
+char serialLine[CONSOLE_LINE_MAX];
+size_t serialLen = 0;
+char pendingData[32];
+uint32_t sendSeq = 0;          ///< Número del último envío periódico (llega en ctx a onDataSent)
+uint8_t txBuffer[32];
+FrameWriter txFrame;
+
+#if USE_MODEM_TASK
+// La API de gsmlte.h pertenece a la tarea: el loop usa esta copia, actualizada con sus eventos
+bool taskModemStarting = true;
+bool taskTcpConnected = false;
+#endif
+
+/**
+ * Indica si el módem sigue arrancando
+ */
+bool appModemStarting() {
+#if USE_MODEM_TASK
+  return taskModemStarting;
+#else
+  return modemIsStarting();
+#endif
+}
+
+/**
+ * Indica si la conexión TCP persistente está abierta
+ */
+bool appTcpConnected() {
+#if USE_MODEM_TASK
+  return taskTcpConnected;
+#else
+  return tcpConnected;
+#endif
+}
+
+/**
+ * Ejecuta una orden que usa la API del módem en el contexto dueño de ella:
+ * la tarea del módem con USE_MODEM_TASK, si no el loop
+ */
+void runModemCommand(ModemTaskCallback fn) {
+#if USE_MODEM_TASK
+  if (!modemTaskCommand(fn, NULL)) Serial.println("Cola de órdenes del módem llena");
+#else
+  fn(NULL);
+#endif
+}
+
+/**
+ * Reporta el resultado de un envío periódico
+ * @details pendingData y txBuffer ya pueden tener el envío siguiente (lotes,
+ * ventana, cola de la tarea), así que se identifica por su número
+ */
+void onDataSent(bool success, void* ctx) {
+  unsigned long seq = (unsigned long)(uintptr_t)ctx;
+  if (success) {
+    Serial.printf("Datos enviados OK (envío %lu)\r\n", seq);
+  } else {
+    Serial.printf("Error enviando datos (envío %lu)\r\n", seq);
+  }
+}
+
+/**
+ * Muestra los datos recibidos del servidor
+ */
+void onTcpData(const uint8_t* data, size_t len, void* ctx) {
+  Serial.print("Datos recibidos: ");
+  Serial.write(data, len);
+  Serial.println();
+}
+
+/**
+ * Lee una línea del monitor serie sin bloquear
+ * @details La línea queda en serialLine sin espacios al inicio ni al final;
+ * lo que exceda CONSOLE_LINE_MAX se descarta
+ * @return true si se completó una línea
+ */
+bool readSerialLine() {
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\n') {
+      while (serialLen > 0 && isspace((unsigned char)serialLine[serialLen - 1])) serialLen--;
+      serialLine[serialLen] = '\0';
+      serialLen = 0;
+      return true;
+    }
+    if (serialLen == 0 && isspace((unsigned char)c)) continue;
+    if (serialLen < CONSOLE_LINE_MAX - 1) serialLine[serialLen++] = c;
+  }
+  return false;
+}
+
+/**
+ * Envío periódico de datos; si el módem sigue arrancando se reintenta en breve
+ */
+void onSendTimer(void* ctx) {
+  if (appModemStarting()) {
+    schedSet(sendTimer, LONG_DELAY);
+    return;
+  }
+
+  Serial.println("Enviando datos...");
+  
+  snprintf(pendingData, sizeof(pendingData), "ESP32_%lu_%d", (unsigned long)millis(), signalsim0);
+  
+  if (appTcpConnected() || USE_OFFLINE_STORE || USE_WIFI_TRANSPORT) {
+    sendSeq++;
+#if USE_MODEM_TASK
+    modemTaskSend(pendingData, strlen(pendingData), 10000, sendSeq);
+#elif USE_WIFI_TRANSPORT
+    transportSendAsync(pendingData, strlen(pendingData), 10000, onDataSent, (void*)(uintptr_t)sendSeq);
+#elif USE_BINARY_FRAMES
+    frameWriterReset(txFrame);
+    frameBegin(txFrame, SCHEMA_STATUS, millis());
+    framePutInt(txFrame, signalsim0);
+    if (frameEnd(txFrame)) {
+      tcpSendBinaryAsync(txBuffer, txFrame.len, 10000, onDataSent, (void*)(uintptr_t)sendSeq);
+    }
+#else
+    tcpSendPersistentAsync(pendingData, strlen(pendingData), 10000, onDataSent, (void*)(uintptr_t)sendSeq);
+#endif
+  } else {
+    Serial.println("TCP no conectado");
+  }
+}
+
+#if STATS_UPLOAD_INTERVAL
+/**
+ * Envía las estadísticas de comandos AT como JSON por la conexión persistente
+ * @details El JSON supera MODEM_TASK_MAX_PAYLOAD, así que con USE_MODEM_TASK
+ * se arma y se envía dentro de la tarea
+ */
+void sendStats(void* ctx) {
+  static char statsJson[TCP_CASEND_MAX];
+  size_t len = modemStatsFormat(statsJson, sizeof(statsJson));
+  if (len > 0) tcpSendPersistentAsync(statsJson, len, 10000, NULL, NULL);
+}
+
+/**
+ * Envío periódico de estadísticas, solo con la conexión abierta
+ */
+void onStatsTimer(void* ctx) {
+  if (appModemStarting() || !appTcpConnected()) return;
+  runModemCommand(sendStats);
+}
+#endif
 
 void setup() {
   Serial.begin(115200);
   delay(2000);
   
   Serial.println("=== ESP32-S3 Módem LTE/GSM ===");
+#if USE_BINARY_LOG
+  logSetFormat(LOG_FORMAT_BINARY);
+#endif
   
   tcpConfigurePersistent(30000);
+  frameWriterInit(txFrame, txBuffer, sizeof(txBuffer));
+  tcpSetReceiveCallback(onTcpData, NULL);
+#if USE_TCP_BATCH
+  tcpBatchConfigure(1024, 5000);
+#endif
+#if USE_TCP_WINDOW
+  tcpSendWindowConfigure(4096);
+#endif
+#if USE_TCP_COMPRESSION
+  tcpCompressionConfigure(true);
+#endif
+#if USE_TLS
+  tcpTlsConfigure(true, TLS_CA_PEM, NULL, NULL);
+#endif
+#if USE_DNS_CACHE
+  tcpResolverConfigure(true, 0);
+#endif
+#if USE_OFFLINE_STORE
+  tcpOfflineBegin();
+#endif
+#if USE_POWER_SAVE
+  modemPowerConfigure(MODEM_POWER_MODE_PSM, DATA_SEND_INTERVAL);
+#endif
+#if USE_WIFI_TRANSPORT
+  transportWifiBegin(WIFI_SSID, WIFI_PASSWORD, DB_SERVER_IP, TCP_PORT);
+  transportSetReceiveCallback(onTcpData, NULL);
+#endif
+  
+  sendTimer = schedAdd(DATA_SEND_INTERVAL, DATA_SEND_INTERVAL, onSendTimer, NULL);
+#if STATS_UPLOAD_INTERVAL
+  schedAdd(STATS_UPLOAD_INTERVAL, STATS_UPLOAD_INTERVAL, onStatsTimer, NULL);
+#endif
+#if !USE_MODEM_TASK
+  schedWatch(SerialAT);
+#if !ARDUINO_USB_CDC_ON_BOOT
+  schedWatch(Serial);
+#endif
+#endif
   
   Serial.println("Iniciando módem...");
-  setupModem();
+#if USE_MODEM_TASK
+  modemTaskStart(true);
+#elif USE_FAST_BOOT
+  setupModemFastAsync();
+#else
+  setupModemAsync();
+#endif
   
   Serial.println("Sistema iniciado");
 }
 
-void loop() {
-  tcpMaintainPersistent();
-  
-  if (millis() - lastDataSend >= DATA_SEND_INTERVAL) {
-    Serial.println("Enviando datos...");
-    
-    String datos = "ESP32_" + String(millis()) + "_" + String(signalsim0);
-    
-    if (tcpIsPersistentActive()) {
-      if (tcpSendPersistent(datos, 10000)) {
-        Serial.println("Datos enviados OK: " + datos);
-      } else {
-        Serial.println("Error enviando datos");
-      }
-    } else {
-      Serial.println("TCP no conectado");
-    }
-    
-    lastDataSend = millis();
+/**
+ * Muestra el estado de las conexiones (comando status)
+ */
+void printStatus(void* ctx) {
+  Serial.printf("TCP: %s\r\n", tcpConnected ? "OK" : "Fail");
+  modemInfo();
+  modemInfoPrint(Serial);
+  if (tcpBreakerState() != TCP_BREAKER_CLOSED) {
+    Serial.printf("Circuito de reconexión: %s\r\n",
+                  tcpBreakerState() == TCP_BREAKER_OPEN ? "abierto" : "semiabierto");
   }
-  
-  if (Serial.available()) {
-    String cmd = Serial.readStringUntil('\n');
-    cmd.trim();
-    
-    if (cmd == "status") {
-      Serial.println("TCP: " + String(tcpIsPersistentActive() ? "OK" : "Fail"));
-      Serial.println("Señal: " + String(signalsim0));
-      Serial.println("ICCID: " + iccidsim0);
-    } else if (cmd == "send") {
-      lastDataSend = 0;
-    } else if (cmd == "test") {
-      if (tcpIsPersistentActive()) {
-        tcpSendPersistent("TEST_MESSAGE", 5000);
-      }
-    } else if (cmd == "diag") {
-      Serial.println("=== EJECUTANDO DIAGNÓSTICO ===");
-      diagnosticoModem();
-    } else if (cmd == "restart") {
-      Serial.println("=== REINICIANDO MÓDEM ===");
-      setupModem();
-    } else if (cmd == "fast") {
-      Serial.println("=== MODO CONFIGURACIÓN RÁPIDA ===");
+#if USE_WIFI_TRANSPORT
+  Serial.printf("Transporte: %s (rtt celular %lums, WiFi %lums)\r\n",
+                transportActive() == TRANSPORT_WIFI ? "WiFi" : "celular",
+                (unsigned long)transportRtt(TRANSPORT_CELLULAR),
+                (unsigned long)transportRtt(TRANSPORT_WIFI));
+#endif
+#if USE_POWER_SAVE
+  Serial.printf("Energía: %s\r\n", modemPowerStateName(modemPowerState()));
+#endif
+#if USE_OFFLINE_STORE
+  Serial.printf("Pendientes en flash: %lu bytes\r\n", (unsigned long)tcpOfflinePending());
+#endif
+}
+
+/**
+ * Diagnóstico completo del módem (comando diag; bloquea mientras dura)
+ */
+void runDiagnostic(void* ctx) {
+  diagnosticoModem();
+}
+
+/**
+ * Reinicio completo del módem (comando restart)
+ */
+void runRestart(void* ctx) {
+  setupModemAsync();
+}
+
+/**
+ * Reinicio con arranque rápido (comando fast)
+ */
+void runFastRestart(void* ctx) {
+  setupModemFastAsync();
+}
+
+/**
+ * Procesa un comando del monitor serie
+ */
+void handleCommand(const char* cmd) {
+  if (strcmp(cmd, "status") == 0) {
+    runModemCommand(printStatus);
+  } else if (strcmp(cmd, "send") == 0) {
+    schedSet(sendTimer, 0);
+  } else if (strcmp(cmd, "test") == 0) {
+    if (appTcpConnected()) {
+#if USE_MODEM_TASK
+      modemTaskSend("TEST_MESSAGE", 12, 5000, 0);
+#else
+      tcpSendPersistentAsync("TEST_MESSAGE", 12, 5000, NULL, NULL);
+#endif
     }
+  } else if (strcmp(cmd, "diag") == 0) {
+    Serial.println("=== EJECUTANDO DIAGNÓSTICO ===");
+    runModemCommand(runDiagnostic);
+  } else if (strcmp(cmd, "restart") == 0) {
+    Serial.println("=== REINICIANDO MÓDEM ===");
+#if USE_MODEM_TASK
+    taskModemStarting = true;
+#endif
+    runModemCommand(runRestart);
+  } else if (strcmp(cmd, "fast") == 0) {
+    Serial.println("=== MODO CONFIGURACIÓN RÁPIDA ===");
+#if USE_MODEM_TASK
+    taskModemStarting = true;
+#endif
+    runModemCommand(runFastRestart);
+  } else if (strcmp(cmd, "stats") == 0) {
+    modemStatsPrint(Serial);
+    SchedStats sched = schedStats();
+    Serial.printf("Loop: %lu esperas (%lu por eventos), %lus dormido\r\n",
+                  (unsigned long)sched.waits, (unsigned long)sched.eventWakes,
+                  (unsigned long)(sched.sleptMs / 1000));
+  } else if (strcmp(cmd, "mem") == 0) {
+    memPrint(Serial);
   }
-  
-  delay(5000);
 }
 
+#if USE_MODEM_TASK
+/**
+ * Procesa un evento de la tarea del módem
+ */
+void onModemEvent(const ModemTaskEvent& event) {
+  switch (event.type) {
+    case MODEM_EVENT_READY:
+      taskModemStarting = false;
+      break;
+    case MODEM_EVENT_TCP_UP:
+      taskTcpConnected = true;
+      break;
+    case MODEM_EVENT_TCP_DOWN:
+      taskTcpConnected = false;
+      break;
+    case MODEM_EVENT_SEND_DONE:
+      // id 0 = mensaje de prueba (comando test)
+      if (event.id != 0) onDataSent(event.success, (void*)(uintptr_t)event.id);
+      break;
+  }
+}
+#endif
+
+void loop() {
+  if (readSerialLine()) handleCommand(serialLine);
+
+#if USE_MODEM_TASK
+  ModemTaskEvent event;
+  while (modemTaskGetEvent(event, 0)) onModemEvent(event);
+  unsigned long wait = schedRun();
+
+  // Los eventos llegan por la cola de la tarea: se espera en ella y la consola se sondea
+  if (wait > CONSOLE_POLL_INTERVAL) wait = CONSOLE_POLL_INTERVAL;
+  if (modemTaskGetEvent(event, wait)) onModemEvent(event);
+#else
+  modemPoll();
+  unsigned long wait = schedRun();
+  unsigned long modemWait = modemPollTimeout();
+  if (modemWait < wait) wait = modemWait;
+#if ARDUINO_USB_CDC_ON_BOOT
+  // La consola USB CDC no avisa al recibir
+  if (wait > CONSOLE_POLL_INTERVAL) wait = CONSOLE_POLL_INTERVAL;
+#endif
+  schedWait(wait);
+#endif
+}